@@ -17,17 +17,22 @@
 #include "simpleperf.h"
 
 #include <limits.h>
+#include <linux/perf_event.h>
 #include <stdarg.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/ioctl.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
+#include <sys/syscall.h>
 #include <sys/wait.h>
 #include <time.h>
 #include <unistd.h>
 
+#include <algorithm>
 #include <mutex>
 #include <sstream>
+#include <unordered_map>
 #include <android/log.h>
 
 namespace simpleperf {
@@ -507,4 +512,224 @@ void ProfileSession::StopRecording() {
   impl_->StopRecording();
 }
 
+// Converts a group read buffer (nr, time_enabled, time_running, then one value per counter) to
+// counter values indexed by CounterKind. Counters with a group_index of -1 are left untouched.
+// last_values holds the values returned by the previous call, and is updated.
+static void ScaleGroupValues(const uint64_t* read_buf, const int* group_index,
+                             uint64_t* last_values, uint64_t* values) {
+  uint64_t time_enabled = read_buf[1];
+  uint64_t time_running = read_buf[2];
+  for (int i = 0; i < COUNTER_KIND_COUNT; ++i) {
+    if (group_index[i] != -1) {
+      uint64_t value = read_buf[3 + group_index[i]];
+      // When the PMU is shared, the group only runs part of the time. Scale the values up to
+      // estimate what they would be if it had run all the time, like perf does.
+      if (time_running == 0) {
+        value = 0;
+      } else if (time_running < time_enabled) {
+        value = static_cast<uint64_t>(static_cast<double>(value) * time_enabled / time_running);
+      }
+      values[i] = std::max(value, last_values[i]);
+      last_values[i] = values[i];
+    }
+  }
+}
+
+class CounterSessionImpl {
+ public:
+  CounterSessionImpl();
+  ~CounterSessionImpl();
+  bool IsCounterAvailable(CounterKind kind) const {
+    return group_index_[kind] != -1 || (kind == COUNTER_TASK_CLOCK && use_thread_clock_);
+  }
+  void ReadCounters(uint64_t* values);
+  void BeginRegion(const std::string& name);
+  void EndRegion();
+  std::vector<RegionStats> GetRegionStats() const {
+    return stats_;
+  }
+  void ResetRegionStats();
+
+ private:
+  bool OpenCounter(CounterKind kind, uint32_t type, uint64_t config);
+  void CloseCounters();
+  void ReadGroup();
+
+  struct RunningRegion {
+    size_t stats_index;
+    uint64_t start[COUNTER_KIND_COUNT];
+  };
+
+  // Counters are opened in one group led by fds_[0], so they are scheduled
+  // together and read with a single read() call.
+  std::vector<int> fds_;
+  // Position of each counter in the group read buffer, or -1 if not opened.
+  int group_index_[COUNTER_KIND_COUNT];
+  // Set when perf_event_open isn't usable at all.
+  bool use_thread_clock_ = false;
+  std::vector<uint64_t> read_buf_;
+  // Values returned by the last ReadCounters(), to keep scaled values from going backwards.
+  uint64_t last_values_[COUNTER_KIND_COUNT] = {};
+  std::vector<RunningRegion> running_;
+  std::vector<RegionStats> stats_;
+  std::unordered_map<std::string, size_t> stats_index_;
+};
+
+CounterSessionImpl::CounterSessionImpl() {
+  for (int& index : group_index_) {
+    index = -1;
+  }
+  OpenCounter(COUNTER_CPU_CYCLES, PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+  OpenCounter(COUNTER_INSTRUCTIONS, PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+  OpenCounter(COUNTER_CACHE_MISSES, PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+  OpenCounter(COUNTER_BRANCH_MISSES, PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+  OpenCounter(COUNTER_TASK_CLOCK, PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK);
+  if (!fds_.empty()) {
+    // Group read format: nr, time_enabled, time_running, followed by one value per counter.
+    read_buf_.resize(3 + fds_.size());
+    ioctl(fds_[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(fds_[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    // Enabling the group schedules it at once on the running thread, unless the PMU can't
+    // fit it, like when other profilers use pinned counters. Counters that never run read
+    // as zero, so fall back to the thread cpu clock instead.
+    ReadGroup();
+    if (read_buf_[2] == 0) {
+      CloseCounters();
+    }
+  }
+  if (fds_.empty()) {
+    use_thread_clock_ = true;
+  }
+}
+
+CounterSessionImpl::~CounterSessionImpl() {
+  CloseCounters();
+}
+
+void CounterSessionImpl::CloseCounters() {
+  for (int fd : fds_) {
+    close(fd);
+  }
+  fds_.clear();
+  for (int& index : group_index_) {
+    index = -1;
+  }
+}
+
+bool CounterSessionImpl::OpenCounter(CounterKind kind, uint32_t type, uint64_t config) {
+  perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = type;
+  attr.config = config;
+  attr.read_format =
+      PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+  attr.disabled = fds_.empty() ? 1 : 0;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  int group_fd = fds_.empty() ? -1 : fds_[0];
+  int fd = syscall(__NR_perf_event_open, &attr, 0, -1, group_fd, PERF_FLAG_FD_CLOEXEC);
+  if (fd == -1) {
+    return false;
+  }
+  group_index_[kind] = static_cast<int>(fds_.size());
+  fds_.push_back(fd);
+  return true;
+}
+
+void CounterSessionImpl::ReadCounters(uint64_t* values) {
+  for (int i = 0; i < COUNTER_KIND_COUNT; ++i) {
+    values[i] = 0;
+  }
+  if (use_thread_clock_) {
+    timespec ts;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) == 0) {
+      values[COUNTER_TASK_CLOCK] = static_cast<uint64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+    }
+    return;
+  }
+  ReadGroup();
+  ScaleGroupValues(read_buf_.data(), group_index_, last_values_, values);
+}
+
+void CounterSessionImpl::ReadGroup() {
+  size_t size = read_buf_.size() * sizeof(uint64_t);
+  if (TEMP_FAILURE_RETRY(read(fds_[0], read_buf_.data(), size)) != static_cast<ssize_t>(size)) {
+    Abort("failed to read perf counters: %s", strerror(errno));
+  }
+}
+
+void CounterSessionImpl::BeginRegion(const std::string& name) {
+  auto it = stats_index_.find(name);
+  if (it == stats_index_.end()) {
+    it = stats_index_.emplace(name, stats_.size()).first;
+    stats_.emplace_back();
+    stats_.back().name = name;
+  }
+  running_.emplace_back();
+  running_.back().stats_index = it->second;
+  // Read last, so the bookkeeping above isn't counted in the region.
+  ReadCounters(running_.back().start);
+}
+
+void CounterSessionImpl::EndRegion() {
+  uint64_t end[COUNTER_KIND_COUNT];
+  ReadCounters(end);
+  if (running_.empty()) {
+    Abort("EndRegion: no region is running");
+  }
+  const RunningRegion& region = running_.back();
+  RegionStats& stats = stats_[region.stats_index];
+  for (int i = 0; i < COUNTER_KIND_COUNT; ++i) {
+    uint64_t delta = end[i] - region.start[i];
+    stats.total[i] += delta;
+    if (stats.runs == 0 || delta < stats.min[i]) {
+      stats.min[i] = delta;
+    }
+    if (delta > stats.max[i]) {
+      stats.max[i] = delta;
+    }
+  }
+  stats.runs++;
+  running_.pop_back();
+}
+
+void CounterSessionImpl::ResetRegionStats() {
+  if (!running_.empty()) {
+    Abort("ResetRegionStats: %zu regions are running", running_.size());
+  }
+  stats_.clear();
+  stats_index_.clear();
+}
+
+CounterSession::CounterSession() : impl_(new CounterSessionImpl) {}
+
+CounterSession::~CounterSession() {
+  delete impl_;
+}
+
+bool CounterSession::IsCounterAvailable(CounterKind kind) const {
+  return impl_->IsCounterAvailable(kind);
+}
+
+void CounterSession::ReadCounters(uint64_t values[COUNTER_KIND_COUNT]) {
+  impl_->ReadCounters(values);
+}
+
+void CounterSession::BeginRegion(const std::string& name) {
+  impl_->BeginRegion(name);
+}
+
+void CounterSession::EndRegion() {
+  impl_->EndRegion();
+}
+
+std::vector<RegionStats> CounterSession::GetRegionStats() const {
+  return impl_->GetRegionStats();
+}
+
+void CounterSession::ResetRegionStats() {
+  impl_->ResetRegionStats();
+}
+
 }  // namespace simpleperf
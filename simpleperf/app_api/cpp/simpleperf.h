@@ -15,6 +15,7 @@
  */
 
 #pragma once
+#include <stdint.h>
 #include <sys/types.h>
 #include <unistd.h>
 
@@ -157,4 +158,106 @@ class ProfileSession {
   ProfileSessionImpl* impl_;
 };
 
+/**
+ * Counters read by CounterSession.
+ */
+enum CounterKind {
+  COUNTER_CPU_CYCLES,
+  COUNTER_INSTRUCTIONS,
+  COUNTER_CACHE_MISSES,
+  COUNTER_BRANCH_MISSES,
+  // Time the thread spent running on cpu, in nanoseconds.
+  COUNTER_TASK_CLOCK,
+  COUNTER_KIND_COUNT,
+};
+
+/**
+ * Accumulated counter deltas of all runs of a region measured by CounterSession.
+ * Entries for counters that aren't available stay at zero.
+ */
+struct RegionStats {
+  std::string name;
+  uint64_t runs = 0;
+  uint64_t total[COUNTER_KIND_COUNT] = {};
+  uint64_t min[COUNTER_KIND_COUNT] = {};
+  uint64_t max[COUNTER_KIND_COUNT] = {};
+};
+
+/**
+ * CounterSession measures code regions in-process, without a simpleperf binary.
+ * It opens a perf_event_open counter group for the calling thread, and reads
+ * all counters with one read() at the start and the end of each region.
+ * When hardware counters can't be opened (like in VMs, or when
+ * security.perf_harden is set), only COUNTER_TASK_CLOCK is measured, using the
+ * task-clock software event or the thread cpu clock. The same happens when the
+ * PMU can't schedule the counter group at all, like when other profilers use it.
+ * When the group only runs part of the time, counter values are scaled up from
+ * the time it was running, so they are estimates.
+ *
+ * A session measures the thread that created it, and must only be used on
+ * that thread. Regions can nest.
+ *
+ * Example:
+ *   CounterSession session;
+ *   for (int i = 0; i < 100; ++i) {
+ *     CounterSession::ScopedRegion region(session, "decode");
+ *     Decode();
+ *   }
+ *   for (const RegionStats& stats : session.GetRegionStats()) {
+ *     ...
+ *   }
+ */
+class CounterSessionImpl;
+class CounterSession {
+ public:
+  CounterSession();
+  ~CounterSession();
+
+  /**
+   * Return true if `kind` is measured by this session.
+   */
+  bool IsCounterAvailable(CounterKind kind) const;
+
+  /**
+   * Read the current values of all counters. Unavailable counters read as zero.
+   */
+  void ReadCounters(uint64_t values[COUNTER_KIND_COUNT]);
+
+  /**
+   * Start a run of the region named `name`. It must be ended by EndRegion().
+   */
+  void BeginRegion(const std::string& name);
+
+  /**
+   * End the region started last, and add its counter deltas to its stats.
+   */
+  void EndRegion();
+
+  /**
+   * Return stats of all regions, in the order they were first started.
+   */
+  std::vector<RegionStats> GetRegionStats() const;
+
+  /**
+   * Clear stats of all regions. It can't be called while a region is running.
+   */
+  void ResetRegionStats();
+
+  class ScopedRegion {
+   public:
+    ScopedRegion(CounterSession& session, const std::string& name) : session_(session) {
+      session_.BeginRegion(name);
+    }
+    ~ScopedRegion() {
+      session_.EndRegion();
+    }
+
+   private:
+    CounterSession& session_;
+  };
+
+ private:
+  CounterSessionImpl* impl_;
+};
+
 }  // namespace simpleperf
@@ -0,0 +1,19 @@
+LOCAL_PATH := $(call my-dir)
+
+include $(CLEAR_VARS)
+LOCAL_MODULE := simpleperf_counter_scaling_test
+# Includes simpleperf.cpp to reach its static helpers.
+LOCAL_SRC_FILES := counter_scaling_test.cpp
+LOCAL_C_INCLUDES := $(LOCAL_PATH)/..
+LOCAL_CPPFLAGS := -Wall
+LOCAL_LDLIBS := -llog
+include $(BUILD_EXECUTABLE)
+
+include $(CLEAR_VARS)
+LOCAL_MODULE := simpleperf_counter_session_test
+# Includes simpleperf.cpp to route its perf_event_open calls through a fake.
+LOCAL_SRC_FILES := counter_session_test.cpp
+LOCAL_C_INCLUDES := $(LOCAL_PATH)/..
+LOCAL_CPPFLAGS := -Wall
+LOCAL_LDLIBS := -llog
+include $(BUILD_EXECUTABLE)
@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Checks how CounterSession turns group reads into counter values, using
+// made-up time_enabled, time_running and counter values instead of a PMU.
+// simpleperf.cpp is included so that its static helpers can be called.
+
+#include "../simpleperf.cpp"
+
+#include <inttypes.h>
+#include <stdio.h>
+
+namespace simpleperf {
+namespace {
+
+int failures = 0;
+
+#define CHECK_EQ(expected, actual)                                                   \
+  do {                                                                               \
+    uint64_t e = (expected);                                                         \
+    uint64_t a = (actual);                                                           \
+    if (e != a) {                                                                    \
+      fprintf(stderr, "%s:%d: expected %s == %" PRIu64 ", got %" PRIu64 "\n",      \
+              __FILE__, __LINE__, #actual, e, a);                                    \
+      ++failures;                                                                    \
+    }                                                                                \
+  } while (0)
+
+// A group of cycles and instructions, with the other counters not opened.
+const int kGroupIndex[COUNTER_KIND_COUNT] = {0, 1, -1, -1, -1};
+
+struct Reader {
+  uint64_t last_values[COUNTER_KIND_COUNT] = {};
+  uint64_t values[COUNTER_KIND_COUNT] = {};
+
+  void Read(uint64_t time_enabled, uint64_t time_running, uint64_t cycles,
+            uint64_t instructions) {
+    const uint64_t read_buf[] = {2, time_enabled, time_running, cycles, instructions};
+    for (uint64_t& value : values) {
+      value = 0;
+    }
+    ScaleGroupValues(read_buf, kGroupIndex, last_values, values);
+  }
+};
+
+void TestNotScaledWhenAlwaysRunning() {
+  Reader reader;
+  reader.Read(1000, 1000, 5000, 7000);
+  CHECK_EQ(5000, reader.values[COUNTER_CPU_CYCLES]);
+  CHECK_EQ(7000, reader.values[COUNTER_INSTRUCTIONS]);
+  CHECK_EQ(0, reader.values[COUNTER_CACHE_MISSES]);
+}
+
+void TestScaledByTimeRunning() {
+  Reader reader;
+  // Ran a quarter of the time.
+  reader.Read(4000, 1000, 5000, 7000);
+  CHECK_EQ(20000, reader.values[COUNTER_CPU_CYCLES]);
+  CHECK_EQ(28000, reader.values[COUNTER_INSTRUCTIONS]);
+  // Ran two thirds of the time; the result is rounded down.
+  reader.Read(3000, 2000, 20001, 20000);
+  CHECK_EQ(30001, reader.values[COUNTER_CPU_CYCLES]);
+  CHECK_EQ(30000, reader.values[COUNTER_INSTRUCTIONS]);
+}
+
+void TestNeverRunReadsAsLastValue() {
+  Reader reader;
+  reader.Read(1000, 0, 0, 0);
+  CHECK_EQ(0, reader.values[COUNTER_CPU_CYCLES]);
+  reader.Read(2000, 1000, 3000, 3000);
+  CHECK_EQ(6000, reader.values[COUNTER_CPU_CYCLES]);
+  // A read with no running time never goes back to 0.
+  reader.Read(3000, 0, 3000, 3000);
+  CHECK_EQ(6000, reader.values[COUNTER_CPU_CYCLES]);
+}
+
+void TestScaledValuesDoNotGoBackwards() {
+  Reader reader;
+  // The estimate from a short run is higher than the next one.
+  reader.Read(4000, 1000, 1000, 1000);
+  CHECK_EQ(4000, reader.values[COUNTER_CPU_CYCLES]);
+  reader.Read(5000, 4000, 2000, 5000);
+  CHECK_EQ(4000, reader.values[COUNTER_CPU_CYCLES]);
+  CHECK_EQ(6250, reader.values[COUNTER_INSTRUCTIONS]);
+  // So the delta between two reads can't underflow.
+  uint64_t start = reader.values[COUNTER_CPU_CYCLES];
+  reader.Read(6000, 5000, 4500, 6000);
+  CHECK_EQ(1400, reader.values[COUNTER_CPU_CYCLES] - start);
+}
+
+}  // namespace
+}  // namespace simpleperf
+
+int main() {
+  simpleperf::TestNotScaledWhenAlwaysRunning();
+  simpleperf::TestScaledByTimeRunning();
+  simpleperf::TestNeverRunReadsAsLastValue();
+  simpleperf::TestScaledValuesDoNotGoBackwards();
+  if (simpleperf::failures != 0) {
+    fprintf(stderr, "%d checks failed\n", simpleperf::failures);
+    return 1;
+  }
+  printf("PASS\n");
+  return 0;
+}
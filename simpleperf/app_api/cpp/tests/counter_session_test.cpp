@@ -0,0 +1,289 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Checks how CounterSession accumulates regions, measuring real work with the
+// task-clock software event, which doesn't need a PMU. perf_event_open calls
+// made by simpleperf.cpp go through FakeSyscall, so tests can make hardware
+// counters unavailable.
+
+#include <errno.h>
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+
+bool fail_hardware_events = false;
+bool fail_all_events = false;
+int software_events_opened = 0;
+
+long FakeSyscall(long number, perf_event_attr* attr, pid_t pid, int cpu, int group_fd,
+                 unsigned long flags) {
+  if (fail_all_events || (fail_hardware_events && attr->type == PERF_TYPE_HARDWARE)) {
+    errno = ENOENT;
+    return -1;
+  }
+  long fd = syscall(number, attr, pid, cpu, group_fd, flags);
+  if (fd != -1 && attr->type == PERF_TYPE_SOFTWARE) {
+    ++software_events_opened;
+  }
+  return fd;
+}
+
+}  // namespace
+
+#define syscall FakeSyscall
+#include "../simpleperf.cpp"
+#undef syscall
+
+#include <inttypes.h>
+#include <signal.h>
+#include <stdio.h>
+#include <sys/wait.h>
+
+namespace simpleperf {
+namespace {
+
+int failures = 0;
+
+#define CHECK(condition)                                                     \
+  do {                                                                       \
+    if (!(condition)) {                                                      \
+      fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__,     \
+              #condition);                                                   \
+      ++failures;                                                            \
+    }                                                                        \
+  } while (0)
+
+#define CHECK_EQ(expected, actual)                                                   \
+  do {                                                                               \
+    uint64_t e = (expected);                                                         \
+    uint64_t a = (actual);                                                           \
+    if (e != a) {                                                                    \
+      fprintf(stderr, "%s:%d: expected %s == %" PRIu64 ", got %" PRIu64 "\n",      \
+              __FILE__, __LINE__, #actual, e, a);                                    \
+      ++failures;                                                                    \
+    }                                                                                \
+  } while (0)
+
+const uint64_t kSpinNs = 2000000;
+
+uint64_t ThreadCpuTimeNs() {
+  timespec ts;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return static_cast<uint64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+// Runs on cpu for kSpinNs of thread cpu time.
+void Spin() {
+  uint64_t end = ThreadCpuTimeNs() + kSpinNs;
+  while (ThreadCpuTimeNs() < end) {
+  }
+}
+
+const RegionStats* FindRegion(const std::vector<RegionStats>& stats, const char* name) {
+  for (const RegionStats& region : stats) {
+    if (region.name == name) {
+      return &region;
+    }
+  }
+  return nullptr;
+}
+
+// Runs `fn` in a child process, and returns true if it was killed by abort().
+template <typename Fn>
+bool Aborts(Fn fn) {
+  pid_t pid = fork();
+  if (pid == 0) {
+    fn();
+    _exit(0);
+  }
+  int status;
+  if (pid == -1 || TEMP_FAILURE_RETRY(waitpid(pid, &status, 0)) != pid) {
+    return false;
+  }
+  return WIFSIGNALED(status) && WTERMSIG(status) == SIGABRT;
+}
+
+void TestRunsAggregatePerRegion() {
+  CounterSession session;
+  CHECK(session.IsCounterAvailable(COUNTER_TASK_CLOCK));
+  for (int i = 0; i < 3; ++i) {
+    CounterSession::ScopedRegion region(session, "a");
+    Spin();
+  }
+  for (int i = 0; i < 2; ++i) {
+    CounterSession::ScopedRegion region(session, "b");
+    Spin();
+  }
+  {
+    CounterSession::ScopedRegion region(session, "a");
+    Spin();
+  }
+  std::vector<RegionStats> stats = session.GetRegionStats();
+  CHECK_EQ(2, stats.size());
+  if (stats.size() != 2) {
+    return;
+  }
+  // Regions are listed in the order they were first started.
+  CHECK(stats[0].name == "a");
+  CHECK(stats[1].name == "b");
+  CHECK_EQ(4, stats[0].runs);
+  CHECK_EQ(2, stats[1].runs);
+  for (const RegionStats& region : stats) {
+    const uint64_t min = region.min[COUNTER_TASK_CLOCK];
+    const uint64_t max = region.max[COUNTER_TASK_CLOCK];
+    const uint64_t total = region.total[COUNTER_TASK_CLOCK];
+    // Allow for the task clock being a bit coarser than the thread cpu clock.
+    CHECK(min >= kSpinNs / 2);
+    CHECK(min <= max);
+    CHECK(total >= min * region.runs);
+    CHECK(total <= max * region.runs);
+    for (int i = 0; i < COUNTER_KIND_COUNT; ++i) {
+      if (!session.IsCounterAvailable(static_cast<CounterKind>(i))) {
+        CHECK_EQ(0, region.total[i]);
+      }
+    }
+  }
+
+  session.ResetRegionStats();
+  CHECK(session.GetRegionStats().empty());
+}
+
+void TestNestedRegions() {
+  CounterSession session;
+  session.BeginRegion("outer");
+  Spin();
+  session.BeginRegion("inner");
+  Spin();
+  // Ends the region started last.
+  session.EndRegion();
+  Spin();
+  session.EndRegion();
+
+  std::vector<RegionStats> stats = session.GetRegionStats();
+  const RegionStats* outer = FindRegion(stats, "outer");
+  const RegionStats* inner = FindRegion(stats, "inner");
+  CHECK(outer != nullptr && inner != nullptr);
+  if (outer == nullptr || inner == nullptr) {
+    return;
+  }
+  CHECK_EQ(1, outer->runs);
+  CHECK_EQ(1, inner->runs);
+  // The outer region includes the inner one and two more spins.
+  CHECK(outer->total[COUNTER_TASK_CLOCK] >= inner->total[COUNTER_TASK_CLOCK] + kSpinNs);
+}
+
+void TestMismatchedEndRegionAborts() {
+  CHECK(Aborts([]() {
+    CounterSession session;
+    session.EndRegion();
+  }));
+  CHECK(Aborts([]() {
+    CounterSession session;
+    session.BeginRegion("a");
+    session.EndRegion();
+    session.EndRegion();
+  }));
+  CHECK(Aborts([]() {
+    CounterSession session;
+    session.BeginRegion("a");
+    session.ResetRegionStats();
+  }));
+}
+
+void TestFallsBackToTaskClockEvent() {
+  fail_hardware_events = true;
+  software_events_opened = 0;
+  {
+    CounterSession session;
+    // Only the task-clock software event is opened.
+    CHECK_EQ(1, software_events_opened);
+    CHECK(session.IsCounterAvailable(COUNTER_TASK_CLOCK));
+    CHECK(!session.IsCounterAvailable(COUNTER_CPU_CYCLES));
+    CHECK(!session.IsCounterAvailable(COUNTER_INSTRUCTIONS));
+    CHECK(!session.IsCounterAvailable(COUNTER_CACHE_MISSES));
+    CHECK(!session.IsCounterAvailable(COUNTER_BRANCH_MISSES));
+    {
+      CounterSession::ScopedRegion region(session, "a");
+      Spin();
+    }
+    std::vector<RegionStats> stats = session.GetRegionStats();
+    CHECK_EQ(1, stats.size());
+    if (!stats.empty()) {
+      CHECK(stats[0].total[COUNTER_TASK_CLOCK] >= kSpinNs / 2);
+      CHECK_EQ(0, stats[0].total[COUNTER_CPU_CYCLES]);
+    }
+  }
+  fail_hardware_events = false;
+}
+
+void TestFallsBackToThreadCpuClock() {
+  fail_all_events = true;
+  {
+    CounterSession session;
+    CHECK(session.IsCounterAvailable(COUNTER_TASK_CLOCK));
+    CHECK(!session.IsCounterAvailable(COUNTER_CPU_CYCLES));
+    {
+      CounterSession::ScopedRegion region(session, "a");
+      Spin();
+    }
+    std::vector<RegionStats> stats = session.GetRegionStats();
+    CHECK_EQ(1, stats.size());
+    if (!stats.empty()) {
+      CHECK(stats[0].total[COUNTER_TASK_CLOCK] >= kSpinNs);
+    }
+  }
+  fail_all_events = false;
+}
+
+// Returns false if this process may not open a task-clock event for itself.
+bool CanOpenTaskClock() {
+  perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = PERF_TYPE_SOFTWARE;
+  attr.config = PERF_COUNT_SW_TASK_CLOCK;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  int fd = syscall(__NR_perf_event_open, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC);
+  if (fd == -1) {
+    return errno != EACCES;
+  }
+  close(fd);
+  return true;
+}
+
+}  // namespace
+}  // namespace simpleperf
+
+int main() {
+  if (!simpleperf::CanOpenTaskClock()) {
+    printf("SKIPPED: perf_event_open isn't allowed\n");
+    return 0;
+  }
+  simpleperf::TestRunsAggregatePerRegion();
+  simpleperf::TestNestedRegions();
+  simpleperf::TestMismatchedEndRegionAborts();
+  simpleperf::TestFallsBackToTaskClockEvent();
+  simpleperf::TestFallsBackToThreadCpuClock();
+  if (simpleperf::failures != 0) {
+    fprintf(stderr, "%d checks failed\n", simpleperf::failures);
+    return 1;
+  }
+  printf("PASS\n");
+  return 0;
+}
@@ -27,6 +27,18 @@
  */
 
 /* ChangeLog for this library:
+ *
+ * NDK r22: Add android_getCpuTopology() and android_readCpuTopology().
+ *
+ *          Add x86 FMA, F16C, BMI1, BMI2 and AVX512 features, and ARM64
+ *          ATOMICS, FP16, DOTPROD, SVE, SVE2, I8MM and BF16 features.
+ *
+ *          Add android_hasCpuFeatures() and android_selectCpuFunction().
+ *
+ *          Only read /proc/cpuinfo on 32-bit ARM.
+ *
+ *          Only report x86 AVX and AVX2 when XCR0 shows the kernel saves
+ *          the YMM registers.
  *
  * NDK r10e?: Add MIPS MSA feature.
  *
@@ -66,6 +78,7 @@
 #include <dlfcn.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <limits.h>
 #include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -79,6 +92,9 @@ static  AndroidCpuFamily   g_cpuFamily;
 static  uint64_t           g_cpuFeatures;
 static  int                g_cpuCount;
 
+static  pthread_once_t     g_topologyOnce;
+static  AndroidCpuTopology g_cpuTopology;
+
 #ifdef __arm__
 static  uint32_t           g_cpuIdArm;
 #endif
@@ -95,7 +111,7 @@ static const int android_cpufeatures_debug = 0;
 #ifdef __i386__
 static __inline__ void x86_cpuid(int func, int values[4])
 {
-    int a, b, c, d;
+    int a, b, c = 0, d;  /* c is the sub-leaf, always 0 here */
     /* We need to preserve ebx since we're compiling PIC code */
     /* this means we can't use "=b" for the second output register */
     __asm__ __volatile__ ( \
@@ -103,7 +119,7 @@ static __inline__ void x86_cpuid(int func, int values[4])
       "cpuid\n" \
       "mov %%ebx, %1\n"
       "pop %%ebx\n"
-      : "=a" (a), "=r" (b), "=c" (c), "=d" (d) \
+      : "=a" (a), "=r" (b), "+c" (c), "=d" (d) \
       : "a" (func) \
     );
     values[0] = a;
@@ -114,7 +130,7 @@ static __inline__ void x86_cpuid(int func, int values[4])
 #elif defined(__x86_64__)
 static __inline__ void x86_cpuid(int func, int values[4])
 {
-    int64_t a, b, c, d;
+    int64_t a, b, c = 0, d;  /* c is the sub-leaf, always 0 here */
     /* We need to preserve ebx since we're compiling PIC code */
     /* this means we can't use "=b" for the second output register */
     __asm__ __volatile__ ( \
@@ -122,7 +138,7 @@ static __inline__ void x86_cpuid(int func, int values[4])
       "cpuid\n" \
       "mov %%rbx, %1\n"
       "pop %%rbx\n"
-      : "=a" (a), "=r" (b), "=c" (c), "=d" (d) \
+      : "=a" (a), "=r" (b), "+c" (c), "=d" (d) \
       : "a" (func) \
     );
     values[0] = a;
@@ -132,6 +148,114 @@ static __inline__ void x86_cpuid(int func, int values[4])
 }
 #endif
 
+#if defined(__i386__) || defined(__x86_64__)
+/* Return the XCR0 register, which tells which register sets the kernel
+ * saves on context switches. Only valid when CPUID reports OSXSAVE.
+ */
+static __inline__ uint32_t x86_xgetbv0(void)
+{
+    uint32_t a, d;
+    __asm__ __volatile__ ("xgetbv" : "=a" (a), "=d" (d) : "c" (0));
+    return a;
+}
+
+/* According to http://en.wikipedia.org/wiki/CPUID */
+#define VENDOR_INTEL_b  0x756e6547
+#define VENDOR_INTEL_c  0x6c65746e
+#define VENDOR_INTEL_d  0x49656e69
+
+/* Return the ANDROID_CPU_X86_FEATURE_XXX flags for the CPUID leaves 0, 1 and
+ * 7 (sub-leaf 0) given as { eax, ebx, ecx, edx } in |leaf0|, |leaf1| and
+ * |leaf7|, and the XCR0 register |xcr0|, which must be 0 when leaf 1 does not
+ * report OSXSAVE.
+ */
+static uint64_t
+x86_features_from_cpuid(const int leaf0[4], const int leaf1[4],
+                        const int leaf7[4], uint32_t xcr0)
+{
+    uint64_t features = 0;
+    int vendorIsIntel = (leaf0[1] == VENDOR_INTEL_b &&
+                         leaf0[2] == VENDOR_INTEL_c &&
+                         leaf0[3] == VENDOR_INTEL_d);
+
+    if ((leaf1[2] & (1 << 9)) != 0) {
+        features |= ANDROID_CPU_X86_FEATURE_SSSE3;
+    }
+    if ((leaf1[2] & (1 << 23)) != 0) {
+        features |= ANDROID_CPU_X86_FEATURE_POPCNT;
+    }
+    if ((leaf1[2] & (1 << 19)) != 0) {
+        features |= ANDROID_CPU_X86_FEATURE_SSE4_1;
+    }
+    if ((leaf1[2] & (1 << 20)) != 0) {
+        features |= ANDROID_CPU_X86_FEATURE_SSE4_2;
+    }
+    if (vendorIsIntel && (leaf1[2] & (1 << 22)) != 0) {
+        features |= ANDROID_CPU_X86_FEATURE_MOVBE;
+    }
+    if ((leaf1[2] & (1 << 25)) != 0) {
+        features |= ANDROID_CPU_X86_FEATURE_AES_NI;
+    }
+    if ((leaf1[2] & (1 << 30)) != 0) {
+        features |= ANDROID_CPU_X86_FEATURE_RDRAND;
+    }
+    if ((leaf7[1] & (1 << 29)) != 0) {
+        features |= ANDROID_CPU_X86_FEATURE_SHA_NI;
+    }
+    if ((leaf7[1] & (1 << 3)) != 0) {
+        features |= ANDROID_CPU_X86_FEATURE_BMI1;
+    }
+    if ((leaf7[1] & (1 << 8)) != 0) {
+        features |= ANDROID_CPU_X86_FEATURE_BMI2;
+    }
+
+    /* Features that use the YMM registers are only usable if the kernel
+     * saves them (XCR0 bits 1 and 2), and the AVX-512 ones also need the
+     * opmask and ZMM state (bits 5 to 7).
+     */
+    int osAvx = (xcr0 & 0x6) == 0x6;
+    int osAvx512 = osAvx && (xcr0 & 0xe0) == 0xe0;
+    if (!osAvx) {
+        return features;
+    }
+
+    if ((leaf1[2] & (1 << 28)) != 0) {
+        features |= ANDROID_CPU_X86_FEATURE_AVX;
+    }
+    if ((leaf1[2] & (1 << 12)) != 0) {
+        features |= ANDROID_CPU_X86_FEATURE_FMA;
+    }
+    if ((leaf1[2] & (1 << 29)) != 0) {
+        features |= ANDROID_CPU_X86_FEATURE_F16C;
+    }
+    if ((leaf7[1] & (1 << 5)) != 0) {
+        features |= ANDROID_CPU_X86_FEATURE_AVX2;
+    }
+    if (osAvx512) {
+        if ((leaf7[1] & (1 << 16)) != 0) {
+            features |= ANDROID_CPU_X86_FEATURE_AVX512F;
+        }
+        if ((leaf7[1] & (1 << 28)) != 0) {
+            features |= ANDROID_CPU_X86_FEATURE_AVX512CD;
+        }
+        if ((leaf7[1] & (1 << 17)) != 0) {
+            features |= ANDROID_CPU_X86_FEATURE_AVX512DQ;
+        }
+        if ((leaf7[1] & (1 << 30)) != 0) {
+            features |= ANDROID_CPU_X86_FEATURE_AVX512BW;
+        }
+        if ((leaf7[1] & (1U << 31)) != 0) {
+            features |= ANDROID_CPU_X86_FEATURE_AVX512VL;
+        }
+        if ((leaf7[2] & (1 << 11)) != 0) {
+            features |= ANDROID_CPU_X86_FEATURE_AVX512VNNI;
+        }
+    }
+    return features;
+}
+#endif
+
+#ifdef __arm__
 /* Get the size of a file by reading it until the end. This is needed
  * because files under /proc do not always return a valid size when
  * using fseek(0, SEEK_END) + ftell(). Nor can they be mmap()-ed.
@@ -165,6 +289,7 @@ get_file_size(const char* pathname)
     close(fd);
     return result;
 }
+#endif /* __arm__ */
 
 /* Read the content of /proc/cpuinfo into a user-provided buffer.
  * Return the length of the data, or -1 on error. Does *not*
@@ -292,7 +417,7 @@ has_list_item(const char* list, const char* item)
  * than 'limit'. Return the value into '*result'.
  *
  * NOTE: Does not skip over leading spaces, or deal with sign characters.
- * NOTE: Ignores overflows.
+ * NOTE: Values that do not fit in an int are a bad format.
  *
  * The function returns NULL in case of error (bad format), or the new
  * position after the decimal number in case of success (which will always
@@ -315,6 +440,8 @@ parse_number(const char* input, const char* limit, int base, int* result)
         }
         if (d >= base)
           break;
+        if (val > (INT_MAX - d) / base)
+          return NULL;
         val = val*base + d;
         p++;
     }
@@ -343,20 +470,24 @@ parse_hexadecimal(const char* input, const char* limit, int* result)
  * from sysfs on Linux. See http://www.kernel.org/doc/Documentation/cputopology.txt
  *
  * For now, we don't expect more than 32 cores on mobile devices, so keep
- * everything simple.
+ * everything simple. 'truncated' is set when the list names a CPU that
+ * does not fit in 'mask'.
  */
 typedef struct {
     uint32_t mask;
+    int      truncated;
 } CpuList;
 
 static __inline__ void
 cpulist_init(CpuList* list) {
     list->mask = 0;
+    list->truncated = 0;
 }
 
 static __inline__ void
 cpulist_and(CpuList* list1, CpuList* list2) {
     list1->mask &= list2->mask;
+    list1->truncated &= list2->truncated;
 }
 
 static __inline__ void
@@ -417,10 +548,15 @@ cpulist_parse(CpuList* list, const char* line, int line_len)
                 goto BAD_FORMAT;
         }
 
-        /* Set bits CPU list bits */
-        for (val = start_value; val <= end_value; val++) {
+        /* Set bits CPU list bits. Reversed ranges are ignored. Stop at the
+         * last index a CpuList can hold, so that huge ranges cannot loop for
+         * long.
+         */
+        for (val = start_value; val <= end_value && val < 32; val++) {
             cpulist_set(list, val);
         }
+        if (start_value <= end_value && end_value >= 32)
+            list->truncated = 1;
 
         /* Jump to next item */
         p = q;
@@ -436,7 +572,7 @@ BAD_FORMAT:
 static void
 cpulist_read_from(CpuList* list, const char* filename)
 {
-    char   file[64];
+    char   file[256];
     int    filelen;
 
     cpulist_init(list);
@@ -447,6 +583,14 @@ cpulist_read_from(CpuList* list, const char* filename)
         return;
     }
 
+    /* A sparse list may not fit. Drop the item that was cut, which could
+     * otherwise read as a different CPU (e.g. '16' for '163').
+     */
+    if (filelen == (int)sizeof file) {
+        while (filelen > 0 && file[filelen-1] != ',')
+            filelen--;
+    }
+
     cpulist_parse(list, file, filelen);
 }
 #if defined(__aarch64__)
@@ -458,6 +602,14 @@ cpulist_read_from(CpuList* list, const char* filename)
 #define HWCAP_SHA1              (1 << 5)
 #define HWCAP_SHA2              (1 << 6)
 #define HWCAP_CRC32             (1 << 7)
+#define HWCAP_ATOMICS           (1 << 8)
+#define HWCAP_FPHP              (1 << 9)
+#define HWCAP_ASIMDHP           (1 << 10)
+#define HWCAP_ASIMDDP           (1 << 20)
+#define HWCAP_SVE               (1 << 22)
+#define HWCAP2_SVE2             (1 << 1)
+#define HWCAP2_I8MM             (1 << 13)
+#define HWCAP2_BF16             (1 << 14)
 #endif
 
 #if defined(__arm__)
@@ -652,6 +804,177 @@ get_cpu_count(void)
     return cpulist_count(cpus_present);
 }
 
+/* Read a small sysfs file into 'buffer', strip its trailing newline and
+ * zero-terminate it. Return the length of the data, or -1 on error.
+ */
+static int
+read_sysfs_line(const char* pathname, char* buffer, size_t buffsize)
+{
+    int len = read_file(pathname, buffer, buffsize - 1);
+    if (len < 0)
+        return -1;
+
+    while (len > 0 && (buffer[len-1] == '\n' || buffer[len-1] == ' '))
+        len--;
+    buffer[len] = '\0';
+    return len;
+}
+
+/* Read a (possibly negative) decimal integer from a sysfs file.
+ * Return 1 on success, 0 otherwise.
+ */
+static int
+read_sysfs_int(const char* pathname, int* result)
+{
+    char buffer[32];
+    const char* p = buffer;
+    int len, negative = 0;
+
+    len = read_sysfs_line(pathname, buffer, sizeof buffer);
+    if (len <= 0)
+        return 0;
+
+    if (*p == '-') {
+        negative = 1;
+        p++;
+    }
+    if (parse_decimal(p, buffer + len, result) == NULL)
+        return 0;
+    if (negative)
+        *result = -*result;
+    return 1;
+}
+
+/* Read a cache size such as "32K" or "2M" from a sysfs file and return it
+ * in bytes, or 0 if it cannot be read.
+ */
+static uint32_t
+read_sysfs_size(const char* pathname)
+{
+    char buffer[32];
+    const char* p;
+    int len, val;
+
+    len = read_sysfs_line(pathname, buffer, sizeof buffer);
+    if (len <= 0)
+        return 0;
+
+    p = parse_decimal(buffer, buffer + len, &val);
+    if (p == NULL)
+        return 0;
+    if (p < buffer + len) {
+        switch (*p) {
+        case 'K': return (uint32_t)val << 10;
+        case 'M': return (uint32_t)val << 20;
+        case 'G': return (uint32_t)val << 30;
+        }
+    }
+    return (uint32_t)val;
+}
+
+/* Read a CPU list from a cpufreq file such as 'related_cpus', which uses
+ * spaces instead of commas between items.
+ */
+static void
+cpulist_read_spaced_from(CpuList* list, const char* filename)
+{
+    char  file[256];
+    int   filelen, n;
+
+    cpulist_init(list);
+    filelen = read_sysfs_line(filename, file, sizeof file);
+    if (filelen <= 0)
+        return;
+
+    /* As in cpulist_read_from(), drop an item cut by a full buffer. */
+    if (filelen == (int)sizeof file - 1) {
+        while (filelen > 0 && file[filelen-1] != ' ')
+            filelen--;
+    }
+
+    for (n = 0; n < filelen; n++) {
+        if (file[n] == ' ')
+            file[n] = ',';
+    }
+    cpulist_parse(list, file, filelen);
+}
+
+/* Fill the description of a single core from its cpuN/ sysfs directory.
+ * Return the mask of cores in its frequency domain, or 0 if unknown.
+ */
+static uint32_t
+read_cpu_core(const char* cpu_dir, AndroidCpuCore* core)
+{
+    char     path[256];
+    CpuList  list[1];
+    int      val, index;
+
+    core->package_id = -1;
+    core->core_id = -1;
+
+    snprintf(path, sizeof path, "%s/topology/physical_package_id", cpu_dir);
+    if (read_sysfs_int(path, &val))
+        core->package_id = val;
+
+    snprintf(path, sizeof path, "%s/topology/core_id", cpu_dir);
+    if (read_sysfs_int(path, &val))
+        core->core_id = val;
+
+    snprintf(path, sizeof path, "%s/topology/thread_siblings_list", cpu_dir);
+    cpulist_read_from(list, path);
+    core->thread_siblings = list->mask;
+    if (core->thread_siblings == 0)
+        core->thread_siblings = 1U << core->cpu;
+
+    snprintf(path, sizeof path, "%s/cpufreq/cpuinfo_max_freq", cpu_dir);
+    if (read_sysfs_int(path, &val) && val > 0)
+        core->max_freq_khz = (uint32_t)val;
+
+    for (index = 0; index < ANDROID_CPU_TOPOLOGY_MAX_CACHES; index++) {
+        AndroidCpuCache* cache = &core->caches[index];
+        char type[32];
+
+        snprintf(path, sizeof path, "%s/cache/index%d/level", cpu_dir, index);
+        if (!read_sysfs_int(path, &val))
+            break;
+        cache->level = val;
+
+        snprintf(path, sizeof path, "%s/cache/index%d/type", cpu_dir, index);
+        if (read_sysfs_line(path, type, sizeof type) > 0) {
+            if (!strcmp(type, "Data"))
+                cache->type = ANDROID_CPU_CACHE_TYPE_DATA;
+            else if (!strcmp(type, "Instruction"))
+                cache->type = ANDROID_CPU_CACHE_TYPE_INSTRUCTION;
+            else if (!strcmp(type, "Unified"))
+                cache->type = ANDROID_CPU_CACHE_TYPE_UNIFIED;
+        }
+
+        snprintf(path, sizeof path, "%s/cache/index%d/size", cpu_dir, index);
+        cache->size = read_sysfs_size(path);
+
+        snprintf(path, sizeof path, "%s/cache/index%d/coherency_line_size",
+                 cpu_dir, index);
+        if (read_sysfs_int(path, &val) && val > 0)
+            cache->line_size = (uint32_t)val;
+
+        snprintf(path, sizeof path, "%s/cache/index%d/ways_of_associativity",
+                 cpu_dir, index);
+        if (read_sysfs_int(path, &val) && val > 0)
+            cache->ways = (uint32_t)val;
+
+        snprintf(path, sizeof path, "%s/cache/index%d/shared_cpu_list",
+                 cpu_dir, index);
+        cpulist_read_from(list, path);
+        cache->shared_cpus = list->mask;
+
+        core->cache_count++;
+    }
+
+    snprintf(path, sizeof path, "%s/cpufreq/related_cpus", cpu_dir);
+    cpulist_read_spaced_from(list, path);
+    return list->mask;
+}
+
 static void
 android_cpuInitFamily(void)
 {
@@ -676,8 +999,10 @@ android_cpuInitFamily(void)
 static void
 android_cpuInit(void)
 {
+#ifdef __arm__
     char* cpuinfo = NULL;
     int   cpuinfo_len;
+#endif
 
     android_cpuInitFamily();
 
@@ -685,6 +1010,19 @@ android_cpuInit(void)
     g_cpuCount    = 1;
     g_inited      = 1;
 
+    /* Count the CPU cores, the value may be 0 for single-core CPUs */
+    g_cpuCount = get_cpu_count();
+    if (g_cpuCount == 0) {
+        g_cpuCount = 1;
+    }
+
+    D("found cpuCount = %d\n", g_cpuCount);
+
+#ifdef __arm__
+    /* Only 32-bit ARM needs /proc/cpuinfo, other architectures get their
+     * features from the ELF hwcaps or the cpuid instruction, which are much
+     * cheaper to query and also work in sandboxed processes.
+     */
     cpuinfo_len = get_file_size("/proc/cpuinfo");
     if (cpuinfo_len < 0) {
       D("cpuinfo_len cannot be computed!");
@@ -704,15 +1042,6 @@ android_cpuInit(void)
         return;
     }
 
-    /* Count the CPU cores, the value may be 0 for single-core CPUs */
-    g_cpuCount = get_cpu_count();
-    if (g_cpuCount == 0) {
-        g_cpuCount = 1;
-    }
-
-    D("found cpuCount = %d\n", g_cpuCount);
-
-#ifdef __arm__
     {
         /* Extract architecture from the "CPU Architecture" field.
          * The list is well-known, unlike the the output of
@@ -991,58 +1320,36 @@ android_cpuInit(void)
                 g_cpuFeatures |= ANDROID_CPU_ARM64_FEATURE_SHA2;
             if (has_crc32)
                 g_cpuFeatures |= ANDROID_CPU_ARM64_FEATURE_CRC32;
+            if (hwcaps & HWCAP_ATOMICS)
+                g_cpuFeatures |= ANDROID_CPU_ARM64_FEATURE_ATOMICS;
+            if ((hwcaps & HWCAP_FPHP) && (hwcaps & HWCAP_ASIMDHP))
+                g_cpuFeatures |= ANDROID_CPU_ARM64_FEATURE_FP16;
+            if (hwcaps & HWCAP_ASIMDDP)
+                g_cpuFeatures |= ANDROID_CPU_ARM64_FEATURE_DOTPROD;
+            if (hwcaps & HWCAP_SVE)
+                g_cpuFeatures |= ANDROID_CPU_ARM64_FEATURE_SVE;
         }
+
+        uint32_t hwcaps2 = get_elf_hwcap_from_getauxval(AT_HWCAP2);
+        if (hwcaps2 & HWCAP2_SVE2)
+            g_cpuFeatures |= ANDROID_CPU_ARM64_FEATURE_SVE2;
+        if (hwcaps2 & HWCAP2_I8MM)
+            g_cpuFeatures |= ANDROID_CPU_ARM64_FEATURE_I8MM;
+        if (hwcaps2 & HWCAP2_BF16)
+            g_cpuFeatures |= ANDROID_CPU_ARM64_FEATURE_BF16;
     }
 #endif /* __aarch64__ */
 
 #if defined(__i386__) || defined(__x86_64__)
-    int regs[4];
-
-/* According to http://en.wikipedia.org/wiki/CPUID */
-#define VENDOR_INTEL_b  0x756e6547
-#define VENDOR_INTEL_c  0x6c65746e
-#define VENDOR_INTEL_d  0x49656e69
-
-    x86_cpuid(0, regs);
-    int vendorIsIntel = (regs[1] == VENDOR_INTEL_b &&
-                         regs[2] == VENDOR_INTEL_c &&
-                         regs[3] == VENDOR_INTEL_d);
-
-    x86_cpuid(1, regs);
-    if ((regs[2] & (1 << 9)) != 0) {
-        g_cpuFeatures |= ANDROID_CPU_X86_FEATURE_SSSE3;
-    }
-    if ((regs[2] & (1 << 23)) != 0) {
-        g_cpuFeatures |= ANDROID_CPU_X86_FEATURE_POPCNT;
-    }
-    if ((regs[2] & (1 << 19)) != 0) {
-        g_cpuFeatures |= ANDROID_CPU_X86_FEATURE_SSE4_1;
-    }
-    if ((regs[2] & (1 << 20)) != 0) {
-        g_cpuFeatures |= ANDROID_CPU_X86_FEATURE_SSE4_2;
-    }
-    if (vendorIsIntel && (regs[2] & (1 << 22)) != 0) {
-        g_cpuFeatures |= ANDROID_CPU_X86_FEATURE_MOVBE;
-    }
-    if ((regs[2] & (1 << 25)) != 0) {
-        g_cpuFeatures |= ANDROID_CPU_X86_FEATURE_AES_NI;
-    }
-    if ((regs[2] & (1 << 28)) != 0) {
-        g_cpuFeatures |= ANDROID_CPU_X86_FEATURE_AVX;
+    int leaf0[4], leaf1[4];
+    int leaf7[4] = { 0, 0, 0, 0 };
+    x86_cpuid(0, leaf0);
+    x86_cpuid(1, leaf1);
+    if (leaf0[0] >= 7) {
+        x86_cpuid(7, leaf7);
     }
-    if ((regs[2] & (1 << 30)) != 0) {
-        g_cpuFeatures |= ANDROID_CPU_X86_FEATURE_RDRAND;
-    }
-
-    x86_cpuid(7, regs);
-    if ((regs[1] & (1 << 5)) != 0) {
-        g_cpuFeatures |= ANDROID_CPU_X86_FEATURE_AVX2;
-    }
-    if ((regs[1] & (1 << 29)) != 0) {
-        g_cpuFeatures |= ANDROID_CPU_X86_FEATURE_SHA_NI;
-    }
-
-
+    uint32_t xcr0 = ((leaf1[2] & (1 << 27)) != 0) ? x86_xgetbv0() : 0;
+    g_cpuFeatures |= x86_features_from_cpuid(leaf0, leaf1, leaf7, xcr0);
 #endif
 #if defined( __mips__)
     {   /* MIPS and MIPS64 */
@@ -1060,7 +1367,9 @@ android_cpuInit(void)
     }
 #endif /* __mips__ */
 
+#ifdef __arm__
     free(cpuinfo);
+#endif
 }
 
 
@@ -1087,6 +1396,158 @@ android_getCpuCount(void)
     return g_cpuCount;
 }
 
+
+int
+android_hasCpuFeatures(uint64_t features)
+{
+    pthread_once(&g_once, android_cpuInit);
+    return (g_cpuFeatures & features) == features;
+}
+
+
+AndroidCpuFunction
+android_selectCpuFunction(const AndroidCpuFunctionVariant* variants, int count)
+{
+    int n;
+
+    pthread_once(&g_once, android_cpuInit);
+    for (n = 0; n < count; n++) {
+        if ((g_cpuFeatures & variants[n].features) == variants[n].features)
+            return variants[n].function;
+    }
+    return NULL;
+}
+
+int
+android_readCpuTopology(const char* sysfs_cpu_dir, AndroidCpuTopology* topology)
+{
+    char      path[256];
+    CpuList   cpus_present[1];
+    CpuList   cpus_possible[1];
+    uint32_t  domains[ANDROID_CPU_TOPOLOGY_MAX_CPUS];
+    uint32_t  core_domains[ANDROID_CPU_TOPOLOGY_MAX_CPUS];
+    int       cpu, n, c;
+
+    if (sysfs_cpu_dir == NULL || topology == NULL)
+        return 0;
+
+    memset(topology, 0, sizeof(*topology));
+
+    snprintf(path, sizeof path, "%s/present", sysfs_cpu_dir);
+    cpulist_read_from(cpus_present, path);
+    snprintf(path, sizeof path, "%s/possible", sysfs_cpu_dir);
+    cpulist_read_from(cpus_possible, path);
+    cpulist_and(cpus_present, cpus_possible);
+    if (cpulist_count(cpus_present) == 0)
+        return 0;
+
+    for (cpu = 0; cpu < ANDROID_CPU_TOPOLOGY_MAX_CPUS; cpu++) {
+        AndroidCpuCore* core;
+
+        if ((cpus_present->mask & (1U << cpu)) == 0)
+            continue;
+
+        core = &topology->cores[topology->core_count];
+        core->cpu = cpu;
+        snprintf(path, sizeof path, "%s/cpu%d", sysfs_cpu_dir, cpu);
+        core_domains[topology->core_count++] = read_cpu_core(path, core);
+    }
+    topology->truncated = cpus_present->truncated;
+
+    /* Offline cores have no cpufreq directory, but still appear in the
+     * related_cpus of the online cores of their frequency domain.
+     */
+    for (n = 0; n < topology->core_count; n++) {
+        if (core_domains[n] != 0)
+            continue;
+        for (c = 0; c < topology->core_count; c++) {
+            if (core_domains[c] & (1U << topology->cores[n].cpu)) {
+                core_domains[n] = core_domains[c];
+                break;
+            }
+        }
+    }
+
+    for (n = 0; n < topology->core_count; n++) {
+        AndroidCpuCore* core = &topology->cores[n];
+        uint32_t domain = core_domains[n];
+
+        /* Group cores by frequency domain. When cpufreq doesn't tell us
+         * about it, cores with the same maximum frequency are assumed to
+         * belong to the same cluster.
+         */
+        for (c = 0; c < topology->cluster_count; c++) {
+            if (domain != 0 ? domains[c] == domain
+                            : (domains[c] == 0 &&
+                               topology->clusters[c].max_freq_khz == core->max_freq_khz))
+                break;
+        }
+        if (c == topology->cluster_count) {
+            topology->cluster_count++;
+            domains[c] = domain;
+        }
+        topology->clusters[c].cpus |= 1U << core->cpu;
+        if (core->max_freq_khz > topology->clusters[c].max_freq_khz)
+            topology->clusters[c].max_freq_khz = core->max_freq_khz;
+    }
+
+    /* Sort clusters from the slowest to the fastest one. */
+    for (c = 1; c < topology->cluster_count; c++) {
+        AndroidCpuCluster cluster = topology->clusters[c];
+        for (n = c; n > 0 &&
+             topology->clusters[n-1].max_freq_khz > cluster.max_freq_khz; n--) {
+            topology->clusters[n] = topology->clusters[n-1];
+        }
+        topology->clusters[n] = cluster;
+    }
+
+    for (n = 0; n < topology->core_count; n++) {
+        AndroidCpuCore* core = &topology->cores[n];
+        for (c = 0; c < topology->cluster_count; c++) {
+            if (topology->clusters[c].cpus & (1U << core->cpu))
+                core->cluster = c;
+        }
+    }
+
+    return 1;
+}
+
+static void
+android_cpuInitTopology(void)
+{
+    int count, n;
+
+    if (android_readCpuTopology("/sys/devices/system/cpu", &g_cpuTopology))
+        return;
+
+    D("Could not read the CPU topology, assuming a single cluster\n");
+
+    memset(&g_cpuTopology, 0, sizeof(g_cpuTopology));
+
+    count = android_getCpuCount();
+    if (count > ANDROID_CPU_TOPOLOGY_MAX_CPUS) {
+        count = ANDROID_CPU_TOPOLOGY_MAX_CPUS;
+        g_cpuTopology.truncated = 1;
+    }
+    g_cpuTopology.core_count = count;
+    g_cpuTopology.cluster_count = 1;
+    for (n = 0; n < count; n++) {
+        AndroidCpuCore* core = &g_cpuTopology.cores[n];
+        core->cpu = n;
+        core->package_id = -1;
+        core->core_id = -1;
+        core->thread_siblings = 1U << n;
+        g_cpuTopology.clusters[0].cpus |= 1U << n;
+    }
+}
+
+const AndroidCpuTopology*
+android_getCpuTopology(void)
+{
+    pthread_once(&g_topologyOnce, android_cpuInitTopology);
+    return &g_cpuTopology;
+}
+
 static void
 android_cpuInitTrivial(void)
 {
@@ -242,6 +242,29 @@ enum {
  *
  *   PMULL:
  *     CPU supports 64-bit PMULL and PMULL2 instructions.
+ *
+ *   ATOMICS:
+ *     CPU supports the ARMv8.1 Large System Extensions atomic instructions
+ *     (LDADD, CAS, SWP...).
+ *
+ *   FP16:
+ *     CPU supports ARMv8.2 half-precision arithmetic, both in the
+ *     floating-point unit and in Advanced SIMD.
+ *
+ *   DOTPROD:
+ *     CPU supports the ARMv8.2 SDOT and UDOT instructions.
+ *
+ *   SVE:
+ *     CPU supports the Scalable Vector Extension.
+ *
+ *   SVE2:
+ *     CPU supports version 2 of the Scalable Vector Extension.
+ *
+ *   I8MM:
+ *     CPU supports the ARMv8.6 Int8 matrix multiplication instructions.
+ *
+ *   BF16:
+ *     CPU supports the ARMv8.6 BFloat16 instructions.
  */
 enum {
     ANDROID_CPU_ARM64_FEATURE_FP      = (1 << 0),
@@ -251,11 +274,22 @@ enum {
     ANDROID_CPU_ARM64_FEATURE_SHA1    = (1 << 4),
     ANDROID_CPU_ARM64_FEATURE_SHA2    = (1 << 5),
     ANDROID_CPU_ARM64_FEATURE_CRC32   = (1 << 6),
+    ANDROID_CPU_ARM64_FEATURE_ATOMICS = (1 << 7),
+    ANDROID_CPU_ARM64_FEATURE_FP16    = (1 << 8),
+    ANDROID_CPU_ARM64_FEATURE_DOTPROD = (1 << 9),
+    ANDROID_CPU_ARM64_FEATURE_SVE     = (1 << 10),
+    ANDROID_CPU_ARM64_FEATURE_SVE2    = (1 << 11),
+    ANDROID_CPU_ARM64_FEATURE_I8MM    = (1 << 12),
+    ANDROID_CPU_ARM64_FEATURE_BF16    = (1 << 13),
 };
 
 /* The bit flags corresponding to the output of android_getCpuFeatures()
  * when android_getCpuFamily() returns ANDROID_CPU_FAMILY_X86 or
  * ANDROID_CPU_FAMILY_X86_64.
+ *
+ * AVX, AVX2, FMA, F16C and the AVX512 flags are only reported when the
+ * kernel also saves the corresponding register state on context switches,
+ * i.e. when the instructions can actually be used.
  */
 enum {
     ANDROID_CPU_X86_FEATURE_SSSE3  = (1 << 0),
@@ -268,6 +302,16 @@ enum {
     ANDROID_CPU_X86_FEATURE_RDRAND = (1 << 7),
     ANDROID_CPU_X86_FEATURE_AVX2 =   (1 << 8),
     ANDROID_CPU_X86_FEATURE_SHA_NI = (1 << 9),
+    ANDROID_CPU_X86_FEATURE_FMA =    (1 << 10),
+    ANDROID_CPU_X86_FEATURE_F16C =   (1 << 11),
+    ANDROID_CPU_X86_FEATURE_BMI1 =   (1 << 12),
+    ANDROID_CPU_X86_FEATURE_BMI2 =   (1 << 13),
+    ANDROID_CPU_X86_FEATURE_AVX512F =    (1 << 14),
+    ANDROID_CPU_X86_FEATURE_AVX512CD =   (1 << 15),
+    ANDROID_CPU_X86_FEATURE_AVX512DQ =   (1 << 16),
+    ANDROID_CPU_X86_FEATURE_AVX512BW =   (1 << 17),
+    ANDROID_CPU_X86_FEATURE_AVX512VL =   (1 << 18),
+    ANDROID_CPU_X86_FEATURE_AVX512VNNI = (1 << 19),
 };
 
 /* The bit flags corresponding to the output of android_getCpuFeatures()
@@ -287,9 +331,156 @@ enum {
 };
 
 
+/* Return 1 if the current device's CPU supports all the features set in
+ * the 'features' bitmask, or 0 otherwise. The bit-flags have the same
+ * meaning as for android_getCpuFeatures().
+ */
+extern int android_hasCpuFeatures(uint64_t features);
+
+/* A generic function pointer type, and a table entry associating one
+ * implementation of a function with the CPU features it requires.
+ */
+typedef void (*AndroidCpuFunction)(void);
+
+typedef struct {
+    uint64_t           features;
+    AndroidCpuFunction function;
+} AndroidCpuFunctionVariant;
+
+/* Return the 'function' of the first entry of 'variants' whose 'features'
+ * are all supported by the current device's CPU, or NULL if there is none.
+ * Entries should be listed from the most to the least demanding one, and
+ * end with a generic implementation whose 'features' is 0.
+ *
+ * This is meant to be called once per function, typically from a
+ * constructor, and the result cast back to the real function type, e.g.:
+ *
+ *   static void (*s_blend)(uint8_t* dst, const uint8_t* src, size_t n);
+ *
+ *   __attribute__((constructor)) static void init_blend(void) {
+ *       static const AndroidCpuFunctionVariant variants[] = {
+ *           { ANDROID_CPU_X86_FEATURE_AVX2, (AndroidCpuFunction)blend_avx2 },
+ *           { ANDROID_CPU_X86_FEATURE_SSSE3, (AndroidCpuFunction)blend_ssse3 },
+ *           { 0, (AndroidCpuFunction)blend_c },
+ *       };
+ *       s_blend = (void (*)(uint8_t*, const uint8_t*, size_t))
+ *           android_selectCpuFunction(variants, 3);
+ *   }
+ */
+extern AndroidCpuFunction android_selectCpuFunction(
+        const AndroidCpuFunctionVariant* variants, int count);
+
 /* Return the number of CPU cores detected on this device. */
 extern int android_getCpuCount(void);
 
+/* The maximum number of CPU cores, and of cache descriptions per core,
+ * that an AndroidCpuTopology can describe. CPU sets are reported as 32-bit
+ * masks, so CPUs with an index of ANDROID_CPU_TOPOLOGY_MAX_CPUS or more are
+ * left out, and the 'truncated' field of AndroidCpuTopology is set.
+ */
+#define ANDROID_CPU_TOPOLOGY_MAX_CPUS    32
+#define ANDROID_CPU_TOPOLOGY_MAX_CACHES  4
+
+/* A list of valid values for the 'type' field of AndroidCpuCache. */
+typedef enum {
+    ANDROID_CPU_CACHE_TYPE_UNKNOWN = 0,
+    ANDROID_CPU_CACHE_TYPE_DATA,
+    ANDROID_CPU_CACHE_TYPE_INSTRUCTION,
+    ANDROID_CPU_CACHE_TYPE_UNIFIED,
+} AndroidCpuCacheType;
+
+/* Describes one cache visible to a CPU core, as reported by the kernel
+ * under /sys/devices/system/cpu/cpuN/cache/indexM/. Sizes are in bytes,
+ * 'shared_cpus' is a bitmask of the CPU indices sharing this cache.
+ * Fields that the kernel does not report are set to 0.
+ */
+typedef struct {
+    int                 level;
+    AndroidCpuCacheType type;
+    uint32_t            size;
+    uint32_t            line_size;
+    uint32_t            ways;
+    uint32_t            shared_cpus;
+} AndroidCpuCache;
+
+/* Describes one CPU core.
+ *
+ *   cpu:
+ *     Index of the core, as used by sched_setaffinity().
+ *
+ *   package_id, core_id:
+ *     Values of topology/physical_package_id and topology/core_id, or -1
+ *     if unknown (e.g. the core is offline).
+ *
+ *   cluster:
+ *     Index of the cluster this core belongs to in the 'clusters' array of
+ *     the enclosing AndroidCpuTopology. An offline core is put in the
+ *     cluster of the online cores that list it in cpufreq/related_cpus.
+ *
+ *   max_freq_khz:
+ *     Maximum frequency of the core in kHz, or 0 if unknown.
+ *
+ *   thread_siblings:
+ *     Bitmask of the cores sharing the same physical core through SMT,
+ *     including this one.
+ *
+ *   cache_count, caches:
+ *     The caches visible to this core, ordered as reported by the kernel
+ *     (usually L1 data, L1 instruction, then L2 and L3).
+ */
+typedef struct {
+    int             cpu;
+    int             package_id;
+    int             core_id;
+    int             cluster;
+    uint32_t        max_freq_khz;
+    uint32_t        thread_siblings;
+    int             cache_count;
+    AndroidCpuCache caches[ANDROID_CPU_TOPOLOGY_MAX_CACHES];
+} AndroidCpuCore;
+
+/* Describes a cluster of cores sharing a frequency domain, e.g. the
+ * 'LITTLE' or 'big' half of a big.LITTLE system. 'cpus' is a bitmask of
+ * the core indices in the cluster.
+ */
+typedef struct {
+    uint32_t cpus;
+    uint32_t max_freq_khz;
+} AndroidCpuCluster;
+
+/* Describes the cores, clusters and caches of the device.
+ *
+ * Clusters are sorted by ascending maximum frequency, so on heterogeneous
+ * systems the last cluster holds the fastest ('big') cores.
+ *
+ * 'truncated' is non-zero if the device has CPUs beyond the first
+ * ANDROID_CPU_TOPOLOGY_MAX_CPUS, which are not described here.
+ */
+typedef struct {
+    int               core_count;
+    AndroidCpuCore    cores[ANDROID_CPU_TOPOLOGY_MAX_CPUS];
+    int               cluster_count;
+    AndroidCpuCluster clusters[ANDROID_CPU_TOPOLOGY_MAX_CPUS];
+    int               truncated;
+} AndroidCpuTopology;
+
+/* Return a description of the CPU topology of the current device. This
+ * is computed from sysfs the first time it is called, and the result is
+ * never NULL. Sandboxed processes that cannot read sysfs get a single
+ * cluster with no cache or frequency information.
+ */
+extern const AndroidCpuTopology* android_getCpuTopology(void);
+
+/* Parse the CPU topology from a sysfs directory laid out like
+ * /sys/devices/system/cpu into 'topology'. This is what
+ * android_getCpuTopology() uses, and is exposed so that the parsing can be
+ * exercised against a copy of another device's sysfs tree.
+ *
+ * This function return 1 on success, and 0 on failure.
+ */
+extern int android_readCpuTopology(const char*         sysfs_cpu_dir,
+                                   AndroidCpuTopology* topology);
+
 /* The following is used to force the CPU count and features
  * mask in sandboxed processes. Under 4.1 and higher, these processes
  * cannot access /proc, which is the only way to get information from
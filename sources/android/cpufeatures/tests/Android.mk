@@ -0,0 +1,17 @@
+LOCAL_PATH := $(call my-dir)
+
+include $(CLEAR_VARS)
+LOCAL_MODULE := cpufeatures_cpuid_test
+# Includes cpu-features.c to reach its static helpers.
+LOCAL_SRC_FILES := cpuid_test.c
+LOCAL_CFLAGS := -Wall -Wextra -Werror
+LOCAL_LDLIBS := -ldl
+include $(BUILD_EXECUTABLE)
+
+include $(CLEAR_VARS)
+LOCAL_MODULE := cpufeatures_topology_test
+# Includes cpu-features.c to reach its static helpers.
+LOCAL_SRC_FILES := topology_test.c
+LOCAL_CFLAGS := -Wall -Wextra -Werror
+LOCAL_LDLIBS := -ldl
+include $(BUILD_EXECUTABLE)
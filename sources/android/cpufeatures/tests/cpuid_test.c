@@ -0,0 +1,170 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/* Checks the x86 feature detection against fixed CPUID and XCR0 values.
+ * The library is included so that its static helpers can be called.
+ */
+
+#include "../cpu-features.c"
+
+#include <stdio.h>
+
+#if defined(__i386__) || defined(__x86_64__)
+
+static int failures = 0;
+
+#define CHECK(cond) \
+    do { \
+        if (!(cond)) { \
+            fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, \
+                    #cond); \
+            ++failures; \
+        } \
+    } while (0)
+
+static const int kIntel[4] = { 7, VENDOR_INTEL_b, VENDOR_INTEL_c, VENDOR_INTEL_d };
+/* "AuthenticAMD" */
+static const int kAmd[4] = { 7, 0x68747541, 0x444d4163, 0x69746e65 };
+
+#define LEAF1_FMA      (1 << 12)
+#define LEAF1_SSSE3    (1 << 9)
+#define LEAF1_SSE4_1   (1 << 19)
+#define LEAF1_SSE4_2   (1 << 20)
+#define LEAF1_MOVBE    (1 << 22)
+#define LEAF1_OSXSAVE  (1 << 27)
+#define LEAF1_AVX      (1 << 28)
+#define LEAF1_F16C     (1 << 29)
+
+#define LEAF7_BMI1      (1 << 3)
+#define LEAF7_AVX2      (1 << 5)
+#define LEAF7_BMI2      (1 << 8)
+#define LEAF7_AVX512F   (1 << 16)
+#define LEAF7_AVX512BW  (1 << 30)
+
+/* XCR0: x87 and SSE, then YMM, then opmask and ZMM. */
+#define XCR0_SSE        0x3
+#define XCR0_AVX        0x7
+#define XCR0_AVX512     0xe7
+
+static const uint64_t kAvxFamily = ANDROID_CPU_X86_FEATURE_AVX |
+                                   ANDROID_CPU_X86_FEATURE_AVX2 |
+                                   ANDROID_CPU_X86_FEATURE_FMA |
+                                   ANDROID_CPU_X86_FEATURE_F16C;
+
+static uint64_t features(const int leaf0[4], int leaf1_ecx, int leaf7_ebx,
+                         uint32_t xcr0)
+{
+    int leaf1[4] = { 0, 0, leaf1_ecx, 0 };
+    int leaf7[4] = { 0, leaf7_ebx, 0, 0 };
+    return x86_features_from_cpuid(leaf0, leaf1, leaf7, xcr0);
+}
+
+/* A Haswell-like CPU: SSE4, AVX, AVX2, FMA, F16C, BMI. */
+static const int kHaswellLeaf1 = LEAF1_SSSE3 | LEAF1_SSE4_1 | LEAF1_SSE4_2 |
+                                 LEAF1_MOVBE | LEAF1_OSXSAVE | LEAF1_AVX |
+                                 LEAF1_FMA | LEAF1_F16C;
+static const int kHaswellLeaf7 = LEAF7_BMI1 | LEAF7_AVX2 | LEAF7_BMI2;
+
+static void test_avx_needs_ymm_state(void)
+{
+    uint64_t f = features(kIntel, kHaswellLeaf1, kHaswellLeaf7, XCR0_AVX);
+    CHECK((f & kAvxFamily) == kAvxFamily);
+    CHECK((f & ANDROID_CPU_X86_FEATURE_AVX512F) == 0);
+
+    /* The kernel does not save the YMM registers. */
+    f = features(kIntel, kHaswellLeaf1, kHaswellLeaf7, XCR0_SSE);
+    CHECK((f & kAvxFamily) == 0);
+
+    /* No OSXSAVE, so XCR0 cannot be read and is given as 0. */
+    f = features(kIntel, kHaswellLeaf1 & ~LEAF1_OSXSAVE, kHaswellLeaf7, 0);
+    CHECK((f & kAvxFamily) == 0);
+}
+
+static void test_other_features_ignore_xcr0(void)
+{
+    const uint64_t expected = ANDROID_CPU_X86_FEATURE_SSSE3 |
+                              ANDROID_CPU_X86_FEATURE_SSE4_1 |
+                              ANDROID_CPU_X86_FEATURE_SSE4_2 |
+                              ANDROID_CPU_X86_FEATURE_MOVBE |
+                              ANDROID_CPU_X86_FEATURE_BMI1 |
+                              ANDROID_CPU_X86_FEATURE_BMI2;
+    CHECK(features(kIntel, kHaswellLeaf1, kHaswellLeaf7, 0) == expected);
+    CHECK(features(kIntel, kHaswellLeaf1, kHaswellLeaf7, XCR0_AVX) ==
+          (expected | kAvxFamily));
+}
+
+static void test_avx512_needs_zmm_state(void)
+{
+    const int leaf7 = kHaswellLeaf7 | LEAF7_AVX512F | LEAF7_AVX512BW;
+    uint64_t f = features(kIntel, kHaswellLeaf1, leaf7, XCR0_AVX512);
+    CHECK((f & ANDROID_CPU_X86_FEATURE_AVX512F) != 0);
+    CHECK((f & ANDROID_CPU_X86_FEATURE_AVX512BW) != 0);
+    CHECK((f & ANDROID_CPU_X86_FEATURE_AVX512CD) == 0);
+
+    /* YMM but not ZMM state: AVX2 without AVX-512. */
+    f = features(kIntel, kHaswellLeaf1, leaf7, XCR0_AVX);
+    CHECK((f & ANDROID_CPU_X86_FEATURE_AVX2) != 0);
+    CHECK((f & (ANDROID_CPU_X86_FEATURE_AVX512F |
+                ANDROID_CPU_X86_FEATURE_AVX512BW)) == 0);
+
+    /* ZMM state alone is not enough. */
+    f = features(kIntel, kHaswellLeaf1, leaf7, 0xe3);
+    CHECK((f & (kAvxFamily | ANDROID_CPU_X86_FEATURE_AVX512F)) == 0);
+}
+
+static void test_movbe_is_intel_only(void)
+{
+    CHECK((features(kIntel, LEAF1_MOVBE, 0, 0) &
+           ANDROID_CPU_X86_FEATURE_MOVBE) != 0);
+    CHECK((features(kAmd, LEAF1_MOVBE, 0, 0) &
+           ANDROID_CPU_X86_FEATURE_MOVBE) == 0);
+}
+
+int main(void)
+{
+    test_avx_needs_ymm_state();
+    test_other_features_ignore_xcr0();
+    test_avx512_needs_zmm_state();
+    test_movbe_is_intel_only();
+    if (failures != 0) {
+        fprintf(stderr, "%d checks failed\n", failures);
+        return 1;
+    }
+    printf("PASS\n");
+    return 0;
+}
+
+#else
+
+int main(void)
+{
+    printf("SKIP: not an x86 build\n");
+    return 0;
+}
+
+#endif
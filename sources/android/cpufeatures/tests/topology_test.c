@@ -0,0 +1,379 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *  * Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *  * Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in
+ *    the documentation and/or other materials provided with the
+ *    distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ * COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ * BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS
+ * OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED
+ * AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT
+ * OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF
+ * SUCH DAMAGE.
+ */
+
+/* Checks android_readCpuTopology() against small sysfs trees written to a
+ * temporary directory, and the CPU list parser against malformed input.
+ * The library is included so that its static helpers can be called.
+ */
+
+#include "../cpu-features.c"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+
+static int failures = 0;
+
+#define CHECK(cond) \
+    do { \
+        if (!(cond)) { \
+            fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, \
+                    #cond); \
+            ++failures; \
+        } \
+    } while (0)
+
+/* One file of a fixture tree: its path under the tree, and its content. */
+typedef struct {
+    const char* path;
+    const char* content;
+} SysfsFile;
+
+static char g_root[256];
+
+/* Create a fresh directory for a fixture tree in g_root. */
+static int make_root(void)
+{
+    const char* candidates[] = { getenv("TMPDIR"), "/data/local/tmp", "/tmp" };
+    size_t n;
+
+    for (n = 0; n < sizeof candidates / sizeof candidates[0]; n++) {
+        if (candidates[n] == NULL)
+            continue;
+        snprintf(g_root, sizeof g_root, "%s/cpufeatures-XXXXXX", candidates[n]);
+        if (mkdtemp(g_root) != NULL)
+            return 1;
+    }
+    return 0;
+}
+
+/* Write 'files' under g_root, creating their directories. */
+static void write_tree(const SysfsFile* files, size_t count)
+{
+    char path[512];
+    size_t n;
+
+    for (n = 0; n < count; n++) {
+        char* slash;
+        FILE* fp;
+
+        snprintf(path, sizeof path, "%s/%s", g_root, files[n].path);
+        for (slash = strchr(path + strlen(g_root) + 1, '/'); slash != NULL;
+             slash = strchr(slash + 1, '/')) {
+            *slash = '\0';
+            mkdir(path, 0700);
+            *slash = '/';
+        }
+        fp = fopen(path, "w");
+        if (fp == NULL) {
+            fprintf(stderr, "Could not write %s\n", path);
+            ++failures;
+            continue;
+        }
+        fputs(files[n].content, fp);
+        fclose(fp);
+    }
+}
+
+static void remove_tree(void)
+{
+    char command[300];
+    snprintf(command, sizeof command, "rm -rf %s", g_root);
+    if (system(command) != 0)
+        fprintf(stderr, "Could not remove %s\n", g_root);
+}
+
+/* Parse 'files' as a sysfs tree into 'topology', returning what
+ * android_readCpuTopology() returned.
+ */
+static int read_tree(const SysfsFile* files, size_t count,
+                     AndroidCpuTopology* topology)
+{
+    int result;
+
+    if (!make_root()) {
+        fprintf(stderr, "Could not create a temporary directory\n");
+        ++failures;
+        return 0;
+    }
+    write_tree(files, count);
+    result = android_readCpuTopology(g_root, topology);
+    remove_tree();
+    return result;
+}
+
+static uint32_t parse(const char* line)
+{
+    CpuList list[1];
+    cpulist_init(list);
+    cpulist_parse(list, line, (int)strlen(line));
+    return list->mask;
+}
+
+#define ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
+
+#define LITTLE_CORE(n) \
+    { "cpu" #n "/topology/physical_package_id", "0\n" }, \
+    { "cpu" #n "/topology/core_id", #n "\n" }, \
+    { "cpu" #n "/topology/thread_siblings_list", #n "\n" }, \
+    { "cpu" #n "/cpufreq/cpuinfo_max_freq", "1804800\n" }, \
+    { "cpu" #n "/cpufreq/related_cpus", "0 1 2 3\n" }, \
+    { "cpu" #n "/cache/index0/level", "1\n" }, \
+    { "cpu" #n "/cache/index0/type", "Data\n" }, \
+    { "cpu" #n "/cache/index0/size", "32K\n" }, \
+    { "cpu" #n "/cache/index0/coherency_line_size", "64\n" }, \
+    { "cpu" #n "/cache/index0/ways_of_associativity", "4\n" }, \
+    { "cpu" #n "/cache/index0/shared_cpu_list", #n "\n" }, \
+    { "cpu" #n "/cache/index1/level", "2\n" }, \
+    { "cpu" #n "/cache/index1/type", "Unified\n" }, \
+    { "cpu" #n "/cache/index1/size", "512K\n" }, \
+    { "cpu" #n "/cache/index1/coherency_line_size", "64\n" }, \
+    { "cpu" #n "/cache/index1/shared_cpu_list", "0-3\n" }
+
+#define BIG_CORE(n) \
+    { "cpu" #n "/topology/physical_package_id", "1\n" }, \
+    { "cpu" #n "/topology/core_id", #n "\n" }, \
+    { "cpu" #n "/topology/thread_siblings_list", #n "\n" }, \
+    { "cpu" #n "/cpufreq/cpuinfo_max_freq", "2841600\n" }, \
+    { "cpu" #n "/cpufreq/related_cpus", "4 5 6 7\n" }, \
+    { "cpu" #n "/cache/index0/level", "1\n" }, \
+    { "cpu" #n "/cache/index0/type", "Data\n" }, \
+    { "cpu" #n "/cache/index0/size", "64K\n" }, \
+    { "cpu" #n "/cache/index0/coherency_line_size", "64\n" }, \
+    { "cpu" #n "/cache/index0/shared_cpu_list", #n "\n" }
+
+/* A 4+4 big.LITTLE device whose big core 6 is offline: the kernel removes
+ * its topology, cpufreq and cache directories.
+ */
+static const SysfsFile kBigLittle[] = {
+    { "present", "0-7\n" },
+    { "possible", "0-7\n" },
+    { "online", "0-5,7\n" },
+    LITTLE_CORE(0), LITTLE_CORE(1), LITTLE_CORE(2), LITTLE_CORE(3),
+    BIG_CORE(4), BIG_CORE(5), BIG_CORE(7),
+    { "cpu6/online", "0\n" },
+};
+
+static void test_big_little_with_offline_core(void)
+{
+    AndroidCpuTopology t;
+    const AndroidCpuCore* core;
+
+    CHECK(read_tree(kBigLittle, ARRAY_SIZE(kBigLittle), &t));
+    CHECK(t.core_count == 8);
+    CHECK(t.cluster_count == 2);
+    CHECK(t.clusters[0].cpus == 0x0f);
+    CHECK(t.clusters[0].max_freq_khz == 1804800);
+    CHECK(t.clusters[1].cpus == 0xf0);
+    CHECK(t.clusters[1].max_freq_khz == 2841600);
+
+    core = &t.cores[0];
+    CHECK(core->cpu == 0 && core->cluster == 0);
+    CHECK(core->package_id == 0 && core->core_id == 0);
+    CHECK(core->thread_siblings == 0x01);
+    CHECK(core->cache_count == 2);
+    CHECK(core->caches[0].level == 1);
+    CHECK(core->caches[0].type == ANDROID_CPU_CACHE_TYPE_DATA);
+    CHECK(core->caches[0].size == 32 * 1024);
+    CHECK(core->caches[0].line_size == 64);
+    CHECK(core->caches[0].ways == 4);
+    CHECK(core->caches[0].shared_cpus == 0x01);
+    CHECK(core->caches[1].level == 2);
+    CHECK(core->caches[1].type == ANDROID_CPU_CACHE_TYPE_UNIFIED);
+    CHECK(core->caches[1].size == 512 * 1024);
+    CHECK(core->caches[1].ways == 0);
+    CHECK(core->caches[1].shared_cpus == 0x0f);
+
+    /* The offline core is known only by its index. */
+    core = &t.cores[6];
+    CHECK(core->cpu == 6 && core->cluster == 1);
+    CHECK(core->package_id == -1 && core->core_id == -1);
+    CHECK(core->max_freq_khz == 0);
+    CHECK(core->thread_siblings == 1U << 6);
+    CHECK(core->cache_count == 0);
+
+    CHECK(t.cores[7].cpu == 7 && t.cores[7].cluster == 1);
+    CHECK(!t.truncated);
+}
+
+/* Sparse CPU lists: CPUs 1 and 4 are not present, and there is no cpufreq
+ * directory, so all cores with the same (unknown) frequency form a cluster.
+ */
+static const SysfsFile kSparse[] = {
+    { "present", "0,2-3,5\n" },
+    { "possible", "0-7\n" },
+    { "cpu0/topology/thread_siblings_list", "0,2\n" },
+    { "cpu0/cache/index0/level", "1\n" },
+    { "cpu0/cache/index0/shared_cpu_list", "0,2-3,5\n" },
+    { "cpu2/topology/thread_siblings_list", "0,2\n" },
+    { "cpu3/topology/thread_siblings_list", "3,5\n" },
+    { "cpu5/topology/thread_siblings_list", "3,5\n" },
+};
+
+static void test_sparse_lists(void)
+{
+    AndroidCpuTopology t;
+
+    CHECK(read_tree(kSparse, ARRAY_SIZE(kSparse), &t));
+    CHECK(t.core_count == 4);
+    CHECK(t.cores[0].cpu == 0);
+    CHECK(t.cores[1].cpu == 2);
+    CHECK(t.cores[2].cpu == 3);
+    CHECK(t.cores[3].cpu == 5);
+    CHECK(t.cores[0].thread_siblings == 0x05);
+    CHECK(t.cores[3].thread_siblings == 0x28);
+    CHECK(t.cores[0].cache_count == 1);
+    CHECK(t.cores[0].caches[0].shared_cpus == 0x2d);
+    CHECK(t.cluster_count == 1);
+    CHECK(t.clusters[0].cpus == 0x2d);
+}
+
+/* Malformed values are ignored rather than misread. */
+static const SysfsFile kMalformed[] = {
+    { "present", "0-1,3-2,x,7\n" },
+    { "possible", "0-2147483647\n" },
+    { "cpu0/topology/core_id", "abc\n" },
+    { "cpu0/topology/thread_siblings_list", "0-\n" },
+    { "cpu0/cpufreq/cpuinfo_max_freq", "-5\n" },
+    { "cpu0/cpufreq/related_cpus", "0 1 \n" },
+    { "cpu0/cache/index0/level", "1\n" },
+    { "cpu0/cache/index0/size", "big\n" },
+    { "cpu0/cache/index0/coherency_line_size", "\n" },
+    { "cpu1/cache/index1/level", "2\n" },
+};
+
+static void test_malformed_files(void)
+{
+    AndroidCpuTopology t;
+
+    CHECK(read_tree(kMalformed, ARRAY_SIZE(kMalformed), &t));
+    /* '3-2' is reversed, and parsing stops at 'x'. */
+    CHECK(t.core_count == 2);
+    CHECK(t.cores[0].core_id == -1);
+    CHECK(t.cores[0].thread_siblings == 0x01);
+    CHECK(t.cores[0].max_freq_khz == 0);
+    CHECK(t.cores[0].cache_count == 1);
+    CHECK(t.cores[0].caches[0].size == 0);
+    CHECK(t.cores[0].caches[0].line_size == 0);
+    /* Caches are read from index0 up to the first missing one. */
+    CHECK(t.cores[1].cache_count == 0);
+    /* cpu1 has no cpufreq directory, but cpu0 lists it as related. */
+    CHECK(t.cluster_count == 1);
+    CHECK(t.clusters[0].cpus == 0x03);
+}
+
+/* A device with more CPUs than an AndroidCpuTopology can describe. */
+static void test_too_many_cpus(void)
+{
+    static const SysfsFile kManyCpus[] = {
+        { "present", "0-39\n" },
+        { "possible", "0-63\n" },
+    };
+    static const SysfsFile kManyPossible[] = {
+        { "present", "0-7\n" },
+        { "possible", "0-63\n" },
+    };
+    AndroidCpuTopology t;
+
+    CHECK(read_tree(kManyCpus, ARRAY_SIZE(kManyCpus), &t));
+    CHECK(t.core_count == ANDROID_CPU_TOPOLOGY_MAX_CPUS);
+    CHECK(t.cores[31].cpu == 31);
+    CHECK(t.truncated);
+
+    /* Only present CPUs count. */
+    CHECK(read_tree(kManyPossible, ARRAY_SIZE(kManyPossible), &t));
+    CHECK(t.core_count == 8);
+    CHECK(!t.truncated);
+}
+
+static void test_missing_tree(void)
+{
+    static const SysfsFile kNoCpus[] = {
+        { "present", "\n" },
+        { "possible", "0-3\n" },
+    };
+    AndroidCpuTopology t;
+
+    CHECK(!android_readCpuTopology("/nonexistent/cpufeatures", &t));
+    CHECK(!read_tree(kNoCpus, ARRAY_SIZE(kNoCpus), &t));
+    CHECK(!android_readCpuTopology(NULL, &t));
+}
+
+static void test_cpulist_parse(void)
+{
+    char line[512];
+    size_t len;
+    int n;
+
+    CHECK(parse("0") == 0x1);
+    CHECK(parse("0-3\n") == 0xf);
+    CHECK(parse("1,3,5-6") == 0x6a);
+    CHECK(parse("") == 0);
+    CHECK(parse("31,32,100") == 0x80000000U);
+    CHECK(parse("0-40") == 0xffffffffU);
+    CHECK(parse("30-2147483647") == 0xc0000000U);
+    /* Malformed items end the list. */
+    CHECK(parse("0,-1,2") == 0x1);
+    CHECK(parse("1-,2") == 0x0);
+    CHECK(parse("1,,2") == 0x2);
+    CHECK(parse("99999999999,1") == 0x0);
+    /* Reversed ranges are skipped. */
+    CHECK(parse("5-3,1") == 0x2);
+
+    /* A list longer than the read buffer: "0,100,101,...". The buffer
+     * ends in the middle of "163", which must not read as CPU 16.
+     */
+    len = (size_t)snprintf(line, sizeof line, "0");
+    for (n = 100; n < 200; n++)
+        len += (size_t)snprintf(line + len, sizeof line - len, ",%d", n);
+    {
+        SysfsFile files[] = {
+            { "present", line },
+            { "possible", "0-31\n" },
+        };
+        AndroidCpuTopology t;
+        CHECK(read_tree(files, ARRAY_SIZE(files), &t));
+        CHECK(t.core_count == 1);
+    }
+}
+
+int main(void)
+{
+    test_big_little_with_offline_core();
+    test_sparse_lists();
+    test_malformed_files();
+    test_too_many_cpus();
+    test_missing_tree();
+    test_cpulist_parse();
+    if (failures != 0) {
+        fprintf(stderr, "%d checks failed\n", failures);
+        return 1;
+    }
+    printf("PASS\n");
+    return 0;
+}
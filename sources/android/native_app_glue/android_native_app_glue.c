@@ -21,6 +21,7 @@
 #include <errno.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/eventfd.h>
 #include <unistd.h>
 
 #include <android/log.h>
@@ -45,12 +46,51 @@ static void free_saved_state(struct android_app* android_app) {
     pthread_mutex_unlock(&android_app->mutex);
 }
 
+// --------------------------------------------------------------------
+// Command queue: lock-free SPSC ring, main thread -> app thread
+// --------------------------------------------------------------------
+
+static void android_app_signal_cmd(struct android_app* android_app) {
+    uint64_t one = 1;
+    if (write(android_app->msgwrite, &one, sizeof(one)) != sizeof(one)) {
+        LOGE("Failure signaling android_app cmd: %s", strerror(errno));
+    }
+}
+
+static void android_app_clear_cmd_signal(struct android_app* android_app) {
+    // Non-blocking: EAGAIN only means the counter is already zero.
+    uint64_t count;
+    if (read(android_app->msgread, &count, sizeof(count)) < 0 && errno != EAGAIN) {
+        LOGE("Failure reading android_app cmd signal: %s", strerror(errno));
+    }
+}
+
+static int android_app_pop_cmd(struct android_app* android_app, int8_t* cmd) {
+    uint32_t head = android_app->cmdQueueHead;
+    if (head == __atomic_load_n(&android_app->cmdQueueTail, __ATOMIC_ACQUIRE)) {
+        return 0;
+    }
+    *cmd = android_app->cmdQueue[head & (ANDROID_APP_CMD_QUEUE_SIZE - 1)];
+    __atomic_store_n(&android_app->cmdQueueHead, head + 1, __ATOMIC_RELEASE);
+    return 1;
+}
+
+static int android_app_has_cmd(struct android_app* android_app) {
+    return android_app->cmdQueueHead !=
+            __atomic_load_n(&android_app->cmdQueueTail, __ATOMIC_ACQUIRE);
+}
+
 int8_t android_app_read_cmd(struct android_app* android_app) {
     int8_t cmd;
-    if (read(android_app->msgread, &cmd, sizeof(cmd)) != sizeof(cmd)) {
-        LOGE("No data on command pipe!");
+    android_app_clear_cmd_signal(android_app);
+    if (!android_app_pop_cmd(android_app, &cmd)) {
+        // A command can be signaled after it was already read, which leaves
+        // a wakeup with nothing to read.
         return -1;
     }
+    // Callers read one command per looper wakeup, so re-arm the eventfd
+    // while more are pending.
+    if (android_app_has_cmd(android_app)) android_app_signal_cmd(android_app);
     if (cmd == APP_CMD_SAVE_STATE) free_saved_state(android_app);
     return cmd;
 }
@@ -81,6 +121,7 @@ static void print_cur_config(struct android_app* android_app) {
 }
 
 void android_app_pre_exec_cmd(struct android_app* android_app, int8_t cmd) {
+    if (cmd < 0) return;
     switch (cmd) {
         case APP_CMD_INPUT_CHANGED:
             LOGV("APP_CMD_INPUT_CHANGED");
@@ -138,6 +179,7 @@ void android_app_pre_exec_cmd(struct android_app* android_app, int8_t cmd) {
 }
 
 void android_app_post_exec_cmd(struct android_app* android_app, int8_t cmd) {
+    if (cmd < 0) return;
     switch (cmd) {
         case APP_CMD_TERM_WINDOW:
             LOGV("APP_CMD_TERM_WINDOW");
@@ -192,10 +234,16 @@ static void process_input(struct android_app* app, struct android_poll_source* s
 }
 
 static void process_cmd(struct android_app* app, struct android_poll_source* source) {
-    int8_t cmd = android_app_read_cmd(app);
-    android_app_pre_exec_cmd(app, cmd);
-    if (app->onAppCmd != NULL) app->onAppCmd(app, cmd);
-    android_app_post_exec_cmd(app, cmd);
+    // Drain every pending command in one looper wakeup.  The signal is
+    // cleared first, so a command queued while we run wakes us up again.
+    int8_t cmd;
+    android_app_clear_cmd_signal(app);
+    while (android_app_pop_cmd(app, &cmd)) {
+        if (cmd == APP_CMD_SAVE_STATE) free_saved_state(app);
+        android_app_pre_exec_cmd(app, cmd);
+        if (app->onAppCmd != NULL) app->onAppCmd(app, cmd);
+        android_app_post_exec_cmd(app, cmd);
+    }
 }
 
 static void* android_app_entry(void* param) {
@@ -247,13 +295,13 @@ static struct android_app* android_app_create(ANativeActivity* activity,
         memcpy(android_app->savedState, savedState, savedStateSize);
     }
 
-    int msgpipe[2];
-    if (pipe(msgpipe)) {
-        LOGE("could not create pipe: %s", strerror(errno));
+    int msgfd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (msgfd < 0) {
+        LOGE("could not create eventfd: %s", strerror(errno));
         return NULL;
     }
-    android_app->msgread = msgpipe[0];
-    android_app->msgwrite = msgpipe[1];
+    android_app->msgread = msgfd;
+    android_app->msgwrite = msgfd;
 
     pthread_attr_t attr;
     pthread_attr_init(&attr);
@@ -271,15 +319,24 @@ static struct android_app* android_app_create(ANativeActivity* activity,
 }
 
 static void android_app_write_cmd(struct android_app* android_app, int8_t cmd) {
-    if (write(android_app->msgwrite, &cmd, sizeof(cmd)) != sizeof(cmd)) {
-        LOGE("Failure writing android_app cmd: %s", strerror(errno));
+    uint32_t tail = android_app->cmdQueueTail;
+    while (tail - __atomic_load_n(&android_app->cmdQueueHead, __ATOMIC_ACQUIRE) >=
+            ANDROID_APP_CMD_QUEUE_SIZE) {
+        // Wait for the app thread to drain the ring.  Callers must not hold
+        // android_app->mutex, which the app thread needs to make progress.
+        sched_yield();
     }
+    android_app->cmdQueue[tail & (ANDROID_APP_CMD_QUEUE_SIZE - 1)] = cmd;
+    __atomic_store_n(&android_app->cmdQueueTail, tail + 1, __ATOMIC_RELEASE);
+    android_app_signal_cmd(android_app);
 }
 
 static void android_app_set_input(struct android_app* android_app, AInputQueue* inputQueue) {
     pthread_mutex_lock(&android_app->mutex);
     android_app->pendingInputQueue = inputQueue;
+    pthread_mutex_unlock(&android_app->mutex);
     android_app_write_cmd(android_app, APP_CMD_INPUT_CHANGED);
+    pthread_mutex_lock(&android_app->mutex);
     while (android_app->inputQueue != android_app->pendingInputQueue) {
         pthread_cond_wait(&android_app->cond, &android_app->mutex);
     }
@@ -288,13 +345,18 @@ static void android_app_set_input(struct android_app* android_app, AInputQueue*
 
 static void android_app_set_window(struct android_app* android_app, ANativeWindow* window) {
     pthread_mutex_lock(&android_app->mutex);
-    if (android_app->pendingWindow != NULL) {
+    int terminating = android_app->pendingWindow != NULL;
+    android_app->pendingWindow = window;
+    pthread_mutex_unlock(&android_app->mutex);
+    if (terminating) {
         android_app_write_cmd(android_app, APP_CMD_TERM_WINDOW);
     }
-    android_app->pendingWindow = window;
     if (window != NULL) {
         android_app_write_cmd(android_app, APP_CMD_INIT_WINDOW);
     }
+    // The old window is only valid until we return, and a new one may be
+    // destroyed as soon as we do, so wait for the app to switch windows.
+    pthread_mutex_lock(&android_app->mutex);
     while (android_app->window != android_app->pendingWindow) {
         pthread_cond_wait(&android_app->cond, &android_app->mutex);
     }
@@ -302,8 +364,10 @@ static void android_app_set_window(struct android_app* android_app, ANativeWindo
 }
 
 static void android_app_set_activity_state(struct android_app* android_app, int8_t cmd) {
-    pthread_mutex_lock(&android_app->mutex);
+    // The framework expects the app to have seen the transition when the
+    // callback returns.
     android_app_write_cmd(android_app, cmd);
+    pthread_mutex_lock(&android_app->mutex);
     while (android_app->activityState != cmd) {
         pthread_cond_wait(&android_app->cond, &android_app->mutex);
     }
@@ -311,15 +375,14 @@ static void android_app_set_activity_state(struct android_app* android_app, int8
 }
 
 static void android_app_free(struct android_app* android_app) {
-    pthread_mutex_lock(&android_app->mutex);
     android_app_write_cmd(android_app, APP_CMD_DESTROY);
+    pthread_mutex_lock(&android_app->mutex);
     while (!android_app->destroyed) {
         pthread_cond_wait(&android_app->cond, &android_app->mutex);
     }
     pthread_mutex_unlock(&android_app->mutex);
 
     close(android_app->msgread);
-    close(android_app->msgwrite);
     pthread_cond_destroy(&android_app->cond);
     pthread_mutex_destroy(&android_app->mutex);
     free(android_app);
@@ -351,7 +414,9 @@ static void* onSaveInstanceState(ANativeActivity* activity, size_t* outLen) {
     void* savedState = NULL;
     pthread_mutex_lock(&android_app->mutex);
     android_app->stateSaved = 0;
+    pthread_mutex_unlock(&android_app->mutex);
     android_app_write_cmd(android_app, APP_CMD_SAVE_STATE);
+    pthread_mutex_lock(&android_app->mutex);
     while (!android_app->stateSaved) {
         pthread_cond_wait(&android_app->cond, &android_app->mutex);
     }
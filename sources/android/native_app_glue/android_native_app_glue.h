@@ -81,6 +81,12 @@ extern "C" {
 
 struct android_app;
 
+/**
+ * Number of commands that can be pending between the activity's main thread
+ * and the app thread.  Must be a power of two.
+ */
+#define ANDROID_APP_CMD_QUEUE_SIZE 64
+
 /**
  * Data associated with an ALooper fd that will be returned as the "outData"
  * when that source has data ready.
@@ -165,9 +171,18 @@ struct android_app {
     pthread_mutex_t mutex;
     pthread_cond_t cond;
 
+    // Both ends of the eventfd used to wake up the app's looper when
+    // commands are pending; msgread and msgwrite are the same descriptor.
     int msgread;
     int msgwrite;
 
+    // Lock-free single-producer/single-consumer ring of pending APP_CMD_*
+    // values.  Only the main thread advances cmdQueueTail and only the app
+    // thread advances cmdQueueHead.
+    int8_t cmdQueue[ANDROID_APP_CMD_QUEUE_SIZE];
+    uint32_t cmdQueueHead;
+    uint32_t cmdQueueTail;
+
     pthread_t thread;
 
     struct android_poll_source cmdPollSource;
@@ -311,7 +326,9 @@ enum {
 
 /**
  * Call when ALooper_pollAll() returns LOOPER_ID_MAIN, reading the next
- * app command message.
+ * app command message.  Returns -1 if no command is pending, which can
+ * happen after a spurious wakeup; android_app_pre_exec_cmd() and
+ * android_app_post_exec_cmd() ignore it, and so should the app.
  */
 int8_t android_app_read_cmd(struct android_app* android_app);
 
@@ -0,0 +1,12 @@
+LOCAL_PATH:= $(call my-dir)
+
+include $(CLEAR_VARS)
+
+LOCAL_MODULE:= android_native_app_glue_looper_test
+LOCAL_SRC_FILES:= looper_test.c ../android_native_app_glue.c
+LOCAL_C_INCLUDES := $(LOCAL_PATH)/..
+LOCAL_CFLAGS += -Wall -Werror
+# The test provides its own looper, configuration and log functions in place
+# of libandroid and liblog, so it links neither.
+
+include $(BUILD_EXECUTABLE)
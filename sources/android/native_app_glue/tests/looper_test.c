@@ -0,0 +1,231 @@
+/*
+ * Copyright (C) 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Stands in for the framework: the main thread makes the activity callbacks
+// the way the system would, against a small looper built on poll(), and
+// checks that each lifecycle callback only returns once the app thread has
+// seen its command.  The app handles every command slowly, so a callback
+// that merely queued its command would return before the app caught up.
+
+#include "android_native_app_glue.h"
+
+#include <poll.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// --------------------------------------------------------------------
+// Stand-ins for libandroid and liblog
+// --------------------------------------------------------------------
+
+#define MAX_LOOPER_FDS 4
+
+struct ALooper {
+    int count;
+    struct pollfd fds[MAX_LOOPER_FDS];
+    int idents[MAX_LOOPER_FDS];
+    void* data[MAX_LOOPER_FDS];
+};
+
+static __thread ALooper* thread_looper;
+
+ALooper* ALooper_prepare(int opts) {
+    if (thread_looper == NULL) thread_looper = calloc(1, sizeof(ALooper));
+    return thread_looper;
+}
+
+int ALooper_addFd(ALooper* looper, int fd, int ident, int events,
+        ALooper_callbackFunc callback, void* data) {
+    if (looper->count == MAX_LOOPER_FDS) return -1;
+    looper->fds[looper->count].fd = fd;
+    looper->fds[looper->count].events = POLLIN;
+    looper->idents[looper->count] = ident;
+    looper->data[looper->count] = data;
+    ++looper->count;
+    return 1;
+}
+
+int ALooper_pollAll(int timeoutMillis, int* outFd, int* outEvents, void** outData) {
+    ALooper* looper = thread_looper;
+    if (poll(looper->fds, looper->count, timeoutMillis) <= 0) {
+        return ALOOPER_POLL_TIMEOUT;
+    }
+    for (int i = 0; i < looper->count; ++i) {
+        if (looper->fds[i].revents & POLLIN) {
+            if (outFd != NULL) *outFd = looper->fds[i].fd;
+            if (outEvents != NULL) *outEvents = ALOOPER_EVENT_INPUT;
+            if (outData != NULL) *outData = looper->data[i];
+            return looper->idents[i];
+        }
+    }
+    return ALOOPER_POLL_ERROR;
+}
+
+void AInputQueue_attachLooper(AInputQueue* queue, ALooper* looper,
+        int ident, ALooper_callbackFunc callback, void* data) {}
+void AInputQueue_detachLooper(AInputQueue* queue) {}
+int32_t AInputQueue_getEvent(AInputQueue* queue, AInputEvent** outEvent) { return -1; }
+int32_t AInputQueue_preDispatchEvent(AInputQueue* queue, AInputEvent* event) { return 0; }
+void AInputQueue_finishEvent(AInputQueue* queue, AInputEvent* event, int handled) {}
+int32_t AInputEvent_getType(const AInputEvent* event) { return 0; }
+
+struct AConfiguration {
+    int unused;
+};
+
+AConfiguration* AConfiguration_new() { return calloc(1, sizeof(AConfiguration)); }
+void AConfiguration_delete(AConfiguration* config) { free(config); }
+void AConfiguration_fromAssetManager(AConfiguration* out, AAssetManager* am) {}
+void AConfiguration_getLanguage(AConfiguration* config, char* outLanguage) {
+    outLanguage[0] = outLanguage[1] = 'x';
+}
+void AConfiguration_getCountry(AConfiguration* config, char* outCountry) {
+    outCountry[0] = outCountry[1] = 'x';
+}
+
+#define CONFIG_GETTER(name) \
+    int32_t AConfiguration_get##name(AConfiguration* config) { return 0; }
+CONFIG_GETTER(Mcc)
+CONFIG_GETTER(Mnc)
+CONFIG_GETTER(Orientation)
+CONFIG_GETTER(Touchscreen)
+CONFIG_GETTER(Density)
+CONFIG_GETTER(Keyboard)
+CONFIG_GETTER(Navigation)
+CONFIG_GETTER(KeysHidden)
+CONFIG_GETTER(NavHidden)
+CONFIG_GETTER(SdkVersion)
+CONFIG_GETTER(ScreenSize)
+CONFIG_GETTER(ScreenLong)
+CONFIG_GETTER(UiModeType)
+CONFIG_GETTER(UiModeNight)
+
+int __android_log_print(int prio, const char* tag, const char* fmt, ...) {
+    return 0;
+}
+
+// --------------------------------------------------------------------
+// The app
+// --------------------------------------------------------------------
+
+static const char kSavedState[] = "saved by the app";
+
+// The last command whose onAppCmd handler returned.
+static int32_t last_handled = -1;
+
+static void handle_cmd(struct android_app* app, int32_t cmd) {
+    usleep(20 * 1000);
+    if (cmd == APP_CMD_SAVE_STATE) {
+        app->savedState = malloc(sizeof(kSavedState));
+        memcpy(app->savedState, kSavedState, sizeof(kSavedState));
+        app->savedStateSize = sizeof(kSavedState);
+    }
+    __atomic_store_n(&last_handled, cmd, __ATOMIC_RELEASE);
+}
+
+void android_main(struct android_app* app) {
+    app->onAppCmd = handle_cmd;
+    while (!app->destroyRequested) {
+        struct android_poll_source* source = NULL;
+        if (ALooper_pollAll(-1, NULL, NULL, (void**)&source) >= 0 && source != NULL) {
+            source->process(app, source);
+        }
+    }
+}
+
+// --------------------------------------------------------------------
+// The framework
+// --------------------------------------------------------------------
+
+static int failures = 0;
+
+#define CHECK(cond)                                                     \
+    do {                                                                \
+        if (!(cond)) {                                                  \
+            fprintf(stderr, "%s:%d: CHECK failed: %s\n", __FILE__,      \
+                    __LINE__, #cond);                                   \
+            ++failures;                                                 \
+        }                                                               \
+    } while (0)
+
+static int8_t activity_state(struct android_app* app) {
+    pthread_mutex_lock(&app->mutex);
+    int8_t state = app->activityState;
+    pthread_mutex_unlock(&app->mutex);
+    return state;
+}
+
+static ANativeWindow* app_window(struct android_app* app) {
+    pthread_mutex_lock(&app->mutex);
+    ANativeWindow* window = app->window;
+    pthread_mutex_unlock(&app->mutex);
+    return window;
+}
+
+int main() {
+    ANativeActivityCallbacks callbacks;
+    memset(&callbacks, 0, sizeof(callbacks));
+    ANativeActivity activity;
+    memset(&activity, 0, sizeof(activity));
+    activity.callbacks = &callbacks;
+    int window_storage;
+    ANativeWindow* window = (ANativeWindow*)&window_storage;
+
+    ANativeActivity_onCreate(&activity, NULL, 0);
+    struct android_app* app = (struct android_app*)activity.instance;
+    CHECK(app != NULL);
+
+    callbacks.onStart(&activity);
+    CHECK(activity_state(app) == APP_CMD_START);
+    callbacks.onResume(&activity);
+    CHECK(activity_state(app) == APP_CMD_RESUME);
+
+    // The app has the new window when the callback returns.
+    callbacks.onNativeWindowCreated(&activity, window);
+    CHECK(app_window(app) == window);
+
+    callbacks.onPause(&activity);
+    CHECK(activity_state(app) == APP_CMD_PAUSE);
+
+    // The state is the one the app saved while handling the command.
+    size_t saved_size = 0;
+    void* saved = callbacks.onSaveInstanceState(&activity, &saved_size);
+    CHECK(saved != NULL);
+    CHECK(saved_size == sizeof(kSavedState));
+    CHECK(saved != NULL && memcmp(saved, kSavedState, sizeof(kSavedState)) == 0);
+    free(saved);
+
+    // The app is done with the window, including its onAppCmd handler, before
+    // the window is destroyed.
+    callbacks.onNativeWindowDestroyed(&activity, window);
+    CHECK(app_window(app) == NULL);
+    CHECK(__atomic_load_n(&last_handled, __ATOMIC_ACQUIRE) == APP_CMD_TERM_WINDOW);
+
+    callbacks.onStop(&activity);
+    CHECK(activity_state(app) == APP_CMD_STOP);
+
+    // Returns once android_main has returned and the glue cleaned up.
+    callbacks.onDestroy(&activity);
+
+    if (failures != 0) {
+        fprintf(stderr, "%d checks failed\n", failures);
+        return 1;
+    }
+    printf("PASS\n");
+    return 0;
+}
@@ -16,7 +16,16 @@
 
 #include "interpolator.h"
 #include <math.h>
-#include "interpolator.h"
+#include <string.h>
+#include <algorithm>
+
+#if defined( __ARM_NEON__ ) || defined( __ARM_NEON )
+#include <arm_neon.h>
+#define INTERPOLATOR_NEON
+#elif defined( __SSE2__ )
+#include <emmintrin.h>
+#define INTERPOLATOR_SSE
+#endif
 
 namespace ndk_helper
 {
@@ -24,9 +33,9 @@ namespace ndk_helper
 //-------------------------------------------------
 //Ctor
 //-------------------------------------------------
-Interpolator::Interpolator()
+Interpolator::Interpolator() :
+                next_param_( 0 )
 {
-    list_params_.clear();
 }
 
 //-------------------------------------------------
@@ -34,12 +43,12 @@ Interpolator::Interpolator()
 //-------------------------------------------------
 Interpolator::~Interpolator()
 {
-    list_params_.clear();
 }
 
 void Interpolator::Clear()
 {
-    list_params_.clear();
+    params_.clear();
+    next_param_ = 0;
 }
 
 Interpolator& Interpolator::Set( const float start,
@@ -61,11 +70,19 @@ Interpolator& Interpolator::Add( const float dest,
         const INTERPOLATOR_TYPE type,
         const double duration )
 {
+    //Drop the consumed segments before they outnumber the queued ones. The
+    //erase moves the rest down without reallocating
+    if( next_param_ > 0 && next_param_ * 2 >= params_.size() )
+    {
+        params_.erase( params_.begin(), params_.begin() + next_param_ );
+        next_param_ = 0;
+    }
+
     InterpolatorParams param;
     param.dest_value_ = dest;
     param.type_ = type;
     param.duration_ = duration;
-    list_params_.push_back( param );
+    params_.push_back( param );
     return *this;
 }
 
@@ -75,16 +92,17 @@ bool Interpolator::Update( const double current_time, float& p )
     if( current_time >= dest_time_ )
     {
         p = dest_value_;
-        if( list_params_.size() )
+        if( next_param_ < params_.size() )
         {
-            InterpolatorParams& item = list_params_.front();
+            InterpolatorParams& item = params_[next_param_++];
             Set( dest_value_, item.dest_value_, item.type_, item.duration_ );
-            list_params_.pop_front();
 
             bContinue = true;
         }
         else
         {
+            //Recycle the storage for the next Add() calls
+            Clear();
             bContinue = false;
         }
     }
@@ -178,4 +196,344 @@ float Interpolator::GetFormula( const INTERPOLATOR_TYPE type,
     }
 }
 
+//-------------------------------------------------
+//Batched easing
+//The polynomial easings of GetFormula(), on the fraction u = t / d of the
+//segment that has elapsed. The NEON and SSE paths compute the formula of
+//each type present for four entries at a time and select the one of each
+//entry's type, so mixed types need no branch. The exponential easings call
+//powf() and are evaluated one at a time instead
+//-------------------------------------------------
+static inline bool IsExponential( const INTERPOLATOR_TYPE type )
+{
+    return type == INTERPOLATOR_TYPE_EASEINEXPO || type == INTERPOLATOR_TYPE_EASEOUTEXPO;
+}
+
+//For builds without NEON or SSE
+static inline float EaseFraction( const int32_t type, const float x )
+{
+    float x2 = x * x;
+    float x1 = x - 1;
+    float h = x * 0.5f;
+    switch( type )
+    {
+    case INTERPOLATOR_TYPE_EASEINQUAD:
+        return x2;
+    case INTERPOLATOR_TYPE_EASEOUTQUAD:
+        return x * (2 - x);
+    case INTERPOLATOR_TYPE_EASEINOUTQUAD:
+        return h < 1 ? h * h * 0.5f : ((h - 1) * (h - 3) - 1) * -0.5f;
+    case INTERPOLATOR_TYPE_EASEINCUBIC:
+        return x2 * x;
+    case INTERPOLATOR_TYPE_EASEOUTCUBIC:
+        return x1 * x1 * x1 + 1;
+    case INTERPOLATOR_TYPE_EASEINOUTCUBIC:
+        return h < 1 ? h * h * h * 0.5f : ((h - 2) * (h - 2) * (h - 2) + 2) * 0.5f;
+    case INTERPOLATOR_TYPE_EASEINQUART:
+        return x2 * x2;
+    default:
+        return x;
+    }
+}
+
+#if defined( INTERPOLATOR_NEON )
+static inline float32x4_t IfType( const int32x4_t type,
+        const INTERPOLATOR_TYPE value,
+        const float32x4_t a,
+        const float32x4_t b )
+{
+    return vbslq_f32( vceqq_s32( type, vdupq_n_s32( value ) ), a, b );
+}
+
+static inline float32x4_t EaseFraction4( const int32x4_t type,
+        const float32x4_t x,
+        const uint32_t present )
+{
+    const float32x4_t one = vdupq_n_f32( 1.f );
+    const float32x4_t two = vdupq_n_f32( 2.f );
+    const float32x4_t half = vdupq_n_f32( 0.5f );
+    float32x4_t x2 = vmulq_f32( x, x );
+    float32x4_t h = vmulq_f32( x, half );
+    uint32x4_t first_half = vcltq_f32( h, one );
+
+    float32x4_t e = x;
+    if( present & (1 << INTERPOLATOR_TYPE_EASEINQUAD) )
+        e = IfType( type, INTERPOLATOR_TYPE_EASEINQUAD, x2, e );
+    if( present & (1 << INTERPOLATOR_TYPE_EASEOUTQUAD) )
+        e = IfType( type, INTERPOLATOR_TYPE_EASEOUTQUAD, vmulq_f32( x, vsubq_f32( two, x ) ), e );
+    if( present & (1 << INTERPOLATOR_TYPE_EASEINOUTQUAD) )
+    {
+        float32x4_t h1 = vsubq_f32( h, one );
+        float32x4_t in_out_quad = vbslq_f32( first_half,
+                vmulq_f32( vmulq_f32( h, h ), half ),
+                vmulq_f32( vsubq_f32( vmulq_f32( h1, vsubq_f32( h, vdupq_n_f32( 3.f ) ) ), one ),
+                        vdupq_n_f32( -0.5f ) ) );
+        e = IfType( type, INTERPOLATOR_TYPE_EASEINOUTQUAD, in_out_quad, e );
+    }
+    if( present & (1 << INTERPOLATOR_TYPE_EASEINCUBIC) )
+        e = IfType( type, INTERPOLATOR_TYPE_EASEINCUBIC, vmulq_f32( x2, x ), e );
+    if( present & (1 << INTERPOLATOR_TYPE_EASEOUTCUBIC) )
+    {
+        float32x4_t x1 = vsubq_f32( x, one );
+        e = IfType( type, INTERPOLATOR_TYPE_EASEOUTCUBIC,
+                vaddq_f32( vmulq_f32( vmulq_f32( x1, x1 ), x1 ), one ), e );
+    }
+    if( present & (1 << INTERPOLATOR_TYPE_EASEINOUTCUBIC) )
+    {
+        float32x4_t h2 = vsubq_f32( h, two );
+        float32x4_t in_out_cubic = vbslq_f32( first_half,
+                vmulq_f32( vmulq_f32( vmulq_f32( h, h ), h ), half ),
+                vmulq_f32( vaddq_f32( vmulq_f32( vmulq_f32( h2, h2 ), h2 ), two ), half ) );
+        e = IfType( type, INTERPOLATOR_TYPE_EASEINOUTCUBIC, in_out_cubic, e );
+    }
+    if( present & (1 << INTERPOLATOR_TYPE_EASEINQUART) )
+        e = IfType( type, INTERPOLATOR_TYPE_EASEINQUART, vmulq_f32( x2, x2 ), e );
+    return e;
+}
+#elif defined( INTERPOLATOR_SSE )
+static inline __m128 Select( const __m128 mask, const __m128 a, const __m128 b )
+{
+    return _mm_or_ps( _mm_and_ps( mask, a ), _mm_andnot_ps( mask, b ) );
+}
+
+static inline __m128 IfType( const __m128i type,
+        const INTERPOLATOR_TYPE value,
+        const __m128 a,
+        const __m128 b )
+{
+    return Select( _mm_castsi128_ps( _mm_cmpeq_epi32( type, _mm_set1_epi32( value ) ) ), a, b );
+}
+
+static inline __m128 EaseFraction4( const __m128i type, const __m128 x, const uint32_t present )
+{
+    const __m128 one = _mm_set1_ps( 1.f );
+    const __m128 two = _mm_set1_ps( 2.f );
+    const __m128 half = _mm_set1_ps( 0.5f );
+    __m128 x2 = _mm_mul_ps( x, x );
+    __m128 h = _mm_mul_ps( x, half );
+    __m128 first_half = _mm_cmplt_ps( h, one );
+
+    __m128 e = x;
+    if( present & (1 << INTERPOLATOR_TYPE_EASEINQUAD) )
+        e = IfType( type, INTERPOLATOR_TYPE_EASEINQUAD, x2, e );
+    if( present & (1 << INTERPOLATOR_TYPE_EASEOUTQUAD) )
+        e = IfType( type, INTERPOLATOR_TYPE_EASEOUTQUAD, _mm_mul_ps( x, _mm_sub_ps( two, x ) ), e );
+    if( present & (1 << INTERPOLATOR_TYPE_EASEINOUTQUAD) )
+    {
+        __m128 h1 = _mm_sub_ps( h, one );
+        __m128 in_out_quad = Select( first_half,
+                _mm_mul_ps( _mm_mul_ps( h, h ), half ),
+                _mm_mul_ps( _mm_sub_ps( _mm_mul_ps( h1, _mm_sub_ps( h, _mm_set1_ps( 3.f ) ) ), one ),
+                        _mm_set1_ps( -0.5f ) ) );
+        e = IfType( type, INTERPOLATOR_TYPE_EASEINOUTQUAD, in_out_quad, e );
+    }
+    if( present & (1 << INTERPOLATOR_TYPE_EASEINCUBIC) )
+        e = IfType( type, INTERPOLATOR_TYPE_EASEINCUBIC, _mm_mul_ps( x2, x ), e );
+    if( present & (1 << INTERPOLATOR_TYPE_EASEOUTCUBIC) )
+    {
+        __m128 x1 = _mm_sub_ps( x, one );
+        e = IfType( type, INTERPOLATOR_TYPE_EASEOUTCUBIC,
+                _mm_add_ps( _mm_mul_ps( _mm_mul_ps( x1, x1 ), x1 ), one ), e );
+    }
+    if( present & (1 << INTERPOLATOR_TYPE_EASEINOUTCUBIC) )
+    {
+        __m128 h2 = _mm_sub_ps( h, two );
+        __m128 in_out_cubic = Select( first_half,
+                _mm_mul_ps( _mm_mul_ps( _mm_mul_ps( h, h ), h ), half ),
+                _mm_mul_ps( _mm_add_ps( _mm_mul_ps( _mm_mul_ps( h2, h2 ), h2 ), two ), half ) );
+        e = IfType( type, INTERPOLATOR_TYPE_EASEINOUTCUBIC, in_out_cubic, e );
+    }
+    if( present & (1 << INTERPOLATOR_TYPE_EASEINQUART) )
+        e = IfType( type, INTERPOLATOR_TYPE_EASEINQUART, _mm_mul_ps( x2, x2 ), e );
+    return e;
+}
+
+#endif
+
+//Writes b + c * ease(u) for count entries of polynomial easing types.
+//present has bit 1 << type set for each type in type[], the formulas of
+//other types are skipped
+static void EaseBatch( const int32_t* type,
+        const float* u,
+        const float* b,
+        const float* c,
+        float* out,
+        const int32_t count,
+        const uint32_t present )
+{
+    int32_t i = 0;
+#if defined( INTERPOLATOR_NEON )
+    for( ; i + 4 <= count; i += 4 )
+    {
+        float32x4_t e = EaseFraction4( vld1q_s32( type + i ), vld1q_f32( u + i ), present );
+        vst1q_f32( out + i, vaddq_f32( vld1q_f32( b + i ), vmulq_f32( vld1q_f32( c + i ), e ) ) );
+    }
+#elif defined( INTERPOLATOR_SSE )
+    for( ; i + 4 <= count; i += 4 )
+    {
+        __m128 e = EaseFraction4( _mm_loadu_si128( (const __m128i*) (type + i) ),
+                _mm_loadu_ps( u + i ), present );
+        _mm_storeu_ps( out + i, _mm_add_ps( _mm_loadu_ps( b + i ),
+                _mm_mul_ps( _mm_loadu_ps( c + i ), e ) ) );
+    }
+#else
+    (void) present;
+#endif
+    for( ; i < count; ++i )
+        out[i] = b[i] + c[i] * EaseFraction( type[i], u[i] );
+}
+
+//-------------------------------------------------
+//AnimationSet
+//-------------------------------------------------
+AnimationSet::AnimationSet()
+{
+    key_begin_.push_back( 0 );
+}
+
+void AnimationSet::Reserve( const int32_t channels, const int32_t keys )
+{
+    key_begin_.reserve( channels + 1 );
+    start_value_.reserve( channels );
+    start_time_.reserve( channels );
+    cursor_.reserve( channels );
+    key_time_.reserve( keys );
+    key_value_.reserve( keys );
+    key_type_.reserve( keys );
+}
+
+int32_t AnimationSet::AddChannel( const float start_value, const double start_time )
+{
+    start_value_.push_back( start_value );
+    start_time_.push_back( start_time );
+    cursor_.push_back( key_begin_.back() );
+    key_begin_.push_back( key_begin_.back() );
+
+    return (int32_t) start_value_.size() - 1;
+}
+
+AnimationSet& AnimationSet::AddKey( const int32_t channel,
+        const float dest,
+        const INTERPOLATOR_TYPE type,
+        const double duration )
+{
+    if( channel < 0 || channel >= GetChannelCount() )
+        return *this;
+
+    uint32_t begin = key_begin_[channel];
+    uint32_t end = key_begin_[channel + 1];
+    double start = end > begin ? key_time_[end - 1] : start_time_[channel];
+    key_time_.insert( key_time_.begin() + end, start + duration );
+    key_value_.insert( key_value_.begin() + end, dest );
+    key_type_.insert( key_type_.begin() + end, type );
+
+    //Keys of the following channels moved up by one
+    for( size_t i = channel + 1; i < key_begin_.size(); ++i )
+        ++key_begin_[i];
+    for( size_t i = channel + 1; i < cursor_.size(); ++i )
+        ++cursor_[i];
+    return *this;
+}
+
+uint32_t AnimationSet::FindSegment( const int32_t channel, const double current_time )
+{
+    //Time usually moves forward by less than a segment per frame, so try the
+    //segment found last time and the next one before searching
+    uint32_t begin = key_begin_[channel];
+    uint32_t end = key_begin_[channel + 1];
+    uint32_t cursor = cursor_[channel];
+    for( uint32_t i = cursor; i < end && i <= cursor + 1; ++i )
+    {
+        if( key_time_[i] > current_time
+                && (i == begin || key_time_[i - 1] <= current_time) )
+            return i;
+    }
+
+    cursor = (uint32_t) (std::upper_bound( key_time_.begin() + begin,
+            key_time_.begin() + end, current_time ) - key_time_.begin());
+    cursor_[channel] = cursor;
+    return cursor;
+}
+
+int32_t AnimationSet::Update( const double current_time, float* values )
+{
+    //Channels are evaluated in blocks that fit in the cache. Channels that
+    //aren't animating, or whose easing is exponential, get a linear entry
+    //with no change from their value so that EaseBatch() writes every channel.
+    //Blocks are padded to a multiple of four so that every entry goes through
+    //the same SIMD code
+    const int32_t kBlock = 64;
+    int32_t type[kBlock];
+    float fraction[kBlock];
+    float start[kBlock];
+    float change[kBlock];
+    float eased[kBlock];
+
+    int32_t active = 0;
+    const int32_t channels = GetChannelCount();
+    for( int32_t block = 0; block < channels; block += kBlock )
+    {
+        const int32_t count = std::min( kBlock, channels - block );
+        uint32_t present = 0;
+        const int32_t padded = (count + 3) & ~3;
+        for( int32_t n = count; n < padded; ++n )
+        {
+            type[n] = INTERPOLATOR_TYPE_LINEAR;
+            fraction[n] = start[n] = change[n] = 0.f;
+        }
+        for( int32_t n = 0; n < count; ++n )
+        {
+            const int32_t i = block + n;
+            uint32_t begin = key_begin_[i];
+            uint32_t end = key_begin_[i + 1];
+            type[n] = INTERPOLATOR_TYPE_LINEAR;
+            fraction[n] = 0.f;
+            change[n] = 0.f;
+            if( begin == end || current_time < start_time_[i] )
+            {
+                start[n] = start_value_[i];
+                continue;
+            }
+            if( current_time >= key_time_[end - 1] )
+            {
+                start[n] = key_value_[end - 1];
+                continue;
+            }
+
+            uint32_t k = FindSegment( i, current_time );
+            cursor_[i] = k;
+            double t0 = k == begin ? start_time_[i] : key_time_[k - 1];
+            float t = (float) (current_time - t0);
+            float d = (float) (key_time_[k] - t0);
+            float b = k == begin ? start_value_[i] : key_value_[k - 1];
+            float c = key_value_[k] - b;
+            ++active;
+            if( IsExponential( key_type_[k] ) )
+            {
+                start[n] = Interpolator::GetFormula( key_type_[k], t, b, d, c );
+                continue;
+            }
+            type[n] = key_type_[k];
+            present |= 1 << key_type_[k];
+            fraction[n] = t / d;
+            start[n] = b;
+            change[n] = c;
+        }
+        EaseBatch( type, fraction, start, change, eased, padded, present );
+        memcpy( values + block, eased, count * sizeof(float) );
+    }
+    return active;
+}
+
+void AnimationSet::Clear()
+{
+    key_begin_.resize( 1 );
+    start_value_.clear();
+    start_time_.clear();
+    cursor_.clear();
+    key_time_.clear();
+    key_value_.clear();
+    key_type_.clear();
+}
+
 }   //namespace ndkHelper
@@ -21,7 +21,7 @@
 #include <time.h>
 #include "JNIHelper.h"
 #include "perfMonitor.h"
-#include <list>
+#include <vector>
 
 namespace ndk_helper
 {
@@ -59,16 +59,22 @@ private:
 
     float start_value_;
     float dest_value_;
-    std::list<InterpolatorParams> list_params_;
+    //Queued segments, consumed from next_param_ on. Kept in a vector so that
+    //Add() doesn't allocate once the capacity has been reached. Add() drops
+    //the consumed prefix once it is half of the vector, so a queue that is
+    //refilled before it drains doesn't grow either
+    std::vector<InterpolatorParams> params_;
+    size_t next_param_;
 
-    float GetFormula( const INTERPOLATOR_TYPE type,
+public:
+    Interpolator();
+    ~Interpolator();
+
+    static float GetFormula( const INTERPOLATOR_TYPE type,
             const float t,
             const float b,
             const float d,
             const float c );
-public:
-    Interpolator();
-    ~Interpolator();
 
     Interpolator& Set( const float start,
             const float dest,
@@ -84,4 +90,62 @@ public:
     void Clear();
 };
 
+/******************************************************************
+ * Evaluates many animated values at once
+ * Each channel is a start value followed by a sequence of segments, like
+ * Interpolator::Set() and Interpolator::Add(). Keyframes of all channels are
+ * stored in contiguous arrays so that a frame's update has no allocation and
+ * no pointer chasing. Update() first finds the active segment of every
+ * channel, then evaluates the polynomial easings of all of them four at a
+ * time with NEON or SSE when available
+ * e.g.
+ * AnimationSet set;
+ * int32_t alpha = set.AddChannel( 0.f, now );
+ * set.AddKey( alpha, 1.f, INTERPOLATOR_TYPE_EASEOUTQUAD, 0.3 )
+ *    .AddKey( alpha, 0.f, INTERPOLATOR_TYPE_EASEINQUAD, 0.3 );
+ * ...
+ * set.Update( PerfMonitor::GetCurrentTime(), values );
+ */
+class AnimationSet
+{
+private:
+    //Per channel, keyframes of channel i are [key_begin_[i], key_begin_[i + 1])
+    std::vector<uint32_t> key_begin_;
+    std::vector<float> start_value_;
+    std::vector<double> start_time_;
+    std::vector<uint32_t> cursor_;
+
+    //Per keyframe: end time, value reached and easing of the segment leading to it
+    std::vector<double> key_time_;
+    std::vector<float> key_value_;
+    std::vector<INTERPOLATOR_TYPE> key_type_;
+
+    uint32_t FindSegment( const int32_t channel, const double current_time );
+public:
+    AnimationSet();
+
+    void Reserve( const int32_t channels, const int32_t keys );
+
+    //Adds a channel holding start_value from start_time on, returns its index
+    int32_t AddChannel( const float start_value, const double start_time );
+
+    //Appends a segment to channel. This is cheapest for the channel added
+    //last, keys of other channels are inserted in the middle of the arrays
+    AnimationSet& AddKey( const int32_t channel,
+            const float dest,
+            const INTERPOLATOR_TYPE type,
+            const double duration );
+
+    int32_t GetChannelCount() const
+    {
+        return (int32_t) start_value_.size();
+    }
+
+    //Writes the value of every channel at current_time to values, and
+    //returns the number of channels that are still animating
+    int32_t Update( const double current_time, float* values );
+
+    void Clear();
+};
+
 }   //namespace ndkHelper
@@ -16,12 +16,119 @@
 
 #include "perfMonitor.h"
 
+#include <stdio.h>
+
 namespace ndk_helper
 {
 
+//--------------------------------------------------------------------------------
+// FrameHistogram
+//--------------------------------------------------------------------------------
+FrameHistogram::FrameHistogram()
+{
+    Reset();
+}
+
+int32_t FrameHistogram::BucketIndex( uint64_t value )
+{
+    if( value < (uint64_t) HISTOGRAM_SUB_BUCKETS )
+        return (int32_t) value;
+
+    int32_t msb = 63 - __builtin_clzll( value );
+    if( msb >= HISTOGRAM_MAX_VALUE_BITS )
+        return HISTOGRAM_BUCKETS - 1;
+
+    int32_t shift = msb - HISTOGRAM_SUB_BUCKET_BITS;
+    return (shift + 1) * HISTOGRAM_SUB_BUCKETS
+            + (int32_t) (value >> shift) - HISTOGRAM_SUB_BUCKETS;
+}
+
+uint64_t FrameHistogram::BucketUpperBound( int32_t index )
+{
+    if( index < HISTOGRAM_SUB_BUCKETS )
+        return index;
+
+    int32_t shift = index / HISTOGRAM_SUB_BUCKETS - 1;
+    uint64_t sub = index % HISTOGRAM_SUB_BUCKETS + HISTOGRAM_SUB_BUCKETS;
+    return ((sub + 1) << shift) - 1;
+}
+
+void FrameHistogram::Record( uint64_t value_us )
+{
+    buckets_[BucketIndex( value_us )].fetch_add( 1, std::memory_order_relaxed );
+    count_.fetch_add( 1, std::memory_order_relaxed );
+    sum_.fetch_add( value_us, std::memory_order_relaxed );
+
+    uint64_t max = max_.load( std::memory_order_relaxed );
+    while( value_us > max
+            && !max_.compare_exchange_weak( max, value_us, std::memory_order_relaxed ) )
+    {
+    }
+}
+
+void FrameHistogram::Reset()
+{
+    for( int32_t i = 0; i < HISTOGRAM_BUCKETS; ++i )
+        buckets_[i].store( 0, std::memory_order_relaxed );
+    count_.store( 0, std::memory_order_relaxed );
+    sum_.store( 0, std::memory_order_relaxed );
+    max_.store( 0, std::memory_order_relaxed );
+}
+
+uint64_t FrameHistogram::Count() const
+{
+    return count_.load( std::memory_order_relaxed );
+}
+
+uint64_t FrameHistogram::Max() const
+{
+    return max_.load( std::memory_order_relaxed );
+}
+
+double FrameHistogram::Mean() const
+{
+    uint64_t count = Count();
+    if( count == 0 )
+        return 0.0;
+    return (double) sum_.load( std::memory_order_relaxed ) / count;
+}
+
+uint64_t FrameHistogram::Percentile( double percentile ) const
+{
+    //Sum the buckets instead of using count_, concurrent writers may have
+    //updated one but not the other yet
+    uint64_t total = 0;
+    for( int32_t i = 0; i < HISTOGRAM_BUCKETS; ++i )
+        total += buckets_[i].load( std::memory_order_relaxed );
+    if( total == 0 )
+        return 0;
+
+    uint64_t rank = (uint64_t) (percentile / 100.0 * total + 0.5);
+    if( rank < 1 )
+        rank = 1;
+
+    uint64_t seen = 0;
+    for( int32_t i = 0; i < HISTOGRAM_BUCKETS; ++i )
+    {
+        seen += buckets_[i].load( std::memory_order_relaxed );
+        if( seen >= rank )
+        {
+            uint64_t bound = BucketUpperBound( i );
+            uint64_t max = Max();
+            return bound < max ? bound : max;
+        }
+    }
+    return Max();
+}
+
+//--------------------------------------------------------------------------------
+// PerfMonitor
+//--------------------------------------------------------------------------------
+
 PerfMonitor::PerfMonitor() :
-                last_tick_( 0.f ),
+                current_FPS_( 0.f ),
                 tv_last_sec_( 0 ),
+                last_tick_( 0.f ),
                 tickindex_( 0 ),
                 ticksum_( 0 )
 {
@@ -45,17 +152,19 @@ double PerfMonitor::UpdateTick( double currentTick )
 
 bool PerfMonitor::Update( float &fFPS )
 {
-    struct timeval Time;
-    gettimeofday( &Time, NULL );
+    //Frame times go into the histogram, so use a clock that can't step backwards
+    struct timespec Time;
+    clock_gettime( CLOCK_MONOTONIC, &Time );
 
-    double time = Time.tv_sec + Time.tv_usec * 1.0 / 1000000.0;
+    double time = Time.tv_sec + Time.tv_nsec * 1.0 / 1000000000.0;
     double tick = time - last_tick_;
     double d = UpdateTick( tick );
+    if( last_tick_ != 0 && tick > 0 )
+        histograms_[PERF_PHASE_FRAME].Record( (uint64_t) (tick * 1000000.0) );
     last_tick_ = time;
 
     if( Time.tv_sec - tv_last_sec_ >= 1 )
     {
-        double time = Time.tv_sec + Time.tv_usec * 1.0 / 1000000.0;
         current_FPS_ = 1.f / d;
         tv_last_sec_ = Time.tv_sec;
         fFPS = current_FPS_;
@@ -68,5 +177,35 @@ bool PerfMonitor::Update( float &fFPS )
     }
 }
 
+void PerfMonitor::ResetHistograms()
+{
+    for( int32_t i = 0; i < PERF_PHASE_COUNT; ++i )
+        histograms_[i].Reset();
+}
+
+std::string PerfMonitor::DumpJSON() const
+{
+    static const char* const phase_names[PERF_PHASE_COUNT] = { "frame", "update",
+            "render", "present" };
+
+    std::string ret = "{";
+    for( int32_t i = 0; i < PERF_PHASE_COUNT; ++i )
+    {
+        const FrameHistogram& h = histograms_[i];
+        char buf[256];
+        snprintf( buf, sizeof(buf),
+                "%s\"%s\":{\"count\":%llu,\"mean_us\":%.1f,\"p50_us\":%llu,"
+                "\"p90_us\":%llu,\"p99_us\":%llu,\"max_us\":%llu}",
+                i ? "," : "", phase_names[i], (unsigned long long) h.Count(), h.Mean(),
+                (unsigned long long) h.Percentile( 50 ),
+                (unsigned long long) h.Percentile( 90 ),
+                (unsigned long long) h.Percentile( 99 ),
+                (unsigned long long) h.Max() );
+        ret += buf;
+    }
+    ret += "}";
+    return ret;
+}
+
 }   //namespace ndkHelper
 
@@ -19,6 +19,8 @@
 #include <jni.h>
 #include <errno.h>
 #include <time.h>
+#include <atomic>
+#include <string>
 #include "JNIHelper.h"
 
 namespace ndk_helper
@@ -26,8 +28,60 @@ namespace ndk_helper
 
 const int32_t NUM_SAMPLES = 100;
 
+//--------------------------------------------------------------------------------
+// Histogram layout: values below 2^HISTOGRAM_SUB_BUCKET_BITS microseconds get
+// their own bucket, every larger power of two is split into
+// 2^HISTOGRAM_SUB_BUCKET_BITS buckets, which bounds the error of any reported
+// percentile to about 3%. Values are clamped at about 67 seconds.
+//--------------------------------------------------------------------------------
+const int32_t HISTOGRAM_SUB_BUCKET_BITS = 5;
+const int32_t HISTOGRAM_SUB_BUCKETS = 1 << HISTOGRAM_SUB_BUCKET_BITS;
+const int32_t HISTOGRAM_MAX_VALUE_BITS = 26;
+const int32_t HISTOGRAM_BUCKETS = (HISTOGRAM_MAX_VALUE_BITS - HISTOGRAM_SUB_BUCKET_BITS + 1)
+        * HISTOGRAM_SUB_BUCKETS;
+
+enum PERF_PHASE
+{
+    PERF_PHASE_FRAME,
+    PERF_PHASE_UPDATE,
+    PERF_PHASE_RENDER,
+    PERF_PHASE_PRESENT,
+    PERF_PHASE_COUNT,
+};
+
+/******************************************************************
+ * Log-linear histogram of durations in microseconds
+ * Record() is lock-free and may be called from several threads at once
+ */
+class FrameHistogram
+{
+private:
+    std::atomic<uint32_t> buckets_[HISTOGRAM_BUCKETS];
+    std::atomic<uint64_t> count_;
+    std::atomic<uint64_t> sum_;
+    std::atomic<uint64_t> max_;
+
+public:
+    FrameHistogram();
+
+    //Returns the bucket of a value, and the largest value of a bucket
+    static int32_t BucketIndex( uint64_t value );
+    static uint64_t BucketUpperBound( int32_t index );
+
+    void Record( uint64_t value_us );
+    void Reset();
+
+    uint64_t Count() const;
+    uint64_t Max() const;
+    double Mean() const;
+    //Returns the value below which the given percentage (0-100) of samples fall
+    uint64_t Percentile( double percentile ) const;
+};
+
 /******************************************************************
  * Helper class for a performance monitoring and get current tick time
+ * Besides the running FPS average, frame times and per-phase durations are
+ * collected into histograms to report percentiles
  */
 class PerfMonitor
 {
@@ -40,6 +94,8 @@ private:
     double ticksum_;
     double ticklist_[NUM_SAMPLES];
 
+    FrameHistogram histograms_[PERF_PHASE_COUNT];
+
     double UpdateTick( double current_tick );
 public:
     PerfMonitor();
@@ -47,6 +103,28 @@ public:
 
     bool Update( float &fFPS );
 
+    void RecordPhase( const PERF_PHASE phase, const uint64_t duration_us )
+    {
+        histograms_[phase].Record( duration_us );
+    }
+
+    const FrameHistogram& GetHistogram( const PERF_PHASE phase ) const
+    {
+        return histograms_[phase];
+    }
+
+    void ResetHistograms();
+
+    //Returns count, mean, p50, p90, p99 and max of each phase as a JSON object
+    std::string DumpJSON() const;
+
+    static uint64_t GetCurrentTimeUs()
+    {
+        struct timespec now;
+        clock_gettime( CLOCK_MONOTONIC, &now );
+        return (uint64_t) now.tv_sec * 1000000 + now.tv_nsec / 1000;
+    }
+
     static double GetCurrentTime()
     {
         struct timeval time;
@@ -56,4 +134,33 @@ public:
     }
 };
 
+/******************************************************************
+ * Records the time spent in its scope into one phase of a PerfMonitor
+ * e.g.
+ * {
+ *     ScopedPhaseTimer timer( monitor, PERF_PHASE_RENDER );
+ *     Render();
+ * }
+ */
+class ScopedPhaseTimer
+{
+private:
+    PerfMonitor& monitor_;
+    PERF_PHASE phase_;
+    uint64_t start_us_;
+
+public:
+    ScopedPhaseTimer( PerfMonitor& monitor, const PERF_PHASE phase ) :
+                    monitor_( monitor ),
+                    phase_( phase ),
+                    start_us_( PerfMonitor::GetCurrentTimeUs() )
+    {
+    }
+
+    ~ScopedPhaseTimer()
+    {
+        monitor_.RecordPhase( phase_, PerfMonitor::GetCurrentTimeUs() - start_us_ );
+    }
+};
+
 }   //namespace ndkHelper
@@ -0,0 +1,37 @@
+LOCAL_PATH:= $(call my-dir)
+
+include $(CLEAR_VARS)
+
+LOCAL_MODULE:= ndk_helper_vecmath_test
+LOCAL_SRC_FILES:= vecmath_test.cpp ../vecmath.cpp
+LOCAL_C_INCLUDES := $(LOCAL_PATH)/.. $(LOCAL_PATH)/../../native_app_glue
+LOCAL_CFLAGS := -Wall -Werror
+
+include $(BUILD_EXECUTABLE)
+
+include $(CLEAR_VARS)
+
+LOCAL_MODULE:= ndk_helper_vecmath_benchmark
+LOCAL_SRC_FILES:= vecmath_benchmark.cpp ../vecmath.cpp
+LOCAL_C_INCLUDES := $(LOCAL_PATH)/.. $(LOCAL_PATH)/../../native_app_glue
+LOCAL_CFLAGS := -Wall -Werror -O2
+
+include $(BUILD_EXECUTABLE)
+
+include $(CLEAR_VARS)
+
+LOCAL_MODULE:= ndk_helper_interpolator_test
+LOCAL_SRC_FILES:= interpolator_test.cpp ../interpolator.cpp
+LOCAL_C_INCLUDES := $(LOCAL_PATH)/.. $(LOCAL_PATH)/../../native_app_glue
+LOCAL_CFLAGS := -Wall -Werror
+
+include $(BUILD_EXECUTABLE)
+
+include $(CLEAR_VARS)
+
+LOCAL_MODULE:= ndk_helper_perf_monitor_test
+LOCAL_SRC_FILES:= perf_monitor_test.cpp ../perfMonitor.cpp
+LOCAL_C_INCLUDES := $(LOCAL_PATH)/.. $(LOCAL_PATH)/../../native_app_glue
+LOCAL_CFLAGS := -Wall -Werror
+
+include $(BUILD_EXECUTABLE)
@@ -0,0 +1,252 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//--------------------------------------------------------------------------------
+// interpolator_test.cpp
+// Checks Interpolator's segment queue and AnimationSet's batched evaluation
+// against Interpolator::GetFormula(). operator new is replaced to count
+// allocations, so that steady-state updates can be checked not to allocate.
+//--------------------------------------------------------------------------------
+#include "interpolator.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <new>
+
+using ndk_helper::AnimationSet;
+using ndk_helper::INTERPOLATOR_TYPE;
+using ndk_helper::Interpolator;
+
+static int failures = 0;
+
+#define CHECK( cond ) \
+    do { \
+        if( !(cond) ) { \
+            fprintf( stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, \
+                    #cond ); \
+            ++failures; \
+        } \
+    } while( 0 )
+
+static int32_t g_allocations = 0;
+
+void* operator new( size_t size )
+{
+    ++g_allocations;
+    void* p = malloc( size ? size : 1 );
+    if( p == NULL )
+        throw std::bad_alloc();
+    return p;
+}
+
+void operator delete( void* p ) noexcept
+{
+    free( p );
+}
+
+void operator delete( void* p, size_t ) noexcept
+{
+    free( p );
+}
+
+static const int32_t kTypeCount = ndk_helper::INTERPOLATOR_TYPE_EASEOUTEXPO + 1;
+
+// Later than any segment in these tests.
+static const double kFarFuture = 1e12;
+
+static bool Near( float a, float b )
+{
+    if( fabsf( a - b ) <= 1e-5f * (fabsf( b ) > 1.f ? fabsf( b ) : 1.f) )
+        return true;
+    fprintf( stderr, "  %.9g != %.9g\n", a, b );
+    return false;
+}
+
+//--------------------------------------------------------------------------------
+// Interpolator
+//--------------------------------------------------------------------------------
+static void TestInterpolatorQueue()
+{
+    Interpolator interpolator;
+    float p = -1.f;
+    interpolator.Set( 0.f, 1.f, ndk_helper::INTERPOLATOR_TYPE_LINEAR, 1.0 )
+            .Add( 2.f, ndk_helper::INTERPOLATOR_TYPE_EASEINQUAD, 1.0 )
+            .Add( 3.f, ndk_helper::INTERPOLATOR_TYPE_EASEOUTQUAD, 1.0 );
+
+    // Each update past the end of a segment reaches its value and starts the
+    // next one.
+    CHECK( interpolator.Update( kFarFuture, p ) && p == 1.f );
+    CHECK( interpolator.Update( kFarFuture, p ) && p == 2.f );
+    CHECK( !interpolator.Update( kFarFuture, p ) && p == 3.f );
+
+    // The drained queue can be refilled.
+    interpolator.Set( 5.f, 6.f, ndk_helper::INTERPOLATOR_TYPE_LINEAR, 1.0 )
+            .Add( 7.f, ndk_helper::INTERPOLATOR_TYPE_LINEAR, 1.0 );
+    CHECK( interpolator.Update( kFarFuture, p ) && p == 6.f );
+    CHECK( !interpolator.Update( kFarFuture, p ) && p == 7.f );
+}
+
+static void TestInterpolatorQueueNeverDrained()
+{
+    // A queue that is refilled before it drains, e.g. a value that follows
+    // a stream of targets, keeps a bounded size.
+    Interpolator interpolator;
+    float p = -1.f;
+    interpolator.Set( 0.f, 0.f, ndk_helper::INTERPOLATOR_TYPE_LINEAR, 1.0 )
+            .Add( 1.f, ndk_helper::INTERPOLATOR_TYPE_LINEAR, 1.0 )
+            .Add( 2.f, ndk_helper::INTERPOLATOR_TYPE_LINEAR, 1.0 );
+
+    int32_t allocations = 0;
+    for( int32_t i = 0; i < 10000; ++i )
+    {
+        if( i == 100 )
+            allocations = g_allocations;
+        CHECK( interpolator.Update( kFarFuture, p ) );
+        CHECK( p == (float) i );
+        interpolator.Add( (float) (i + 3), ndk_helper::INTERPOLATOR_TYPE_LINEAR, 1.0 );
+    }
+    CHECK( g_allocations == allocations );
+}
+
+//--------------------------------------------------------------------------------
+// AnimationSet
+//--------------------------------------------------------------------------------
+static void TestAnimationSetMatchesFormula()
+{
+    // One channel per easing type, from 2 to 5 over 2 seconds starting at 10,
+    // evaluated in a single update.
+    AnimationSet set;
+    for( int32_t type = 0; type < kTypeCount; ++type )
+    {
+        int32_t channel = set.AddChannel( 2.f, 10.0 );
+        set.AddKey( channel, 5.f, (INTERPOLATOR_TYPE) type, 2.0 );
+    }
+
+    const double times[] = { 10.0, 10.3, 10.9, 11.0, 11.5, 11.999 };
+    for( size_t n = 0; n < sizeof(times) / sizeof(times[0]); ++n )
+    {
+        float values[kTypeCount];
+        CHECK( set.Update( times[n], values ) == kTypeCount );
+        for( int32_t type = 0; type < kTypeCount; ++type )
+        {
+            float expected = Interpolator::GetFormula( (INTERPOLATOR_TYPE) type,
+                    (float) (times[n] - 10.0), 2.f, 2.f, 3.f );
+            CHECK( Near( values[type], expected ) );
+        }
+    }
+}
+
+static void TestAnimationSetBatchPositions()
+{
+    // More channels than an evaluation block, with polynomial types mixed
+    // within each group of four. Entries evaluated four at a time, in the
+    // scalar tail, or in the next block give the same results.
+    const int32_t kChannels = 67;
+    const int32_t kPolynomialTypes = ndk_helper::INTERPOLATOR_TYPE_EASEINQUART + 1;
+    AnimationSet set;
+    for( int32_t i = 0; i < kChannels; ++i )
+    {
+        int32_t channel = set.AddChannel( -1.f, 0.0 );
+        set.AddKey( channel, 3.f, (INTERPOLATOR_TYPE) (i % kPolynomialTypes), 1.0 );
+    }
+
+    const double times[] = { 0.0, 0.25, 0.5, 0.75 };
+    for( size_t n = 0; n < sizeof(times) / sizeof(times[0]); ++n )
+    {
+        float values[kChannels];
+        CHECK( set.Update( times[n], values ) == kChannels );
+        for( int32_t i = 0; i < kChannels; ++i )
+        {
+            CHECK( values[i] == values[i % kPolynomialTypes] );
+            float expected = Interpolator::GetFormula(
+                    (INTERPOLATOR_TYPE) (i % kPolynomialTypes), (float) times[n], -1.f, 1.f, 4.f );
+            CHECK( Near( values[i], expected ) );
+        }
+    }
+}
+
+static void TestAnimationSetSegments()
+{
+    AnimationSet set;
+    int32_t a = set.AddChannel( 0.f, 1.0 );
+    int32_t b = set.AddChannel( 10.f, 1.0 );
+    // Keys of a are added after b exists, and keys of the two interleave.
+    set.AddKey( b, 20.f, ndk_helper::INTERPOLATOR_TYPE_LINEAR, 4.0 );
+    set.AddKey( a, 1.f, ndk_helper::INTERPOLATOR_TYPE_LINEAR, 1.0 )
+            .AddKey( a, 3.f, ndk_helper::INTERPOLATOR_TYPE_LINEAR, 1.0 );
+    set.AddKey( b, 0.f, ndk_helper::INTERPOLATOR_TYPE_LINEAR, 1.0 );
+    set.AddKey( a, 4.f, ndk_helper::INTERPOLATOR_TYPE_LINEAR, 2.0 );
+    // Out of range channels are ignored.
+    set.AddKey( 2, 100.f, ndk_helper::INTERPOLATOR_TYPE_LINEAR, 1.0 );
+    set.AddKey( -1, 100.f, ndk_helper::INTERPOLATOR_TYPE_LINEAR, 1.0 );
+    CHECK( set.GetChannelCount() == 2 );
+
+    // a: 0 at 1s, 1 at 2s, 3 at 3s, 4 at 5s. b: 10 at 1s, 20 at 5s, 0 at 6s.
+    float values[2];
+    CHECK( set.Update( 0.0, values ) == 0 );
+    CHECK( values[a] == 0.f && values[b] == 10.f );
+    CHECK( set.Update( 1.5, values ) == 2 );
+    CHECK( Near( values[a], 0.5f ) && Near( values[b], 11.25f ) );
+    CHECK( set.Update( 2.5, values ) == 2 );
+    CHECK( Near( values[a], 2.f ) && Near( values[b], 13.75f ) );
+    CHECK( set.Update( 4.0, values ) == 2 );
+    CHECK( Near( values[a], 3.5f ) && Near( values[b], 17.5f ) );
+    CHECK( set.Update( 5.5, values ) == 1 );
+    CHECK( values[a] == 4.f && Near( values[b], 10.f ) );
+    CHECK( set.Update( 6.0, values ) == 0 );
+    CHECK( values[a] == 4.f && values[b] == 0.f );
+
+    // Going back in time skips the cursor, and the segment is searched for.
+    CHECK( set.Update( 1.5, values ) == 2 );
+    CHECK( Near( values[a], 0.5f ) && Near( values[b], 11.25f ) );
+}
+
+static void TestAnimationSetUpdateDoesNotAllocate()
+{
+    const int32_t kChannels = 1000;
+    AnimationSet set;
+    set.Reserve( kChannels, kChannels * 3 );
+    for( int32_t i = 0; i < kChannels; ++i )
+    {
+        int32_t channel = set.AddChannel( 0.f, 0.0 );
+        for( int32_t k = 1; k <= 3; ++k )
+            set.AddKey( channel, (float) k, (INTERPOLATOR_TYPE) ((i + k) % kTypeCount), 1.0 );
+    }
+
+    static float values[kChannels];
+    int32_t allocations = g_allocations;
+    for( int32_t frame = 0; frame < 180; ++frame )
+        CHECK( set.Update( frame / 60.0, values ) == kChannels );
+    CHECK( g_allocations == allocations );
+}
+
+int main()
+{
+    TestInterpolatorQueue();
+    TestInterpolatorQueueNeverDrained();
+    TestAnimationSetMatchesFormula();
+    TestAnimationSetBatchPositions();
+    TestAnimationSetSegments();
+    TestAnimationSetUpdateDoesNotAllocate();
+    if( failures != 0 )
+    {
+        fprintf( stderr, "%d checks failed\n", failures );
+        return 1;
+    }
+    printf( "PASS\n" );
+    return 0;
+}
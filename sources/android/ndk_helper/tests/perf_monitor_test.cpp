@@ -0,0 +1,326 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//--------------------------------------------------------------------------------
+// perf_monitor_test.cpp
+// Checks FrameHistogram's bucket layout, and its percentiles against the exact
+// percentiles of synthetic frame time streams. Also checks concurrent
+// recording, PerfMonitor::DumpJSON() and ScopedPhaseTimer.
+//--------------------------------------------------------------------------------
+#include "perfMonitor.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+using ndk_helper::FrameHistogram;
+using ndk_helper::PerfMonitor;
+using ndk_helper::ScopedPhaseTimer;
+
+static int failures = 0;
+
+#define CHECK( cond ) \
+    do { \
+        if( !(cond) ) { \
+            fprintf( stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, \
+                    #cond ); \
+            ++failures; \
+        } \
+    } while( 0 )
+
+// The error bound of a percentile, from the number of sub buckets.
+static const double kTolerance = 1.0 / ndk_helper::HISTOGRAM_SUB_BUCKETS;
+
+// A fixed LCG, so that every run checks the same values.
+static uint32_t g_seed = 12345;
+
+static uint32_t Random()
+{
+    g_seed = g_seed * 1664525u + 1013904223u;
+    return g_seed >> 8;
+}
+
+//--------------------------------------------------------------------------------
+// Bucket layout
+//--------------------------------------------------------------------------------
+// The bucket of a value must be the one whose range holds it.
+static bool InBucket( uint64_t value )
+{
+    int32_t index = FrameHistogram::BucketIndex( value );
+    if( FrameHistogram::BucketUpperBound( index ) < value )
+        return false;
+    return index == 0 || FrameHistogram::BucketUpperBound( index - 1 ) < value;
+}
+
+static void TestBucketBoundaries()
+{
+    // Small values are exact.
+    for( uint64_t v = 0; v < (uint64_t) ndk_helper::HISTOGRAM_SUB_BUCKETS; ++v )
+    {
+        CHECK( FrameHistogram::BucketIndex( v ) == (int32_t) v );
+        CHECK( FrameHistogram::BucketUpperBound( (int32_t) v ) == v );
+    }
+
+    // Every power of two starts a new bucket, right after the bucket ending at
+    // the value before it.
+    for( int32_t bits = ndk_helper::HISTOGRAM_SUB_BUCKET_BITS;
+            bits < ndk_helper::HISTOGRAM_MAX_VALUE_BITS; ++bits )
+    {
+        uint64_t p = 1ull << bits;
+        int32_t index = FrameHistogram::BucketIndex( p );
+        CHECK( index == FrameHistogram::BucketIndex( p - 1 ) + 1 );
+        CHECK( FrameHistogram::BucketUpperBound( index - 1 ) == p - 1 );
+        CHECK( InBucket( p - 1 ) );
+        CHECK( InBucket( p ) );
+        CHECK( InBucket( p + 1 ) );
+        // The power of two splits into HISTOGRAM_SUB_BUCKETS equal buckets.
+        CHECK( FrameHistogram::BucketIndex( 2 * p - 1 )
+                == index + ndk_helper::HISTOGRAM_SUB_BUCKETS - 1 );
+        CHECK( FrameHistogram::BucketUpperBound( index )
+                == p + (p >> ndk_helper::HISTOGRAM_SUB_BUCKET_BITS) - 1 );
+    }
+
+    for( uint64_t v = 0; v < (1u << 16); ++v )
+        CHECK( InBucket( v ) );
+
+    // No bucket is wider than kTolerance of its values.
+    for( int32_t i = 1; i < ndk_helper::HISTOGRAM_BUCKETS; ++i )
+    {
+        uint64_t lower = FrameHistogram::BucketUpperBound( i - 1 ) + 1;
+        uint64_t upper = FrameHistogram::BucketUpperBound( i );
+        CHECK( upper >= lower );
+        CHECK( upper - lower <= lower * kTolerance );
+    }
+
+    // Values past the last power of two are clamped.
+    uint64_t limit = 1ull << ndk_helper::HISTOGRAM_MAX_VALUE_BITS;
+    CHECK( FrameHistogram::BucketIndex( limit - 1 ) == ndk_helper::HISTOGRAM_BUCKETS - 1 );
+    CHECK( FrameHistogram::BucketIndex( limit ) == ndk_helper::HISTOGRAM_BUCKETS - 1 );
+    CHECK( FrameHistogram::BucketIndex( ~0ull ) == ndk_helper::HISTOGRAM_BUCKETS - 1 );
+}
+
+//--------------------------------------------------------------------------------
+// Percentiles
+//--------------------------------------------------------------------------------
+// Nearest-rank percentile of sorted values, as FrameHistogram ranks them.
+static uint64_t ExactPercentile( const std::vector<uint64_t>& sorted, double percentile )
+{
+    size_t rank = (size_t) (percentile / 100.0 * sorted.size() + 0.5);
+    if( rank < 1 )
+        rank = 1;
+    return sorted[rank - 1];
+}
+
+static void CheckPercentiles( const std::vector<uint64_t>& values )
+{
+    FrameHistogram histogram;
+    for( size_t i = 0; i < values.size(); ++i )
+        histogram.Record( values[i] );
+
+    std::vector<uint64_t> sorted( values );
+    std::sort( sorted.begin(), sorted.end() );
+
+    static const double percentiles[] = { 50, 90, 99 };
+    for( size_t i = 0; i < sizeof(percentiles) / sizeof(percentiles[0]); ++i )
+    {
+        uint64_t exact = ExactPercentile( sorted, percentiles[i] );
+        uint64_t reported = histogram.Percentile( percentiles[i] );
+        if( reported < exact || reported - exact > exact * kTolerance )
+        {
+            fprintf( stderr, "p%g: reported %llu, exact %llu\n", percentiles[i],
+                    (unsigned long long) reported, (unsigned long long) exact );
+            ++failures;
+        }
+    }
+    CHECK( histogram.Count() == values.size() );
+    CHECK( histogram.Max() == sorted.back() );
+    CHECK( histogram.Percentile( 100 ) == sorted.back() );
+}
+
+static void TestPercentiles()
+{
+    // Steady 60 fps frames with jitter.
+    std::vector<uint64_t> steady;
+    for( int32_t i = 0; i < 10000; ++i )
+        steady.push_back( 16667 - 1000 + Random() % 2000 );
+    CheckPercentiles( steady );
+
+    // Mostly fast frames with a long tail of hitches.
+    std::vector<uint64_t> hitches;
+    for( int32_t i = 0; i < 10000; ++i )
+    {
+        uint32_t r = Random();
+        if( r % 100 < 90 )
+            hitches.push_back( 8000 + r % 4000 );
+        else if( r % 100 < 99 )
+            hitches.push_back( 30000 + r % 20000 );
+        else
+            hitches.push_back( 100000 + r % 400000 );
+    }
+    CheckPercentiles( hitches );
+
+    // Values spread over every power of two.
+    std::vector<uint64_t> spread;
+    for( int32_t i = 0; i < 10000; ++i )
+        spread.push_back( Random() >> (Random() % 24) );
+    CheckPercentiles( spread );
+}
+
+//--------------------------------------------------------------------------------
+// Max and Reset
+//--------------------------------------------------------------------------------
+static void TestMaxAndReset()
+{
+    FrameHistogram histogram;
+    CHECK( histogram.Count() == 0 );
+    CHECK( histogram.Max() == 0 );
+    CHECK( histogram.Mean() == 0.0 );
+    CHECK( histogram.Percentile( 50 ) == 0 );
+
+    histogram.Record( 300 );
+    histogram.Record( 100 );
+    histogram.Record( 200 );
+    CHECK( histogram.Count() == 3 );
+    CHECK( histogram.Max() == 300 );
+    CHECK( histogram.Mean() == 200.0 );
+    // Percentiles never exceed the largest value.
+    CHECK( histogram.Percentile( 99 ) == 300 );
+
+    histogram.Reset();
+    CHECK( histogram.Count() == 0 );
+    CHECK( histogram.Max() == 0 );
+    CHECK( histogram.Mean() == 0.0 );
+    CHECK( histogram.Percentile( 50 ) == 0 );
+
+    histogram.Record( 20 );
+    CHECK( histogram.Count() == 1 );
+    CHECK( histogram.Max() == 20 );
+    CHECK( histogram.Percentile( 50 ) == 20 );
+}
+
+//--------------------------------------------------------------------------------
+// Concurrent recording
+//--------------------------------------------------------------------------------
+static void TestConcurrentRecord()
+{
+    const int32_t kThreads = 4;
+    const int32_t kRecords = 100000;
+
+    // Each thread records its own exact value, so that lost bucket increments
+    // show up in the percentiles.
+    FrameHistogram histogram;
+    std::vector<std::thread> threads;
+    for( int32_t t = 0; t < kThreads; ++t )
+    {
+        threads.push_back( std::thread( [&histogram, t]()
+        {
+            for( int32_t i = 0; i < kRecords; ++i )
+                histogram.Record( t + 1 );
+        } ) );
+    }
+    for( size_t t = 0; t < threads.size(); ++t )
+        threads[t].join();
+
+    CHECK( histogram.Count() == (uint64_t) kThreads * kRecords );
+    CHECK( histogram.Max() == (uint64_t) kThreads );
+    CHECK( histogram.Mean() == (kThreads + 1) / 2.0 );
+    for( int32_t t = 0; t < kThreads; ++t )
+        CHECK( histogram.Percentile( 100.0 * (t + 1) / kThreads ) == (uint64_t) (t + 1) );
+}
+
+//--------------------------------------------------------------------------------
+// PerfMonitor
+//--------------------------------------------------------------------------------
+static void TestDumpJSON()
+{
+    PerfMonitor monitor;
+    monitor.RecordPhase( ndk_helper::PERF_PHASE_RENDER, 100 );
+    monitor.RecordPhase( ndk_helper::PERF_PHASE_RENDER, 200 );
+    monitor.RecordPhase( ndk_helper::PERF_PHASE_RENDER, 300 );
+
+    // 200 falls in the bucket [200, 203].
+    const char* expected =
+            "{\"frame\":{\"count\":0,\"mean_us\":0.0,\"p50_us\":0,\"p90_us\":0,"
+            "\"p99_us\":0,\"max_us\":0},"
+            "\"update\":{\"count\":0,\"mean_us\":0.0,\"p50_us\":0,\"p90_us\":0,"
+            "\"p99_us\":0,\"max_us\":0},"
+            "\"render\":{\"count\":3,\"mean_us\":200.0,\"p50_us\":203,\"p90_us\":300,"
+            "\"p99_us\":300,\"max_us\":300},"
+            "\"present\":{\"count\":0,\"mean_us\":0.0,\"p50_us\":0,\"p90_us\":0,"
+            "\"p99_us\":0,\"max_us\":0}}";
+    std::string json = monitor.DumpJSON();
+    if( json != expected )
+    {
+        fprintf( stderr, "DumpJSON: %s\nexpected: %s\n", json.c_str(), expected );
+        ++failures;
+    }
+
+    monitor.ResetHistograms();
+    CHECK( monitor.GetHistogram( ndk_helper::PERF_PHASE_RENDER ).Count() == 0 );
+}
+
+static void TestScopedPhaseTimer()
+{
+    PerfMonitor monitor;
+    {
+        ScopedPhaseTimer timer( monitor, ndk_helper::PERF_PHASE_UPDATE );
+        usleep( 2000 );
+    }
+    const FrameHistogram& update = monitor.GetHistogram( ndk_helper::PERF_PHASE_UPDATE );
+    CHECK( update.Count() == 1 );
+    CHECK( update.Max() >= 2000 );
+    CHECK( monitor.GetHistogram( ndk_helper::PERF_PHASE_RENDER ).Count() == 0 );
+}
+
+static void TestUpdateRecordsFrameTimes()
+{
+    PerfMonitor monitor;
+    float fps;
+    // The first call only starts the clock.
+    monitor.Update( fps );
+    const FrameHistogram& frame = monitor.GetHistogram( ndk_helper::PERF_PHASE_FRAME );
+    CHECK( frame.Count() == 0 );
+
+    usleep( 2000 );
+    monitor.Update( fps );
+    usleep( 2000 );
+    monitor.Update( fps );
+    CHECK( frame.Count() == 2 );
+    CHECK( frame.Percentile( 0 ) >= 2000 );
+    // Far below the 2^HISTOGRAM_MAX_VALUE_BITS overflow bucket.
+    CHECK( frame.Max() < 1000000 );
+}
+
+int main()
+{
+    TestBucketBoundaries();
+    TestPercentiles();
+    TestMaxAndReset();
+    TestConcurrentRecord();
+    TestDumpJSON();
+    TestScopedPhaseTimer();
+    TestUpdateRecordsFrameTimes();
+    if( failures != 0 )
+    {
+        fprintf( stderr, "%d checks failed\n", failures );
+        return 1;
+    }
+    printf( "PASS\n" );
+    return 0;
+}
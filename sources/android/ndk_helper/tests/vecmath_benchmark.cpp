@@ -0,0 +1,192 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//--------------------------------------------------------------------------------
+// vecmath_benchmark.cpp
+// Times the Mat4 products and batch transforms against the scalar loops they
+// replace, and the operations that are still scalar (Inverse(), Quaternion
+// products). Prints nanoseconds per operation:
+//     vecmath_benchmark [iterations]
+//--------------------------------------------------------------------------------
+#include "vecmath.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+using ndk_helper::Mat4;
+using ndk_helper::Quaternion;
+using ndk_helper::Vec3;
+using ndk_helper::Vec4;
+
+static const int32_t kBatch = 1024;
+
+// Results are summed in here so that the compiler cannot drop the work.
+static volatile float g_sink;
+
+static double NowNs()
+{
+    struct timespec ts;
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void Report( const char* name, double start, int32_t ops )
+{
+    printf( "%-28s %8.2f ns/op\n", name, (NowNs() - start) / ops );
+}
+
+//--------------------------------------------------------------------------------
+// The scalar code the SIMD paths replaced
+//--------------------------------------------------------------------------------
+static void ScalarMulVec( const float* m, const float* v, float* out )
+{
+    float x = v[0], y = v[1], z = v[2], w = v[3];
+    out[0] = x * m[0] + y * m[4] + z * m[8] + w * m[12];
+    out[1] = x * m[1] + y * m[5] + z * m[9] + w * m[13];
+    out[2] = x * m[2] + y * m[6] + z * m[10] + w * m[14];
+    out[3] = x * m[3] + y * m[7] + z * m[11] + w * m[15];
+}
+
+static void ScalarMulMat( const float* a, const float* b, float* out )
+{
+    for( int32_t c = 0; c < 16; c += 4 )
+        ScalarMulVec( a, b + c, out + c );
+}
+
+//--------------------------------------------------------------------------------
+// Benchmarks
+//--------------------------------------------------------------------------------
+static void BenchMat4TimesMat4( Mat4 m, int32_t iterations )
+{
+    Mat4 acc = Mat4::Identity();
+    double start = NowNs();
+    for( int32_t i = 0; i < iterations; ++i )
+    {
+        float out[16];
+        ScalarMulMat( acc.Ptr(), m.Ptr(), out );
+        acc = Mat4( out );
+    }
+    Report( "Mat4*Mat4 scalar", start, iterations );
+    g_sink = acc.Ptr()[0];
+
+    acc = Mat4::Identity();
+    start = NowNs();
+    for( int32_t i = 0; i < iterations; ++i )
+        acc = acc * m;
+    Report( "Mat4*Mat4", start, iterations );
+    g_sink = acc.Ptr()[0];
+}
+
+static void BenchTransform( Mat4 m, Vec4* vecs, int32_t iterations )
+{
+    double start = NowNs();
+    for( int32_t i = 0; i < iterations; ++i )
+    {
+        float* f = reinterpret_cast<float*>( vecs );
+        for( int32_t n = 0; n < kBatch; ++n )
+        {
+            float out[4];
+            ScalarMulVec( m.Ptr(), f + 4 * n, out );
+            vecs[n] = Vec4( out );
+        }
+    }
+    Report( "Mat4*Vec4 scalar", start, iterations * kBatch );
+
+    start = NowNs();
+    for( int32_t i = 0; i < iterations; ++i )
+    {
+        for( int32_t n = 0; n < kBatch; ++n )
+            vecs[n] = m * vecs[n];
+    }
+    Report( "Mat4*Vec4", start, iterations * kBatch );
+
+    start = NowNs();
+    for( int32_t i = 0; i < iterations; ++i )
+        m.Transform( vecs, vecs, kBatch );
+    Report( "Mat4::Transform", start, iterations * kBatch );
+
+    float x, y, z, w;
+    vecs[0].Value( x, y, z, w );
+    g_sink = x;
+}
+
+static void BenchTransformPoints( Mat4 m, float* x, float* y, float* z, int32_t iterations )
+{
+    const float* f = m.Ptr();
+    double start = NowNs();
+    for( int32_t i = 0; i < iterations; ++i )
+    {
+        for( int32_t n = 0; n < kBatch; ++n )
+        {
+            float px = x[n], py = y[n], pz = z[n];
+            x[n] = px * f[0] + py * f[4] + pz * f[8] + f[12];
+            y[n] = px * f[1] + py * f[5] + pz * f[9] + f[13];
+            z[n] = px * f[2] + py * f[6] + pz * f[10] + f[14];
+        }
+    }
+    Report( "SoA points scalar", start, iterations * kBatch );
+
+    start = NowNs();
+    for( int32_t i = 0; i < iterations; ++i )
+        m.TransformPoints( x, y, z, x, y, z, kBatch );
+    Report( "Mat4::TransformPoints", start, iterations * kBatch );
+    g_sink = x[0];
+}
+
+static void BenchScalarOnly( int32_t iterations )
+{
+    Mat4 m = Mat4::Translation( 1.f, 2.f, 3.f ) * Mat4::RotationY( 0.3f );
+    double start = NowNs();
+    for( int32_t i = 0; i < iterations; ++i )
+        m.Inverse();
+    Report( "Mat4::Inverse", start, iterations );
+    g_sink = m.Ptr()[12];
+
+    Quaternion q = Quaternion::RotationAxis( Vec3( 0.f, 1.f, 0.f ), 0.01f );
+    Quaternion acc;
+    start = NowNs();
+    for( int32_t i = 0; i < iterations; ++i )
+        acc *= q;
+    Report( "Quaternion*Quaternion", start, iterations );
+    float x, y, z, w;
+    acc.Value( x, y, z, w );
+    g_sink = w;
+}
+
+int main( int argc, char** argv )
+{
+    const int32_t iterations = argc > 1 ? atoi( argv[1] ) : 2000;
+
+    // A rotation, so that repeated products stay bounded.
+    Mat4 m = Mat4::RotationX( 0.001f ) * Mat4::RotationZ( 0.002f );
+
+    static Vec4 vecs[kBatch];
+    static float x[kBatch], y[kBatch], z[kBatch];
+    for( int32_t n = 0; n < kBatch; ++n )
+    {
+        vecs[n] = Vec4( (float)n, 1.f, -1.f, 1.f );
+        x[n] = (float)n;
+        y[n] = 0.5f * n;
+        z[n] = -0.25f * n;
+    }
+
+    BenchMat4TimesMat4( m, iterations * kBatch );
+    BenchTransform( m, vecs, iterations );
+    BenchTransformPoints( m, x, y, z, iterations );
+    BenchScalarOnly( iterations * kBatch );
+    return 0;
+}
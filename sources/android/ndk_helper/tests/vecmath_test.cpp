@@ -0,0 +1,292 @@
+/*
+ * Copyright 2020 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//--------------------------------------------------------------------------------
+// vecmath_test.cpp
+// Checks the NEON/SSE Mat4 products and batch transforms against the plain
+// scalar formulas, on pseudo-random inputs. Each result must be within
+// kTolerance of the reference, relative to the magnitude of its terms.
+//--------------------------------------------------------------------------------
+#include "vecmath.h"
+
+#include <stdio.h>
+#include <string.h>
+
+using ndk_helper::Mat4;
+using ndk_helper::Quaternion;
+using ndk_helper::Vec3;
+using ndk_helper::Vec4;
+
+static int failures = 0;
+
+#define CHECK( cond ) \
+    do { \
+        if( !(cond) ) { \
+            fprintf( stderr, "%s:%d: CHECK failed: %s\n", __FILE__, __LINE__, \
+                    #cond ); \
+            ++failures; \
+        } \
+    } while( 0 )
+
+static const float kTolerance = 1e-5f;
+
+//--------------------------------------------------------------------------------
+// Inputs and reference results
+//--------------------------------------------------------------------------------
+// A fixed LCG, so that every run checks the same values.
+static uint32_t g_seed = 12345;
+
+static float Random()
+{
+    g_seed = g_seed * 1664525u + 1013904223u;
+    return (float)(g_seed >> 8) / (float)(1 << 24) * 20.f - 10.f;
+}
+
+static Mat4 RandomMat4()
+{
+    float f[16];
+    for( int32_t i = 0; i < 16; ++i )
+        f[i] = Random();
+    return Mat4( f );
+}
+
+static Vec4 RandomVec4()
+{
+    return Vec4( Random(), Random(), Random(), Random() );
+}
+
+// Column-major m * v, as in the original scalar vecmath.
+static void RefMulVec( const float* m, const float* v, float* out )
+{
+    for( int32_t r = 0; r < 4; ++r )
+        out[r] = m[r] * v[0] + m[r + 4] * v[1] + m[r + 8] * v[2] + m[r + 12] * v[3];
+}
+
+static void RefMulMat( const float* a, const float* b, float* out )
+{
+    for( int32_t c = 0; c < 16; c += 4 )
+        RefMulVec( a, b + c, out + c );
+}
+
+// |a - b| is small relative to 'scale', the magnitude of the products summed.
+static bool Near( float a, float b, float scale )
+{
+    return fabsf( a - b ) <= kTolerance * (scale > 1.f ? scale : 1.f);
+}
+
+static bool NearAll( const float* a, const float* b, int32_t count, float scale )
+{
+    for( int32_t i = 0; i < count; ++i )
+    {
+        if( !Near( a[i], b[i], scale ) )
+        {
+            fprintf( stderr, "  element %d: %.9g != %.9g\n", i, a[i], b[i] );
+            return false;
+        }
+    }
+    return true;
+}
+
+// Inputs are within [-10, 10], so each product of two is at most 100, and a
+// sum of four of them at most 400.
+static const float kProductScale = 400.f;
+
+static void VecValues( Vec4& v, float* out )
+{
+    v.Value( out[0], out[1], out[2], out[3] );
+}
+
+//--------------------------------------------------------------------------------
+// Tests
+//--------------------------------------------------------------------------------
+static void TestMat4TimesMat4()
+{
+    for( int32_t n = 0; n < 100; ++n )
+    {
+        Mat4 a = RandomMat4();
+        Mat4 b = RandomMat4();
+        float expected[16];
+        RefMulMat( a.Ptr(), b.Ptr(), expected );
+
+        Mat4 product = a * b;
+        CHECK( NearAll( product.Ptr(), expected, 16, kProductScale ) );
+
+        Mat4 in_place = a;
+        in_place *= b;
+        CHECK( NearAll( in_place.Ptr(), expected, 16, kProductScale ) );
+    }
+}
+
+static void TestMat4TimesVec4()
+{
+    for( int32_t n = 0; n < 100; ++n )
+    {
+        Mat4 m = RandomMat4();
+        Vec4 v = RandomVec4();
+        float vf[4], expected[4], actual[4];
+        VecValues( v, vf );
+        RefMulVec( m.Ptr(), vf, expected );
+
+        Vec4 product = m * v;
+        VecValues( product, actual );
+        CHECK( NearAll( actual, expected, 4, kProductScale ) );
+    }
+}
+
+static void TestTransform()
+{
+    const int32_t kCount = 7;
+    Mat4 m = RandomMat4();
+    Vec4 in[kCount], out[kCount];
+    float expected[kCount][4];
+    for( int32_t i = 0; i < kCount; ++i )
+    {
+        float vf[4];
+        in[i] = RandomVec4();
+        VecValues( in[i], vf );
+        RefMulVec( m.Ptr(), vf, expected[i] );
+    }
+
+    m.Transform( in, out, kCount );
+    for( int32_t i = 0; i < kCount; ++i )
+    {
+        float actual[4];
+        VecValues( out[i], actual );
+        CHECK( NearAll( actual, expected[i], 4, kProductScale ) );
+    }
+
+    // In place.
+    m.Transform( in, in, kCount );
+    for( int32_t i = 0; i < kCount; ++i )
+    {
+        float actual[4];
+        VecValues( in[i], actual );
+        CHECK( NearAll( actual, expected[i], 4, kProductScale ) );
+    }
+
+    // An empty batch writes nothing.
+    Vec4 untouched( 1.f, 2.f, 3.f, 4.f );
+    m.Transform( &untouched, &untouched, 0 );
+    float values[4];
+    VecValues( untouched, values );
+    CHECK( values[0] == 1.f && values[1] == 2.f && values[2] == 3.f && values[3] == 4.f );
+}
+
+static void TestTransformPoints()
+{
+    // Counts around the SIMD width, so that both the four-wide loop and the
+    // scalar tail are checked.
+    const int32_t kMaxCount = 11;
+    Mat4 m = RandomMat4();
+    for( int32_t count = 0; count <= kMaxCount; ++count )
+    {
+        float x[kMaxCount], y[kMaxCount], z[kMaxCount];
+        float ox[kMaxCount + 1], oy[kMaxCount + 1], oz[kMaxCount + 1];
+        float expected[kMaxCount][4];
+        for( int32_t i = 0; i < count; ++i )
+        {
+            x[i] = Random();
+            y[i] = Random();
+            z[i] = Random();
+            float v[4] = { x[i], y[i], z[i], 1.f };
+            RefMulVec( m.Ptr(), v, expected[i] );
+        }
+        ox[count] = oy[count] = oz[count] = -1.f;
+
+        m.TransformPoints( x, y, z, ox, oy, oz, count );
+        for( int32_t i = 0; i < count; ++i )
+        {
+            float actual[3] = { ox[i], oy[i], oz[i] };
+            CHECK( NearAll( actual, expected[i], 3, kProductScale ) );
+        }
+        CHECK( ox[count] == -1.f && oy[count] == -1.f && oz[count] == -1.f );
+
+        // In place.
+        m.TransformPoints( x, y, z, x, y, z, count );
+        for( int32_t i = 0; i < count; ++i )
+        {
+            float actual[3] = { x[i], y[i], z[i] };
+            CHECK( NearAll( actual, expected[i], 3, kProductScale ) );
+        }
+    }
+}
+
+static void TestVec4TimesMat4()
+{
+    // Row vector times matrix: the same as the transposed matrix times v.
+    Mat4 m = RandomMat4();
+    Vec4 v = RandomVec4();
+    Mat4 t = m;
+    t.Transpose();
+    float vf[4], expected[4], actual[4];
+    VecValues( v, vf );
+    RefMulVec( t.Ptr(), vf, expected );
+    Vec4 product = v * m;
+    VecValues( product, actual );
+    CHECK( NearAll( actual, expected, 4, kProductScale ) );
+}
+
+static void TestInverse()
+{
+    // Inverse() handles rotation, scale and translation.
+    Mat4 m = Mat4::Translation( 3.f, -2.f, 5.f ) * Mat4::RotationY( 0.7f ) *
+            Mat4::RotationX( -1.2f );
+    m *= 2.f;
+    m.Ptr()[15] = 1.f;
+    Mat4 inverse = m;
+    inverse.Inverse();
+    Mat4 product = m * inverse;
+    CHECK( NearAll( product.Ptr(), Mat4::Identity().Ptr(), 16, 10.f ) );
+}
+
+static void TestQuaternion()
+{
+    // The product of two rotations is the product of their matrices.
+    Quaternion a = Quaternion::RotationAxis( Vec3( 0.f, 0.f, 1.f ), 0.5f );
+    Quaternion b = Quaternion::RotationAxis( Vec3( 0.6f, 0.f, 0.8f ), -1.1f );
+    Mat4 ma, mb, mab;
+    a.ToMatrix( ma );
+    b.ToMatrix( mb );
+    (a * b).ToMatrix( mab );
+    float expected[16];
+    RefMulMat( ma.Ptr(), mb.Ptr(), expected );
+    CHECK( NearAll( mab.Ptr(), expected, 16, 1.f ) );
+
+    Quaternion in_place = a;
+    in_place *= b;
+    float x, y, z, w, ex, ey, ez, ew;
+    in_place.Value( x, y, z, w );
+    (a * b).Value( ex, ey, ez, ew );
+    CHECK( x == ex && y == ey && z == ez && w == ew );
+}
+
+int main()
+{
+    TestMat4TimesMat4();
+    TestMat4TimesVec4();
+    TestTransform();
+    TestTransformPoints();
+    TestVec4TimesMat4();
+    TestInverse();
+    TestQuaternion();
+    if( failures != 0 )
+    {
+        fprintf( stderr, "%d checks failed\n", failures );
+        return 1;
+    }
+    printf( "PASS\n" );
+    return 0;
+}
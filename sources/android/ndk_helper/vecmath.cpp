@@ -19,6 +19,14 @@
 //--------------------------------------------------------------------------------
 #include "vecmath.h"
 
+#if defined( __ARM_NEON__ ) || defined( __ARM_NEON )
+#include <arm_neon.h>
+#define VECMATH_NEON
+#elif defined( __SSE__ )
+#include <xmmintrin.h>
+#define VECMATH_SSE
+#endif
+
 namespace ndk_helper
 {
 
@@ -60,58 +68,154 @@ Mat4::Mat4( const float* mIn )
         f_[i] = mIn[i];
 }
 
+//--------------------------------------------------------------------------------
+// SIMD helpers
+// Mat4 is column-major, so M * v is the sum of the columns of M weighted by
+// the components of v. Each helper computes that for one vector, taking its
+// components by value so that Vec4 members are never read as a float array.
+//--------------------------------------------------------------------------------
+#if defined( VECMATH_NEON )
+static inline float32x4_t MulColumns( const float32x4_t* col, const float x, const float y,
+                                      const float z, const float w )
+{
+    float32x4_t r = vmulq_n_f32( col[0], x );
+    r = vmlaq_n_f32( r, col[1], y );
+    r = vmlaq_n_f32( r, col[2], z );
+    r = vmlaq_n_f32( r, col[3], w );
+    return r;
+}
+#elif defined( VECMATH_SSE )
+static inline __m128 MulColumns( const __m128* col, const float x, const float y,
+                                 const float z, const float w )
+{
+    __m128 r = _mm_mul_ps( col[0], _mm_set1_ps( x ) );
+    r = _mm_add_ps( r, _mm_mul_ps( col[1], _mm_set1_ps( y ) ) );
+    r = _mm_add_ps( r, _mm_mul_ps( col[2], _mm_set1_ps( z ) ) );
+    r = _mm_add_ps( r, _mm_mul_ps( col[3], _mm_set1_ps( w ) ) );
+    return r;
+}
+#else
+static inline void MulColumns( const float* m, const float x, const float y, const float z,
+                               const float w, float* out )
+{
+    out[0] = x * m[0] + y * m[4] + z * m[8] + w * m[12];
+    out[1] = x * m[1] + y * m[5] + z * m[9] + w * m[13];
+    out[2] = x * m[2] + y * m[6] + z * m[10] + w * m[14];
+    out[3] = x * m[3] + y * m[7] + z * m[11] + w * m[15];
+}
+#endif
+
 Mat4 Mat4::operator*( const Mat4& rhs ) const
 {
     Mat4 ret;
-    ret.f_[0] = f_[0] * rhs.f_[0] + f_[4] * rhs.f_[1] + f_[8] * rhs.f_[2]
-            + f_[12] * rhs.f_[3];
-    ret.f_[1] = f_[1] * rhs.f_[0] + f_[5] * rhs.f_[1] + f_[9] * rhs.f_[2]
-            + f_[13] * rhs.f_[3];
-    ret.f_[2] = f_[2] * rhs.f_[0] + f_[6] * rhs.f_[1] + f_[10] * rhs.f_[2]
-            + f_[14] * rhs.f_[3];
-    ret.f_[3] = f_[3] * rhs.f_[0] + f_[7] * rhs.f_[1] + f_[11] * rhs.f_[2]
-            + f_[15] * rhs.f_[3];
-
-    ret.f_[4] = f_[0] * rhs.f_[4] + f_[4] * rhs.f_[5] + f_[8] * rhs.f_[6]
-            + f_[12] * rhs.f_[7];
-    ret.f_[5] = f_[1] * rhs.f_[4] + f_[5] * rhs.f_[5] + f_[9] * rhs.f_[6]
-            + f_[13] * rhs.f_[7];
-    ret.f_[6] = f_[2] * rhs.f_[4] + f_[6] * rhs.f_[5] + f_[10] * rhs.f_[6]
-            + f_[14] * rhs.f_[7];
-    ret.f_[7] = f_[3] * rhs.f_[4] + f_[7] * rhs.f_[5] + f_[11] * rhs.f_[6]
-            + f_[15] * rhs.f_[7];
-
-    ret.f_[8] = f_[0] * rhs.f_[8] + f_[4] * rhs.f_[9] + f_[8] * rhs.f_[10]
-            + f_[12] * rhs.f_[11];
-    ret.f_[9] = f_[1] * rhs.f_[8] + f_[5] * rhs.f_[9] + f_[9] * rhs.f_[10]
-            + f_[13] * rhs.f_[11];
-    ret.f_[10] = f_[2] * rhs.f_[8] + f_[6] * rhs.f_[9] + f_[10] * rhs.f_[10]
-            + f_[14] * rhs.f_[11];
-    ret.f_[11] = f_[3] * rhs.f_[8] + f_[7] * rhs.f_[9] + f_[11] * rhs.f_[10]
-            + f_[15] * rhs.f_[11];
-
-    ret.f_[12] = f_[0] * rhs.f_[12] + f_[4] * rhs.f_[13] + f_[8] * rhs.f_[14]
-            + f_[12] * rhs.f_[15];
-    ret.f_[13] = f_[1] * rhs.f_[12] + f_[5] * rhs.f_[13] + f_[9] * rhs.f_[14]
-            + f_[13] * rhs.f_[15];
-    ret.f_[14] = f_[2] * rhs.f_[12] + f_[6] * rhs.f_[13] + f_[10] * rhs.f_[14]
-            + f_[14] * rhs.f_[15];
-    ret.f_[15] = f_[3] * rhs.f_[12] + f_[7] * rhs.f_[13] + f_[11] * rhs.f_[14]
-            + f_[15] * rhs.f_[15];
-
+    const float* v = rhs.f_;
+#if defined( VECMATH_NEON )
+    float32x4_t col[4] = { vld1q_f32( f_ ), vld1q_f32( f_ + 4 ), vld1q_f32( f_ + 8 ),
+            vld1q_f32( f_ + 12 ) };
+    for( int32_t i = 0; i < 16; i += 4 )
+        vst1q_f32( ret.f_ + i, MulColumns( col, v[i], v[i + 1], v[i + 2], v[i + 3] ) );
+#elif defined( VECMATH_SSE )
+    __m128 col[4] = { _mm_loadu_ps( f_ ), _mm_loadu_ps( f_ + 4 ), _mm_loadu_ps( f_ + 8 ),
+            _mm_loadu_ps( f_ + 12 ) };
+    for( int32_t i = 0; i < 16; i += 4 )
+        _mm_storeu_ps( ret.f_ + i, MulColumns( col, v[i], v[i + 1], v[i + 2], v[i + 3] ) );
+#else
+    for( int32_t i = 0; i < 16; i += 4 )
+        MulColumns( f_, v[i], v[i + 1], v[i + 2], v[i + 3], ret.f_ + i );
+#endif
     return ret;
 }
 
 Vec4 Mat4::operator*( const Vec4& rhs ) const
 {
     Vec4 ret;
-    ret.x_ = rhs.x_ * f_[0] + rhs.y_ * f_[4] + rhs.z_ * f_[8] + rhs.w_ * f_[12];
-    ret.y_ = rhs.x_ * f_[1] + rhs.y_ * f_[5] + rhs.z_ * f_[9] + rhs.w_ * f_[13];
-    ret.z_ = rhs.x_ * f_[2] + rhs.y_ * f_[6] + rhs.z_ * f_[10] + rhs.w_ * f_[14];
-    ret.w_ = rhs.x_ * f_[3] + rhs.y_ * f_[7] + rhs.z_ * f_[11] + rhs.w_ * f_[15];
+    Transform( &rhs, &ret, 1 );
     return ret;
 }
 
+void Mat4::Transform( const Vec4* in, Vec4* out, const int32_t count ) const
+{
+    // The result goes through a float array and is copied member by member.
+    // The compiler folds the copy into the vector store.
+    float r[4];
+#if defined( VECMATH_NEON )
+    float32x4_t col[4] = { vld1q_f32( f_ ), vld1q_f32( f_ + 4 ), vld1q_f32( f_ + 8 ),
+            vld1q_f32( f_ + 12 ) };
+    for( int32_t i = 0; i < count; ++i )
+    {
+        vst1q_f32( r, MulColumns( col, in[i].x_, in[i].y_, in[i].z_, in[i].w_ ) );
+        out[i] = Vec4( r[0], r[1], r[2], r[3] );
+    }
+#elif defined( VECMATH_SSE )
+    __m128 col[4] = { _mm_loadu_ps( f_ ), _mm_loadu_ps( f_ + 4 ), _mm_loadu_ps( f_ + 8 ),
+            _mm_loadu_ps( f_ + 12 ) };
+    for( int32_t i = 0; i < count; ++i )
+    {
+        _mm_storeu_ps( r, MulColumns( col, in[i].x_, in[i].y_, in[i].z_, in[i].w_ ) );
+        out[i] = Vec4( r[0], r[1], r[2], r[3] );
+    }
+#else
+    for( int32_t i = 0; i < count; ++i )
+    {
+        MulColumns( f_, in[i].x_, in[i].y_, in[i].z_, in[i].w_, r );
+        out[i] = Vec4( r[0], r[1], r[2], r[3] );
+    }
+#endif
+}
+
+void Mat4::TransformPoints( const float* in_x, const float* in_y, const float* in_z,
+                            float* out_x, float* out_y, float* out_z,
+                            const int32_t count ) const
+{
+    int32_t i = 0;
+#if defined( VECMATH_NEON )
+    // Process four points at a time, one output coordinate per register
+    for( ; i + 4 <= count; i += 4 )
+    {
+        float32x4_t x = vld1q_f32( in_x + i );
+        float32x4_t y = vld1q_f32( in_y + i );
+        float32x4_t z = vld1q_f32( in_z + i );
+        float32x4_t rx = vmlaq_n_f32( vmlaq_n_f32( vmlaq_n_f32( vdupq_n_f32( f_[12] ), x, f_[0] ),
+                y, f_[4] ), z, f_[8] );
+        float32x4_t ry = vmlaq_n_f32( vmlaq_n_f32( vmlaq_n_f32( vdupq_n_f32( f_[13] ), x, f_[1] ),
+                y, f_[5] ), z, f_[9] );
+        float32x4_t rz = vmlaq_n_f32( vmlaq_n_f32( vmlaq_n_f32( vdupq_n_f32( f_[14] ), x, f_[2] ),
+                y, f_[6] ), z, f_[10] );
+        vst1q_f32( out_x + i, rx );
+        vst1q_f32( out_y + i, ry );
+        vst1q_f32( out_z + i, rz );
+    }
+#elif defined( VECMATH_SSE )
+    __m128 m[12];
+    const int32_t rows[12] = { 0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14 };
+    for( int32_t j = 0; j < 12; ++j )
+        m[j] = _mm_set1_ps( f_[rows[j]] );
+    // Process four points at a time, one output coordinate per register
+    for( ; i + 4 <= count; i += 4 )
+    {
+        __m128 x = _mm_loadu_ps( in_x + i );
+        __m128 y = _mm_loadu_ps( in_y + i );
+        __m128 z = _mm_loadu_ps( in_z + i );
+        __m128 rx = _mm_add_ps( _mm_add_ps( _mm_mul_ps( x, m[0] ), _mm_mul_ps( y, m[1] ) ),
+                _mm_add_ps( _mm_mul_ps( z, m[2] ), m[3] ) );
+        __m128 ry = _mm_add_ps( _mm_add_ps( _mm_mul_ps( x, m[4] ), _mm_mul_ps( y, m[5] ) ),
+                _mm_add_ps( _mm_mul_ps( z, m[6] ), m[7] ) );
+        __m128 rz = _mm_add_ps( _mm_add_ps( _mm_mul_ps( x, m[8] ), _mm_mul_ps( y, m[9] ) ),
+                _mm_add_ps( _mm_mul_ps( z, m[10] ), m[11] ) );
+        _mm_storeu_ps( out_x + i, rx );
+        _mm_storeu_ps( out_y + i, ry );
+        _mm_storeu_ps( out_z + i, rz );
+    }
+#endif
+    for( ; i < count; ++i )
+    {
+        float x = in_x[i], y = in_y[i], z = in_z[i];
+        out_x[i] = x * f_[0] + y * f_[4] + z * f_[8] + f_[12];
+        out_y[i] = x * f_[1] + y * f_[5] + z * f_[9] + f_[13];
+        out_z[i] = x * f_[2] + y * f_[6] + z * f_[10] + f_[14];
+    }
+}
+
 Mat4 Mat4::Inverse()
 {
     Mat4 ret;
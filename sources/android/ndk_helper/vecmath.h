@@ -24,7 +24,10 @@ namespace ndk_helper
 
 /******************************************************************
  * Helper class for vector math operations
- * Currently all implementations are in pure C++.
+ * Mat4 products and batch transforms use NEON or SSE when available,
+ * everything else is in pure C++. Mat4::Inverse() and the Quaternion
+ * operators are deliberately left scalar: both work on a single object at a
+ * time, and tests/vecmath_benchmark.cpp measures them alongside the rest.
  * Each class is an opaque class so caller does not have a direct access
  * to each element. This is for an ease of future optimization to use vector operations.
  *
@@ -798,44 +801,7 @@ public:
 
     Mat4& operator*=( const Mat4& rhs )
     {
-        Mat4 ret;
-        ret.f_[0] = f_[0] * rhs.f_[0] + f_[4] * rhs.f_[1] + f_[8] * rhs.f_[2]
-                + f_[12] * rhs.f_[3];
-        ret.f_[1] = f_[1] * rhs.f_[0] + f_[5] * rhs.f_[1] + f_[9] * rhs.f_[2]
-                + f_[13] * rhs.f_[3];
-        ret.f_[2] = f_[2] * rhs.f_[0] + f_[6] * rhs.f_[1] + f_[10] * rhs.f_[2]
-                + f_[14] * rhs.f_[3];
-        ret.f_[3] = f_[3] * rhs.f_[0] + f_[7] * rhs.f_[1] + f_[11] * rhs.f_[2]
-                + f_[15] * rhs.f_[3];
-
-        ret.f_[4] = f_[0] * rhs.f_[4] + f_[4] * rhs.f_[5] + f_[8] * rhs.f_[6]
-                + f_[12] * rhs.f_[7];
-        ret.f_[5] = f_[1] * rhs.f_[4] + f_[5] * rhs.f_[5] + f_[9] * rhs.f_[6]
-                + f_[13] * rhs.f_[7];
-        ret.f_[6] = f_[2] * rhs.f_[4] + f_[6] * rhs.f_[5] + f_[10] * rhs.f_[6]
-                + f_[14] * rhs.f_[7];
-        ret.f_[7] = f_[3] * rhs.f_[4] + f_[7] * rhs.f_[5] + f_[11] * rhs.f_[6]
-                + f_[15] * rhs.f_[7];
-
-        ret.f_[8] = f_[0] * rhs.f_[8] + f_[4] * rhs.f_[9] + f_[8] * rhs.f_[10]
-                + f_[12] * rhs.f_[11];
-        ret.f_[9] = f_[1] * rhs.f_[8] + f_[5] * rhs.f_[9] + f_[9] * rhs.f_[10]
-                + f_[13] * rhs.f_[11];
-        ret.f_[10] = f_[2] * rhs.f_[8] + f_[6] * rhs.f_[9] + f_[10] * rhs.f_[10]
-                + f_[14] * rhs.f_[11];
-        ret.f_[11] = f_[3] * rhs.f_[8] + f_[7] * rhs.f_[9] + f_[11] * rhs.f_[10]
-                + f_[15] * rhs.f_[11];
-
-        ret.f_[12] = f_[0] * rhs.f_[12] + f_[4] * rhs.f_[13] + f_[8] * rhs.f_[14]
-                + f_[12] * rhs.f_[15];
-        ret.f_[13] = f_[1] * rhs.f_[12] + f_[5] * rhs.f_[13] + f_[9] * rhs.f_[14]
-                + f_[13] * rhs.f_[15];
-        ret.f_[14] = f_[2] * rhs.f_[12] + f_[6] * rhs.f_[13] + f_[10] * rhs.f_[14]
-                + f_[14] * rhs.f_[15];
-        ret.f_[15] = f_[3] * rhs.f_[12] + f_[7] * rhs.f_[13] + f_[11] * rhs.f_[14]
-                + f_[15] * rhs.f_[15];
-
-        *this = ret;
+        *this = *this * rhs;
         return *this;
     }
 
@@ -906,6 +872,18 @@ public:
         return f_;
     }
 
+    //--------------------------------------------------------------------------------
+    // Batch transforms
+    //--------------------------------------------------------------------------------
+    // Multiply count vectors by this matrix. in and out may be the same array.
+    void Transform( const Vec4* in, Vec4* out, const int32_t count ) const;
+
+    // Transform count points stored as separate x/y/z arrays (w is assumed
+    // to be 1), e.g. particle positions. Input and output arrays may alias.
+    void TransformPoints( const float* in_x, const float* in_y, const float* in_z,
+                          float* out_x, float* out_y, float* out_z,
+                          const int32_t count ) const;
+
     //--------------------------------------------------------------------------------
     // Misc
     //--------------------------------------------------------------------------------
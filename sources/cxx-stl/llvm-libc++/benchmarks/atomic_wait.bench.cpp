@@ -0,0 +1,136 @@
+//===----------------------------------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+// Measures atomic waits, latches, barriers and semaphores: the polling phase
+// that runs in the headers before a waiter blocks in the library, and the
+// handoff latency between two threads, which includes the library's futex
+// wait and wake.  Waits that are satisfied within __libcpp_polling_count
+// polls never read the clock.
+
+#include <atomic>
+#include <barrier>
+#include <latch>
+#include <semaphore>
+#include <thread>
+
+#include "benchmark/benchmark.h"
+
+namespace {
+
+// The value has already changed: the wait returns from its first poll.
+void BM_AtomicWait_Ready(benchmark::State& state) {
+  std::atomic<int> a(1);
+  for (auto _ : state) {
+    a.wait(0);
+    benchmark::DoNotOptimize(a);
+  }
+}
+BENCHMARK(BM_AtomicWait_Ready);
+
+// The condition holds after state.range(0) failed polls, all within the
+// first __libcpp_polling_count polls.
+void BM_PollWithBackoff(benchmark::State& state) {
+  const long polls = state.range(0);
+  for (auto _ : state) {
+    long remaining = polls;
+    benchmark::DoNotOptimize(remaining);
+    benchmark::DoNotOptimize(std::__libcpp_thread_poll_with_backoff(
+        [&remaining] { return remaining-- == 0; },
+        std::__libcpp_timed_backoff_policy()));
+  }
+}
+BENCHMARK(BM_PollWithBackoff)->Arg(0)->Arg(16)->Arg(63);
+
+void BM_Latch_ArriveAndWait(benchmark::State& state) {
+  for (auto _ : state) {
+    std::latch l(1);
+    l.arrive_and_wait();
+    benchmark::DoNotOptimize(l);
+  }
+}
+BENCHMARK(BM_Latch_ArriveAndWait);
+
+void BM_Semaphore_AcquireRelease(benchmark::State& state) {
+  std::binary_semaphore s(1);
+  for (auto _ : state) {
+    s.acquire();
+    s.release();
+  }
+}
+BENCHMARK(BM_Semaphore_AcquireRelease);
+
+// Two threads pass a token back and forth, each waiting for its turn.
+void BM_AtomicWait_PingPong(benchmark::State& state) {
+  std::atomic<int> turn(0);
+  std::thread other([&turn] {
+    for (;;) {
+      turn.wait(0);
+      if (turn.load() == 2)
+        return;
+      turn.store(0);
+      turn.notify_one();
+    }
+  });
+  for (auto _ : state) {
+    turn.store(1);
+    turn.notify_one();
+    turn.wait(1);
+  }
+  turn.store(2);
+  turn.notify_one();
+  other.join();
+}
+BENCHMARK(BM_AtomicWait_PingPong);
+
+// The same handoff with a semaphore for each direction.
+void BM_Semaphore_PingPong(benchmark::State& state) {
+  std::binary_semaphore ping(0);
+  std::binary_semaphore pong(0);
+  bool done = false;
+  std::thread other([&] {
+    for (;;) {
+      ping.acquire();
+      if (done)
+        return;
+      pong.release();
+    }
+  });
+  for (auto _ : state) {
+    ping.release();
+    pong.acquire();
+  }
+  done = true;
+  ping.release();
+  other.join();
+}
+BENCHMARK(BM_Semaphore_PingPong);
+
+// Two threads meet at a barrier once per iteration.
+void BM_Barrier_ArriveAndWait(benchmark::State& state) {
+  std::barrier<> b(2);
+  std::atomic<bool> done(false);
+  std::thread other([&] {
+    for (;;) {
+      b.arrive_and_wait();
+      if (done.load())
+        return;
+    }
+  });
+  for (auto _ : state)
+    b.arrive_and_wait();
+  // The other thread may or may not arrive once more, depending on whether
+  // it sees |done| after the last phase, so leave without waiting.
+  done.store(true);
+  b.arrive_and_drop();
+  other.join();
+}
+BENCHMARK(BM_Barrier_ArriveAndWait);
+
+} // namespace
+
+BENCHMARK_MAIN();
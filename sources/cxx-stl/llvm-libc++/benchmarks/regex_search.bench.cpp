@@ -0,0 +1,106 @@
+//===----------------------------------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+// Compares regex_search through the automaton matcher with the backtracker.
+// Each pattern is run as is, which uses the automaton, and with an empty
+// back reference appended, which matches the same text but makes basic_regex
+// fall back to backtracking.
+
+#include <regex>
+#include <string>
+
+#include "benchmark/benchmark.h"
+
+namespace {
+
+std::string make_words(size_t n) {
+  static const char* const words[] = {"the ", "quick ", "brown ", "fox ",
+                                      "jumps ", "over ", "lazy ", "dogs "};
+  std::string s;
+  for (size_t i = 0; s.size() < n; ++i)
+    s += words[(i * 7) % 8];
+  s.resize(n);
+  return s;
+}
+
+std::string make_ab(size_t n) {
+  std::string s;
+  for (size_t i = 0; i < n; ++i)
+    s += "ab"[(i * 5 / 3) % 2];
+  return s;
+}
+
+void run_search(benchmark::State& state, const std::string& pattern,
+                const std::string& text) {
+  std::regex re(pattern);
+  std::cmatch m;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(
+        std::regex_search(text.data(), text.data() + text.size(), m, re));
+  }
+  state.SetBytesProcessed(state.iterations() * text.size());
+}
+
+// A word ending in "ing" that is not in the text: every position is tried.
+void BM_WordSuffix_Automaton(benchmark::State& state) {
+  run_search(state, "[a-z]+ing", make_words(state.range(0)));
+}
+void BM_WordSuffix_Backtrack(benchmark::State& state) {
+  run_search(state, "(?:[a-z]+ing)()\\1", make_words(state.range(0)));
+}
+BENCHMARK(BM_WordSuffix_Automaton)->Arg(1 << 10)->Arg(1 << 14);
+BENCHMARK(BM_WordSuffix_Backtrack)->Arg(1 << 10)->Arg(1 << 14);
+
+// A leading literal: the search skips to each occurrence of 'j'.
+void BM_LiteralPrefix_Automaton(benchmark::State& state) {
+  run_search(state, "jumps [0-9]+", make_words(state.range(0)));
+}
+void BM_LiteralPrefix_Backtrack(benchmark::State& state) {
+  run_search(state, "jumps [0-9]+()\\1", make_words(state.range(0)));
+}
+BENCHMARK(BM_LiteralPrefix_Automaton)->Arg(1 << 10)->Arg(1 << 14);
+BENCHMARK(BM_LiteralPrefix_Backtrack)->Arg(1 << 10)->Arg(1 << 14);
+
+// Bounded repeats, which the automaton tells apart by their counters.
+void BM_CountedRepeat_Automaton(benchmark::State& state) {
+  run_search(state, "[a-z]{3,5} [0-9]{2}", make_words(state.range(0)));
+}
+void BM_CountedRepeat_Backtrack(benchmark::State& state) {
+  run_search(state, "(?:[a-z]{3,5} [0-9]{2})()\\1", make_words(state.range(0)));
+}
+BENCHMARK(BM_CountedRepeat_Automaton)->Arg(1 << 10)->Arg(1 << 14);
+BENCHMARK(BM_CountedRepeat_Backtrack)->Arg(1 << 10)->Arg(1 << 14);
+
+// A short log line, where the setup of each search is a large part of its
+// cost.
+const char kLogLine[] =
+    "2020-06-01 12:00:03 I worker-3: request handled in 15 ms";
+
+void BM_LogLine_Automaton(benchmark::State& state) {
+  run_search(state, "[0-9]{1,500}ms", kLogLine);
+}
+void BM_LogLine_Backtrack(benchmark::State& state) {
+  run_search(state, "[0-9]{1,500}ms()\\1", kLogLine);
+}
+BENCHMARK(BM_LogLine_Automaton);
+BENCHMARK(BM_LogLine_Backtrack);
+
+// Every start runs to the end of the text before failing, which is
+// quadratic when backtracking and linear for the automaton.
+void BM_UnanchoredStar_Automaton(benchmark::State& state) {
+  run_search(state, "(a|b)*c", make_ab(state.range(0)));
+}
+void BM_UnanchoredStar_Backtrack(benchmark::State& state) {
+  run_search(state, "(?:(a|b)*c)()\\2", make_ab(state.range(0)));
+}
+BENCHMARK(BM_UnanchoredStar_Automaton)->Arg(1 << 8)->Arg(1 << 10);
+BENCHMARK(BM_UnanchoredStar_Backtrack)->Arg(1 << 8)->Arg(1 << 10);
+
+} // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,193 @@
+//===----------------------------------------------------------------------===//
+//
+// Part of the LLVM Project, under the Apache License v2.0 with LLVM Exceptions.
+// See https://llvm.org/LICENSE.txt for license information.
+// SPDX-License-Identifier: Apache-2.0 WITH LLVM-exception
+//
+//===----------------------------------------------------------------------===//
+
+// <regex>
+
+// template <class BidirectionalIterator, class Allocator, class charT, class traits>
+//     bool
+//     regex_search(BidirectionalIterator first, BidirectionalIterator last,
+//                  match_results<BidirectionalIterator, Allocator>& m,
+//                  const basic_regex<charT, traits>& e,
+//                  regex_constants::match_flag_type flags = regex_constants::match_default);
+
+// ECMAScript patterns without back references are searched by an automaton
+// and the others by backtracking.  Both must give the ECMAScript results:
+// the leftmost match, preferring earlier alternatives and greedy repeats.
+
+#include <regex>
+#include <string>
+#include <cassert>
+
+static bool search(const char* s, const char* pattern, std::cmatch& m,
+                   std::regex_constants::match_flag_type flags =
+                       std::regex_constants::match_default) {
+  std::regex re(pattern);
+  return std::regex_search(s, s + std::char_traits<char>::length(s), m, re,
+                           flags);
+}
+
+static void check(const std::cmatch& m, const char* s, std::size_t i,
+                  std::ptrdiff_t pos, std::ptrdiff_t len) {
+  assert(m[i].matched);
+  assert(m.position(i) == pos);
+  assert(m.length(i) == len);
+  assert(m[i].first == s + pos);
+}
+
+static void test_automaton() {
+  std::cmatch m;
+  // Alternatives and repeats are tried in order, not for the longest match.
+  {
+    const char s[] = "xabcd";
+    assert(search(s, "a|ab", m));
+    check(m, s, 0, 1, 1);
+    assert(search(s, "(a|ab)(c|bcd)", m));
+    check(m, s, 0, 1, 4);
+    check(m, s, 1, 1, 1);
+    check(m, s, 2, 2, 3);
+    assert(m.prefix().matched && m.prefix().length() == 1);
+    assert(!m.suffix().matched);
+  }
+  {
+    const char s[] = "<a><b>";
+    assert(search(s, "<.*?>", m));
+    check(m, s, 0, 0, 3);
+    assert(search(s, "<.*>", m));
+    check(m, s, 0, 0, 6);
+  }
+  // Captures inside a loop hold the last iteration and are reset on each.
+  {
+    const char s[] = "abab";
+    assert(search(s, "(a|b)*", m));
+    check(m, s, 0, 0, 4);
+    check(m, s, 1, 3, 1);
+    assert(search(s, "(?:(a)|b)*", m));
+    check(m, s, 0, 0, 4);
+    assert(!m[1].matched);
+  }
+  // Bounded repeats keep their counts apart.
+  {
+    const char s[] = "aaaaa";
+    assert(search(s, "a{2,3}", m));
+    check(m, s, 0, 0, 3);
+    assert(search(s, "(?:a{2}){2}", m));
+    check(m, s, 0, 0, 4);
+    assert(search(s, "(a{1,2}){2,}?", m));
+    check(m, s, 0, 0, 4);
+    check(m, s, 1, 2, 2);
+    assert(!search(s, "^a{6}", m));
+    assert(search("ab12-345x", "[0-9]{2}-[0-9]{3}", m));
+    check(m, "ab12-345x", 0, 2, 6);
+  }
+  // An iteration that matches nothing ends the loop.
+  {
+    const char s[] = "b";
+    assert(search(s, "(a*)*b", m));
+    check(m, s, 0, 0, 1);
+    check(m, s, 1, 0, 0);
+  }
+  // Assertions and lookahead.
+  {
+    const char s[] = "cat concat cats";
+    assert(search(s, "\\bcat\\b", m));
+    check(m, s, 0, 0, 3);
+    assert(search(s, "\\Bcat", m));
+    check(m, s, 0, 7, 3);
+    assert(search(s, "cat(?=s)", m));
+    check(m, s, 0, 11, 3);
+    assert(search(s, "c(?!a)\\w+", m));
+    check(m, s, 0, 4, 6);
+    assert(search(s, "s$", m));
+    check(m, s, 0, 14, 1);
+  }
+  // Match flags.
+  {
+    const char s[] = "xaay";
+    assert(search(s, "a*", m));
+    check(m, s, 0, 0, 0);
+    assert(search(s, "a*", m, std::regex_constants::match_not_null));
+    check(m, s, 0, 1, 2);
+    assert(!search(s, "a+", m, std::regex_constants::match_continuous));
+    assert(!search(s, "^x", m, std::regex_constants::match_not_bol));
+    assert(search(s, "\\bx", m));
+    const char t[] = "ax";
+    assert(!std::regex_search(t + 1, t + 2, m, std::regex("\\bx"),
+                              std::regex_constants::match_prev_avail));
+  }
+  // A leading literal lets the search skip ahead to its occurrences.
+  {
+    const char s[] = "jumps over jumps 42";
+    assert(search(s, "jumps [0-9]+", m));
+    check(m, s, 0, 11, 8);
+    assert(!search(s, "jumps [a-z]{5}", m));
+  }
+}
+
+static void test_back_references() {
+  std::cmatch m;
+  {
+    const char s[] = "xaabaa";
+    assert(search(s, "(a+)b\\1", m));
+    check(m, s, 0, 1, 5);
+    check(m, s, 1, 1, 2);
+  }
+  {
+    const char s[] = "abcabc";
+    assert(search(s, "(\\w+)\\1", m));
+    check(m, s, 0, 0, 6);
+    check(m, s, 1, 0, 3);
+    assert(!search("abcab", "^(\\w+)\\1$", m));
+  }
+}
+
+static void test_copies() {
+  // The node numbers the automaton uses are kept by the regex, not by its
+  // nodes, so they must follow the nodes through copies and swaps.
+  const char s[] = "xx ab12-345.x";
+  std::cmatch m;
+  std::regex a("([a-z]{2})([0-9]{2})-[0-9]{3}\\.");
+  std::regex b(a);
+  std::regex c("c+");
+  assert(std::regex_search(s, m, b));
+  check(m, s, 0, 3, 9);
+  check(m, s, 1, 3, 2);
+  c.swap(b);
+  assert(std::regex_search(s, m, c));
+  check(m, s, 2, 5, 2);
+  assert(!std::regex_search(s, m, b));
+  b = c;
+  c.assign("x+");
+  assert(std::regex_search(s, m, b));
+  check(m, s, 0, 3, 9);
+  assert(std::regex_search(s, m, c));
+  check(m, s, 0, 0, 2);
+}
+
+static void test_complexity() {
+  // The automaton stays linear where backtracking is exponential, and
+  // patterns with back references still backtrack.
+  std::string s(64, 'a');
+  std::cmatch m;
+  assert(!search(s.c_str(), "(a|aa)*c", m));
+#ifndef TEST_HAS_NO_EXCEPTIONS
+  try {
+    search(s.c_str(), "(a|aa)*c()\\2", m);
+    assert(false);
+  } catch (const std::regex_error& e) {
+    assert(e.code() == std::regex_constants::error_complexity);
+  }
+#endif
+}
+
+int main(int, char**) {
+  test_automaton();
+  test_back_references();
+  test_copies();
+  test_complexity();
+  return 0;
+}
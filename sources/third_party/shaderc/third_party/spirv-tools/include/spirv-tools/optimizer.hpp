@@ -15,6 +15,7 @@
 #ifndef INCLUDE_SPIRV_TOOLS_OPTIMIZER_HPP_
 #define INCLUDE_SPIRV_TOOLS_OPTIMIZER_HPP_
 
+#include <functional>
 #include <memory>
 #include <ostream>
 #include <string>
@@ -98,12 +99,14 @@ class Optimizer {
 
   // Registers passes that attempt to improve performance of generated code.
   // This sequence of passes is subject to constant review and will change
-  // from time to time.
+  // from time to time.  If one of its passes cannot be registered, the error
+  // is sent to the message consumer and Run() fails.
   Optimizer& RegisterPerformancePasses();
 
   // Registers passes that attempt to improve the size of generated code.
   // This sequence of passes is subject to constant review and will change
-  // from time to time.
+  // from time to time.  If one of its passes cannot be registered, the error
+  // is sent to the message consumer and Run() fails.
   Optimizer& RegisterSizePasses();
 
   // Registers passes that have been prescribed for converting from Vulkan to
@@ -126,6 +129,14 @@ class Optimizer {
   // from time to time.
   Optimizer& RegisterLegalizationPasses();
 
+  // Makes RegisterPerformancePasses() and RegisterSizePasses() register their
+  // cleanup passes as one group that is repeated until it stops changing the
+  // module, at most |max_rounds| times, instead of as a fixed sequence.  A
+  // pass of the group is skipped while nothing changed since it last ran.  See
+  // CreateFixedPointPass().  A |max_rounds| of 0 restores the fixed sequences.
+  // This only affects passes registered after the call.
+  Optimizer& SetFixedPointScheduling(uint32_t max_rounds);
+
   // Register passes specified in the list of |flags|.  Each flag must be a
   // string of a form accepted by Optimizer::FlagHasValidForm().
   //
@@ -151,6 +162,10 @@ class Optimizer {
   //
   // --legalize-hlsl: Registers all passes that legalize SPIR-V generated by an
   //                  HLSL front-end.
+  //
+  // --fixed-point-scheduling[=rounds]: Calls SetFixedPointScheduling() for
+  //                  the -O and -Os flags that follow.  The default is 4
+  //                  rounds.
   bool RegisterPassFromFlag(const std::string& flag);
 
   // Validates that |flag| has a valid format.  Strings accepted:
@@ -211,6 +226,103 @@ class Optimizer {
            std::vector<uint32_t>* optimized_binary,
            const spv_optimizer_options opt_options) const;
 
+  // Specializes and optimizes |original_binary| once per entry of |variants|,
+  // and writes the results to |optimized_binaries| in the same order.  Each
+  // variant sets the default values of the spec constants it maps, as
+  // CreateSetSpecConstantDefaultValuePass() does, and then runs the passes
+  // named by |pass_flags| (see RegisterPassesFromFlags()).  The passes
+  // registered on this optimizer are not used.
+  //
+  // The binary is validated and parsed only once.  Every variant starts from
+  // an in-memory copy of that module, so no variant re-parses it.  Variants
+  // are processed on up to |num_threads| threads, each with its own passes.
+  // The message consumer must be thread-safe if |num_threads| is above 1.
+  //
+  // Returns false if |original_binary| fails to validate, if |pass_flags| is
+  // not valid, or if any variant fails to optimize.  In that case the
+  // contents of |optimized_binaries| may be invalid.
+  bool RunVariants(
+      const uint32_t* original_binary, const size_t original_binary_size,
+      const std::vector<std::unordered_map<uint32_t, std::string>>& variants,
+      const std::vector<std::string>& pass_flags,
+      std::vector<std::vector<uint32_t>>* optimized_binaries,
+      const spv_optimizer_options opt_options, uint32_t num_threads = 1) const;
+
+  // Scores an optimized binary for TunePasses().  Lower is better.  The
+  // objective is called concurrently when tuning uses more than one thread,
+  // so it must be thread-safe.
+  using TuningObjective =
+      std::function<double(const std::vector<uint32_t>& binary)>;
+
+  // Returns an objective that counts the instructions inside function bodies.
+  static TuningObjective InstructionCountObjective();
+
+  // Returns an objective that counts the words in the whole binary.
+  static TuningObjective CodeSizeObjective();
+
+  // Returns an objective that estimates register pressure as the sum, over all
+  // functions, of the highest number of live registers in any block, as
+  // computed by the register liveness analysis.  Binaries are decoded using
+  // the target environment of this optimizer.
+  TuningObjective RegisterPressureObjective() const;
+
+  // Controls the search done by TunePasses().
+  struct TuningOptions {
+    // The number of search rounds.  Each round mutates the best recipe found
+    // so far and keeps the best mutation if it improves on it.
+    uint32_t num_rounds = 16;
+    // The number of mutated recipes evaluated in each round.
+    uint32_t candidates_per_round = 32;
+    // The number of threads used to evaluate candidates.
+    uint32_t num_threads = 1;
+    // Seed for the mutations, so a search can be reproduced.
+    uint32_t seed = 0;
+    // Recipes never grow beyond this many flags.
+    size_t max_recipe_length = 64;
+    // The flags mutations draw from.  If empty, the flags of the performance
+    // and size recipes are used, along with a few settings of the
+    // parameterized passes such as --scalar-replacement=N and
+    // --loop-unroll-partial=N.
+    std::vector<std::string> candidate_flags;
+    // Recipes the search starts from, in addition to the performance and size
+    // recipes.
+    std::vector<std::vector<std::string>> initial_recipes;
+  };
+
+  // Searches for a pass recipe that minimizes |objective| on
+  // |original_binary|, and writes it to |best_flags| as a list of flags that
+  // RegisterPassesFromFlags() accepts.  If |objective| is empty, the
+  // instruction count objective is used.  If |best_cost| is not null, the
+  // cost of the recipe is written to it.  The passes registered on this
+  // optimizer are not used.
+  //
+  // The binary is validated and parsed only once, and each candidate runs on
+  // an in-memory copy of it.  Candidates that fail to optimize, or whose
+  // output fails to validate when validation is enabled in |opt_options|, are
+  // rejected.  Between recipes with the same cost, the shorter one wins.
+  //
+  // Returns false if |original_binary| fails to validate or if no candidate
+  // recipe succeeds.
+  bool TunePasses(const uint32_t* original_binary,
+                  const size_t original_binary_size,
+                  const TuningObjective& objective,
+                  const TuningOptions& tuning_options,
+                  std::vector<std::string>* best_flags, double* best_cost,
+                  const spv_optimizer_options opt_options) const;
+
+  // Writes a static performance report for |original_binary| to |report|.
+  // For each entry point, it gives the estimated dynamic instruction mix
+  // (ALU, texture, memory and control), the estimated bytes read from and
+  // written to memory shared between invocations, the highest number of live
+  // registers, and the trip count of each loop.  Loops whose trip count cannot
+  // be computed are assumed to run |unknown_trip_count| times.  No passes are
+  // run, and the report format is stable so it can be diffed in CI.
+  //
+  // Returns false if |original_binary| cannot be parsed.
+  bool ReportCost(const uint32_t* original_binary,
+                  const size_t original_binary_size, std::ostream* report,
+                  size_t unknown_trip_count = 16) const;
+
   // Returns a vector of strings with all the pass names added to this
   // optimizer's pass manager. These strings are valid until the associated
   // pass manager is destroyed.
@@ -762,9 +874,19 @@ Optimizer::PassToken CreateCombineAccessChainsPass();
 // |input_length_enable| controls instrumentation of runtime descriptor array
 // references, and |input_init_enable| controls instrumentation of descriptor
 // initialization checking, both of which require input buffer support.
+//
+// If |sample_period| is not zero, only about one in |sample_period|
+// references is instrumented, selected by hashing its position in the module
+// with |sample_seed|. An instrumented reference dominated by another making
+// the same check reuses the result of that check and only the dominating one
+// writes an error record. This keeps the cost low enough to leave validation
+// on in normal runs; changing the seed between builds rotates which
+// references are checked. A period of 1 guards every reference but computes
+// and reports each dominating check once.
 Optimizer::PassToken CreateInstBindlessCheckPass(
     uint32_t desc_set, uint32_t shader_id, bool input_length_enable = false,
-    bool input_init_enable = false, bool input_buff_oob_enable = false);
+    bool input_init_enable = false, bool input_buff_oob_enable = false,
+    uint32_t sample_period = 0, uint32_t sample_seed = 0);
 
 // Create a pass to instrument physical buffer address checking
 // This pass instruments all physical buffer address references to check that
@@ -785,8 +907,12 @@ Optimizer::PassToken CreateInstBindlessCheckPass(
 // The instrumentation will read and write buffers in debug
 // descriptor set |desc_set|. It will write |shader_id| in each output record
 // to identify the shader module which generated the record.
+// |sample_period| and |sample_seed| select a subset of the references to
+// instrument as for CreateInstBindlessCheckPass.
 Optimizer::PassToken CreateInstBuffAddrCheckPass(uint32_t desc_set,
-                                                 uint32_t shader_id);
+                                                 uint32_t shader_id,
+                                                 uint32_t sample_period = 0,
+                                                 uint32_t sample_seed = 0);
 
 // Create a pass to instrument OpDebugPrintf instructions.
 // This pass replaces all OpDebugPrintf instructions with instructions to write
@@ -839,6 +965,11 @@ Optimizer::PassToken CreateSplitInvalidUnreachablePass();
 // This pass injects code to clamp indexed accesses to buffers and internal
 // arrays, providing guarantees satisfying Vulkan's robustBufferAccess rules.
 //
+// An index into a vector, matrix or array of constant size is not clamped if
+// the pass can prove it is in bounds: for example a loop counter whose loop
+// condition bounds it, a value checked by a dominating branch, or the result
+// of an earlier clamp.
+//
 // TODO(dneto): Clamps coordinates and sample index for pointer calculations
 // into storage images (OpImageTexelPointer).  For an cube array image, it
 // assumes the maximum layer count times 6 is at most 0xffffffff.
@@ -887,6 +1018,46 @@ Optimizer::PassToken CreateWrapOpKillPass();
 // capabilities.
 Optimizer::PassToken CreateAmdExtToKhrPass();
 
+// Creates a pass that vectorizes innermost counted loops.
+// Loops that process one array element per iteration are rewritten to
+// process |vector_width| elements per iteration with vector arithmetic, and
+// the iterations left over run in a scalar copy of the body after the loop.
+// |vector_width| must be 2 or 4.  See LoopVectorizer in loop_vectorizer.h for
+// the loops that qualify.
+Optimizer::PassToken CreateLoopVectorizePass(uint32_t vector_width = 4);
+
+// Creates a pass that eliminates redundant loads and dead stores of memory
+// shared between invocations.
+// Loads from Uniform, StorageBuffer, PushConstant and Workgroup variables are
+// replaced by a value loaded or stored earlier on every path, and stores that
+// are overwritten on every path before being read are removed.  Barriers,
+// atomics and function calls end the range over which this is done.  See
+// GlobalLoadStoreElimPass in global_load_store_elim_pass.h for details.
+Optimizer::PassToken CreateGlobalLoadStoreElimPass();
+
+// Creates a pass that runs the passes made by |pass_factories| in order, and
+// repeats them until they stop changing the module, at most |max_rounds|
+// times.  A pass is not run again while no function changed since it last
+// ran, and passes that work on each function alone are only run again on the
+// functions another pass of the group changed.  Each run of a pass uses a new
+// token from its factory.
+Optimizer::PassToken CreateFixedPointPass(
+    std::vector<std::function<Optimizer::PassToken()>> pass_factories,
+    uint32_t max_rounds);
+
+// Creates a pass that decorates float32 instructions with RelaxedPrecision
+// where computing them in float16 is proven to hardly change the values a
+// fragment shader writes to 8-bit UNORM render targets.
+// |unorm8_locations| are the Locations of the outputs written to such
+// targets.  An instruction is only relaxed if its results only flow into
+// those outputs, and a bound on the error float16 adds to each stored value,
+// computed from the ranges of the values, is at most half a step of the
+// target.  Run the ConvertRelaxedToHalf pass after it to compute the relaxed
+// instructions in float16.  See RelaxFloatOpsByPrecisionPass in
+// relax_float_ops_by_precision_pass.h for details.
+Optimizer::PassToken CreateRelaxFloatOpsByPrecisionPass(
+    const std::vector<uint32_t>& unorm8_locations);
+
 }  // namespace spvtools
 
 #endif  // INCLUDE_SPIRV_TOOLS_OPTIMIZER_HPP_
@@ -21,6 +21,7 @@
 #include "source/opt/ir_loader.h"
 #include "source/table.h"
 #include "source/util/make_unique.h"
+#include "source/val/validate.h"
 
 namespace spvtools {
 namespace {
@@ -65,6 +66,32 @@ std::unique_ptr<opt::IRContext> BuildModule(spv_target_env env,
   return status == SPV_SUCCESS ? std::move(irContext) : nullptr;
 }
 
+std::unique_ptr<opt::IRContext> ValidateAndBuildModule(
+    spv_target_env env, MessageConsumer consumer, const uint32_t* binary,
+    const size_t size, spv_const_validator_options options) {
+  auto context = spvContextCreate(env);
+  SetContextMessageConsumer(context, consumer);
+
+  auto irContext = MakeUnique<opt::IRContext>(env, consumer);
+  opt::IrLoader loader(consumer, irContext->module());
+
+  spv_diagnostic diagnostic = nullptr;
+  spv_result_t status = val::ValidateBinaryAndForwardParse(
+      context, options, binary, size, &diagnostic, &loader, SetSpvHeader,
+      SetSpvInst);
+  loader.EndModule();
+
+  // Report validation errors the same way SpirvTools::Validate() does. Errors
+  // from the loader have already been sent to |consumer|.
+  if (status != SPV_SUCCESS && diagnostic != nullptr && consumer) {
+    consumer(SPV_MSG_ERROR, nullptr, diagnostic->position, diagnostic->error);
+  }
+  spvDiagnosticDestroy(diagnostic);
+  spvContextDestroy(context);
+
+  return status == SPV_SUCCESS ? std::move(irContext) : nullptr;
+}
+
 std::unique_ptr<opt::IRContext> BuildModule(spv_target_env env,
                                             MessageConsumer consumer,
                                             const std::string& text,
@@ -33,6 +33,14 @@ std::unique_ptr<opt::IRContext> BuildModule(spv_target_env env,
                                             const uint32_t* binary,
                                             size_t size);
 
+// Validates the given SPIR-V |binary| with |options| and builds a Module from
+// it, returning the owning IRContext. The binary is parsed once for both.
+// Returns nullptr if the binary is invalid or errors occur, and sends the
+// errors to |consumer|.
+std::unique_ptr<opt::IRContext> ValidateAndBuildModule(
+    spv_target_env env, MessageConsumer consumer, const uint32_t* binary,
+    size_t size, spv_const_validator_options options);
+
 // Builds an Module and returns the owning IRContext from the given
 // SPIR-V assembly |text|.  The |text| will be encoded according to the given
 // target |env|. Returns nullptr if errors occur and sends the errors to
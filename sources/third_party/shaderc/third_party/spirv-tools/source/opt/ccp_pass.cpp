@@ -44,10 +44,17 @@ bool CCPPass::IsVaryingValue(uint32_t id) const { return id == kVaryingSSAId; }
 SSAPropagator::PropStatus CCPPass::MarkInstructionVarying(Instruction* instr) {
   assert(instr->result_id() != 0 &&
          "Instructions with no result cannot be marked varying.");
-  values_[instr->result_id()] = kVaryingSSAId;
+  SetValue(instr->result_id(), kVaryingSSAId);
   return SSAPropagator::kVarying;
 }
 
+void CCPPass::SetValue(uint32_t id, uint32_t value) {
+  if (id >= values_.size()) {
+    values_.resize(std::max<size_t>(id + 1, context()->module()->IdBound()), 0);
+  }
+  values_[id] = value;
+}
+
 SSAPropagator::PropStatus CCPPass::VisitPhi(Instruction* phi) {
   uint32_t meet_val_id = 0;
 
@@ -60,19 +67,19 @@ SSAPropagator::PropStatus CCPPass::VisitPhi(Instruction* phi) {
       continue;
     }
     uint32_t phi_arg_id = phi->GetSingleWordOperand(i);
-    auto it = values_.find(phi_arg_id);
-    if (it != values_.end()) {
+    uint32_t arg_val_id = GetValue(phi_arg_id);
+    if (arg_val_id != 0) {
       // We found an argument with a constant value.  Apply the meet operation
       // with the previous arguments.
-      if (it->second == kVaryingSSAId) {
+      if (arg_val_id == kVaryingSSAId) {
         // The "constant" value is actually a placeholder for varying. Return
         // varying for this phi.
         return MarkInstructionVarying(phi);
       } else if (meet_val_id == 0) {
         // This is the first argument we find.  Initialize the result to its
         // constant value id.
-        meet_val_id = it->second;
-      } else if (it->second == meet_val_id) {
+        meet_val_id = arg_val_id;
+      } else if (arg_val_id == meet_val_id) {
         // The argument is the same constant value already computed. Continue
         // looking.
         continue;
@@ -98,7 +105,7 @@ SSAPropagator::PropStatus CCPPass::VisitPhi(Instruction* phi) {
 
   // All the operands have the same constant value represented by |meet_val_id|.
   // Set the Phi's result to that value and declare it interesting.
-  values_[phi->result_id()] = meet_val_id;
+  SetValue(phi->result_id(), meet_val_id);
   return SSAPropagator::kInteresting;
 }
 
@@ -110,12 +117,12 @@ SSAPropagator::PropStatus CCPPass::VisitAssignment(Instruction* instr) {
   // value to the LHS.
   if (instr->opcode() == SpvOpCopyObject) {
     uint32_t rhs_id = instr->GetSingleWordInOperand(0);
-    auto it = values_.find(rhs_id);
-    if (it != values_.end()) {
-      if (IsVaryingValue(it->second)) {
+    uint32_t rhs_val_id = GetValue(rhs_id);
+    if (rhs_val_id != 0) {
+      if (IsVaryingValue(rhs_val_id)) {
         return MarkInstructionVarying(instr);
       } else {
-        values_[instr->result_id()] = it->second;
+        SetValue(instr->result_id(), rhs_val_id);
         return SSAPropagator::kInteresting;
       }
     }
@@ -129,11 +136,11 @@ SSAPropagator::PropStatus CCPPass::VisitAssignment(Instruction* instr) {
 
   // See if the RHS of the assignment folds into a constant value.
   auto map_func = [this](uint32_t id) {
-    auto it = values_.find(id);
-    if (it == values_.end() || IsVaryingValue(it->second)) {
+    uint32_t val_id = GetValue(id);
+    if (val_id == 0 || IsVaryingValue(val_id)) {
       return id;
     }
-    return it->second;
+    return val_id;
   };
   uint32_t next_id = context()->module()->IdBound();
   Instruction* folded_inst =
@@ -143,7 +150,7 @@ SSAPropagator::PropStatus CCPPass::VisitAssignment(Instruction* instr) {
     // We do not want to change the body of the function by adding new
     // instructions.  When folding we can only generate new constants.
     assert(folded_inst->IsConstant() && "CCP is only interested in constant.");
-    values_[instr->result_id()] = folded_inst->result_id();
+    SetValue(instr->result_id(), folded_inst->result_id());
 
     // If the folded instruction has just been created, its result ID will
     // match the previous ID bound. When this happens, we need to indicate
@@ -157,8 +164,7 @@ SSAPropagator::PropStatus CCPPass::VisitAssignment(Instruction* instr) {
 
   // Conservatively mark this instruction as varying if any input id is varying.
   if (!instr->WhileEachInId([this](uint32_t* op_id) {
-        auto iter = values_.find(*op_id);
-        if (iter != values_.end() && IsVaryingValue(iter->second)) return false;
+        if (IsVaryingValue(GetValue(*op_id))) return false;
         return true;
       })) {
     return MarkInstructionVarying(instr);
@@ -167,8 +173,7 @@ SSAPropagator::PropStatus CCPPass::VisitAssignment(Instruction* instr) {
   // If not, see if there is a least one unknown operand to the instruction.  If
   // so, we might be able to fold it later.
   if (!instr->WhileEachInId([this](uint32_t* op_id) {
-        auto it = values_.find(*op_id);
-        if (it == values_.end()) return false;
+        if (GetValue(*op_id) == 0) return false;
         return true;
       })) {
     return SSAPropagator::kNotInteresting;
@@ -193,15 +198,14 @@ SSAPropagator::PropStatus CCPPass::VisitBranch(Instruction* instr,
     // known value in |values_|.  If it does, set the destination block
     // according to the selector's boolean value.
     uint32_t pred_id = instr->GetSingleWordOperand(0);
-    auto it = values_.find(pred_id);
-    if (it == values_.end() || IsVaryingValue(it->second)) {
+    uint32_t pred_val_id = GetValue(pred_id);
+    if (pred_val_id == 0 || IsVaryingValue(pred_val_id)) {
       // The predicate has an unknown value, either branch could be taken.
       return SSAPropagator::kVarying;
     }
 
-    // Get the constant value for the predicate selector from the value table.
-    // Use it to decide which branch will be taken.
-    uint32_t pred_val_id = it->second;
+    // Use the constant value for the predicate selector from the value table
+    // to decide which branch will be taken.
     const analysis::Constant* c = const_mgr_->FindDeclaredConstant(pred_val_id);
     assert(c && "Expected to find a constant declaration for a known value.");
     // Undef values should have returned as varying above.
@@ -224,15 +228,14 @@ SSAPropagator::PropStatus CCPPass::VisitBranch(Instruction* instr,
       return SSAPropagator::kVarying;
     }
     uint32_t select_id = instr->GetSingleWordOperand(0);
-    auto it = values_.find(select_id);
-    if (it == values_.end() || IsVaryingValue(it->second)) {
+    uint32_t select_val_id = GetValue(select_id);
+    if (select_val_id == 0 || IsVaryingValue(select_val_id)) {
       // The selector has an unknown value, any of the branches could be taken.
       return SSAPropagator::kVarying;
     }
 
-    // Get the constant value for the selector from the value table. Use it to
-    // decide which branch will be taken.
-    uint32_t select_val_id = it->second;
+    // Use the constant value for the selector from the value table to decide
+    // which branch will be taken.
     const analysis::Constant* c =
         const_mgr_->FindDeclaredConstant(select_val_id);
     assert(c && "Expected to find a constant declaration for a known value.");
@@ -282,10 +285,9 @@ bool CCPPass::ReplaceValues() {
   // created_new_constant_ indicator.  For an example, see the bug reported
   // in https://github.com/KhronosGroup/SPIRV-Tools/issues/3636.
   bool changed_ir = created_new_constant_;
-  for (const auto& it : values_) {
-    uint32_t id = it.first;
-    uint32_t cst_id = it.second;
-    if (!IsVaryingValue(cst_id) && id != cst_id) {
+  for (uint32_t id = 0; id < values_.size(); ++id) {
+    uint32_t cst_id = values_[id];
+    if (cst_id != 0 && !IsVaryingValue(cst_id) && id != cst_id) {
       context()->KillNamesAndDecorates(id);
       changed_ir |= context()->ReplaceAllUsesWith(id, cst_id);
     }
@@ -296,16 +298,9 @@ bool CCPPass::ReplaceValues() {
 bool CCPPass::PropagateConstants(Function* fp) {
   // Mark function parameters as varying.
   fp->ForEachParam([this](const Instruction* inst) {
-    values_[inst->result_id()] = kVaryingSSAId;
+    SetValue(inst->result_id(), kVaryingSSAId);
   });
 
-  const auto visit_fn = [this](Instruction* instr, BasicBlock** dest_bb) {
-    return VisitInstruction(instr, dest_bb);
-  };
-
-  propagator_ =
-      std::unique_ptr<SSAPropagator>(new SSAPropagator(context(), visit_fn));
-
   if (propagator_->Run(fp)) {
     return ReplaceValues();
   }
@@ -315,6 +310,7 @@ bool CCPPass::PropagateConstants(Function* fp) {
 
 void CCPPass::Initialize() {
   const_mgr_ = context()->get_constant_mgr();
+  values_.assign(context()->module()->IdBound(), 0);
 
   // Populate the constant table with values from constant declarations in the
   // module.  The values of each OpConstant declaration is the identity
@@ -323,12 +319,20 @@ void CCPPass::Initialize() {
     // Record compile time constant ids. Treat all other global values as
     // varying.
     if (inst.IsConstant()) {
-      values_[inst.result_id()] = inst.result_id();
+      SetValue(inst.result_id(), inst.result_id());
     } else {
-      values_[inst.result_id()] = kVaryingSSAId;
+      SetValue(inst.result_id(), kVaryingSSAId);
     }
   }
 
+  // The propagator is shared by all functions, so that its tables are only
+  // allocated once.
+  const auto visit_fn = [this](Instruction* instr, BasicBlock** dest_bb) {
+    return VisitInstruction(instr, dest_bb);
+  };
+  propagator_ =
+      std::unique_ptr<SSAPropagator>(new SSAPropagator(context(), visit_fn));
+
   created_new_constant_ = false;
 }
 
@@ -27,7 +27,11 @@ Pass::Status CombineAccessChains::Process() {
   bool modified = false;
 
   for (auto& function : *get_module()) {
-    modified |= ProcessFunction(function);
+    if (!context()->IsInFunctionScope(function)) continue;
+    if (ProcessFunction(function)) {
+      context()->MarkFunctionChanged(function);
+      modified = true;
+    }
   }
 
   return (modified ? Status::SuccessWithChange : Status::SuccessWithoutChange);
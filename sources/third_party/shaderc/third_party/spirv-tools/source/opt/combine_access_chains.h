@@ -37,6 +37,8 @@ class CombineAccessChains : public Pass {
            IRContext::kAnalysisTypes;
   }
 
+  bool IsFunctionLocal() const override { return true; }
+
  private:
   // Combine access chains in |function|. Blocks are processed in reverse
   // post-order. Returns true if the function is modified.
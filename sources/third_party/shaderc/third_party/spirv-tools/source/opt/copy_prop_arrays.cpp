@@ -40,6 +40,7 @@ bool IsOpenCL100DebugDeclareOrValue(Instruction* di) {
 Pass::Status CopyPropagateArrays::Process() {
   bool modified = false;
   for (Function& function : *get_module()) {
+    if (!context()->IsInFunctionScope(function)) continue;
     BasicBlock* entry_bb = &*function.begin();
 
     for (auto var_inst = entry_bb->begin(); var_inst->opcode() == SpvOpVariable;
@@ -61,6 +62,7 @@ Pass::Status CopyPropagateArrays::Process() {
       if (source_object != nullptr) {
         if (CanUpdateUses(&*var_inst, source_object->GetPointerTypeId(this))) {
           modified = true;
+          context()->MarkFunctionChanged(function);
           PropagateObject(&*var_inst, source_object.get(), store_inst);
         }
       }
@@ -51,6 +51,8 @@ class CopyPropagateArrays : public MemPass {
            IRContext::kAnalysisConstants | IRContext::kAnalysisTypes;
   }
 
+  bool IsFunctionLocal() const override { return true; }
+
  private:
   // The class used to identify a particular memory object.  This memory object
   // will be owned by a particular variable, meaning that the memory is part of
@@ -0,0 +1,443 @@
+// Copyright (c) 2020 Google LLC.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "source/opt/cost_model.h"
+
+#include <algorithm>
+#include <unordered_set>
+
+#include "source/opcode.h"
+#include "source/opt/ir_context.h"
+#include "source/opt/loop_descriptor.h"
+#include "source/opt/register_pressure.h"
+#include "source/opt/scalar_analysis.h"
+
+namespace spvtools {
+namespace opt {
+
+namespace {
+
+// Returns true if |opcode| operates on an image without being a load, which
+// spvOpcodeIsLoad already covers for sampling, fetching and reading.
+bool IsImageWriteOrQuery(SpvOp opcode) {
+  switch (opcode) {
+    case SpvOpImageWrite:
+    case SpvOpImageQueryFormat:
+    case SpvOpImageQueryOrder:
+    case SpvOpImageQuerySizeLod:
+    case SpvOpImageQuerySize:
+    case SpvOpImageQueryLod:
+    case SpvOpImageQueryLevels:
+    case SpvOpImageQuerySamples:
+      return true;
+    default:
+      return false;
+  }
+}
+
+// Returns true if |inst| does no work of its own once the module is compiled
+// for a GPU.
+bool IsFree(const Instruction& inst) {
+  switch (inst.opcode()) {
+    case SpvOpNop:
+    case SpvOpLabel:
+    case SpvOpPhi:
+    case SpvOpVariable:
+    case SpvOpUndef:
+    case SpvOpCopyObject:
+    case SpvOpSelectionMerge:
+    case SpvOpLoopMerge:
+    case SpvOpLine:
+    case SpvOpNoLine:
+    case SpvOpSampledImage:
+    case SpvOpImage:
+      return true;
+    default:
+      return inst.IsOpenCL100DebugInstr() || inst.IsNonSemanticInstruction();
+  }
+}
+
+uint64_t Round(double value) { return static_cast<uint64_t>(value + 0.5); }
+
+}  // namespace
+
+std::vector<EntryPointCost> ShaderCostModel::ComputeEntryPointCosts() {
+  std::vector<EntryPointCost> costs;
+  for (auto& entry_point : context_->module()->entry_points()) {
+    EntryPointCost cost;
+    cost.execution_model =
+        static_cast<SpvExecutionModel>(entry_point.GetSingleWordInOperand(0));
+    cost.function_id = entry_point.GetSingleWordInOperand(1);
+    cost.name = entry_point.GetInOperand(2).AsString();
+
+    const FunctionCost& function_cost = GetFunctionCost(cost.function_id);
+    cost.alu_instructions = function_cost.alu_instructions;
+    cost.texture_instructions = function_cost.texture_instructions;
+    cost.memory_instructions = function_cost.memory_instructions;
+    cost.control_instructions = function_cost.control_instructions;
+    cost.bytes_read = function_cost.bytes_read;
+    cost.bytes_written = function_cost.bytes_written;
+
+    // Registers and loops are reported once per reachable function, however
+    // many times it is called.
+    std::unordered_set<uint32_t> visited;
+    std::vector<uint32_t> work_list = {cost.function_id};
+    while (!work_list.empty()) {
+      const uint32_t function_id = work_list.back();
+      work_list.pop_back();
+      if (!visited.insert(function_id).second) continue;
+
+      const FunctionCost& reached = GetFunctionCost(function_id);
+      cost.max_live_registers =
+          std::max(cost.max_live_registers, reached.max_live_registers);
+      cost.loops.insert(cost.loops.end(), reached.loops.begin(),
+                        reached.loops.end());
+      for (const auto& call : reached.calls) {
+        work_list.push_back(call.first);
+      }
+    }
+    costs.push_back(std::move(cost));
+  }
+  return costs;
+}
+
+void ShaderCostModel::PrintReport(const std::vector<EntryPointCost>& costs,
+                                  std::ostream& out) const {
+  for (const auto& cost : costs) {
+    out << "entry point \"" << cost.name << "\" ("
+        << context_->grammar().lookupOperandName(
+               SPV_OPERAND_TYPE_EXECUTION_MODEL, cost.execution_model)
+        << ", function %" << cost.function_id << ")\n";
+    out << "  alu instructions: " << Round(cost.alu_instructions) << "\n";
+    out << "  texture instructions: " << Round(cost.texture_instructions)
+        << "\n";
+    out << "  memory instructions: " << Round(cost.memory_instructions)
+        << "\n";
+    out << "  control instructions: " << Round(cost.control_instructions)
+        << "\n";
+    out << "  bytes read: " << Round(cost.bytes_read) << "\n";
+    out << "  bytes written: " << Round(cost.bytes_written) << "\n";
+    out << "  max live registers: " << cost.max_live_registers << "\n";
+    for (const auto& loop : cost.loops) {
+      out << "  loop %" << loop.header_id << " in function %"
+          << loop.function_id << ", depth " << loop.depth << ": ";
+      if (loop.trip_count_known) {
+        out << loop.trip_count << " iterations\n";
+      } else {
+        out << "unknown iterations (assumed " << loop.trip_count << ")\n";
+      }
+    }
+  }
+}
+
+const ShaderCostModel::FunctionCost& ShaderCostModel::GetFunctionCost(
+    uint32_t function_id) {
+  auto it = function_costs_.find(function_id);
+  if (it != function_costs_.end()) return it->second;
+
+  // The entry is created before the callees are visited, so an invalid,
+  // recursive module sees an empty cost instead of recursing forever.
+  FunctionCost& cost = function_costs_[function_id];
+  Function* function = context_->GetFunction(function_id);
+  if (function == nullptr) return cost;
+  cost = ComputeFunctionCost(function);
+
+  // Fold in the callees, weighted by how often each call runs.
+  for (const auto& call : cost.calls) {
+    const FunctionCost& callee = GetFunctionCost(call.first);
+    const double weight = call.second;
+    cost.alu_instructions += weight * callee.alu_instructions;
+    cost.texture_instructions += weight * callee.texture_instructions;
+    cost.memory_instructions += weight * callee.memory_instructions;
+    cost.control_instructions += weight * callee.control_instructions;
+    cost.bytes_read += weight * callee.bytes_read;
+    cost.bytes_written += weight * callee.bytes_written;
+  }
+  return cost;
+}
+
+ShaderCostModel::FunctionCost ShaderCostModel::ComputeFunctionCost(
+    Function* function) {
+  FunctionCost cost;
+
+  LoopDescriptor* loop_descriptor = context_->GetLoopDescriptor(function);
+  std::unordered_map<const Loop*, size_t> trip_counts;
+  for (size_t i = 0; i < loop_descriptor->NumLoops(); ++i) {
+    const Loop& loop = loop_descriptor->GetLoopByIndex(i);
+    bool known = false;
+    const size_t trip_count = GetTripCount(&loop, &known);
+    trip_counts[&loop] = trip_count;
+    cost.loops.push_back({function->result_id(), loop.GetHeaderBlock()->id(),
+                          loop.GetDepth(), known, trip_count});
+  }
+
+  const RegisterLiveness* liveness =
+      context_->GetLivenessAnalysis()->Get(function);
+
+  for (auto& block : *function) {
+    double weight = 1;
+    for (const Loop* loop = (*loop_descriptor)[&block]; loop != nullptr;
+         loop = loop->GetParent()) {
+      weight *= trip_counts[loop];
+    }
+
+    const RegisterLiveness::RegionRegisterLiveness* block_liveness =
+        liveness->Get(&block);
+    if (block_liveness != nullptr) {
+      cost.max_live_registers =
+          std::max(cost.max_live_registers, block_liveness->used_registers_);
+    }
+
+    for (auto& inst : block) {
+      if (IsFree(inst)) continue;
+
+      const SpvOp opcode = inst.opcode();
+      switch (opcode) {
+        case SpvOpLoad:
+          cost.memory_instructions += weight;
+          cost.bytes_read += weight * GetSharedMemoryAccessSize(
+                                          inst.GetSingleWordInOperand(0));
+          break;
+        case SpvOpStore:
+          cost.memory_instructions += weight;
+          cost.bytes_written += weight * GetSharedMemoryAccessSize(
+                                             inst.GetSingleWordInOperand(0));
+          break;
+        case SpvOpCopyMemory:
+        case SpvOpCopyMemorySized:
+          cost.memory_instructions += weight;
+          cost.bytes_written += weight * GetSharedMemoryAccessSize(
+                                             inst.GetSingleWordInOperand(0));
+          cost.bytes_read += weight * GetSharedMemoryAccessSize(
+                                          inst.GetSingleWordInOperand(1));
+          break;
+        case SpvOpFunctionCall:
+          cost.control_instructions += weight;
+          cost.calls.emplace_back(inst.GetSingleWordInOperand(0), weight);
+          break;
+        default:
+          if (spvOpcodeIsAtomicOp(opcode)) {
+            cost.memory_instructions += weight;
+            const size_t size =
+                GetSharedMemoryAccessSize(inst.GetSingleWordInOperand(0));
+            if (opcode != SpvOpAtomicStore) cost.bytes_read += weight * size;
+            if (opcode != SpvOpAtomicLoad) cost.bytes_written += weight * size;
+          } else if (spvOpcodeIsLoad(opcode) || IsImageWriteOrQuery(opcode)) {
+            cost.texture_instructions += weight;
+          } else if (spvOpcodeIsBlockTerminator(opcode) ||
+                     !inst.HasResultId()) {
+            // Barriers and geometry stream instructions are counted with the
+            // branches.
+            cost.control_instructions += weight;
+          } else {
+            cost.alu_instructions += weight;
+          }
+          break;
+      }
+    }
+  }
+  return cost;
+}
+
+size_t ShaderCostModel::GetTripCount(const Loop* loop, bool* known) {
+  *known = false;
+  const BasicBlock* condition = loop->FindConditionBlock();
+  if (condition == nullptr) return unknown_trip_count_;
+
+  size_t iterations = 0;
+  const Instruction* induction = loop->FindConditionVariable(condition);
+  if (induction != nullptr &&
+      loop->FindNumberOfIterations(induction, &*condition->ctail(),
+                                   &iterations)) {
+    *known = true;
+    return iterations;
+  }
+
+  // The loop descriptor only handles a literal bound on the right of the
+  // comparison.  Scalar evolution also folds computed bounds and either
+  // operand order.
+  iterations = GetTripCountFromScalarEvolution(loop, condition, induction);
+  if (iterations != 0) {
+    *known = true;
+    return iterations;
+  }
+  return unknown_trip_count_;
+}
+
+size_t ShaderCostModel::GetTripCountFromScalarEvolution(
+    const Loop* loop, const BasicBlock* condition,
+    const Instruction* induction) {
+  const Instruction& branch = *condition->ctail();
+  if (branch.opcode() != SpvOpBranchConditional) return 0;
+  // Only loops that keep going while the comparison holds are handled.
+  if (!loop->IsInsideLoop(branch.GetSingleWordInOperand(1))) return 0;
+
+  analysis::DefUseManager* def_use_mgr = context_->get_def_use_mgr();
+  const Instruction* compare =
+      def_use_mgr->GetDef(branch.GetSingleWordInOperand(0));
+  if (compare == nullptr || compare->NumInOperands() != 2) return 0;
+
+  const Instruction* lhs =
+      def_use_mgr->GetDef(compare->GetSingleWordInOperand(0));
+  const Instruction* rhs =
+      def_use_mgr->GetDef(compare->GetSingleWordInOperand(1));
+  if (lhs == nullptr || rhs == nullptr) return 0;
+
+  // Put the induction variable on the left, mirroring the comparison if it
+  // was on the right.
+  SpvOp opcode = compare->opcode();
+  if (rhs == induction ||
+      (induction == nullptr && rhs->opcode() == SpvOpPhi &&
+       context_->get_instr_block(rhs->result_id()) ==
+           loop->GetHeaderBlock())) {
+    std::swap(lhs, rhs);
+    switch (opcode) {
+      case SpvOpSLessThan:
+        opcode = SpvOpSGreaterThan;
+        break;
+      case SpvOpULessThan:
+        opcode = SpvOpUGreaterThan;
+        break;
+      case SpvOpSLessThanEqual:
+        opcode = SpvOpSGreaterThanEqual;
+        break;
+      case SpvOpULessThanEqual:
+        opcode = SpvOpUGreaterThanEqual;
+        break;
+      case SpvOpSGreaterThan:
+        opcode = SpvOpSLessThan;
+        break;
+      case SpvOpUGreaterThan:
+        opcode = SpvOpULessThan;
+        break;
+      case SpvOpSGreaterThanEqual:
+        opcode = SpvOpSLessThanEqual;
+        break;
+      case SpvOpUGreaterThanEqual:
+        opcode = SpvOpULessThanEqual;
+        break;
+      default:
+        break;
+    }
+  }
+
+  ScalarEvolutionAnalysis* scev = context_->GetScalarEvolutionAnalysis();
+  const SERecurrentNode* recurrence =
+      scev->SimplifyExpression(scev->AnalyzeInstruction(lhs))
+          ->AsSERecurrentNode();
+  if (recurrence == nullptr || recurrence->GetLoop() != loop) return 0;
+  const SEConstantNode* init = recurrence->GetOffset()->AsSEConstantNode();
+  const SEConstantNode* step = recurrence->GetCoefficient()->AsSEConstantNode();
+  const SEConstantNode* bound =
+      scev->SimplifyExpression(scev->AnalyzeInstruction(rhs))
+          ->AsSEConstantNode();
+  if (init == nullptr || step == nullptr || bound == nullptr) return 0;
+
+  const int64_t first = init->FoldToSingleValue();
+  const int64_t stride = step->FoldToSingleValue();
+  const int64_t last = bound->FoldToSingleValue();
+  switch (opcode) {
+    case SpvOpSLessThan:
+    case SpvOpULessThan:
+      if (stride <= 0 || first >= last) return 0;
+      return static_cast<size_t>((last - first + stride - 1) / stride);
+    case SpvOpSLessThanEqual:
+    case SpvOpULessThanEqual:
+      if (stride <= 0 || first > last) return 0;
+      return static_cast<size_t>((last - first) / stride + 1);
+    case SpvOpSGreaterThan:
+    case SpvOpUGreaterThan:
+      if (stride >= 0 || first <= last) return 0;
+      return static_cast<size_t>((first - last - stride - 1) / -stride);
+    case SpvOpSGreaterThanEqual:
+    case SpvOpUGreaterThanEqual:
+      if (stride >= 0 || first < last) return 0;
+      return static_cast<size_t>((first - last) / -stride + 1);
+    case SpvOpINotEqual:
+      if (stride == 0 || (last - first) % stride != 0 ||
+          (last - first) / stride <= 0) {
+        return 0;
+      }
+      return static_cast<size_t>((last - first) / stride);
+    default:
+      return 0;
+  }
+}
+
+size_t ShaderCostModel::GetTypeSize(const analysis::Type* type) const {
+  // Sizes ignore layout padding; they estimate traffic, not offsets.
+  if (const analysis::Integer* int_type = type->AsInteger()) {
+    return int_type->width() / 8;
+  }
+  if (const analysis::Float* float_type = type->AsFloat()) {
+    return float_type->width() / 8;
+  }
+  if (type->AsBool()) return 4;
+  if (type->AsPointer()) return 8;
+  if (const analysis::Vector* vector_type = type->AsVector()) {
+    return vector_type->element_count() *
+           GetTypeSize(vector_type->element_type());
+  }
+  if (const analysis::Matrix* matrix_type = type->AsMatrix()) {
+    return matrix_type->element_count() *
+           GetTypeSize(matrix_type->element_type());
+  }
+  if (const analysis::Array* array_type = type->AsArray()) {
+    const auto& length = array_type->length_info();
+    if (length.words.size() < 2 ||
+        length.words[0] == analysis::Array::LengthInfo::kDefiningId) {
+      return 0;
+    }
+    // The literal value follows the case word, and the spec id if any.
+    const uint32_t count =
+        length.words[0] == analysis::Array::LengthInfo::kConstant
+            ? length.words[1]
+            : length.words.back();
+    return count * GetTypeSize(array_type->element_type());
+  }
+  if (const analysis::Struct* struct_type = type->AsStruct()) {
+    size_t size = 0;
+    for (const analysis::Type* member : struct_type->element_types()) {
+      size += GetTypeSize(member);
+    }
+    return size;
+  }
+  return 0;
+}
+
+size_t ShaderCostModel::GetSharedMemoryAccessSize(uint32_t pointer_id) const {
+  const Instruction* pointer_inst =
+      context_->get_def_use_mgr()->GetDef(pointer_id);
+  if (pointer_inst == nullptr) return 0;
+  const analysis::Type* type =
+      context_->get_type_mgr()->GetType(pointer_inst->type_id());
+  const analysis::Pointer* pointer_type = type ? type->AsPointer() : nullptr;
+  if (pointer_type == nullptr) return 0;
+
+  switch (pointer_type->storage_class()) {
+    case SpvStorageClassUniform:
+    case SpvStorageClassUniformConstant:
+    case SpvStorageClassStorageBuffer:
+    case SpvStorageClassPhysicalStorageBuffer:
+    case SpvStorageClassPushConstant:
+    case SpvStorageClassWorkgroup:
+    case SpvStorageClassCrossWorkgroup:
+      return GetTypeSize(pointer_type->pointee_type());
+    default:
+      return 0;
+  }
+}
+
+}  // namespace opt
+}  // namespace spvtools
@@ -0,0 +1,143 @@
+// Copyright (c) 2020 Google LLC.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SOURCE_OPT_COST_MODEL_H_
+#define SOURCE_OPT_COST_MODEL_H_
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "source/opt/function.h"
+#include "source/opt/types.h"
+
+namespace spvtools {
+namespace opt {
+
+class IRContext;
+class Loop;
+
+// Static estimate of the work done by one invocation of an entry point.
+//
+// Instruction counts are dynamic estimates: each instruction is weighted by
+// the trip counts of the loops enclosing it, and the instructions of a called
+// function are weighted by the weight of the call site.  Both sides of a
+// selection are counted, so the estimate is an upper bound on straight-line
+// work.
+struct EntryPointCost {
+  // Trip count information for one loop reachable from the entry point.
+  struct LoopCost {
+    // The id of the function containing the loop.
+    uint32_t function_id;
+    // The id of the loop header block.
+    uint32_t header_id;
+    // The nesting depth of the loop, 1 for an outermost loop.
+    size_t depth;
+    // True if the trip count could be computed.  Otherwise |trip_count| is
+    // the trip count the model assumed.
+    bool trip_count_known;
+    size_t trip_count;
+  };
+
+  std::string name;
+  SpvExecutionModel execution_model;
+  uint32_t function_id;
+
+  // Estimated dynamic instruction mix.
+  double alu_instructions = 0;
+  double texture_instructions = 0;
+  double memory_instructions = 0;
+  double control_instructions = 0;
+
+  // Estimated bytes loaded from and stored to memory that is not private to
+  // the invocation (uniform, storage, push constant and workgroup memory).
+  double bytes_read = 0;
+  double bytes_written = 0;
+
+  // The highest number of live registers in any block of any function
+  // reachable from the entry point.
+  size_t max_live_registers = 0;
+
+  std::vector<LoopCost> loops;
+};
+
+// Computes an EntryPointCost for every entry point of a module, from the
+// register liveness, loop descriptor and scalar evolution analyses.
+class ShaderCostModel {
+ public:
+  // |unknown_trip_count| is the trip count assumed for loops whose trip count
+  // cannot be computed.
+  explicit ShaderCostModel(IRContext* context, size_t unknown_trip_count = 16)
+      : context_(context), unknown_trip_count_(unknown_trip_count) {}
+
+  // Returns the cost of each entry point, in the order of the OpEntryPoint
+  // instructions.
+  std::vector<EntryPointCost> ComputeEntryPointCosts();
+
+  // Writes |costs| to |out| as a plain text report, one entry point after the
+  // other.  The format is stable so reports can be diffed.
+  void PrintReport(const std::vector<EntryPointCost>& costs,
+                   std::ostream& out) const;
+
+ private:
+  // The cost of a single function, not counting its callees.
+  struct FunctionCost {
+    double alu_instructions = 0;
+    double texture_instructions = 0;
+    double memory_instructions = 0;
+    double control_instructions = 0;
+    double bytes_read = 0;
+    double bytes_written = 0;
+    size_t max_live_registers = 0;
+    std::vector<EntryPointCost::LoopCost> loops;
+    // The functions called by this function, with the weight of each call.
+    std::vector<std::pair<uint32_t, double>> calls;
+  };
+
+  // Returns the cost of the function |function_id|, computing it the first
+  // time it is asked for.
+  const FunctionCost& GetFunctionCost(uint32_t function_id);
+
+  // Computes the cost of |function|.
+  FunctionCost ComputeFunctionCost(Function* function);
+
+  // Returns the number of iterations of |loop| and sets |known| to whether it
+  // could be computed.
+  size_t GetTripCount(const Loop* loop, bool* known);
+
+  // Returns the number of iterations of |loop| computed from the scalar
+  // evolution of its condition variable, or 0 if it cannot be computed.
+  size_t GetTripCountFromScalarEvolution(const Loop* loop,
+                                         const BasicBlock* condition,
+                                         const Instruction* induction);
+
+  // Returns the size in bytes of |type|, or 0 if it is not sized.
+  size_t GetTypeSize(const analysis::Type* type) const;
+
+  // Returns the number of bytes accessed through |pointer_id| if it points to
+  // memory shared between invocations, and 0 otherwise.
+  size_t GetSharedMemoryAccessSize(uint32_t pointer_id) const;
+
+  IRContext* context_;
+  size_t unknown_trip_count_;
+  std::unordered_map<uint32_t, FunctionCost> function_costs_;
+};
+
+}  // namespace opt
+}  // namespace spvtools
+
+#endif  // SOURCE_OPT_COST_MODEL_H_
@@ -450,7 +450,9 @@ void DeadBranchElimPass::FixBlockOrder() {
     for (uint32_t i = 1; i < blocks.size(); ++i) {
       function->MoveBasicBlockToAfter(blocks[i]->id(), blocks[i - 1]);
     }
-    return true;
+    // Reordering gives no other pass new work, so the function is not marked
+    // as changed for it.
+    return false;
   };
 
   // Reorders blocks according to structured order.
@@ -465,7 +467,7 @@ void DeadBranchElimPass::FixBlockOrder() {
     for (uint32_t i = 1; i < blocks.size(); ++i) {
       function->MoveBasicBlockToAfter(blocks[i]->id(), blocks[i - 1]);
     }
-    return true;
+    return false;
   };
 
   // Structured order is more intuitive so use it where possible.
@@ -49,6 +49,8 @@ class DeadBranchElimPass : public MemPass {
            IRContext::kAnalysisConstants | IRContext::kAnalysisTypes;
   }
 
+  bool IsFunctionLocal() const override { return true; }
+
  private:
   // If |condId| is boolean constant, return conditional value in |condVal| and
   // return true, otherwise return false.
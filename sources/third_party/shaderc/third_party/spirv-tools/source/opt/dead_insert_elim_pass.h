@@ -49,6 +49,8 @@ class DeadInsertElimPass : public MemPass {
            IRContext::kAnalysisTypes;
   }
 
+  bool IsFunctionLocal() const override { return true; }
+
  private:
   // Return the number of subcomponents in the composite type |typeId|.
   // Return 0 if not a composite type or number of components is not a
@@ -0,0 +1,88 @@
+// Copyright (c) 2020 Google LLC.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "source/opt/fixed_point_pass.h"
+
+#include "source/opt/ir_context.h"
+
+namespace spvtools {
+namespace opt {
+
+Pass::Status FixedPointPass::Process() {
+  // The functions changed since each pass last ran.
+  std::vector<std::unordered_set<uint32_t>> dirty(factories_.size());
+  std::vector<bool> has_run(factories_.size(), false);
+  bool modified = false;
+
+  for (uint32_t round = 0; round < max_rounds_; ++round) {
+    bool ran_pass = false;
+    for (size_t i = 0; i < factories_.size(); ++i) {
+      if (has_run[i] && dirty[i].empty()) continue;
+
+      std::unique_ptr<Pass> pass = factories_[i]();
+      pass->SetMessageConsumer(consumer());
+      const std::unordered_map<uint32_t, uint32_t> before = GetChangeCounts();
+      if (has_run[i] && pass->IsFunctionLocal()) {
+        context()->SetFunctionScope(&dirty[i]);
+      }
+      Status status = pass->Run(context());
+      context()->SetFunctionScope(nullptr);
+      if (status == Status::Failure) return status;
+      ran_pass = true;
+      has_run[i] = true;
+      dirty[i].clear();
+
+      if (status == Status::SuccessWithChange) {
+        modified = true;
+        const std::unordered_set<uint32_t> changed =
+            GetChangedFunctions(before);
+        for (size_t j = 0; j < factories_.size(); ++j) {
+          if (j != i) dirty[j].insert(changed.begin(), changed.end());
+        }
+      }
+    }
+    if (!ran_pass) break;
+  }
+
+  return modified ? Status::SuccessWithChange : Status::SuccessWithoutChange;
+}
+
+std::unordered_map<uint32_t, uint32_t> FixedPointPass::GetChangeCounts()
+    const {
+  std::unordered_map<uint32_t, uint32_t> counts;
+  for (const Function& function : *get_module()) {
+    counts[function.result_id()] =
+        context()->GetFunctionChangeCount(function.result_id());
+  }
+  return counts;
+}
+
+std::unordered_set<uint32_t> FixedPointPass::GetChangedFunctions(
+    const std::unordered_map<uint32_t, uint32_t>& before) const {
+  std::unordered_set<uint32_t> changed;
+  std::unordered_set<uint32_t> all;
+  for (const Function& function : *get_module()) {
+    const uint32_t id = function.result_id();
+    all.insert(id);
+    auto it = before.find(id);
+    if (it == before.end() ||
+        it->second != context()->GetFunctionChangeCount(id)) {
+      changed.insert(id);
+    }
+  }
+  return changed.empty() ? all : changed;
+}
+
+}  // namespace opt
+}  // namespace spvtools
@@ -0,0 +1,75 @@
+// Copyright (c) 2020 Google LLC.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SOURCE_OPT_FIXED_POINT_PASS_H_
+#define SOURCE_OPT_FIXED_POINT_PASS_H_
+
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "source/opt/pass.h"
+
+namespace spvtools {
+namespace opt {
+
+// Runs a group of passes repeatedly until they stop changing the module.
+//
+// Each round runs the passes of the group in order, but a pass is skipped if
+// no function has changed since the pass last ran: running it again would
+// find the same code it already processed.  A function-local pass (see
+// Pass::IsFunctionLocal) is run again only on the functions that changed;
+// other passes see the whole module.  The group stops when a round runs no
+// pass, or after |max_rounds| rounds.
+//
+// Changes are tracked per function through the change counts of the context
+// (see IRContext::MarkFunctionChanged).  A pass that reports a change without
+// marking any function is taken to have changed every function.
+//
+// A pass object can only run once, so the group is given factories and makes
+// a new pass for each run.
+class FixedPointPass : public Pass {
+ public:
+  using PassFactory = std::function<std::unique_ptr<Pass>()>;
+
+  FixedPointPass(std::vector<PassFactory> factories, uint32_t max_rounds)
+      : factories_(std::move(factories)), max_rounds_(max_rounds) {}
+
+  const char* name() const override { return "fixed-point"; }
+  Status Process() override;
+
+  // Every pass of the group invalidates the analyses it does not preserve.
+  IRContext::Analysis GetPreservedAnalyses() override {
+    return static_cast<IRContext::Analysis>(IRContext::kAnalysisEnd - 1);
+  }
+
+ private:
+  // Returns the change count of every function of the module, by id.
+  std::unordered_map<uint32_t, uint32_t> GetChangeCounts() const;
+
+  // Returns the ids of the functions whose change count differs from
+  // |before|, or of every function if there are none.
+  std::unordered_set<uint32_t> GetChangedFunctions(
+      const std::unordered_map<uint32_t, uint32_t>& before) const;
+
+  std::vector<PassFactory> factories_;
+  uint32_t max_rounds_;
+};
+
+}  // namespace opt
+}  // namespace spvtools
+
+#endif  // SOURCE_OPT_FIXED_POINT_PASS_H_
@@ -0,0 +1,637 @@
+// Copyright (c) 2020 Google LLC.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "source/opt/global_load_store_elim_pass.h"
+
+#include <algorithm>
+#include <list>
+
+#include "source/opcode.h"
+
+namespace spvtools {
+namespace opt {
+
+namespace {
+
+const uint32_t kLoadPointerInIdx = 0;
+const uint32_t kLoadMemoryAccessInIdx = 1;
+const uint32_t kStorePointerInIdx = 0;
+const uint32_t kStoreValueInIdx = 1;
+const uint32_t kStoreMemoryAccessInIdx = 2;
+const uint32_t kControlBarrierSemanticsInIdx = 2;
+const uint32_t kMemoryBarrierSemanticsInIdx = 1;
+const uint32_t kAccessChainBaseInIdx = 0;
+const uint32_t kPointerTypeStorageClassInIdx = 0;
+const uint32_t kPointerTypePointeeInIdx = 1;
+
+// Memory access flags that make a load or store observable by, or dependent
+// on, other invocations.
+const uint32_t kSynchronizingMemoryAccess =
+    SpvMemoryAccessVolatileMask | SpvMemoryAccessMakePointerAvailableMask |
+    SpvMemoryAccessMakePointerVisibleMask;
+
+// Memory semantics flags naming a storage class.
+const uint32_t kStorageClassSemantics =
+    SpvMemorySemanticsUniformMemoryMask | SpvMemorySemanticsSubgroupMemoryMask |
+    SpvMemorySemanticsWorkgroupMemoryMask |
+    SpvMemorySemanticsCrossWorkgroupMemoryMask |
+    SpvMemorySemanticsAtomicCounterMemoryMask |
+    SpvMemorySemanticsImageMemoryMask | SpvMemorySemanticsOutputMemoryKHRMask;
+
+// Removes from |values| and |locations| the locations satisfying |pred|.
+template <typename Predicate>
+void RemoveIf(std::unordered_map<uint32_t, uint32_t>* values, Predicate pred) {
+  for (auto it = values->begin(); it != values->end();) {
+    if (pred(it->first)) {
+      it = values->erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+template <typename Predicate>
+void RemoveIf(utils::BitVector* locations, Predicate pred) {
+  locations->ForEachSetBit([locations, &pred](uint32_t location) {
+    if (pred(location)) locations->Clear(location);
+  });
+}
+
+void RemoveLocation(uint32_t location,
+                    std::unordered_map<uint32_t, uint32_t>* values) {
+  values->erase(location);
+}
+
+void RemoveLocation(uint32_t location, utils::BitVector* locations) {
+  locations->Clear(location);
+}
+
+// Returns true if |inst| accesses no memory even though it may have pointer
+// operands.
+bool IsPointerArithmetic(const Instruction* inst) {
+  switch (inst->opcode()) {
+    case SpvOpAccessChain:
+    case SpvOpInBoundsAccessChain:
+    case SpvOpPtrAccessChain:
+    case SpvOpInBoundsPtrAccessChain:
+    case SpvOpCopyObject:
+    case SpvOpArrayLength:
+    case SpvOpPtrEqual:
+    case SpvOpPtrNotEqual:
+    case SpvOpPtrDiff:
+    case SpvOpPhi:
+    case SpvOpSelect:
+      return true;
+    default:
+      return inst->IsOpenCL100DebugInstr();
+  }
+}
+
+}  // namespace
+
+bool GlobalLoadStoreElimPass::MayAlias(uint32_t a, uint32_t b) const {
+  if (a == b) return true;
+  const Location& first = locations_[a];
+  const Location& second = locations_[b];
+  if (first.kind != second.kind) return false;
+  if (first.variable != second.variable) {
+    return first.aliased || second.aliased;
+  }
+
+  // Within a variable, locations are disjoint only if they differ in a
+  // constant index.  Otherwise one contains the other, or they may be the
+  // same element.
+  size_t length = std::min(first.indexes.size(), second.indexes.size());
+  for (size_t i = 0; i < length; ++i) {
+    const Index& x = first.indexes[i];
+    const Index& y = second.indexes[i];
+    if (x.is_constant && y.is_constant && x.value != y.value) return false;
+  }
+  return true;
+}
+
+template <typename Container>
+void GlobalLoadStoreElimPass::RemoveAliases(uint32_t location,
+                                            Container* container) const {
+  RemoveIf(container, [this, location](uint32_t other) {
+    return MayAlias(location, other);
+  });
+}
+
+template <typename Container>
+void GlobalLoadStoreElimPass::RemoveKinds(uint32_t kinds,
+                                          Container* container) const {
+  if (kinds == kNoMemory) return;
+  RemoveIf(container, [this, kinds](uint32_t location) {
+    return (locations_[location].kind & kinds) != 0;
+  });
+}
+
+template <typename Container>
+void GlobalLoadStoreElimPass::RemoveDependents(uint32_t id,
+                                               Container* container) const {
+  auto users = index_users_.find(id);
+  if (users == index_users_.end()) return;
+  for (uint32_t location : users->second) {
+    RemoveLocation(location, container);
+  }
+}
+
+Pass::Status GlobalLoadStoreElimPass::Process() {
+  // Physical pointers can point anywhere, so locations cannot be told apart.
+  if (context()->get_feature_mgr()->HasCapability(SpvCapabilityAddresses))
+    return Status::SuccessWithoutChange;
+  stores_may_be_discarded_ = context()->get_feature_mgr()->HasCapability(
+      SpvCapabilityDemoteToHelperInvocationEXT);
+
+  bool modified = false;
+  for (Function& func : *get_module()) {
+    modified |= EliminateRedundantLoads(&func);
+    modified |= EliminateDeadStores(&func);
+  }
+  return modified ? Status::SuccessWithChange : Status::SuccessWithoutChange;
+}
+
+bool GlobalLoadStoreElimPass::EliminateRedundantLoads(Function* func) {
+  ResetLocations();
+  std::list<BasicBlock*> order;
+  cfg()->ComputeStructuredOrder(func, &*func->begin(), &order);
+
+  // The values available at the end of each block.  A block that is not in
+  // the map has not been visited yet, and does not restrict its successors.
+  std::unordered_map<uint32_t, AvailableValues> block_values;
+  auto get_entry_values = [this, func, &block_values](BasicBlock* bb,
+                                                      AvailableValues* values) {
+    bool visited = false;
+    for (uint32_t pred_id : cfg()->preds(bb->id())) {
+      auto pred = block_values.find(pred_id);
+      if (pred == block_values.end()) continue;
+      if (!visited) {
+        *values = pred->second;
+        visited = true;
+        continue;
+      }
+      for (auto it = values->begin(); it != values->end();) {
+        auto other = pred->second.find(it->first);
+        if (other == pred->second.end() || other->second != it->second) {
+          it = values->erase(it);
+        } else {
+          ++it;
+        }
+      }
+    }
+    return visited || bb == &*func->begin();
+  };
+
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (BasicBlock* bb : order) {
+      AvailableValues values;
+      if (!get_entry_values(bb, &values)) continue;
+      for (Instruction& inst : *bb) {
+        UpdateAvailableValues(&inst, &values, nullptr);
+      }
+      auto it = block_values.find(bb->id());
+      if (it == block_values.end()) {
+        block_values.emplace(bb->id(), std::move(values));
+        changed = true;
+      } else if (it->second != values) {
+        it->second = std::move(values);
+        changed = true;
+      }
+    }
+  }
+
+  std::vector<std::pair<Instruction*, uint32_t>> redundant_loads;
+  for (BasicBlock* bb : order) {
+    AvailableValues values;
+    if (!get_entry_values(bb, &values)) continue;
+    for (Instruction& inst : *bb) {
+      UpdateAvailableValues(&inst, &values, &redundant_loads);
+    }
+  }
+
+  // A load replaced earlier can be the value of a later load.  The structured
+  // order visits the earlier load first, so one lookup finds the final value.
+  DominatorAnalysis* dom = context()->GetDominatorAnalysis(func);
+  std::vector<std::pair<Instruction*, uint32_t>> replacements;
+  std::unordered_map<uint32_t, uint32_t> replaced_ids;
+  for (const auto& redundant : redundant_loads) {
+    Instruction* load = redundant.first;
+    uint32_t value_id = redundant.second;
+    auto it = replaced_ids.find(value_id);
+    if (it != replaced_ids.end()) value_id = it->second;
+    Instruction* value = get_def_use_mgr()->GetDef(value_id);
+    if (value->type_id() != load->type_id()) continue;
+    if (context()->get_instr_block(value) != nullptr &&
+        !dom->Dominates(value, load)) {
+      continue;
+    }
+    replaced_ids[load->result_id()] = value_id;
+    replacements.emplace_back(load, value_id);
+  }
+
+  for (const auto& replacement : replacements) {
+    Instruction* load = replacement.first;
+    context()->KillNamesAndDecorates(load);
+    context()->ReplaceAllUsesWith(load->result_id(), replacement.second);
+    context()->KillInst(load);
+  }
+  return !replacements.empty();
+}
+
+bool GlobalLoadStoreElimPass::EliminateDeadStores(Function* func) {
+  ResetLocations();
+  std::list<BasicBlock*> order;
+  cfg()->ComputeStructuredOrder(func, &*func->begin(), &order);
+  order.reverse();
+
+  // The locations overwritten after the start of each block.  A block that is
+  // not in the map has not been visited yet, and does not restrict its
+  // predecessors.  Blocks without successors leave the function, after which
+  // every location may be read.
+  std::unordered_map<uint32_t, OverwrittenLocations> block_locations;
+  auto get_exit_locations = [&block_locations](
+                                BasicBlock* bb,
+                                OverwrittenLocations* locations) {
+    bool has_successor = false;
+    bool visited = false;
+    bb->ForEachSuccessorLabel([&](uint32_t succ_id) {
+      has_successor = true;
+      auto succ = block_locations.find(succ_id);
+      if (succ == block_locations.end()) return;
+      if (!visited) {
+        *locations = succ->second;
+        visited = true;
+        return;
+      }
+      locations->And(succ->second);
+    });
+    return visited || !has_successor;
+  };
+
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (BasicBlock* bb : order) {
+      OverwrittenLocations locations;
+      if (!get_exit_locations(bb, &locations)) continue;
+      for (auto inst = bb->rbegin(); inst != bb->rend(); ++inst) {
+        UpdateOverwrittenLocations(&*inst, &locations, nullptr);
+      }
+      auto it = block_locations.find(bb->id());
+      if (it == block_locations.end()) {
+        block_locations.emplace(bb->id(), std::move(locations));
+        changed = true;
+      } else if (it->second != locations) {
+        it->second = std::move(locations);
+        changed = true;
+      }
+    }
+  }
+
+  std::vector<Instruction*> dead_stores;
+  for (BasicBlock* bb : order) {
+    OverwrittenLocations locations;
+    if (!get_exit_locations(bb, &locations)) continue;
+    for (auto inst = bb->rbegin(); inst != bb->rend(); ++inst) {
+      UpdateOverwrittenLocations(&*inst, &locations, &dead_stores);
+    }
+  }
+
+  for (Instruction* store : dead_stores) {
+    context()->KillInst(store);
+  }
+  return !dead_stores.empty();
+}
+
+void GlobalLoadStoreElimPass::UpdateAvailableValues(
+    Instruction* inst, AvailableValues* values,
+    std::vector<std::pair<Instruction*, uint32_t>>* redundant_loads) {
+  switch (inst->opcode()) {
+    case SpvOpLoad: {
+      uint32_t location = GetAccessedLocation(inst);
+      if (location == 0) break;
+      auto it = values->find(location);
+      if (it == values->end()) {
+        (*values)[location] = inst->result_id();
+      } else if (redundant_loads != nullptr) {
+        redundant_loads->emplace_back(inst, it->second);
+      }
+      break;
+    }
+    case SpvOpStore: {
+      uint32_t location = GetAccessedLocation(inst);
+      if (location == 0) {
+        RemoveKinds(
+            GetMemoryKind(inst->GetSingleWordInOperand(kStorePointerInIdx)),
+            values);
+        break;
+      }
+      RemoveAliases(location, values);
+      if (!stores_may_be_discarded_) {
+        (*values)[location] = inst->GetSingleWordInOperand(kStoreValueInIdx);
+      }
+      break;
+    }
+    default: {
+      if (IsPointerArithmetic(inst)) break;
+      uint32_t synchronized = GetSynchronizedMemory(inst);
+      if (synchronized != kNoMemory) {
+        RemoveKinds(synchronized, values);
+        break;
+      }
+      // Any other access through a pointer may write it.
+      ForEachPointerOperand(inst, [this, values](uint32_t kind,
+                                                 uint32_t location) {
+        if (location == 0) {
+          RemoveKinds(kind, values);
+        } else {
+          RemoveAliases(location, values);
+        }
+      });
+      break;
+    }
+  }
+
+  if (inst->result_id() != 0) {
+    RemoveDependents(inst->result_id(), values);
+  }
+}
+
+void GlobalLoadStoreElimPass::UpdateOverwrittenLocations(
+    Instruction* inst, OverwrittenLocations* locations,
+    std::vector<Instruction*>* dead_stores) {
+  // Above the definition of an id, a location indexed by it is not the
+  // location that is overwritten.
+  if (inst->result_id() != 0) {
+    RemoveDependents(inst->result_id(), locations);
+  }
+
+  switch (inst->opcode()) {
+    case SpvOpStore: {
+      uint32_t location = GetAccessedLocation(inst);
+      if (location == 0) break;
+      if (locations->Set(location) && dead_stores != nullptr) {
+        dead_stores->push_back(inst);
+      }
+      break;
+    }
+    case SpvOpLoad: {
+      uint32_t location = GetAccessedLocation(inst);
+      if (location == 0) {
+        RemoveKinds(
+            GetMemoryKind(inst->GetSingleWordInOperand(kLoadPointerInIdx)),
+            locations);
+      } else {
+        RemoveAliases(location, locations);
+      }
+      break;
+    }
+    default: {
+      if (IsPointerArithmetic(inst)) break;
+      uint32_t synchronized = GetSynchronizedMemory(inst);
+      if (synchronized != kNoMemory) {
+        RemoveKinds(synchronized, locations);
+        break;
+      }
+      // Any other access through a pointer may read it.
+      ForEachPointerOperand(inst, [this, locations](uint32_t kind,
+                                                    uint32_t location) {
+        if (location == 0) {
+          RemoveKinds(kind, locations);
+        } else {
+          RemoveAliases(location, locations);
+        }
+      });
+      break;
+    }
+  }
+}
+
+uint32_t GlobalLoadStoreElimPass::GetAccessedLocation(Instruction* inst) {
+  uint32_t pointer_in_idx = kLoadPointerInIdx;
+  uint32_t memory_access_in_idx = kLoadMemoryAccessInIdx;
+  if (inst->opcode() == SpvOpStore) {
+    pointer_in_idx = kStorePointerInIdx;
+    memory_access_in_idx = kStoreMemoryAccessInIdx;
+  }
+  if (inst->NumInOperands() > memory_access_in_idx &&
+      (inst->GetSingleWordInOperand(memory_access_in_idx) &
+       kSynchronizingMemoryAccess) != 0) {
+    return 0;
+  }
+  return GetLocation(inst->GetSingleWordInOperand(pointer_in_idx));
+}
+
+uint32_t GlobalLoadStoreElimPass::GetLocation(uint32_t pointer_id) {
+  auto cached = pointer_locations_.find(pointer_id);
+  if (cached != pointer_locations_.end()) return cached->second;
+
+  uint32_t location = 0;
+  Instruction* pointer = get_def_use_mgr()->GetDef(pointer_id);
+  switch (pointer->opcode()) {
+    case SpvOpVariable: {
+      uint32_t kind = GetMemoryKind(pointer_id);
+      if (kind == kNoMemory || IsVolatileOrCoherent(pointer)) break;
+      Location variable;
+      variable.variable = pointer_id;
+      variable.kind = kind;
+      variable.aliased = !get_decoration_mgr()->WhileEachDecoration(
+          pointer_id, SpvDecorationAliased,
+          [](const Instruction&) { return false; });
+      location = AddLocation(std::move(variable));
+      break;
+    }
+    case SpvOpAccessChain:
+    case SpvOpInBoundsAccessChain: {
+      uint32_t base =
+          GetLocation(pointer->GetSingleWordInOperand(kAccessChainBaseInIdx));
+      if (base == 0) break;
+      Location element = locations_[base];
+      for (uint32_t i = kAccessChainBaseInIdx + 1; i < pointer->NumInOperands();
+           ++i) {
+        Index index = {pointer->GetSingleWordInOperand(i), false, 0};
+        // Specialization constants may turn out equal, so only constants
+        // with a fixed value are compared by value.
+        Instruction* index_inst = get_def_use_mgr()->GetDef(index.id);
+        if (index_inst->opcode() == SpvOpConstant) {
+          const analysis::IntConstant* constant =
+              context()
+                  ->get_constant_mgr()
+                  ->GetConstantFromInst(index_inst)
+                  ->AsIntConstant();
+          if (constant != nullptr) {
+            index.is_constant = true;
+            index.value =
+                constant->type()->AsInteger()->IsSigned()
+                    ? static_cast<uint64_t>(constant->GetSignExtendedValue())
+                    : constant->GetZeroExtendedValue();
+          }
+        }
+        element.indexes.push_back(index);
+      }
+      location = AddLocation(std::move(element));
+      break;
+    }
+    case SpvOpCopyObject:
+      location = GetLocation(pointer->GetSingleWordInOperand(0));
+      break;
+    default:
+      break;
+  }
+  pointer_locations_[pointer_id] = location;
+  return location;
+}
+
+uint32_t GlobalLoadStoreElimPass::AddLocation(Location&& location) {
+  std::vector<uint32_t> key = {location.variable};
+  for (const Index& index : location.indexes) {
+    if (index.is_constant) {
+      key.push_back(1);
+      key.push_back(static_cast<uint32_t>(index.value));
+      key.push_back(static_cast<uint32_t>(index.value >> 32));
+    } else {
+      key.push_back(0);
+      key.push_back(index.id);
+    }
+  }
+
+  auto inserted = location_numbers_.insert(
+      {std::move(key), static_cast<uint32_t>(locations_.size())});
+  uint32_t number = inserted.first->second;
+  if (inserted.second) {
+    for (const Index& index : location.indexes) {
+      if (!index.is_constant) index_users_[index.id].push_back(number);
+    }
+    locations_.push_back(std::move(location));
+  }
+  return number;
+}
+
+uint32_t GlobalLoadStoreElimPass::GetMemoryKind(uint32_t pointer_id) {
+  Instruction* pointer = get_def_use_mgr()->GetDef(pointer_id);
+  if (pointer == nullptr || pointer->type_id() == 0) return kNoMemory;
+  Instruction* type = get_def_use_mgr()->GetDef(pointer->type_id());
+  if (type->opcode() != SpvOpTypePointer) return kNoMemory;
+  switch (type->GetSingleWordInOperand(kPointerTypeStorageClassInIdx)) {
+    case SpvStorageClassUniform:
+    case SpvStorageClassStorageBuffer:
+    case SpvStorageClassPhysicalStorageBuffer:
+      return kBufferMemory;
+    case SpvStorageClassWorkgroup:
+      return kWorkgroupMemory;
+    case SpvStorageClassPushConstant:
+      return kConstantMemory;
+    default:
+      return kNoMemory;
+  }
+}
+
+uint32_t GlobalLoadStoreElimPass::GetSynchronizedMemory(Instruction* inst) {
+  uint32_t semantics_id = 0;
+  switch (inst->opcode()) {
+    case SpvOpControlBarrier:
+      semantics_id =
+          inst->GetSingleWordInOperand(kControlBarrierSemanticsInIdx);
+      break;
+    case SpvOpMemoryBarrier:
+      semantics_id = inst->GetSingleWordInOperand(kMemoryBarrierSemanticsInIdx);
+      break;
+    case SpvOpFunctionCall:
+    case SpvOpBeginInvocationInterlockEXT:
+    case SpvOpEndInvocationInterlockEXT:
+    case SpvOpKill:
+    case SpvOpTerminateInvocation:
+    case SpvOpDemoteToHelperInvocationEXT:
+      return kAllMemory;
+    default:
+      return spvOpcodeIsAtomicOp(inst->opcode()) ? kAllMemory : kNoMemory;
+  }
+
+  // Constant memory is never written, so barriers do not affect it.
+  const uint32_t kWritableMemory = kBufferMemory | kWorkgroupMemory;
+  Instruction* semantics = get_def_use_mgr()->GetDef(semantics_id);
+  if (semantics->opcode() != SpvOpConstant) return kWritableMemory;
+  uint32_t value = semantics->GetSingleWordInOperand(0);
+  if ((value & kStorageClassSemantics) == 0) return kWritableMemory;
+
+  uint32_t kinds = kNoMemory;
+  if (value & SpvMemorySemanticsUniformMemoryMask) kinds |= kBufferMemory;
+  if (value & SpvMemorySemanticsWorkgroupMemoryMask) kinds |= kWorkgroupMemory;
+  return kinds;
+}
+
+void GlobalLoadStoreElimPass::ForEachPointerOperand(
+    Instruction* inst, const std::function<void(uint32_t, uint32_t)>& f) {
+  inst->ForEachInId([this, &f](const uint32_t* id) {
+    uint32_t kind = GetMemoryKind(*id);
+    if (kind != kNoMemory) f(kind, GetLocation(*id));
+  });
+}
+
+bool GlobalLoadStoreElimPass::IsVolatileOrCoherent(
+    const Instruction* variable) {
+  analysis::DecorationManager* decoration_mgr = get_decoration_mgr();
+  for (uint32_t decoration : {SpvDecorationVolatile, SpvDecorationCoherent}) {
+    if (!decoration_mgr->WhileEachDecoration(
+            variable->result_id(), decoration,
+            [](const Instruction&) { return false; })) {
+      return true;
+    }
+  }
+  Instruction* pointer_type = get_def_use_mgr()->GetDef(variable->type_id());
+  return HasVolatileOrCoherentMembers(
+      pointer_type->GetSingleWordInOperand(kPointerTypePointeeInIdx));
+}
+
+bool GlobalLoadStoreElimPass::HasVolatileOrCoherentMembers(uint32_t type_id) {
+  Instruction* type = get_def_use_mgr()->GetDef(type_id);
+  switch (type->opcode()) {
+    case SpvOpTypeStruct: {
+      analysis::DecorationManager* decoration_mgr = get_decoration_mgr();
+      for (uint32_t decoration :
+           {SpvDecorationVolatile, SpvDecorationCoherent}) {
+        if (!decoration_mgr->WhileEachDecoration(
+                type_id, decoration,
+                [](const Instruction&) { return false; })) {
+          return true;
+        }
+      }
+      for (uint32_t i = 0; i < type->NumInOperands(); ++i) {
+        if (HasVolatileOrCoherentMembers(type->GetSingleWordInOperand(i))) {
+          return true;
+        }
+      }
+      return false;
+    }
+    case SpvOpTypeArray:
+    case SpvOpTypeRuntimeArray:
+      return HasVolatileOrCoherentMembers(type->GetSingleWordInOperand(0));
+    default:
+      return false;
+  }
+}
+
+void GlobalLoadStoreElimPass::ResetLocations() {
+  locations_.clear();
+  location_numbers_.clear();
+  pointer_locations_.clear();
+  index_users_.clear();
+  locations_.push_back({0, kNoMemory, false, {}});
+}
+
+}  // namespace opt
+}  // namespace spvtools
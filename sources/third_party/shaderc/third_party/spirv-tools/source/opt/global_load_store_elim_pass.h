@@ -0,0 +1,187 @@
+// Copyright (c) 2020 Google LLC.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SOURCE_OPT_GLOBAL_LOAD_STORE_ELIM_PASS_H_
+#define SOURCE_OPT_GLOBAL_LOAD_STORE_ELIM_PASS_H_
+
+#include <functional>
+#include <map>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "source/opt/ir_context.h"
+#include "source/opt/pass.h"
+#include "source/util/bit_vector.h"
+
+namespace spvtools {
+namespace opt {
+
+// Eliminates redundant loads and dead stores of memory shared between
+// invocations: Uniform, StorageBuffer, PushConstant and Workgroup variables.
+// Unlike the local load/store passes, it works across the whole CFG of a
+// function.
+//
+// A load is replaced by the value of an earlier load or store of the same
+// location if that load or store happens on every path to it, and no
+// instruction on those paths may write the location.  A store is removed if,
+// on every path from it, the location is stored to again before it may be
+// read.
+//
+// Locations are identified by their variable and the indexes of the access
+// chains that reach them.  Accesses through other pointers, and accesses to
+// variables decorated Volatile or Coherent, are left alone and treated as
+// touching any location of their storage class.
+//
+// Barriers end the range over which a location can be forwarded or
+// overwritten.  An OpControlBarrier or OpMemoryBarrier whose memory semantics
+// are a constant naming storage classes only affects those storage classes;
+// any other barrier, any atomic and any function call affect all of them.
+// So do OpKill, OpTerminateInvocation and OpDemoteToHelperInvocationEXT,
+// after which other invocations may observe the stores made so far.  The
+// stores of a demoted invocation have no effect, so in modules that can
+// demote a store does not make its value available to later loads.
+class GlobalLoadStoreElimPass : public Pass {
+ public:
+  const char* name() const override { return "eliminate-global-load-store"; }
+  Status Process() override;
+
+  IRContext::Analysis GetPreservedAnalyses() override {
+    return IRContext::kAnalysisDefUse |
+           IRContext::kAnalysisInstrToBlockMapping |
+           IRContext::kAnalysisDecorations | IRContext::kAnalysisCombinators |
+           IRContext::kAnalysisCFG | IRContext::kAnalysisDominatorAnalysis |
+           IRContext::kAnalysisLoopAnalysis | IRContext::kAnalysisNameMap |
+           IRContext::kAnalysisConstants | IRContext::kAnalysisTypes;
+  }
+
+ private:
+  // The kinds of memory the pass tracks, as a bit mask.
+  enum MemoryKind {
+    kNoMemory = 0,
+    kBufferMemory = 1,
+    kWorkgroupMemory = 2,
+    kConstantMemory = 4,
+    kAllMemory = 7,
+  };
+
+  // One index of an access chain.  Constant indexes are compared by value,
+  // other indexes by id.
+  struct Index {
+    uint32_t id;
+    bool is_constant;
+    uint64_t value;
+  };
+
+  // A location in memory: a variable and the indexes leading into it.
+  struct Location {
+    uint32_t variable;
+    uint32_t kind;
+    bool aliased;
+    std::vector<Index> indexes;
+  };
+
+  // Maps each location known to hold a value to the id of that value.
+  using AvailableValues = std::unordered_map<uint32_t, uint32_t>;
+  // The set of locations that will be overwritten before being read.
+  using OverwrittenLocations = utils::BitVector;
+
+  // Replaces loads in |func| whose value is already available.  Returns true
+  // if |func| was changed.
+  bool EliminateRedundantLoads(Function* func);
+
+  // Removes stores in |func| whose value is overwritten before it may be
+  // read.  Returns true if |func| was changed.
+  bool EliminateDeadStores(Function* func);
+
+  // Updates |values| for the effect of |inst|.  If |inst| is a load whose
+  // value is available and |redundant_loads| is not null, the load and the id
+  // of its value are added to |redundant_loads|.
+  void UpdateAvailableValues(
+      Instruction* inst, AvailableValues* values,
+      std::vector<std::pair<Instruction*, uint32_t>>* redundant_loads);
+
+  // Updates |locations|, which holds the locations overwritten after |inst|,
+  // to the locations overwritten before |inst|.  If |inst| is a store to one
+  // of |locations| and |dead_stores| is not null, |inst| is added to
+  // |dead_stores|.
+  void UpdateOverwrittenLocations(Instruction* inst,
+                                  OverwrittenLocations* locations,
+                                  std::vector<Instruction*>* dead_stores);
+
+  // Returns the location accessed by the load or store |inst|, or 0 if it
+  // is not one the pass can track.
+  uint32_t GetAccessedLocation(Instruction* inst);
+
+  // Returns the location |pointer_id| points to, or 0 if it is unknown.
+  uint32_t GetLocation(uint32_t pointer_id);
+
+  // Returns the number of |location|, adding it to the known locations if it
+  // is new.
+  uint32_t AddLocation(Location&& location);
+
+  // Returns the MemoryKind of the memory |pointer_id| points to.
+  uint32_t GetMemoryKind(uint32_t pointer_id);
+
+  // Returns the kinds of memory made visible to or by other invocations by
+  // the barrier, atomic, call, kill or demote |inst|.  Returns kNoMemory for
+  // any other instruction.
+  uint32_t GetSynchronizedMemory(Instruction* inst);
+
+  // Calls |f| with the MemoryKind of, and the location accessed through, each
+  // pointer operand of |inst| to tracked memory.  The location is 0 if it is
+  // unknown.
+  void ForEachPointerOperand(Instruction* inst,
+                             const std::function<void(uint32_t, uint32_t)>& f);
+
+  // Returns true if |variable| or one of the members of its type is
+  // decorated Volatile or Coherent.
+  bool IsVolatileOrCoherent(const Instruction* variable);
+  bool HasVolatileOrCoherentMembers(uint32_t type_id);
+
+  // Returns true if the locations |a| and |b| may overlap.
+  bool MayAlias(uint32_t a, uint32_t b) const;
+
+  // Removes from |container| every location that may overlap |location|.
+  template <typename Container>
+  void RemoveAliases(uint32_t location, Container* container) const;
+
+  // Removes from |container| every location of a kind in |kinds|.
+  template <typename Container>
+  void RemoveKinds(uint32_t kinds, Container* container) const;
+
+  // Removes from |container| every location whose indexes use |id|.
+  template <typename Container>
+  void RemoveDependents(uint32_t id, Container* container) const;
+
+  // Forgets every location, so that pointers are looked up again after the
+  // function has been changed.
+  void ResetLocations();
+
+  // The known locations.  Location 0 is the unknown location.
+  std::vector<Location> locations_;
+  // Maps the variable and indexes of a location to its number.
+  std::map<std::vector<uint32_t>, uint32_t> location_numbers_;
+  // Maps each pointer to its location.
+  std::unordered_map<uint32_t, uint32_t> pointer_locations_;
+  // Maps each id used as a non-constant index to the locations using it.
+  std::unordered_map<uint32_t, std::vector<uint32_t>> index_users_;
+  // True if invocations may be demoted to helpers, whose stores are dropped.
+  bool stores_may_be_discarded_ = false;
+};
+
+}  // namespace opt
+}  // namespace spvtools
+
+#endif  // SOURCE_OPT_GLOBAL_LOAD_STORE_ELIM_PASS_H_
@@ -154,6 +154,7 @@
 #include "ir_context.h"
 #include "module.h"
 #include "pass.h"
+#include "scalar_analysis.h"
 #include "source/diagnostic.h"
 #include "source/util/make_unique.h"
 #include "spirv-tools/libspirv.h"
@@ -169,6 +170,73 @@ using opt::Instruction;
 using opt::Operand;
 using spvtools::MakeUnique;
 
+namespace {
+
+// The number of definitions looked through to find the range of a value.
+const uint32_t kMaxValueRangeDepth = 8;
+
+const int64_t kMinInt32 = std::numeric_limits<int32_t>::min();
+const int64_t kMaxInt32 = std::numeric_limits<int32_t>::max();
+
+// Returns the comparison which holds for (y, x) when |op| holds for (x, y),
+// or SpvOpNop if |op| is not an integer comparison.
+SpvOp MirrorComparison(SpvOp op) {
+  switch (op) {
+    case SpvOpSLessThan:
+      return SpvOpSGreaterThan;
+    case SpvOpSLessThanEqual:
+      return SpvOpSGreaterThanEqual;
+    case SpvOpSGreaterThan:
+      return SpvOpSLessThan;
+    case SpvOpSGreaterThanEqual:
+      return SpvOpSLessThanEqual;
+    case SpvOpULessThan:
+      return SpvOpUGreaterThan;
+    case SpvOpULessThanEqual:
+      return SpvOpUGreaterThanEqual;
+    case SpvOpUGreaterThan:
+      return SpvOpULessThan;
+    case SpvOpUGreaterThanEqual:
+      return SpvOpULessThanEqual;
+    case SpvOpIEqual:
+    case SpvOpINotEqual:
+      return op;
+    default:
+      return SpvOpNop;
+  }
+}
+
+// Returns the comparison which holds exactly when |op| does not, or SpvOpNop
+// if |op| is not an integer comparison.
+SpvOp NegateComparison(SpvOp op) {
+  switch (op) {
+    case SpvOpSLessThan:
+      return SpvOpSGreaterThanEqual;
+    case SpvOpSLessThanEqual:
+      return SpvOpSGreaterThan;
+    case SpvOpSGreaterThan:
+      return SpvOpSLessThanEqual;
+    case SpvOpSGreaterThanEqual:
+      return SpvOpSLessThan;
+    case SpvOpULessThan:
+      return SpvOpUGreaterThanEqual;
+    case SpvOpULessThanEqual:
+      return SpvOpUGreaterThan;
+    case SpvOpUGreaterThan:
+      return SpvOpULessThanEqual;
+    case SpvOpUGreaterThanEqual:
+      return SpvOpULessThan;
+    case SpvOpIEqual:
+      return SpvOpINotEqual;
+    case SpvOpINotEqual:
+      return SpvOpIEqual;
+    default:
+      return SpvOpNop;
+  }
+}
+
+}  // namespace
+
 GraphicsRobustAccessPass::GraphicsRobustAccessPass() : module_status_() {}
 
 Pass::Status GraphicsRobustAccessPass::Process() {
@@ -367,6 +435,15 @@ void GraphicsRobustAccessPass::ClampIndicesForAccessChain(
                              GetValueForType(maxval, maxval_type));
       }
     } else {
+      // Leave the index alone if it is already known to be in bounds, for
+      // example because it is a loop counter or a dominating branch checked
+      // it.
+      const ValueRange range =
+          GetValueRange(index_inst, context()->get_instr_block(&inst), 0);
+      if (range.min >= 0 && uint64_t(range.max) <= maxval) {
+        return SPV_SUCCESS;
+      }
+
       // Generate a clamp instruction.
       assert(maxval >= 1);
       assert(index_width <= 64);  // Otherwise, already returned above.
@@ -554,6 +631,264 @@ void GraphicsRobustAccessPass::ClampIndicesForAccessChain(
   }
 }
 
+GraphicsRobustAccessPass::ValueRange GraphicsRobustAccessPass::GetValueRange(
+    Instruction* value, const BasicBlock* block, uint32_t depth) {
+  ValueRange range = {kMinInt32, kMaxInt32};
+  const auto* type = context()->get_type_mgr()->GetType(value->type_id());
+  if (!type || !type->AsInteger() || type->AsInteger()->width() != 32) {
+    return range;
+  }
+  if (const auto* constant = GetIntConstant(value)) {
+    const int64_t constant_value = constant->GetSignExtendedValue();
+    return {constant_value, constant_value};
+  }
+  if (depth < kMaxValueRangeDepth) {
+    range = GetDefinitionRange(value, block, depth + 1);
+  }
+  NarrowRangeByBranches(value, block, &range);
+  return range;
+}
+
+GraphicsRobustAccessPass::ValueRange
+GraphicsRobustAccessPass::GetDefinitionRange(Instruction* value,
+                                             const BasicBlock* block,
+                                             uint32_t depth) {
+  const ValueRange full_range = {kMinInt32, kMaxInt32};
+  auto operand_range = [this, value, block, depth](uint32_t operand_index) {
+    return GetValueRange(GetDef(value->GetSingleWordInOperand(operand_index)),
+                         block, depth);
+  };
+  // Integer arithmetic wraps, so a result outside of the 32-bit range means
+  // nothing is known.
+  auto checked = [&full_range](int64_t min, int64_t max) {
+    if (min < kMinInt32 || max > kMaxInt32) return full_range;
+    return ValueRange{min, max};
+  };
+
+  switch (value->opcode()) {
+    case SpvOpCopyObject:
+      return operand_range(0);
+    case SpvOpIAdd: {
+      const ValueRange a = operand_range(0);
+      const ValueRange b = operand_range(1);
+      return checked(a.min + b.min, a.max + b.max);
+    }
+    case SpvOpISub: {
+      const ValueRange a = operand_range(0);
+      const ValueRange b = operand_range(1);
+      return checked(a.min - b.max, a.max - b.min);
+    }
+    case SpvOpIMul: {
+      const ValueRange a = operand_range(0);
+      const ValueRange b = operand_range(1);
+      // The products of 32-bit values cannot overflow 64 bits.
+      const auto products = {a.min * b.min, a.min * b.max, a.max * b.min,
+                             a.max * b.max};
+      return checked(std::min(products), std::max(products));
+    }
+    case SpvOpBitwiseAnd: {
+      // The result has no bits set which are clear in a non-negative operand.
+      const ValueRange a = operand_range(0);
+      const ValueRange b = operand_range(1);
+      if (a.min >= 0 && b.min >= 0) return {0, std::min(a.max, b.max)};
+      if (a.min >= 0) return {0, a.max};
+      if (b.min >= 0) return {0, b.max};
+      break;
+    }
+    case SpvOpUMod: {
+      const ValueRange divisor = operand_range(1);
+      if (divisor.min >= 1) return {0, divisor.max - 1};
+      break;
+    }
+    case SpvOpExtInst: {
+      if (value->GetSingleWordInOperand(0) !=
+          context()->get_feature_mgr()->GetExtInstImportId_GLSLstd450()) {
+        break;
+      }
+      switch (value->GetSingleWordInOperand(1)) {
+        case GLSLstd450SMin: {
+          const ValueRange a = operand_range(2);
+          const ValueRange b = operand_range(3);
+          return {std::min(a.min, b.min), std::min(a.max, b.max)};
+        }
+        case GLSLstd450SMax: {
+          const ValueRange a = operand_range(2);
+          const ValueRange b = operand_range(3);
+          return {std::max(a.min, b.min), std::max(a.max, b.max)};
+        }
+        case GLSLstd450UMin: {
+          // The result is unsigned-less-or-equal to each operand, so a
+          // non-negative operand bounds it.
+          const ValueRange a = operand_range(2);
+          const ValueRange b = operand_range(3);
+          if (a.min >= 0 && b.min >= 0) {
+            return {std::min(a.min, b.min), std::min(a.max, b.max)};
+          }
+          if (a.min >= 0) return {0, a.max};
+          if (b.min >= 0) return {0, b.max};
+          break;
+        }
+        case GLSLstd450SClamp: {
+          // The result is undefined if the minimum exceeds the maximum.
+          const ValueRange x = operand_range(2);
+          const ValueRange min_val = operand_range(3);
+          const ValueRange max_val = operand_range(4);
+          if (min_val.max > max_val.min) break;
+          return {std::min(std::max(x.min, min_val.min), max_val.min),
+                  std::min(std::max(x.max, min_val.max), max_val.max)};
+        }
+        case GLSLstd450UClamp: {
+          const ValueRange min_val = operand_range(3);
+          const ValueRange max_val = operand_range(4);
+          if (min_val.min < 0 || min_val.max > max_val.min) break;
+          return {min_val.min, max_val.max};
+        }
+        default:
+          break;
+      }
+      break;
+    }
+    case SpvOpPhi:
+      return GetInductionRange(value);
+    default:
+      break;
+  }
+  return full_range;
+}
+
+GraphicsRobustAccessPass::ValueRange
+GraphicsRobustAccessPass::GetInductionRange(Instruction* phi) {
+  const ValueRange full_range = {kMinInt32, kMaxInt32};
+  ScalarEvolutionAnalysis* scev = context()->GetScalarEvolutionAnalysis();
+  SERecurrentNode* recurrence =
+      scev->AnalyzeInstruction(phi)->AsSERecurrentNode();
+  if (!recurrence) return full_range;
+  const SEConstantNode* init = recurrence->GetOffset()->AsSEConstantNode();
+  const SEConstantNode* step =
+      scev->SimplifyExpression(recurrence->GetCoefficient())
+          ->AsSEConstantNode();
+  if (!init || !step) return full_range;
+  const int64_t init_value = init->FoldToSingleValue();
+  const int64_t step_value = step->FoldToSingleValue();
+  if (init_value < kMinInt32 || init_value > kMaxInt32 || step_value == 0 ||
+      step_value < kMinInt32 || step_value > kMaxInt32) {
+    return full_range;
+  }
+
+  // The value taken around the back edge is |phi| plus the step, computed in
+  // the same iteration, so the range of |phi| at the latch bounds it.
+  ValueRange latch_range = full_range;
+  NarrowRangeByBranches(phi, recurrence->GetLoop()->GetLatchBlock(),
+                        &latch_range);
+  if (step_value > 0) {
+    if (latch_range.max + step_value > kMaxInt32) return full_range;
+    return {init_value, std::max(init_value, latch_range.max + step_value)};
+  }
+  if (latch_range.min + step_value < kMinInt32) return full_range;
+  return {std::min(init_value, latch_range.min + step_value), init_value};
+}
+
+void GraphicsRobustAccessPass::NarrowRangeByBranches(Instruction* value,
+                                                     const BasicBlock* block,
+                                                     ValueRange* range) {
+  // A block with a single predecessor is only reached through the edge from
+  // that predecessor.  If the block dominates |block|, the condition of that
+  // edge held for the latest definition of |value| on every path to |block|.
+  const Function* function = block->GetParent();
+  DominatorAnalysis* dom = context()->GetDominatorAnalysis(function);
+  const BasicBlock* entry = &*function->begin();
+  for (const BasicBlock* bb = block; bb != nullptr && bb != entry;
+       bb = dom->ImmediateDominator(bb)) {
+    const std::vector<uint32_t>& preds = cfg()->preds(bb->id());
+    if (preds.size() != 1) continue;
+    const Instruction& branch = *cfg()->block(preds[0])->ctail();
+    if (branch.opcode() != SpvOpBranchConditional) continue;
+    const uint32_t true_label = branch.GetSingleWordInOperand(1);
+    const uint32_t false_label = branch.GetSingleWordInOperand(2);
+    if (true_label == false_label) continue;
+    NarrowRangeByCondition(value, GetDef(branch.GetSingleWordInOperand(0)),
+                           bb->id() == true_label, range);
+  }
+}
+
+void GraphicsRobustAccessPass::NarrowRangeByCondition(Instruction* value,
+                                                      Instruction* condition,
+                                                      bool is_true,
+                                                      ValueRange* range) {
+  SpvOp op = condition->opcode();
+  if (op == SpvOpLogicalNot) {
+    NarrowRangeByCondition(value,
+                           GetDef(condition->GetSingleWordInOperand(0)),
+                           !is_true, range);
+    return;
+  }
+  // Both operands of an "and" that holds hold, and neither operand of an "or"
+  // that does not hold does.
+  if ((op == SpvOpLogicalAnd && is_true) ||
+      (op == SpvOpLogicalOr && !is_true)) {
+    for (uint32_t i = 0; i < 2; ++i) {
+      NarrowRangeByCondition(value,
+                             GetDef(condition->GetSingleWordInOperand(i)),
+                             is_true, range);
+    }
+    return;
+  }
+  if (MirrorComparison(op) == SpvOpNop) return;
+
+  const analysis::Constant* bound = nullptr;
+  if (condition->GetSingleWordInOperand(0) == value->result_id()) {
+    bound = GetIntConstant(GetDef(condition->GetSingleWordInOperand(1)));
+  } else if (condition->GetSingleWordInOperand(1) == value->result_id()) {
+    bound = GetIntConstant(GetDef(condition->GetSingleWordInOperand(0)));
+    op = MirrorComparison(op);
+  }
+  if (!bound || bound->type()->AsInteger()->width() != 32) return;
+  if (!is_true) op = NegateComparison(op);
+
+  const int64_t signed_bound = bound->GetSignExtendedValue();
+  const int64_t unsigned_bound = int64_t(bound->GetZeroExtendedValue());
+  switch (op) {
+    case SpvOpSLessThan:
+      range->max = std::min(range->max, signed_bound - 1);
+      break;
+    case SpvOpSLessThanEqual:
+      range->max = std::min(range->max, signed_bound);
+      break;
+    case SpvOpSGreaterThan:
+      range->min = std::max(range->min, signed_bound + 1);
+      break;
+    case SpvOpSGreaterThanEqual:
+      range->min = std::max(range->min, signed_bound);
+      break;
+    case SpvOpULessThan:
+    case SpvOpULessThanEqual:
+      // Below a non-negative bound, the value is non-negative as well.
+      if (unsigned_bound > kMaxInt32) break;
+      range->min = std::max<int64_t>(range->min, 0);
+      range->max = std::min(range->max, op == SpvOpULessThan
+                                            ? unsigned_bound - 1
+                                            : unsigned_bound);
+      break;
+    case SpvOpIEqual:
+      range->min = std::max(range->min, signed_bound);
+      range->max = std::min(range->max, signed_bound);
+      break;
+    default:
+      break;
+  }
+}
+
+const analysis::Constant* GraphicsRobustAccessPass::GetIntConstant(
+    Instruction* inst) {
+  if (inst->opcode() != SpvOpConstant && inst->opcode() != SpvOpConstantNull) {
+    return nullptr;
+  }
+  const auto* constant =
+      context()->get_constant_mgr()->GetConstantFromInst(inst);
+  if (!constant || !constant->type()->AsInteger()) return nullptr;
+  return constant;
+}
+
 uint32_t GraphicsRobustAccessPass::GetGlslInsts() {
   if (module_status_.glsl_insts_id == 0) {
     // This string serves double-duty as raw data for a string and for a vector
@@ -68,6 +68,45 @@ class GraphicsRobustAccessPass : public Pass {
   // analyses and records that the module is modified.  This can log a failure.
   void ClampIndicesForAccessChain(Instruction* access_chain);
 
+  // A range of signed integer values, including both bounds.
+  struct ValueRange {
+    int64_t min;
+    int64_t max;
+  };
+
+  // Returns a range including every value the 32-bit integer |value| can have
+  // where it is used in |block|.  If nothing is known about |value|, or it is
+  // not a 32-bit integer, returns the full range of 32-bit signed integers.
+  // |depth| is the number of definitions already looked through.
+  ValueRange GetValueRange(Instruction* value, const BasicBlock* block,
+                           uint32_t depth);
+
+  // Returns a range including every value the instruction |value| can
+  // produce, based on its opcode and on the ranges of its operands where used
+  // in |block|.
+  ValueRange GetDefinitionRange(Instruction* value, const BasicBlock* block,
+                                uint32_t depth);
+
+  // Returns a range including every value of the loop induction variable
+  // |phi|, computed from its scalar evolution.  The increment must not be
+  // able to overflow, so the branches leading to the loop's back edge must
+  // bound |phi|.
+  ValueRange GetInductionRange(Instruction* phi);
+
+  // Narrows |range| with each branch condition that must have held for
+  // |block| to be reached and which compares |value| to a constant.
+  void NarrowRangeByBranches(Instruction* value, const BasicBlock* block,
+                             ValueRange* range);
+
+  // Narrows |range| given that the boolean |condition| is |is_true|, if
+  // |condition| compares |value| to a constant.
+  void NarrowRangeByCondition(Instruction* value, Instruction* condition,
+                              bool is_true, ValueRange* range);
+
+  // Returns the constant defined by |inst| if it is an OpConstant or
+  // OpConstantNull of integer type.  Returns null otherwise.
+  const analysis::Constant* GetIntConstant(Instruction* inst);
+
   // Returns the id of the instruction importing the "GLSL.std.450" extended
   // instruction set. If it does not yet exist, the import instruction is
   // created and inserted into the module, and updates |_.modified| and
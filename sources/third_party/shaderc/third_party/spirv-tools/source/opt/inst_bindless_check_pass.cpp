@@ -430,22 +430,26 @@ void InstBindlessCheckPass::GenCheckCode(
   uint32_t new_ref_id = CloneOriginalReference(ref, &builder);
   (void)builder.AddBranch(merge_blk_id);
   new_blocks->push_back(std::move(new_blk_ptr));
-  // Gen invalid block
+  // Gen invalid block. No error id means a dominating reference has already
+  // reported the failure of this check.
   new_blk_ptr.reset(new BasicBlock(std::move(invalid_label)));
   builder.SetInsertPoint(&*new_blk_ptr);
-  uint32_t u_index_id = GenUintCastCode(ref->desc_idx_id, &builder);
-  if (offset_id != 0)
-    GenDebugStreamWrite(uid2offset_[ref->ref_inst->unique_id()], stage_idx,
-                        {error_id, u_index_id, offset_id, length_id}, &builder);
-  else if (buffer_bounds_enabled_)
-    // So all error modes will use same debug stream write function
-    GenDebugStreamWrite(
-        uid2offset_[ref->ref_inst->unique_id()], stage_idx,
-        {error_id, u_index_id, length_id, builder.GetUintConstantId(0)},
-        &builder);
-  else
-    GenDebugStreamWrite(uid2offset_[ref->ref_inst->unique_id()], stage_idx,
-                        {error_id, u_index_id, length_id}, &builder);
+  if (error_id != 0) {
+    uint32_t u_index_id = GenUintCastCode(ref->desc_idx_id, &builder);
+    if (offset_id != 0)
+      GenDebugStreamWrite(uid2offset_[ref->ref_inst->unique_id()], stage_idx,
+                          {error_id, u_index_id, offset_id, length_id},
+                          &builder);
+    else if (buffer_bounds_enabled_)
+      // So all error modes will use same debug stream write function
+      GenDebugStreamWrite(
+          uid2offset_[ref->ref_inst->unique_id()], stage_idx,
+          {error_id, u_index_id, length_id, builder.GetUintConstantId(0)},
+          &builder);
+    else
+      GenDebugStreamWrite(uid2offset_[ref->ref_inst->unique_id()], stage_idx,
+                          {error_id, u_index_id, length_id}, &builder);
+  }
   // Remember last invalid block id
   uint32_t last_invalid_blk_id = new_blk_ptr->GetLabelInst()->result_id();
   // Gen zero for invalid  reference
@@ -469,6 +473,36 @@ void InstBindlessCheckPass::GenCheckCode(
   context()->KillInst(ref->ref_inst);
 }
 
+bool InstBindlessCheckPass::IsInitCheckOnly(ref_analysis* ref) {
+  if (ref->desc_load_id != 0 || !buffer_bounds_enabled_) return true;
+  // For now, only do bounds check for non-aggregate types. Otherwise
+  // just do descriptor initialization check.
+  // TODO(greg-lunarg): Do bounds check for aggregate loads and stores
+  Instruction* ref_ptr_inst = get_def_use_mgr()->GetDef(ref->ptr_id);
+  Instruction* pte_type_inst = GetPointeeTypeInst(ref_ptr_inst);
+  uint32_t pte_type_op = pte_type_inst->opcode();
+  return pte_type_op == SpvOpTypeArray ||
+         pte_type_op == SpvOpTypeRuntimeArray ||
+         pte_type_op == SpvOpTypeStruct;
+}
+
+std::vector<uint32_t> InstBindlessCheckPass::GetDescIdxCheckKey(
+    Instruction* ref_inst) {
+  ref_analysis ref;
+  if (!AnalyzeDescriptorReference(ref_inst, &ref) || ref.desc_idx_id == 0)
+    return {};
+  return {ref.var_id, ref.desc_idx_id};
+}
+
+std::vector<uint32_t> InstBindlessCheckPass::GetDescInitCheckKey(
+    Instruction* ref_inst) {
+  ref_analysis ref;
+  if (!AnalyzeDescriptorReference(ref_inst, &ref)) return {};
+  // A bounds check depends on the bytes referenced through the pointer.
+  if (IsInitCheckOnly(&ref)) return {ref.var_id, ref.desc_idx_id};
+  return {ref.var_id, ref.desc_idx_id, ref.ptr_id};
+}
+
 void InstBindlessCheckPass::GenDescIdxCheckCode(
     BasicBlock::iterator ref_inst_itr,
     UptrVectorIterator<BasicBlock> ref_block_itr, uint32_t stage_idx,
@@ -477,6 +511,7 @@ void InstBindlessCheckPass::GenDescIdxCheckCode(
   // save components. If not, return.
   ref_analysis ref;
   if (!AnalyzeDescriptorReference(&*ref_inst_itr, &ref)) return;
+  if (!IsSampledReference(ref.ref_inst)) return;
   Instruction* ptr_inst = get_def_use_mgr()->GetDef(ref.ptr_id);
   if (ptr_inst->opcode() != SpvOp::SpvOpAccessChain) return;
   // If index and bound both compile-time constants and index < bound,
@@ -505,21 +540,29 @@ void InstBindlessCheckPass::GenDescIdxCheckCode(
       context(), &*new_blk_ptr,
       IRContext::kAnalysisDefUse | IRContext::kAnalysisInstrToBlockMapping);
   new_blocks->push_back(std::move(new_blk_ptr));
-  uint32_t error_id = builder.GetUintConstantId(kInstErrorBindlessBounds);
-  // If length id not yet set, descriptor array is runtime size so
-  // generate load of length from stage's debug input buffer.
-  if (length_id == 0) {
-    assert(desc_type_inst->opcode() == SpvOpTypeRuntimeArray &&
-           "unexpected bindless type");
-    length_id = GenDebugReadLength(ref.var_id, &builder);
+  // If a dominating reference has made the same check, branch on its result
+  // without reporting the failure again.
+  uint32_t check_id = GetDominatingCheckId(ref.ref_inst);
+  if (check_id != 0) {
+    GenCheckCode(check_id, 0u, 0u, 0u, stage_idx, &ref, new_blocks);
+  } else {
+    uint32_t error_id = builder.GetUintConstantId(kInstErrorBindlessBounds);
+    // If length id not yet set, descriptor array is runtime size so
+    // generate load of length from stage's debug input buffer.
+    if (length_id == 0) {
+      assert(desc_type_inst->opcode() == SpvOpTypeRuntimeArray &&
+             "unexpected bindless type");
+      length_id = GenDebugReadLength(ref.var_id, &builder);
+    }
+    // Generate full runtime bounds test code with true branch
+    // being full reference and false branch being debug output and zero
+    // for the referenced value.
+    Instruction* ult_inst = builder.AddBinaryOp(GetBoolId(), SpvOpULessThan,
+                                                ref.desc_idx_id, length_id);
+    SetCheckId(ref.ref_inst, ult_inst->result_id());
+    GenCheckCode(ult_inst->result_id(), error_id, 0u, length_id, stage_idx,
+                 &ref, new_blocks);
   }
-  // Generate full runtime bounds test code with true branch
-  // being full reference and false branch being debug output and zero
-  // for the referenced value.
-  Instruction* ult_inst = builder.AddBinaryOp(GetBoolId(), SpvOpULessThan,
-                                              ref.desc_idx_id, length_id);
-  GenCheckCode(ult_inst->result_id(), error_id, 0u, length_id, stage_idx, &ref,
-               new_blocks);
   // Move original block's remaining code into remainder/merge block and add
   // to new blocks
   BasicBlock* back_blk_ptr = &*new_blocks->back();
@@ -533,21 +576,9 @@ void InstBindlessCheckPass::GenDescInitCheckCode(
   // Look for reference through descriptor. If not, return.
   ref_analysis ref;
   if (!AnalyzeDescriptorReference(&*ref_inst_itr, &ref)) return;
+  if (!IsSampledReference(ref.ref_inst)) return;
   // Determine if we can only do initialization check
-  bool init_check = false;
-  if (ref.desc_load_id != 0 || !buffer_bounds_enabled_) {
-    init_check = true;
-  } else {
-    // For now, only do bounds check for non-aggregate types. Otherwise
-    // just do descriptor initialization check.
-    // TODO(greg-lunarg): Do bounds check for aggregate loads and stores
-    Instruction* ref_ptr_inst = get_def_use_mgr()->GetDef(ref.ptr_id);
-    Instruction* pte_type_inst = GetPointeeTypeInst(ref_ptr_inst);
-    uint32_t pte_type_op = pte_type_inst->opcode();
-    if (pte_type_op == SpvOpTypeArray || pte_type_op == SpvOpTypeRuntimeArray ||
-        pte_type_op == SpvOpTypeStruct)
-      init_check = true;
-  }
+  bool init_check = IsInitCheckOnly(&ref);
   // If initialization check and not enabled, return
   if (init_check && !desc_init_enabled_) return;
   // Move original block's preceding instructions into first new block
@@ -557,25 +588,33 @@ void InstBindlessCheckPass::GenDescInitCheckCode(
       context(), &*new_blk_ptr,
       IRContext::kAnalysisDefUse | IRContext::kAnalysisInstrToBlockMapping);
   new_blocks->push_back(std::move(new_blk_ptr));
-  // If initialization check, use reference value of zero.
-  // Else use the index of the last byte referenced.
-  uint32_t ref_id = init_check ? builder.GetUintConstantId(0u)
-                               : GenLastByteIdx(&ref, &builder);
-  // Read initialization/bounds from debug input buffer. If index id not yet
-  // set, binding is single descriptor, so set index to constant 0.
-  if (ref.desc_idx_id == 0) ref.desc_idx_id = builder.GetUintConstantId(0u);
-  uint32_t init_id = GenDebugReadInit(ref.var_id, ref.desc_idx_id, &builder);
-  // Generate runtime initialization/bounds test code with true branch
-  // being full reference and false branch being debug output and zero
-  // for the referenced value.
-  Instruction* ult_inst =
-      builder.AddBinaryOp(GetBoolId(), SpvOpULessThan, ref_id, init_id);
-  uint32_t error =
-      init_check ? kInstErrorBindlessUninit : kInstErrorBindlessBuffOOB;
-  uint32_t error_id = builder.GetUintConstantId(error);
-  GenCheckCode(ult_inst->result_id(), error_id, init_check ? 0 : ref_id,
-               init_check ? builder.GetUintConstantId(0u) : init_id, stage_idx,
-               &ref, new_blocks);
+  // If a dominating reference has made the same check, branch on its result
+  // without reporting the failure again.
+  uint32_t check_id = GetDominatingCheckId(ref.ref_inst);
+  if (check_id != 0) {
+    GenCheckCode(check_id, 0u, 0u, 0u, stage_idx, &ref, new_blocks);
+  } else {
+    // If initialization check, use reference value of zero.
+    // Else use the index of the last byte referenced.
+    uint32_t ref_id = init_check ? builder.GetUintConstantId(0u)
+                                 : GenLastByteIdx(&ref, &builder);
+    // Read initialization/bounds from debug input buffer. If index id not yet
+    // set, binding is single descriptor, so set index to constant 0.
+    if (ref.desc_idx_id == 0) ref.desc_idx_id = builder.GetUintConstantId(0u);
+    uint32_t init_id = GenDebugReadInit(ref.var_id, ref.desc_idx_id, &builder);
+    // Generate runtime initialization/bounds test code with true branch
+    // being full reference and false branch being debug output and zero
+    // for the referenced value.
+    Instruction* ult_inst =
+        builder.AddBinaryOp(GetBoolId(), SpvOpULessThan, ref_id, init_id);
+    uint32_t error =
+        init_check ? kInstErrorBindlessUninit : kInstErrorBindlessBuffOOB;
+    uint32_t error_id = builder.GetUintConstantId(error);
+    SetCheckId(ref.ref_inst, ult_inst->result_id());
+    GenCheckCode(ult_inst->result_id(), error_id, init_check ? 0 : ref_id,
+                 init_check ? builder.GetUintConstantId(0u) : init_id,
+                 stage_idx, &ref, new_blocks);
+  }
   // Move original block's remaining code into remainder/merge block and add
   // to new blocks
   BasicBlock* back_blk_ptr = &*new_blocks->back();
@@ -608,6 +647,8 @@ Pass::Status InstBindlessCheckPass::ProcessImpl() {
         return GenDescIdxCheckCode(ref_inst_itr, ref_block_itr, stage_idx,
                                    new_blocks);
       };
+  SampleReferences(
+      [this](Instruction* inst) { return GetDescIdxCheckKey(inst); });
   bool modified = InstProcessEntryPointCallTree(pfn);
   if (desc_init_enabled_ || buffer_bounds_enabled_) {
     // Perform descriptor initialization check on each entry point function in
@@ -619,6 +660,8 @@ Pass::Status InstBindlessCheckPass::ProcessImpl() {
       return GenDescInitCheckCode(ref_inst_itr, ref_block_itr, stage_idx,
                                   new_blocks);
     };
+    SampleReferences(
+        [this](Instruction* inst) { return GetDescInitCheckKey(inst); });
     modified |= InstProcessEntryPointCallTree(pfn);
   }
   return modified ? Status::SuccessWithChange : Status::SuccessWithoutChange;
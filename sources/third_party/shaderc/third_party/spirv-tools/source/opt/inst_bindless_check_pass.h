@@ -36,13 +36,15 @@ class InstBindlessCheckPass : public InstrumentPass {
         desc_init_enabled_(desc_init_enable),
         buffer_bounds_enabled_(false) {}
 
-  // New interface supporting buffer overrun checking
+  // New interface supporting buffer overrun checking and sampling
   InstBindlessCheckPass(uint32_t desc_set, uint32_t shader_id,
                         bool desc_idx_enable, bool desc_init_enable,
-                        bool buffer_bounds_enable)
+                        bool buffer_bounds_enable, uint32_t sample_period = 0,
+                        uint32_t sample_seed = 0)
       : InstrumentPass(
             desc_set, shader_id, kInstValidationIdBindless,
-            desc_idx_enable || desc_init_enable || buffer_bounds_enable),
+            desc_idx_enable || desc_init_enable || buffer_bounds_enable,
+            sample_period, sample_seed),
         desc_idx_enabled_(desc_idx_enable),
         desc_init_enabled_(desc_init_enable),
         buffer_bounds_enabled_(buffer_bounds_enable) {}
@@ -158,13 +160,22 @@ class InstBindlessCheckPass : public InstrumentPass {
   // Return true if |ref_inst| is a descriptor reference, false otherwise.
   bool AnalyzeDescriptorReference(Instruction* ref_inst, ref_analysis* ref);
 
+  // Return true if only the initialization of the descriptor of |ref| can be
+  // checked, rather than the bounds of the buffer it references.
+  bool IsInitCheckOnly(ref_analysis* ref);
+
+  // Return the key of the check GenDescIdxCheckCode or GenDescInitCheckCode
+  // would make for |ref_inst|. See InstrumentPass::ReferenceKeyFunction.
+  std::vector<uint32_t> GetDescIdxCheckKey(Instruction* ref_inst);
+  std::vector<uint32_t> GetDescInitCheckKey(Instruction* ref_inst);
+
   // Generate instrumentation code for generic test result |check_id|, starting
   // with |builder| of block |new_blk_ptr|, adding new blocks to |new_blocks|.
   // Generate conditional branch to a valid or invalid branch. Generate valid
   // block which does original reference |ref|. Generate invalid block which
   // writes debug error output utilizing |ref|, |error_id|, |length_id| and
-  // |stage_idx|. Generate merge block for valid and invalid branches. Kill
-  // original reference.
+  // |stage_idx|, unless |error_id| is 0. Generate merge block for valid and
+  // invalid branches. Kill original reference.
   void GenCheckCode(uint32_t check_id, uint32_t error_id, uint32_t offset_id,
                     uint32_t length_id, uint32_t stage_idx, ref_analysis* ref,
                     std::vector<std::unique_ptr<BasicBlock>>* new_blocks);
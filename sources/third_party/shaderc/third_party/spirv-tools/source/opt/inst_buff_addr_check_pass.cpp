@@ -55,6 +55,13 @@ bool InstBuffAddrCheckPass::IsPhysicalBuffAddrReference(Instruction* ref_inst) {
   return true;
 }
 
+std::vector<uint32_t> InstBuffAddrCheckPass::GetBuffAddrCheckKey(
+    Instruction* ref_inst) {
+  if (!IsPhysicalBuffAddrReference(ref_inst)) return {};
+  // The pointer determines both the address and the length checked.
+  return {ref_inst->GetSingleWordInOperand(0)};
+}
+
 // TODO(greg-lunarg): Refactor with InstBindlessCheckPass::GenCheckCode() ??
 void InstBuffAddrCheckPass::GenCheckCode(
     uint32_t check_id, uint32_t error_id, uint32_t ref_uptr_id,
@@ -81,21 +88,24 @@ void InstBuffAddrCheckPass::GenCheckCode(
   uint32_t new_ref_id = CloneOriginalReference(ref_inst, &builder);
   (void)builder.AddBranch(merge_blk_id);
   new_blocks->push_back(std::move(new_blk_ptr));
-  // Gen invalid block
+  // Gen invalid block. No error id means a dominating reference has already
+  // reported the failure of this check.
   new_blk_ptr.reset(new BasicBlock(std::move(invalid_label)));
   builder.SetInsertPoint(&*new_blk_ptr);
-  // Convert uptr from uint64 to 2 uint32
-  Instruction* lo_uptr_inst =
-      builder.AddUnaryOp(GetUintId(), SpvOpUConvert, ref_uptr_id);
-  Instruction* rshift_uptr_inst =
-      builder.AddBinaryOp(GetUint64Id(), SpvOpShiftRightLogical, ref_uptr_id,
-                          builder.GetUintConstantId(32));
-  Instruction* hi_uptr_inst = builder.AddUnaryOp(GetUintId(), SpvOpUConvert,
-                                                 rshift_uptr_inst->result_id());
-  GenDebugStreamWrite(
-      uid2offset_[ref_inst->unique_id()], stage_idx,
-      {error_id, lo_uptr_inst->result_id(), hi_uptr_inst->result_id()},
-      &builder);
+  if (error_id != 0) {
+    // Convert uptr from uint64 to 2 uint32
+    Instruction* lo_uptr_inst =
+        builder.AddUnaryOp(GetUintId(), SpvOpUConvert, ref_uptr_id);
+    Instruction* rshift_uptr_inst =
+        builder.AddBinaryOp(GetUint64Id(), SpvOpShiftRightLogical, ref_uptr_id,
+                            builder.GetUintConstantId(32));
+    Instruction* hi_uptr_inst = builder.AddUnaryOp(
+        GetUintId(), SpvOpUConvert, rshift_uptr_inst->result_id());
+    GenDebugStreamWrite(
+        uid2offset_[ref_inst->unique_id()], stage_idx,
+        {error_id, lo_uptr_inst->result_id(), hi_uptr_inst->result_id()},
+        &builder);
+  }
   // Gen zero for invalid load. If pointer type, need to convert uint64
   // zero to pointer; cannot create ConstantNull of pointer type.
   uint32_t null_id = 0;
@@ -386,6 +396,7 @@ void InstBuffAddrCheckPass::GenBuffAddrCheckCode(
   // save components. If not, return.
   Instruction* ref_inst = &*ref_inst_itr;
   if (!IsPhysicalBuffAddrReference(ref_inst)) return;
+  if (!IsSampledReference(ref_inst)) return;
   // Move original block's preceding instructions into first new block
   std::unique_ptr<BasicBlock> new_blk_ptr;
   MovePreludeCode(ref_inst_itr, ref_block_itr, &new_blk_ptr);
@@ -393,16 +404,26 @@ void InstBuffAddrCheckPass::GenBuffAddrCheckCode(
       context(), &*new_blk_ptr,
       IRContext::kAnalysisDefUse | IRContext::kAnalysisInstrToBlockMapping);
   new_blocks->push_back(std::move(new_blk_ptr));
-  uint32_t error_id = builder.GetUintConstantId(kInstErrorBuffAddrUnallocRef);
-  // Generate code to do search and test if all bytes of reference
-  // are within a listed buffer. Return reference pointer converted to uint64.
-  uint32_t ref_uptr_id;
-  uint32_t valid_id = GenSearchAndTest(ref_inst, &builder, &ref_uptr_id);
-  // Generate test of search results with true branch
-  // being full reference and false branch being debug output and zero
-  // for the referenced value.
-  GenCheckCode(valid_id, error_id, ref_uptr_id, stage_idx, ref_inst,
-               new_blocks);
+  // If a dominating reference has made the same check, branch on its result
+  // without reporting the failure again.
+  uint32_t check_id = GetDominatingCheckId(ref_inst);
+  if (check_id != 0) {
+    GenCheckCode(check_id, 0u, 0u, stage_idx, ref_inst, new_blocks);
+  } else {
+    uint32_t error_id =
+        builder.GetUintConstantId(kInstErrorBuffAddrUnallocRef);
+    // Generate code to do search and test if all bytes of reference
+    // are within a listed buffer. Return reference pointer converted to
+    // uint64.
+    uint32_t ref_uptr_id;
+    uint32_t valid_id = GenSearchAndTest(ref_inst, &builder, &ref_uptr_id);
+    // Generate test of search results with true branch
+    // being full reference and false branch being debug output and zero
+    // for the referenced value.
+    SetCheckId(ref_inst, valid_id);
+    GenCheckCode(valid_id, error_id, ref_uptr_id, stage_idx, ref_inst,
+                 new_blocks);
+  }
   // Move original block's remaining code into remainder/merge block and add
   // to new blocks
   BasicBlock* back_blk_ptr = &*new_blocks->back();
@@ -425,6 +446,8 @@ Pass::Status InstBuffAddrCheckPass::ProcessImpl() {
         return GenBuffAddrCheckCode(ref_inst_itr, ref_block_itr, stage_idx,
                                     new_blocks);
       };
+  SampleReferences(
+      [this](Instruction* inst) { return GetBuffAddrCheckKey(inst); });
   bool modified = InstProcessEntryPointCallTree(pfn);
   return modified ? Status::SuccessWithChange : Status::SuccessWithoutChange;
 }
@@ -29,8 +29,10 @@ namespace opt {
 class InstBuffAddrCheckPass : public InstrumentPass {
  public:
   // Preferred interface
-  InstBuffAddrCheckPass(uint32_t desc_set, uint32_t shader_id)
-      : InstrumentPass(desc_set, shader_id, kInstValidationIdBuffAddr) {}
+  InstBuffAddrCheckPass(uint32_t desc_set, uint32_t shader_id,
+                        uint32_t sample_period = 0, uint32_t sample_seed = 0)
+      : InstrumentPass(desc_set, shader_id, kInstValidationIdBuffAddr, false,
+                       sample_period, sample_seed) {}
 
   ~InstBuffAddrCheckPass() override = default;
 
@@ -98,6 +100,10 @@ class InstBuffAddrCheckPass : public InstrumentPass {
   // otherwise.
   bool IsPhysicalBuffAddrReference(Instruction* ref_inst);
 
+  // Return the key of the check GenBuffAddrCheckCode would make for
+  // |ref_inst|. See InstrumentPass::ReferenceKeyFunction.
+  std::vector<uint32_t> GetBuffAddrCheckKey(Instruction* ref_inst);
+
   // Clone original reference |ref_inst| into |builder| and return id of result
   uint32_t CloneOriginalReference(Instruction* ref_inst,
                                   InstructionBuilder* builder);
@@ -107,8 +113,8 @@ class InstBuffAddrCheckPass : public InstrumentPass {
   // or invalid reference blocks. Generate valid reference block which does
   // original reference |ref_inst|. Then generate invalid reference block which
   // writes debug error output utilizing |ref_inst|, |error_id| and
-  // |stage_idx|. Generate merge block for valid and invalid reference blocks.
-  // Kill original reference.
+  // |stage_idx|, unless |error_id| is 0. Generate merge block for valid and
+  // invalid reference blocks. Kill original reference.
   void GenCheckCode(uint32_t check_id, uint32_t error_id, uint32_t length_id,
                     uint32_t stage_idx, Instruction* ref_inst,
                     std::vector<std::unique_ptr<BasicBlock>>* new_blocks);
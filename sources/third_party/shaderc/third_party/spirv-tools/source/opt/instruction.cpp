@@ -14,6 +14,7 @@
 
 #include "source/opt/instruction.h"
 
+#include <algorithm>
 #include <initializer_list>
 
 #include "OpenCLDebugInfo100.h"
@@ -153,6 +154,12 @@ Instruction* Instruction::Clone(IRContext* c) const {
   clone->unique_id_ = c->TakeNextUniqueId();
   clone->operands_ = operands_;
   clone->dbg_line_insts_ = dbg_line_insts_;
+  // The copied line instructions still belong to this instruction's context,
+  // which may not be |c|.
+  for (auto& i : clone->dbg_line_insts_) {
+    i.context_ = c;
+    i.unique_id_ = c->TakeNextUniqueId();
+  }
   clone->dbg_scope_ = dbg_scope_;
   return clone;
 }
@@ -181,11 +188,19 @@ bool Instruction::HasBranchWeights() const {
 
 void Instruction::ToBinaryWithoutAttachedDebugInsts(
     std::vector<uint32_t>* binary) const {
+  const size_t start = binary->size();
+  binary->resize(start + 1 + NumOperandWords());
+  ToBinaryWithoutAttachedDebugInsts(binary->data() + start);
+}
+
+uint32_t* Instruction::ToBinaryWithoutAttachedDebugInsts(
+    uint32_t* words) const {
   const uint32_t num_words = 1 + NumOperandWords();
-  binary->push_back((num_words << 16) | static_cast<uint16_t>(opcode_));
+  *words++ = (num_words << 16) | static_cast<uint16_t>(opcode_);
   for (const auto& operand : operands_) {
-    binary->insert(binary->end(), operand.words.begin(), operand.words.end());
+    words = std::copy(operand.words.begin(), operand.words.end(), words);
   }
+  return words;
 }
 
 void Instruction::ReplaceOperands(const OperandList& new_operands) {
@@ -936,29 +951,39 @@ bool Instruction::IsNonSemanticInstruction() const {
   return import_name.find("NonSemantic.") == 0;
 }
 
+uint32_t DebugScope::GetNumWords() const {
+  if (GetLexicalScope() == kNoDebugScope) return kDebugNoScopeNumWords;
+  if (GetInlinedAt() == kNoInlinedAt) {
+    return kDebugScopeNumWordsWithoutInlinedAt;
+  }
+  return kDebugScopeNumWords;
+}
+
 void DebugScope::ToBinary(uint32_t type_id, uint32_t result_id,
                           uint32_t ext_set,
                           std::vector<uint32_t>* binary) const {
-  uint32_t num_words = kDebugScopeNumWords;
+  const size_t start = binary->size();
+  binary->resize(start + GetNumWords());
+  ToBinary(type_id, result_id, ext_set, binary->data() + start);
+}
+
+uint32_t* DebugScope::ToBinary(uint32_t type_id, uint32_t result_id,
+                               uint32_t ext_set, uint32_t* words) const {
+  const uint32_t num_words = GetNumWords();
   OpenCLDebugInfo100Instructions dbg_opcode = OpenCLDebugInfo100DebugScope;
   if (GetLexicalScope() == kNoDebugScope) {
-    num_words = kDebugNoScopeNumWords;
     dbg_opcode = OpenCLDebugInfo100DebugNoScope;
-  } else if (GetInlinedAt() == kNoInlinedAt) {
-    num_words = kDebugScopeNumWordsWithoutInlinedAt;
-  }
-  std::vector<uint32_t> operands = {
-      (num_words << 16) | static_cast<uint16_t>(SpvOpExtInst),
-      type_id,
-      result_id,
-      ext_set,
-      static_cast<uint32_t>(dbg_opcode),
-  };
-  binary->insert(binary->end(), operands.begin(), operands.end());
+  }
+  *words++ = (num_words << 16) | static_cast<uint16_t>(SpvOpExtInst);
+  *words++ = type_id;
+  *words++ = result_id;
+  *words++ = ext_set;
+  *words++ = static_cast<uint32_t>(dbg_opcode);
   if (GetLexicalScope() != kNoDebugScope) {
-    binary->push_back(GetLexicalScope());
-    if (GetInlinedAt() != kNoInlinedAt) binary->push_back(GetInlinedAt());
+    *words++ = GetLexicalScope();
+    if (GetInlinedAt() != kNoInlinedAt) *words++ = GetInlinedAt();
   }
+  return words;
 }
 
 }  // namespace opt
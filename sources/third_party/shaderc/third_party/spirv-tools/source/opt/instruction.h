@@ -139,11 +139,21 @@ class DebugScope {
   uint32_t GetInlinedAt() const { return inlined_at_; }
   void SetInlinedAt(uint32_t at) { inlined_at_ = at; }
 
+  // Returns the number of words the DebugScope or DebugNoScope instruction
+  // for this scope occupies in the binary.
+  uint32_t GetNumWords() const;
+
   // Pushes the binary segments for this DebugScope instruction into
   // the back of *|binary|.
   void ToBinary(uint32_t type_id, uint32_t result_id, uint32_t ext_set,
                 std::vector<uint32_t>* binary) const;
 
+  // Writes the binary segments for this DebugScope instruction starting at
+  // |words|, which must have room for GetNumWords() words. Returns a pointer
+  // one past the last word written.
+  uint32_t* ToBinary(uint32_t type_id, uint32_t result_id, uint32_t ext_set,
+                     uint32_t* words) const;
+
  private:
   // The result id of the lexical scope in which this debug scope is
   // contained. The value is kNoDebugScope if there is no scope.
@@ -396,6 +406,11 @@ class Instruction : public utils::IntrusiveNodeBase<Instruction> {
   // Pushes the binary segments for this instruction into the back of *|binary|.
   void ToBinaryWithoutAttachedDebugInsts(std::vector<uint32_t>* binary) const;
 
+  // Writes the binary segments for this instruction starting at |words|, which
+  // must have room for 1 + NumOperandWords() words. Returns a pointer one past
+  // the last word written.
+  uint32_t* ToBinaryWithoutAttachedDebugInsts(uint32_t* words) const;
+
   // Replaces the operands to the instruction with |new_operands|. The caller
   // is responsible for building a complete and valid list of operands for
   // this instruction.
@@ -16,6 +16,9 @@
 
 #include "instrument_pass.h"
 
+#include <algorithm>
+#include <utility>
+
 #include "source/cfa.h"
 #include "source/spirv_constant.h"
 
@@ -997,6 +1000,78 @@ bool InstrumentPass::InstProcessEntryPointCallTree(InstProcessFunction& pfn) {
   return modified;
 }
 
+bool InstrumentPass::IsSampledSite(uint32_t offset) const {
+  // Mix the bits so that nearby offsets are sampled independently.
+  uint32_t hash = (offset ^ sample_seed_) * 0x9e3779b1u;
+  hash ^= hash >> 16;
+  hash *= 0x85ebca6bu;
+  hash ^= hash >> 13;
+  return hash % sample_period_ == 0;
+}
+
+void InstrumentPass::SampleReferences(const ReferenceKeyFunction& key) {
+  sampled_refs_.clear();
+  dominating_refs_.clear();
+  check_ids_.clear();
+  if (sample_period_ == 0) return;
+  // Instrumenting replaces blocks without updating the CFG.
+  context()->InvalidateAnalyses(IRContext::kAnalysisCFG |
+                                IRContext::kAnalysisDominatorAnalysis);
+  for (auto& func : *get_module()) {
+    if (func.begin() == func.end()) continue;
+    DominatorAnalysis* dom = context()->GetDominatorAnalysis(&func);
+    // Blocks and unique ids of the selected references of each key which are
+    // not dominated by another. Visiting blocks in reverse post order sees a
+    // dominating reference before the references it dominates.
+    std::unordered_map<std::vector<uint32_t>,
+                       std::vector<std::pair<const BasicBlock*, uint32_t>>,
+                       vector_hash_>
+        checked;
+    cfg()->ForEachBlockInReversePostOrder(
+        &*func.begin(), [this, &key, dom, &checked](BasicBlock* bb) {
+          for (auto& inst : *bb) {
+            std::vector<uint32_t> ref_key = key(&inst);
+            if (ref_key.empty()) continue;
+            auto offset = uid2offset_.find(inst.unique_id());
+            if (offset == uid2offset_.end() || !IsSampledSite(offset->second))
+              continue;
+            sampled_refs_.insert(inst.unique_id());
+            // The dominated reference still needs its guard: a failing check
+            // only replaces the dominating access with a null value.
+            std::vector<std::pair<const BasicBlock*, uint32_t>>& refs =
+                checked[ref_key];
+            auto dom_ref = std::find_if(
+                refs.begin(), refs.end(),
+                [dom, bb](const std::pair<const BasicBlock*, uint32_t>& ref) {
+                  return dom->Dominates(ref.first, bb);
+                });
+            if (dom_ref != refs.end())
+              dominating_refs_[inst.unique_id()] = dom_ref->second;
+            else
+              refs.emplace_back(bb, inst.unique_id());
+          }
+        });
+  }
+}
+
+bool InstrumentPass::IsSampledReference(const Instruction* ref_inst) const {
+  return sample_period_ == 0 || sampled_refs_.count(ref_inst->unique_id());
+}
+
+uint32_t InstrumentPass::GetDominatingCheckId(
+    const Instruction* ref_inst) const {
+  auto dom_ref = dominating_refs_.find(ref_inst->unique_id());
+  if (dom_ref == dominating_refs_.end()) return 0;
+  auto check = check_ids_.find(dom_ref->second);
+  return check == check_ids_.end() ? 0 : check->second;
+}
+
+void InstrumentPass::SetCheckId(const Instruction* ref_inst,
+                                uint32_t check_id) {
+  if (sample_period_ == 0) return;
+  check_ids_[ref_inst->unique_id()] = check_id;
+}
+
 void InstrumentPass::InitializeInstrument() {
   output_buffer_id_ = 0;
   output_buffer_ptr_id_ = 0;
@@ -17,8 +17,10 @@
 #ifndef LIBSPIRV_OPT_INSTRUMENT_PASS_H_
 #define LIBSPIRV_OPT_INSTRUMENT_PASS_H_
 
+#include <functional>
 #include <list>
 #include <memory>
+#include <unordered_set>
 #include <vector>
 
 #include "source/opt/ir_builder.h"
@@ -52,6 +54,16 @@
 // creation of the instrumentation pass. The bindings of the buffers used by
 // a validation pass are permanantly assigned and fixed and documented by
 // the kDebugOutput* static consts.
+//
+// A validation pass may also be created in a sampled mode, which lowers the
+// cost of the instrumented shader enough for it to be left on during normal
+// use. In that mode only a subset of the references in the module are
+// checked, chosen by hashing their offset in the original module with a
+// seed, so that varying the seed between builds eventually covers every
+// reference. A reference dominated by a sampled reference making the same
+// check is still guarded, but branches on the result of the dominating
+// check instead of computing it again, and does not write a second record
+// when it fails.
 
 namespace spvtools {
 namespace opt {
@@ -84,13 +96,24 @@ class InstrumentPass : public Pass {
   // set |desc_set| for debug input and output buffers and writes |shader_id|
   // into debug output records. |opt_direct_reads| indicates that the pass
   // will see direct input buffer reads and should prepare to optimize them.
+  // If |sample_period| is not zero, the pass is in sampled mode and checks
+  // about one in |sample_period| references, selected using |sample_seed|.
   InstrumentPass(uint32_t desc_set, uint32_t shader_id, uint32_t validation_id,
-                 bool opt_direct_reads = false)
+                 bool opt_direct_reads = false, uint32_t sample_period = 0,
+                 uint32_t sample_seed = 0)
       : Pass(),
         desc_set_(desc_set),
         shader_id_(shader_id),
         validation_id_(validation_id),
-        opt_direct_reads_(opt_direct_reads) {}
+        opt_direct_reads_(opt_direct_reads),
+        sample_period_(sample_period),
+        sample_seed_(sample_seed) {}
+
+  // Returns the key of the check made for reference |ref_inst|, or an empty
+  // key if |ref_inst| is not checked. Two references have the same key only
+  // if a check passing for one implies it passes for the other.
+  using ReferenceKeyFunction =
+      std::function<std::vector<uint32_t>(Instruction*)>;
 
   // Initialize state for instrumentation of module.
   void InitializeInstrument();
@@ -101,6 +124,28 @@ class InstrumentPass : public Pass {
   // processing at the top of the last new block.
   bool InstProcessEntryPointCallTree(InstProcessFunction& pfn);
 
+  // In sampled mode, select the references to check among the instructions
+  // of the module, using |key| to find the references and the checks they
+  // need. A reference is selected if its site is sampled. A selected
+  // reference dominated by another selected reference with the same key
+  // reuses the check of the dominating one (see GetDominatingCheckId). Must
+  // be called before each InstProcessEntryPointCallTree whose |pfn| uses
+  // IsSampledReference, since instrumenting replaces references.
+  void SampleReferences(const ReferenceKeyFunction& key);
+
+  // Return true if reference |ref_inst| should be checked: always true
+  // unless the pass is in sampled mode.
+  bool IsSampledReference(const Instruction* ref_inst) const;
+
+  // Return the id of the condition computed for the reference dominating
+  // |ref_inst| with the same check, or 0 if |ref_inst| must compute its own.
+  // Also 0 until the dominating reference has recorded it with SetCheckId.
+  uint32_t GetDominatingCheckId(const Instruction* ref_inst) const;
+
+  // Record |check_id| as the condition computed for reference |ref_inst|,
+  // for the references it dominates to branch on.
+  void SetCheckId(const Instruction* ref_inst, uint32_t check_id);
+
   // Move all code in |ref_block_itr| preceding the instruction |ref_inst_itr|
   // to be instrumented into block |new_blk_ptr|.
   void MovePreludeCode(BasicBlock::iterator ref_inst_itr,
@@ -362,6 +407,10 @@ class InstrumentPass : public Pass {
   void UpdateSucceedingPhis(
       std::vector<std::unique_ptr<BasicBlock>>& new_blocks);
 
+  // Return true if the reference at |offset| in the original module is
+  // sampled for the current seed.
+  bool IsSampledSite(uint32_t offset) const;
+
   // Debug descriptor set index
   uint32_t desc_set_;
 
@@ -463,6 +512,22 @@ class InstrumentPass : public Pass {
   // Optimize direct debug input buffer reads. Specifically, move all such
   // reads with constant args to first block and reuse them.
   bool opt_direct_reads_;
+
+  // Check about one in |sample_period_| references if not zero
+  uint32_t sample_period_;
+
+  // Seed of the hash selecting the sampled references
+  uint32_t sample_seed_;
+
+  // Unique ids of the references selected by SampleReferences
+  std::unordered_set<uint32_t> sampled_refs_;
+
+  // Map from unique id of a selected reference to unique id of the selected
+  // reference with the same key dominating it, if any
+  std::unordered_map<uint32_t, uint32_t> dominating_refs_;
+
+  // Map from unique id of a dominating reference to id of its check condition
+  std::unordered_map<uint32_t, uint32_t> check_ids_;
 };
 
 }  // namespace opt
@@ -39,6 +39,16 @@ static const uint32_t kDebugGlobalVariableOperandVariableIndex = 11;
 namespace spvtools {
 namespace opt {
 
+std::unique_ptr<IRContext> IRContext::Clone() const {
+  std::unique_ptr<IRContext> clone(
+      new IRContext(grammar_.target_env(), consumer_));
+  clone->max_id_bound_ = max_id_bound_;
+  clone->preserve_bindings_ = preserve_bindings_;
+  clone->preserve_spec_constants_ = preserve_spec_constants_;
+  module_->CloneInto(clone->module());
+  return clone;
+}
+
 void IRContext::BuildInvalidAnalyses(IRContext::Analysis set) {
   if (set & kAnalysisDefUse) {
     BuildDefUseManager();
@@ -918,7 +928,10 @@ bool IRContext::ProcessCallTreeFromRoots(ProcessFunction& pfn,
     if (done.insert(fi).second) {
       Function* fn = GetFunction(fi);
       assert(fn && "Trying to process a function that does not exist.");
-      modified = pfn(fn) || modified;
+      if (IsInFunctionScope(*fn) && pfn(fn)) {
+        MarkFunctionChanged(*fn);
+        modified = true;
+      }
       AddCalls(fn, roots);
     }
   }
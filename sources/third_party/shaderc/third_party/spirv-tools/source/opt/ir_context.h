@@ -104,7 +104,8 @@ class IRContext {
         id_to_name_(nullptr),
         max_id_bound_(kDefaultMaxIdBound),
         preserve_bindings_(false),
-        preserve_spec_constants_(false) {
+        preserve_spec_constants_(false),
+        function_scope_(nullptr) {
     SetContextMessageConsumer(syntax_context_, consumer_);
     module_->SetContext(this);
   }
@@ -121,7 +122,8 @@ class IRContext {
         id_to_name_(nullptr),
         max_id_bound_(kDefaultMaxIdBound),
         preserve_bindings_(false),
-        preserve_spec_constants_(false) {
+        preserve_spec_constants_(false),
+        function_scope_(nullptr) {
     SetContextMessageConsumer(syntax_context_, consumer_);
     module_->SetContext(this);
     InitializeCombinators();
@@ -129,6 +131,12 @@ class IRContext {
 
   ~IRContext() { spvContextDestroy(syntax_context_); }
 
+  // Returns a new context holding a copy of the module of this context, made
+  // without encoding or parsing a binary.  Analyses are not copied; the clone
+  // builds them on demand.  This context is only read, so it can be cloned
+  // from several threads at once.
+  std::unique_ptr<IRContext> Clone() const;
+
   Module* module() const { return module_.get(); }
 
   // Returns a vector of pointers to constant-creation instructions in this
@@ -593,9 +601,38 @@ class IRContext {
   // |roots|.  Returns true if any call to |pfn| returns true.  By convention
   // |pfn| should return true if it modified the module.  After returning
   // |roots| will be empty.
+  //
+  // Functions outside the function scope are not given to |pfn|, and those
+  // for which |pfn| returns true are marked as changed.
   bool ProcessCallTreeFromRoots(ProcessFunction& pfn,
                                 std::queue<uint32_t>* roots);
 
+  // Restricts the passes that are function local (see Pass::IsFunctionLocal)
+  // to the functions whose ids are in |scope|.  A null |scope| lifts the
+  // restriction.  |scope| must outlive its use.
+  void SetFunctionScope(const std::unordered_set<uint32_t>* scope) {
+    function_scope_ = scope;
+  }
+
+  // Returns true if |function| is in the function scope.
+  bool IsInFunctionScope(const Function& function) const {
+    return function_scope_ == nullptr ||
+           function_scope_->count(function.result_id()) != 0;
+  }
+
+  // Records that |function| has been changed.  Passes mark the functions they
+  // change so that FixedPointPass can tell which functions to revisit.
+  void MarkFunctionChanged(const Function& function) {
+    ++function_changes_[function.result_id()];
+  }
+
+  // Returns the number of times the function |function_id| has been marked
+  // as changed.
+  uint32_t GetFunctionChangeCount(uint32_t function_id) const {
+    auto it = function_changes_.find(function_id);
+    return it == function_changes_.end() ? 0 : it->second;
+  }
+
   // Emmits a error message to the message consumer indicating the error
   // described by |message| occurred in |inst|.
   void EmitErrorMessage(std::string message, Instruction* inst);
@@ -834,6 +871,13 @@ class IRContext {
   // Whether all specialization constants within |module_|
   // should be preserved.
   bool preserve_spec_constants_;
+
+  // The ids of the functions that function-local passes may change, or null
+  // for all of them.
+  const std::unordered_set<uint32_t>* function_scope_;
+
+  // The number of times each function has been marked as changed, by id.
+  std::unordered_map<uint32_t, uint32_t> function_changes_;
 };
 
 inline IRContext::Analysis operator|(IRContext::Analysis lhs,
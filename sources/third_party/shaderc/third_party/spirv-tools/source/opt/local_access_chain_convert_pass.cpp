@@ -343,7 +343,12 @@ Pass::Status LocalAccessChainConvertPass::ProcessImpl() {
   // Process all functions in the module.
   Status status = Status::SuccessWithoutChange;
   for (Function& func : *get_module()) {
-    status = CombineStatus(status, ConvertLocalAccessChains(&func));
+    if (!context()->IsInFunctionScope(func)) continue;
+    Status func_status = ConvertLocalAccessChains(&func);
+    if (func_status == Status::SuccessWithChange) {
+      context()->MarkFunctionChanged(func);
+    }
+    status = CombineStatus(status, func_status);
     if (status == Status::Failure) {
       break;
     }
@@ -48,6 +48,8 @@ class LocalAccessChainConvertPass : public MemPass {
            IRContext::kAnalysisTypes;
   }
 
+  bool IsFunctionLocal() const override { return true; }
+
   using ProcessFunction = std::function<bool(Function*)>;
 
  private:
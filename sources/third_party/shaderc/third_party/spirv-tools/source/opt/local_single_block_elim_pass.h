@@ -47,6 +47,8 @@ class LocalSingleBlockLoadStoreElimPass : public MemPass {
            IRContext::kAnalysisConstants | IRContext::kAnalysisTypes;
   }
 
+  bool IsFunctionLocal() const override { return true; }
+
  private:
   // Return true if all uses of |varId| are only through supported reference
   // operations ie. loads and store. Also cache in supported_ref_ptrs_.
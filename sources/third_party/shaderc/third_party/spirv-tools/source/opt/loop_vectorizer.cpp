@@ -0,0 +1,833 @@
+// Copyright (c) 2020 Google LLC.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "source/opt/loop_vectorizer.h"
+
+#include <memory>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "source/opt/ir_builder.h"
+#include "source/opt/ir_context.h"
+#include "source/opt/loop_dependence.h"
+#include "source/opt/loop_descriptor.h"
+#include "source/opt/reflect.h"
+
+namespace spvtools {
+namespace opt {
+
+namespace {
+
+// Returns true if |opcode| applies component-wise when its operands are
+// vectors.
+bool IsComponentWiseOp(SpvOp opcode) {
+  switch (opcode) {
+    case SpvOpFAdd:
+    case SpvOpFSub:
+    case SpvOpFMul:
+    case SpvOpFDiv:
+    case SpvOpFRem:
+    case SpvOpFMod:
+    case SpvOpFNegate:
+    case SpvOpIAdd:
+    case SpvOpISub:
+    case SpvOpIMul:
+    case SpvOpSDiv:
+    case SpvOpUDiv:
+    case SpvOpSRem:
+    case SpvOpSMod:
+    case SpvOpUMod:
+    case SpvOpSNegate:
+    case SpvOpBitwiseAnd:
+    case SpvOpBitwiseOr:
+    case SpvOpBitwiseXor:
+    case SpvOpNot:
+    case SpvOpShiftLeftLogical:
+    case SpvOpShiftRightLogical:
+    case SpvOpShiftRightArithmetic:
+    case SpvOpConvertFToU:
+    case SpvOpConvertFToS:
+    case SpvOpConvertSToF:
+    case SpvOpConvertUToF:
+    case SpvOpUConvert:
+    case SpvOpSConvert:
+    case SpvOpFConvert:
+    case SpvOpBitcast:
+    case SpvOpSelect:
+    case SpvOpIEqual:
+    case SpvOpINotEqual:
+    case SpvOpUGreaterThan:
+    case SpvOpSGreaterThan:
+    case SpvOpUGreaterThanEqual:
+    case SpvOpSGreaterThanEqual:
+    case SpvOpULessThan:
+    case SpvOpSLessThan:
+    case SpvOpULessThanEqual:
+    case SpvOpSLessThanEqual:
+    case SpvOpFOrdEqual:
+    case SpvOpFUnordEqual:
+    case SpvOpFOrdNotEqual:
+    case SpvOpFUnordNotEqual:
+    case SpvOpFOrdLessThan:
+    case SpvOpFUnordLessThan:
+    case SpvOpFOrdGreaterThan:
+    case SpvOpFUnordGreaterThan:
+    case SpvOpFOrdLessThanEqual:
+    case SpvOpFUnordLessThanEqual:
+    case SpvOpFOrdGreaterThanEqual:
+    case SpvOpFUnordGreaterThanEqual:
+    case SpvOpLogicalEqual:
+    case SpvOpLogicalNotEqual:
+    case SpvOpLogicalOr:
+    case SpvOpLogicalAnd:
+    case SpvOpLogicalNot:
+    case SpvOpIsNan:
+    case SpvOpIsInf:
+      return true;
+    default:
+      return false;
+  }
+}
+
+// Returns true if the GLSL.std.450 instruction |ext_opcode| applies
+// component-wise when its operands are vectors.
+bool IsComponentWiseGLSLOp(uint32_t ext_opcode) {
+  switch (ext_opcode) {
+    case GLSLstd450FAbs:
+    case GLSLstd450SAbs:
+    case GLSLstd450FSign:
+    case GLSLstd450SSign:
+    case GLSLstd450Floor:
+    case GLSLstd450Ceil:
+    case GLSLstd450Trunc:
+    case GLSLstd450Round:
+    case GLSLstd450RoundEven:
+    case GLSLstd450Fract:
+    case GLSLstd450Sqrt:
+    case GLSLstd450InverseSqrt:
+    case GLSLstd450Exp:
+    case GLSLstd450Exp2:
+    case GLSLstd450Log:
+    case GLSLstd450Log2:
+    case GLSLstd450Pow:
+    case GLSLstd450Sin:
+    case GLSLstd450Cos:
+    case GLSLstd450Tan:
+    case GLSLstd450FMin:
+    case GLSLstd450UMin:
+    case GLSLstd450SMin:
+    case GLSLstd450FMax:
+    case GLSLstd450UMax:
+    case GLSLstd450SMax:
+    case GLSLstd450FClamp:
+    case GLSLstd450UClamp:
+    case GLSLstd450SClamp:
+    case GLSLstd450FMix:
+    case GLSLstd450Step:
+    case GLSLstd450SmoothStep:
+    case GLSLstd450Fma:
+      return true;
+    default:
+      return false;
+  }
+}
+
+bool IsScalar(const analysis::Type* type) {
+  return type->AsInteger() || type->AsFloat() || type->AsBool();
+}
+
+// Returns true if |inst| names or decorates an id rather than computing with
+// it.
+bool IsNameOrDecoration(const Instruction& inst) {
+  return spvOpcodeIsDebug(inst.opcode()) || IsAnnotationInst(inst.opcode());
+}
+
+// Checks and vectorizes a single loop.
+class LoopVectorizerImpl {
+ public:
+  LoopVectorizerImpl(IRContext* context, Loop* loop, uint32_t vector_width)
+      : context_(context),
+        loop_(loop),
+        vector_width_(vector_width),
+        body_(nullptr),
+        induction_(nullptr),
+        increment_(nullptr),
+        condition_(nullptr),
+        init_value_(0),
+        trip_count_(0) {}
+
+  // Returns true if the loop has the shape described in LoopVectorizer and
+  // vectorizing it is legal and worth it.
+  bool CanVectorize();
+
+  // Vectorizes the loop.  CanVectorize() must have returned true.
+  void Vectorize();
+
+ private:
+  // How a value computed in the loop body is vectorized.
+  enum class Shape {
+    // Same in every iteration; left as is.
+    kUniform,
+    // Replaced by a vector holding one value per lane.
+    kVector,
+    // A pointer replaced by one pointer per lane.
+    kLanes,
+  };
+
+  // Checks the header, the continue block and the induction variable.
+  bool CheckLoopShape();
+
+  // Classifies the instructions of the body.  Returns false if one of them
+  // cannot be vectorized.
+  bool ClassifyBody();
+
+  // Returns false if vectorizing would reorder dependent memory accesses.
+  bool CheckDependences();
+
+  // Returns true if the vector arithmetic saves more instructions than the
+  // composites that gather and scatter its operands and results add.
+  bool IsProfitable() const;
+
+  // Returns true if |id| has the same value in every iteration.
+  bool IsUniform(uint32_t id) const;
+
+  // Returns true if |inst| is a component-wise operation.
+  bool IsComponentWise(const Instruction& inst) const;
+
+  // Returns the id of the integer constant |value| of the induction type.
+  uint32_t GetInductionConstant(int64_t value);
+
+  // Returns the id of a vector of |vector_width_| elements of type
+  // |scalar_type_id|.
+  uint32_t GetVectorTypeId(uint32_t scalar_type_id);
+
+  // Returns the vector for |id|, splatting uniform values before
+  // |insert_before|.
+  uint32_t GetVector(uint32_t id, Instruction* insert_before);
+
+  // Returns the value of |id| in |lane|, extracting it before |insert_before|
+  // if needed.
+  uint32_t GetLane(uint32_t id, uint32_t lane, Instruction* insert_before);
+
+  // Copies the scalar body after the loop once for each iteration the vector
+  // loop does not cover.
+  void EmitScalarEpilogue(int64_t first_iteration, int64_t count);
+
+  // Replaces the body with its vector form.
+  void WidenBody();
+
+  IRContext* context_;
+  Loop* loop_;
+  uint32_t vector_width_;
+
+  BasicBlock* body_;
+  Instruction* induction_;
+  Instruction* increment_;
+  Instruction* condition_;
+  int64_t init_value_;
+  size_t trip_count_;
+
+  // The body instructions in order, and how each is vectorized.
+  std::vector<Instruction*> body_insts_;
+  std::unordered_map<uint32_t, Shape> shapes_;
+
+  // Vector values, per-lane values and per-lane pointers built while widening.
+  std::unordered_map<uint32_t, uint32_t> vectors_;
+  std::unordered_map<uint32_t, std::vector<uint32_t>> lanes_;
+};
+
+bool LoopVectorizerImpl::CanVectorize() {
+  if (loop_->HasNestedLoops()) return false;
+  if (!CheckLoopShape()) return false;
+  // A loop that cannot complete a single vector iteration gains nothing.
+  if (trip_count_ < vector_width_) return false;
+  if (!ClassifyBody()) return false;
+  if (!CheckDependences()) return false;
+  return IsProfitable();
+}
+
+bool LoopVectorizerImpl::CheckLoopShape() {
+  BasicBlock* header = loop_->GetHeaderBlock();
+  BasicBlock* merge = loop_->GetMergeBlock();
+  BasicBlock* continue_block = loop_->GetContinueBlock();
+  if (merge == nullptr || continue_block == nullptr) return false;
+  // The scalar epilogue goes at the start of the merge block, so it must run
+  // exactly once after the loop.
+  if (merge->GetLoopMergeInst() != nullptr) return false;
+  if (context_->cfg()->preds(merge->id()).size() != 1) return false;
+
+  const Instruction& branch = *header->ctail();
+  if (branch.opcode() != SpvOpBranchConditional) return false;
+  if (branch.GetSingleWordInOperand(2) != merge->id()) return false;
+  body_ = context_->cfg()->block(branch.GetSingleWordInOperand(1));
+  if (body_ == header || !loop_->IsInsideLoop(body_)) return false;
+  if (context_->cfg()->preds(body_->id()).size() != 1) return false;
+
+  // The loop is the header, the body, and possibly a separate continue block.
+  const size_t num_blocks = loop_->GetBlocks().size();
+  if (body_ == continue_block) {
+    if (num_blocks != 2) return false;
+    if (body_->ctail()->opcode() != SpvOpBranch) return false;
+  } else {
+    if (num_blocks != 3) return false;
+    if (body_->ctail()->opcode() != SpvOpBranch ||
+        body_->ctail()->GetSingleWordInOperand(0) != continue_block->id()) {
+      return false;
+    }
+  }
+
+  analysis::DefUseManager* def_use_mgr = context_->get_def_use_mgr();
+  condition_ = def_use_mgr->GetDef(branch.GetSingleWordInOperand(0));
+  if (condition_ == nullptr ||
+      context_->get_instr_block(condition_) != header ||
+      (condition_->opcode() != SpvOpSLessThan &&
+       condition_->opcode() != SpvOpULessThan)) {
+    return false;
+  }
+  // The condition is rewritten for the vector loop and is false by the time
+  // the epilogue runs, so nothing but the exit branch may read it.
+  if (!def_use_mgr->WhileEachUser(condition_, [&branch](Instruction* user) {
+        return IsNameOrDecoration(*user) || user == &branch;
+      })) {
+    return false;
+  }
+
+  // The header may hold only the induction variable, the condition and the
+  // loop control.
+  for (auto& inst : *header) {
+    switch (inst.opcode()) {
+      case SpvOpPhi:
+        if (induction_ != nullptr) return false;
+        induction_ = &inst;
+        break;
+      case SpvOpLoopMerge:
+      case SpvOpBranchConditional:
+      case SpvOpLine:
+      case SpvOpNoLine:
+        break;
+      default:
+        if (&inst != condition_) return false;
+        break;
+    }
+  }
+  if (induction_ == nullptr ||
+      loop_->FindConditionVariable(header) != induction_) {
+    return false;
+  }
+
+  const analysis::Integer* int_type = context_->get_type_mgr()
+                                          ->GetType(induction_->type_id())
+                                          ->AsInteger();
+  if (int_type == nullptr || int_type->width() != 32) return false;
+
+  int64_t step = 0;
+  if (!loop_->FindNumberOfIterations(induction_, &branch, &trip_count_, &step,
+                                     &init_value_) ||
+      step != 1) {
+    return false;
+  }
+
+  // The induction update must be the only other loop-carried computation,
+  // and only feed the induction variable.
+  for (uint32_t i = 0; i < induction_->NumInOperands(); i += 2) {
+    Instruction* incoming =
+        def_use_mgr->GetDef(induction_->GetSingleWordInOperand(i));
+    if (incoming != nullptr && loop_->IsInsideLoop(incoming)) {
+      increment_ = incoming;
+    }
+  }
+  if (increment_ == nullptr || increment_->opcode() != SpvOpIAdd) return false;
+  uint32_t increment_uses = 0;
+  def_use_mgr->ForEachUser(increment_, [&increment_uses](Instruction* user) {
+    if (!IsNameOrDecoration(*user)) ++increment_uses;
+  });
+  if (increment_uses != 1) return false;
+  if (continue_block != body_) {
+    for (auto& inst : *continue_block) {
+      if (&inst != increment_ && inst.opcode() != SpvOpBranch &&
+          inst.opcode() != SpvOpLine && inst.opcode() != SpvOpNoLine) {
+        return false;
+      }
+    }
+  }
+
+  // The exit value of the induction variable changes, so it must not be
+  // used after the loop.
+  return def_use_mgr->WhileEachUser(induction_, [this](Instruction* user) {
+    if (IsNameOrDecoration(*user)) return true;
+    BasicBlock* block = context_->get_instr_block(user);
+    return block != nullptr && loop_->IsInsideLoop(block);
+  });
+}
+
+bool LoopVectorizerImpl::IsUniform(uint32_t id) const {
+  auto it = shapes_.find(id);
+  if (it != shapes_.end()) return it->second == Shape::kUniform;
+  // Anything not computed in the body is defined outside the loop.
+  return id != induction_->result_id();
+}
+
+bool LoopVectorizerImpl::IsComponentWise(const Instruction& inst) const {
+  if (inst.opcode() == SpvOpExtInst) {
+    return inst.GetSingleWordInOperand(0) ==
+               context_->get_feature_mgr()->GetExtInstImportId_GLSLstd450() &&
+           IsComponentWiseGLSLOp(inst.GetSingleWordInOperand(1));
+  }
+  return IsComponentWiseOp(inst.opcode());
+}
+
+bool LoopVectorizerImpl::ClassifyBody() {
+  analysis::DefUseManager* def_use_mgr = context_->get_def_use_mgr();
+  analysis::TypeManager* type_mgr = context_->get_type_mgr();
+
+  for (auto& inst : *body_) {
+    if (&inst == increment_ || inst.IsBranch() ||
+        inst.opcode() == SpvOpLine || inst.opcode() == SpvOpNoLine) {
+      continue;
+    }
+    body_insts_.push_back(&inst);
+
+    switch (inst.opcode()) {
+      case SpvOpAccessChain:
+      case SpvOpInBoundsAccessChain: {
+        if (!IsUniform(inst.GetSingleWordInOperand(0))) return false;
+        bool uniform = true;
+        for (uint32_t i = 1; i < inst.NumInOperands(); ++i) {
+          uniform = uniform && IsUniform(inst.GetSingleWordInOperand(i));
+        }
+        if (uniform) {
+          shapes_[inst.result_id()] = Shape::kUniform;
+          break;
+        }
+        // Per-lane pointers can only be used to load and store scalars.
+        const analysis::Pointer* pointer_type =
+            type_mgr->GetType(inst.type_id())->AsPointer();
+        if (!IsScalar(pointer_type->pointee_type())) return false;
+        const Instruction* base = inst.GetBaseAddress();
+        if (base == nullptr || base->opcode() != SpvOpVariable) return false;
+        switch (base->GetSingleWordInOperand(0)) {
+          case SpvStorageClassFunction:
+          case SpvStorageClassPrivate:
+          case SpvStorageClassUniform:
+          case SpvStorageClassStorageBuffer:
+            break;
+          default:
+            return false;
+        }
+        shapes_[inst.result_id()] = Shape::kLanes;
+        break;
+      }
+      case SpvOpLoad: {
+        // Memory operands such as Volatile are not carried over.
+        if (inst.NumInOperands() != 1) return false;
+        const uint32_t pointer = inst.GetSingleWordInOperand(0);
+        if (IsUniform(pointer)) {
+          shapes_[inst.result_id()] = Shape::kUniform;
+        } else if (shapes_[pointer] == Shape::kLanes) {
+          shapes_[inst.result_id()] = Shape::kVector;
+        } else {
+          return false;
+        }
+        break;
+      }
+      case SpvOpStore: {
+        if (inst.NumInOperands() != 2) return false;
+        auto it = shapes_.find(inst.GetSingleWordInOperand(0));
+        if (it == shapes_.end() || it->second != Shape::kLanes) return false;
+        break;
+      }
+      default: {
+        if (!inst.HasResultId() || !IsComponentWise(inst)) return false;
+        bool uniform = true;
+        bool scalar_operands = true;
+        inst.ForEachInId([&](const uint32_t* id) {
+          uniform = uniform && IsUniform(*id);
+          const Instruction* def = def_use_mgr->GetDef(*id);
+          if (def->type_id() == 0 ||
+              !IsScalar(type_mgr->GetType(def->type_id()))) {
+            // The extended instruction set id has no type, and is not an
+            // operand of the operation.
+            scalar_operands =
+                scalar_operands && def->opcode() == SpvOpExtInstImport;
+          }
+        });
+        if (uniform) {
+          shapes_[inst.result_id()] = Shape::kUniform;
+          break;
+        }
+        if (!scalar_operands || !IsScalar(type_mgr->GetType(inst.type_id()))) {
+          return false;
+        }
+        shapes_[inst.result_id()] = Shape::kVector;
+        break;
+      }
+    }
+  }
+
+  // Values that become vectors or per-lane pointers must not escape the body.
+  bool has_store = false;
+  for (Instruction* inst : body_insts_) {
+    has_store = has_store || inst->opcode() == SpvOpStore;
+    if (!inst->HasResultId() || IsUniform(inst->result_id())) continue;
+    const bool contained = def_use_mgr->WhileEachUser(
+        inst, [this](Instruction* user) {
+          return IsNameOrDecoration(*user) ||
+                 context_->get_instr_block(user) == body_;
+        });
+    if (!contained) return false;
+  }
+  // A loop that stores nothing is left for dead code elimination.
+  return has_store;
+}
+
+bool LoopVectorizerImpl::CheckDependences() {
+  std::vector<Instruction*> loads;
+  std::vector<Instruction*> stores;
+  for (Instruction* inst : body_insts_) {
+    if (inst->opcode() == SpvOpLoad) loads.push_back(inst);
+    if (inst->opcode() == SpvOpStore) stores.push_back(inst);
+  }
+
+  analysis::DecorationManager* decoration_mgr =
+      context_->get_decoration_mgr();
+  auto is_aliased = [decoration_mgr](const Instruction* base) {
+    return !decoration_mgr->WhileEachDecoration(
+        base->result_id(), SpvDecorationAliased,
+        [](const Instruction&) { return false; });
+  };
+
+  LoopDependenceAnalysis analysis(context_, {loop_});
+  auto independent = [&analysis, &is_aliased](const Instruction* source,
+                                              const Instruction* destination) {
+    const Instruction* source_base = source->GetBaseAddress();
+    const Instruction* destination_base = destination->GetBaseAddress();
+    if (source_base == nullptr || destination_base == nullptr) return false;
+    if (source_base != destination_base) {
+      // Distinct variables only overlap when declared to.
+      return source_base->opcode() == SpvOpVariable &&
+             destination_base->opcode() == SpvOpVariable &&
+             !is_aliased(source_base) && !is_aliased(destination_base);
+    }
+
+    DistanceVector distance(1);
+    if (analysis.GetDependence(source, destination, &distance)) return true;
+    // Accesses to the same element in the same iteration stay in order, as
+    // every lane of one instruction is done before the next instruction.
+    const DistanceEntry& entry = distance.GetEntries()[0];
+    switch (entry.dependence_information) {
+      case DistanceEntry::DependenceInformation::IRRELEVANT:
+        return true;
+      case DistanceEntry::DependenceInformation::DISTANCE:
+        return entry.distance == 0;
+      case DistanceEntry::DependenceInformation::DIRECTION:
+        return entry.direction == DistanceEntry::Directions::EQ;
+      default:
+        return false;
+    }
+  };
+
+  for (Instruction* store : stores) {
+    for (Instruction* load : loads) {
+      if (!independent(load, store)) return false;
+    }
+    for (Instruction* other : stores) {
+      if (other != store && !independent(other, store)) return false;
+    }
+  }
+  return true;
+}
+
+bool LoopVectorizerImpl::IsProfitable() const {
+  analysis::DefUseManager* def_use_mgr = context_->get_def_use_mgr();
+
+  // The loads and stores stay scalar, so only the arithmetic and the loop
+  // control (increment, compare and branch) run once instead of
+  // |vector_width_| times.  In exchange each gathered load costs a
+  // composite construct, each store of a computed vector |vector_width_|
+  // extracts, the induction variable |vector_width_| - 1 lane offsets, and
+  // each uniform operand of the arithmetic, or the induction variable, a
+  // construct.
+  const size_t kLoopControl = 3;
+  size_t arithmetic = 0;
+  size_t added = vector_width_ - 1;
+  std::unordered_set<uint32_t> constructed;
+  for (Instruction* inst : body_insts_) {
+    switch (inst->opcode()) {
+      case SpvOpAccessChain:
+      case SpvOpInBoundsAccessChain:
+        break;
+      case SpvOpLoad:
+        if (!IsUniform(inst->result_id())) ++added;
+        break;
+      case SpvOpStore: {
+        // The lanes of a loaded value are the scalar loads themselves.
+        const uint32_t value = inst->GetSingleWordInOperand(1);
+        if (!IsUniform(value) && value != induction_->result_id() &&
+            def_use_mgr->GetDef(value)->opcode() != SpvOpLoad) {
+          added += vector_width_;
+        }
+        break;
+      }
+      default:
+        if (IsUniform(inst->result_id())) break;
+        ++arithmetic;
+        inst->ForEachInId(
+            [this, def_use_mgr, &constructed](const uint32_t* id) {
+              if (*id == induction_->result_id() ||
+                  (IsUniform(*id) &&
+                   def_use_mgr->GetDef(*id)->opcode() != SpvOpExtInstImport)) {
+                constructed.insert(*id);
+              }
+            });
+        break;
+    }
+  }
+  // Without arithmetic this would only unroll the loop.
+  if (arithmetic == 0) return false;
+  added += constructed.size();
+  return (vector_width_ - 1) * (arithmetic + kLoopControl) > added;
+}
+
+uint32_t LoopVectorizerImpl::GetInductionConstant(int64_t value) {
+  analysis::ConstantManager* const_mgr = context_->get_constant_mgr();
+  const analysis::Type* type =
+      context_->get_type_mgr()->GetType(induction_->type_id());
+  const analysis::Constant* constant =
+      const_mgr->GetConstant(type, {static_cast<uint32_t>(value)});
+  return const_mgr->GetDefiningInstruction(constant)->result_id();
+}
+
+uint32_t LoopVectorizerImpl::GetVectorTypeId(uint32_t scalar_type_id) {
+  analysis::TypeManager* type_mgr = context_->get_type_mgr();
+  analysis::Vector vector_type(type_mgr->GetType(scalar_type_id),
+                               vector_width_);
+  return type_mgr->GetTypeInstruction(&vector_type);
+}
+
+uint32_t LoopVectorizerImpl::GetVector(uint32_t id,
+                                       Instruction* insert_before) {
+  auto it = vectors_.find(id);
+  if (it != vectors_.end()) return it->second;
+
+  // Uniform values are splatted.  The splat is built before its first use,
+  // which dominates every later use in the body.
+  InstructionBuilder builder(
+      context_, insert_before,
+      IRContext::kAnalysisDefUse | IRContext::kAnalysisInstrToBlockMapping);
+  const uint32_t type_id = context_->get_def_use_mgr()->GetDef(id)->type_id();
+  const uint32_t splat =
+      builder
+          .AddCompositeConstruct(GetVectorTypeId(type_id),
+                                 std::vector<uint32_t>(vector_width_, id))
+          ->result_id();
+  vectors_[id] = splat;
+  return splat;
+}
+
+uint32_t LoopVectorizerImpl::GetLane(uint32_t id, uint32_t lane,
+                                     Instruction* insert_before) {
+  if (IsUniform(id)) return id;
+  std::vector<uint32_t>& lanes = lanes_[id];
+  if (lanes.empty()) lanes.assign(vector_width_, 0);
+  if (lanes[lane] != 0) return lanes[lane];
+
+  InstructionBuilder builder(
+      context_, insert_before,
+      IRContext::kAnalysisDefUse | IRContext::kAnalysisInstrToBlockMapping);
+  const uint32_t type_id = context_->get_def_use_mgr()->GetDef(id)->type_id();
+  lanes[lane] =
+      builder.AddCompositeExtract(type_id, GetVector(id, insert_before), {lane})
+          ->result_id();
+  return lanes[lane];
+}
+
+void LoopVectorizerImpl::EmitScalarEpilogue(int64_t first_iteration,
+                                            int64_t count) {
+  BasicBlock* merge = loop_->GetMergeBlock();
+  auto insert_point = merge->begin();
+  while (insert_point->opcode() == SpvOpPhi) ++insert_point;
+
+  for (int64_t i = 0; i < count; ++i) {
+    std::unordered_map<uint32_t, uint32_t> remap;
+    remap[induction_->result_id()] = GetInductionConstant(first_iteration + i);
+    for (Instruction* inst : body_insts_) {
+      std::unique_ptr<Instruction> copy(inst->Clone(context_));
+      if (copy->HasResultId()) {
+        const uint32_t new_id = context_->TakeNextId();
+        remap[inst->result_id()] = new_id;
+        copy->SetResultId(new_id);
+        context_->get_decoration_mgr()->CloneDecorations(inst->result_id(),
+                                                         new_id);
+      }
+      copy->ForEachInId([&remap](uint32_t* id) {
+        auto it = remap.find(*id);
+        if (it != remap.end()) *id = it->second;
+      });
+      Instruction* added = insert_point->InsertBefore(std::move(copy));
+      context_->AnalyzeDefUse(added);
+      context_->set_instr_block(added, merge);
+    }
+  }
+}
+
+void LoopVectorizerImpl::WidenBody() {
+  analysis::DefUseManager* def_use_mgr = context_->get_def_use_mgr();
+  const uint32_t induction_id = induction_->result_id();
+
+  // The induction variable of each lane, and as a vector.
+  Instruction* first = body_insts_.front();
+  InstructionBuilder builder(
+      context_, first,
+      IRContext::kAnalysisDefUse | IRContext::kAnalysisInstrToBlockMapping);
+  std::vector<uint32_t>& induction_lanes = lanes_[induction_id];
+  induction_lanes.push_back(induction_id);
+  for (uint32_t lane = 1; lane < vector_width_; ++lane) {
+    induction_lanes.push_back(builder
+                                  .AddIAdd(induction_->type_id(), induction_id,
+                                           GetInductionConstant(lane))
+                                  ->result_id());
+  }
+  vectors_[induction_id] =
+      builder
+          .AddCompositeConstruct(GetVectorTypeId(induction_->type_id()),
+                                 induction_lanes)
+          ->result_id();
+
+  std::vector<Instruction*> replaced;
+  for (Instruction* inst : body_insts_) {
+    InstructionBuilder inst_builder(
+        context_, inst,
+        IRContext::kAnalysisDefUse | IRContext::kAnalysisInstrToBlockMapping);
+    switch (inst->opcode()) {
+      case SpvOpAccessChain:
+      case SpvOpInBoundsAccessChain: {
+        if (IsUniform(inst->result_id())) continue;
+        std::vector<uint32_t>& pointers = lanes_[inst->result_id()];
+        for (uint32_t lane = 0; lane < vector_width_; ++lane) {
+          std::vector<uint32_t> operands;
+          for (uint32_t i = 0; i < inst->NumInOperands(); ++i) {
+            operands.push_back(
+                GetLane(inst->GetSingleWordInOperand(i), lane, inst));
+          }
+          pointers.push_back(
+              inst_builder.AddNaryOp(inst->type_id(), inst->opcode(), operands)
+                  ->result_id());
+        }
+        break;
+      }
+      case SpvOpLoad: {
+        if (IsUniform(inst->result_id())) continue;
+        const std::vector<uint32_t>& pointers =
+            lanes_[inst->GetSingleWordInOperand(0)];
+        std::vector<uint32_t> values;
+        for (uint32_t lane = 0; lane < vector_width_; ++lane) {
+          values.push_back(
+              inst_builder.AddLoad(inst->type_id(), pointers[lane])
+                  ->result_id());
+        }
+        Instruction* vector = inst_builder.AddCompositeConstruct(
+            GetVectorTypeId(inst->type_id()), values);
+        context_->get_decoration_mgr()->CloneDecorations(inst->result_id(),
+                                                         vector->result_id());
+        vectors_[inst->result_id()] = vector->result_id();
+        lanes_[inst->result_id()] = values;
+        break;
+      }
+      case SpvOpStore: {
+        const std::vector<uint32_t>& pointers =
+            lanes_[inst->GetSingleWordInOperand(0)];
+        const uint32_t value = inst->GetSingleWordInOperand(1);
+        for (uint32_t lane = 0; lane < vector_width_; ++lane) {
+          inst_builder.AddStore(pointers[lane], GetLane(value, lane, inst));
+        }
+        break;
+      }
+      default: {
+        if (IsUniform(inst->result_id())) continue;
+        std::unique_ptr<Instruction> vector(inst->Clone(context_));
+        const uint32_t vector_id = context_->TakeNextId();
+        vector->SetResultId(vector_id);
+        vector->SetResultType(GetVectorTypeId(inst->type_id()));
+        vector->ForEachInId([this, inst, def_use_mgr](uint32_t* id) {
+          if (def_use_mgr->GetDef(*id)->opcode() == SpvOpExtInstImport) return;
+          *id = GetVector(*id, inst);
+        });
+        Instruction* added = inst->InsertBefore(std::move(vector));
+        context_->AnalyzeDefUse(added);
+        context_->set_instr_block(added, body_);
+        context_->get_decoration_mgr()->CloneDecorations(inst->result_id(),
+                                                         vector_id);
+        vectors_[inst->result_id()] = vector_id;
+        break;
+      }
+    }
+    replaced.push_back(inst);
+  }
+
+  // Remove the scalar instructions, users first.
+  for (auto it = replaced.rbegin(); it != replaced.rend(); ++it) {
+    context_->KillInst(*it);
+  }
+}
+
+void LoopVectorizerImpl::Vectorize() {
+  const int64_t vector_iterations =
+      static_cast<int64_t>(trip_count_ / vector_width_) * vector_width_;
+  const int64_t remainder = static_cast<int64_t>(trip_count_) -
+                            vector_iterations;
+
+  // The epilogue copies the scalar body, so it is built first.
+  EmitScalarEpilogue(init_value_ + vector_iterations, remainder);
+  WidenBody();
+
+  // Step by |vector_width_| and stop before the remainder.
+  const uint32_t step_operand =
+      increment_->GetSingleWordInOperand(0) == induction_->result_id() ? 1 : 0;
+  increment_->SetInOperand(step_operand,
+                           {GetInductionConstant(vector_width_)});
+  context_->AnalyzeUses(increment_);
+  condition_->SetInOperand(
+      1, {GetInductionConstant(init_value_ + vector_iterations)});
+  context_->AnalyzeUses(condition_);
+}
+
+}  // namespace
+
+Pass::Status LoopVectorizer::Process() {
+  if (vector_width_ != 2 && vector_width_ != 4) {
+    return Status::SuccessWithoutChange;
+  }
+
+  bool changed = false;
+  for (Function& f : *context()->module()) {
+    LoopDescriptor* loop_descriptor = context()->GetLoopDescriptor(&f);
+    for (Loop& loop : *loop_descriptor) {
+      LoopVectorizerImpl vectorizer(context(), &loop, vector_width_);
+      if (!vectorizer.CanVectorize()) continue;
+      vectorizer.Vectorize();
+      // Scalar evolution caches nodes for the instructions that were
+      // replaced.
+      context()->InvalidateAnalyses(IRContext::kAnalysisScalarEvolution |
+                                    IRContext::kAnalysisRegisterPressure);
+      changed = true;
+    }
+  }
+
+  return changed ? Status::SuccessWithChange : Status::SuccessWithoutChange;
+}
+
+}  // namespace opt
+}  // namespace spvtools
@@ -0,0 +1,72 @@
+// Copyright (c) 2020 Google LLC.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SOURCE_OPT_LOOP_VECTORIZER_H_
+#define SOURCE_OPT_LOOP_VECTORIZER_H_
+
+#include "source/opt/pass.h"
+
+namespace spvtools {
+namespace opt {
+
+// Turns innermost counted loops that work on one array element per iteration
+// into loops that work on |vector_width| elements per iteration, using vector
+// arithmetic.
+//
+// A loop is vectorized when:
+//   - it has no nested loop, and consists of its header, a single body block
+//     and optionally a continue block holding only the induction update;
+//   - its only loop-carried value is an induction variable that starts at a
+//     constant, steps by one and is compared with "<" against a constant;
+//   - every value computed in the body is used only in the body;
+//   - the body only does component-wise arithmetic, and loads and stores
+//     through access chains into Function, Private, Uniform or StorageBuffer
+//     variables;
+//   - the loop dependence analysis shows no dependence between iterations;
+//   - the body does some arithmetic, and turning it into vector operations
+//     saves more instructions than the gathers and scatters below add.
+//
+// Logical addressing cannot reinterpret an array of scalars as an array of
+// vectors, so each vector is gathered from |vector_width| scalar loads and
+// scattered with scalar stores, while the arithmetic runs on vectors.  The
+// iterations left over when the trip count is not a multiple of
+// |vector_width| are executed by a scalar copy of the body placed after the
+// loop.
+class LoopVectorizer : public Pass {
+ public:
+  // |vector_width| must be 2 or 4.
+  explicit LoopVectorizer(uint32_t vector_width = 4)
+      : Pass(), vector_width_(vector_width) {}
+
+  const char* name() const override { return "loop-vectorize"; }
+
+  Status Process() override;
+
+  IRContext::Analysis GetPreservedAnalyses() override {
+    return IRContext::kAnalysisDefUse |
+           IRContext::kAnalysisInstrToBlockMapping |
+           IRContext::kAnalysisDecorations | IRContext::kAnalysisCombinators |
+           IRContext::kAnalysisCFG | IRContext::kAnalysisDominatorAnalysis |
+           IRContext::kAnalysisLoopAnalysis | IRContext::kAnalysisNameMap |
+           IRContext::kAnalysisConstants | IRContext::kAnalysisTypes;
+  }
+
+ private:
+  uint32_t vector_width_;
+};
+
+}  // namespace opt
+}  // namespace spvtools
+
+#endif  // SOURCE_OPT_LOOP_VECTORIZER_H_
@@ -133,35 +133,97 @@ void Module::ForEachInst(const std::function<void(const Instruction*)>& f,
 #undef DELEGATE
 }
 
+void Module::CloneInto(Module* target) const {
+  IRContext* ctx = target->context();
+  auto clone_list = [ctx](const InstructionList& from, InstructionList* to) {
+    for (const auto& inst : from) {
+      to->push_back(std::unique_ptr<Instruction>(inst.Clone(ctx)));
+    }
+  };
+
+  target->header_ = header_;
+  clone_list(capabilities_, &target->capabilities_);
+  clone_list(extensions_, &target->extensions_);
+  clone_list(ext_inst_imports_, &target->ext_inst_imports_);
+  if (memory_model_) {
+    target->memory_model_.reset(memory_model_->Clone(ctx));
+  }
+  clone_list(entry_points_, &target->entry_points_);
+  clone_list(execution_modes_, &target->execution_modes_);
+  clone_list(debugs1_, &target->debugs1_);
+  clone_list(debugs2_, &target->debugs2_);
+  clone_list(debugs3_, &target->debugs3_);
+  clone_list(ext_inst_debuginfo_, &target->ext_inst_debuginfo_);
+  clone_list(annotations_, &target->annotations_);
+  clone_list(types_values_, &target->types_values_);
+  target->functions_.reserve(functions_.size());
+  for (const auto& function : functions_) {
+    target->functions_.emplace_back(function->Clone(ctx));
+  }
+  target->trailing_dbg_line_info_.clear();
+  for (const auto& line : trailing_dbg_line_info_) {
+    std::unique_ptr<Instruction> clone(line.Clone(ctx));
+    target->trailing_dbg_line_info_.push_back(*clone);
+  }
+  target->contains_debug_scope_ = contains_debug_scope_;
+}
+
 void Module::ToBinary(std::vector<uint32_t>* binary, bool skip_nop) const {
-  binary->push_back(header_.magic_number);
-  binary->push_back(header_.version);
+  // Size the output once up front so emitting instructions never reallocates.
+  const size_t start = binary->size();
+  binary->resize(start + ComputeBinaryWordCount(skip_nop));
+  ToBinary(binary->data() + start, skip_nop);
+}
+
+size_t Module::ToBinary(uint32_t* words, bool skip_nop) const {
+  uint32_t* out = words;
+  *out++ = header_.magic_number;
+  *out++ = header_.version;
   // TODO(antiagainst): should we change the generator number?
-  binary->push_back(header_.generator);
-  binary->push_back(header_.bound);
-  binary->push_back(header_.reserved);
+  *out++ = header_.generator;
+  *out++ = header_.bound;
+  *out++ = header_.reserved;
 
-  size_t bound_idx = binary->size() - 2;
+  uint32_t* bound = words + 3;
   DebugScope last_scope(kNoDebugScope, kNoInlinedAt);
-  auto write_inst = [binary, skip_nop, &last_scope,
-                     this](const Instruction* i) {
+  auto write_inst = [&out, skip_nop, &last_scope, this](const Instruction* i) {
     if (!(skip_nop && i->IsNop())) {
       const auto& scope = i->GetDebugScope();
       if (scope != last_scope) {
-        // Emit DebugScope |scope| to |binary|.
+        // Emit DebugScope |scope| to |out|.
         auto dbg_inst = ext_inst_debuginfo_.begin();
-        scope.ToBinary(dbg_inst->type_id(), context()->TakeNextId(),
-                       dbg_inst->GetSingleWordOperand(2), binary);
+        out = scope.ToBinary(dbg_inst->type_id(), context()->TakeNextId(),
+                             dbg_inst->GetSingleWordOperand(2), out);
         last_scope = scope;
       }
 
-      i->ToBinaryWithoutAttachedDebugInsts(binary);
+      out = i->ToBinaryWithoutAttachedDebugInsts(out);
     }
   };
   ForEachInst(write_inst, true);
 
   // We create new instructions for DebugScope. The bound must be updated.
-  binary->data()[bound_idx] = header_.bound;
+  *bound = header_.bound;
+  return static_cast<size_t>(out - words);
+}
+
+size_t Module::ComputeBinaryWordCount(bool skip_nop) const {
+  // Mirrors ToBinary, but only tallies sizes so it has no side effects on the
+  // id bound.
+  size_t count = 5;
+  DebugScope last_scope(kNoDebugScope, kNoInlinedAt);
+  ForEachInst(
+      [&count, skip_nop, &last_scope](const Instruction* i) {
+        if (skip_nop && i->IsNop()) return;
+        const auto& scope = i->GetDebugScope();
+        if (scope != last_scope) {
+          count += scope.GetNumWords();
+          last_scope = scope;
+        }
+        count += 1 + i->NumOperandWords();
+      },
+      true);
+  return count;
 }
 
 uint32_t Module::ComputeIdBound() const {
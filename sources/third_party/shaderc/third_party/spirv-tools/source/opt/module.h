@@ -242,10 +242,26 @@ class Module {
   void ForEachInst(const std::function<void(const Instruction*)>& f,
                    bool run_on_debug_line_insts = false) const;
 
+  // Copies the header and every instruction of this module into |target|,
+  // which must be empty.  The copies belong to the context of |target|.  This
+  // module is only read, so several copies can be made concurrently.
+  void CloneInto(Module* target) const;
+
   // Pushes the binary segments for this instruction into the back of *|binary|.
   // If |skip_nop| is true and this is a OpNop, do nothing.
   void ToBinary(std::vector<uint32_t>* binary, bool skip_nop) const;
 
+  // Writes the binary for this module starting at |words|, which must have
+  // room for ComputeBinaryWordCount(|skip_nop|) words, and returns the number
+  // of words written.  This lets callers emit straight into storage they own,
+  // such as a memory-mapped output file, without an intermediate vector.
+  size_t ToBinary(uint32_t* words, bool skip_nop) const;
+
+  // Returns the exact number of words ToBinary(..., |skip_nop|) will write,
+  // including the header and any DebugScope instructions materialized from
+  // the instructions' debug scopes.
+  size_t ComputeBinaryWordCount(bool skip_nop) const;
+
   // Returns 1 more than the maximum Id value mentioned in the module.
   uint32_t ComputeIdBound() const;
 
@@ -14,17 +14,25 @@
 
 #include "spirv-tools/optimizer.hpp"
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <limits>
 #include <memory>
+#include <random>
 #include <string>
+#include <thread>
 #include <unordered_map>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
 #include "source/opt/build_module.h"
+#include "source/opt/cost_model.h"
 #include "source/opt/graphics_robust_access_pass.h"
 #include "source/opt/log.h"
 #include "source/opt/pass_manager.h"
+#include "source/opt/register_pressure.h"
 #include "source/opt/passes.h"
 #include "source/spirv_optimizer_options.h"
 #include "source/util/make_unique.h"
@@ -56,10 +64,20 @@ Optimizer::PassToken& Optimizer::PassToken::operator=(PassToken&& that) {
 Optimizer::PassToken::~PassToken() {}
 
 struct Optimizer::Impl {
-  explicit Impl(spv_target_env env) : target_env(env), pass_manager() {}
+  explicit Impl(spv_target_env env)
+      : target_env(env),
+        pass_manager(),
+        fixed_point_rounds(0),
+        invalid_recipe(false) {}
 
   spv_target_env target_env;      // Target environment.
   opt::PassManager pass_manager;  // Internal implementation pass manager.
+  // The round budget of the cleanup groups of the -O and -Os recipes, or 0
+  // to register them as fixed sequences.
+  uint32_t fixed_point_rounds;
+  // Set when a flag of the -O or -Os recipes could not be registered.  Run()
+  // then fails instead of running part of the recipe.
+  bool invalid_recipe;
 };
 
 Optimizer::Optimizer(spv_target_env env) : impl_(new Impl(env)) {}
@@ -156,86 +174,177 @@ Optimizer& Optimizer::RegisterLegalizationPasses() {
           .RegisterPass(CreateAggressiveDCEPass());
 }
 
+namespace {
+
+// The -O and -Os recipes, as flags.  RegisterPerformancePasses() and
+// RegisterSizePasses() register the prologue, followed by either the cleanup
+// sequence or, with fixed-point scheduling, a fixed-point group of cleanup
+// passes.  TunePasses() starts from the prologue and cleanup sequence.
+const char* const kPerformancePrologueFlags[] = {
+    "--wrap-opkill",
+    "--eliminate-dead-branches",
+    "--merge-return",
+    "--inline-entry-points-exhaustive",
+    "--eliminate-dead-code-aggressive",
+    "--private-to-local",
+    "--eliminate-local-single-block",
+    "--eliminate-local-single-store",
+    "--eliminate-dead-code-aggressive",
+    "--scalar-replacement",
+    "--convert-local-access-chains",
+    "--eliminate-local-single-block",
+    "--eliminate-local-single-store",
+    "--eliminate-dead-code-aggressive",
+    "--eliminate-local-multi-store",
+    "--eliminate-dead-code-aggressive",
+    "--ccp",
+    "--eliminate-dead-code-aggressive",
+    "--loop-unroll",
+};
+
+const char* const kPerformanceCleanupFlags[] = {
+    "--eliminate-dead-branches",
+    "--redundancy-elimination",
+    "--combine-access-chains",
+    "--simplify-instructions",
+    "--scalar-replacement",
+    "--convert-local-access-chains",
+    "--eliminate-local-single-block",
+    "--eliminate-local-single-store",
+    "--eliminate-dead-code-aggressive",
+    "--ssa-rewrite",
+    "--eliminate-dead-code-aggressive",
+    "--vector-dce",
+    "--eliminate-dead-inserts",
+    "--eliminate-dead-branches",
+    "--simplify-instructions",
+    "--if-conversion",
+    "--copy-propagate-arrays",
+    "--reduce-load-size",
+    "--eliminate-dead-code-aggressive",
+    "--merge-blocks",
+    "--redundancy-elimination",
+    "--eliminate-dead-branches",
+    "--merge-blocks",
+    "--simplify-instructions",
+};
+
+const char* const kSizePrologueFlags[] = {
+    "--wrap-opkill",
+    "--eliminate-dead-branches",
+    "--merge-return",
+    "--inline-entry-points-exhaustive",
+    "--eliminate-dead-functions",
+    "--private-to-local",
+    "--scalar-replacement=0",
+    "--eliminate-local-multi-store",
+    "--ccp",
+    "--loop-unroll",
+};
+
+const char* const kSizeCleanupFlags[] = {
+    "--eliminate-dead-branches",
+    "--simplify-instructions",
+    "--scalar-replacement=0",
+    "--eliminate-local-single-store",
+    "--if-conversion",
+    "--simplify-instructions",
+    "--eliminate-dead-code-aggressive",
+    "--eliminate-dead-branches",
+    "--merge-blocks",
+    "--convert-local-access-chains",
+    "--eliminate-local-single-block",
+    "--eliminate-dead-code-aggressive",
+    "--copy-propagate-arrays",
+    "--vector-dce",
+    "--eliminate-dead-inserts",
+    "--eliminate-dead-members",
+    "--eliminate-local-single-store",
+    "--merge-blocks",
+    "--eliminate-local-multi-store",
+    "--redundancy-elimination",
+    "--simplify-instructions",
+    "--eliminate-dead-code-aggressive",
+    "--cfg-cleanup",
+};
+
+// Registers the passes of |flags| on |optimizer|.  Returns false, after
+// reporting the flag to the message consumer, if a flag is not valid.
+template <size_t N>
+bool RegisterRecipeFlags(Optimizer* optimizer, const char* const (&flags)[N]) {
+  for (const char* flag : flags) {
+    if (!optimizer->RegisterPassFromFlag(flag)) {
+      Errorf(optimizer->consumer(), nullptr, {},
+             "Invalid flag '%s' in an optimization recipe", flag);
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+Optimizer& Optimizer::SetFixedPointScheduling(uint32_t max_rounds) {
+  impl_->fixed_point_rounds = max_rounds;
+  return *this;
+}
+
 Optimizer& Optimizer::RegisterPerformancePasses() {
-  return RegisterPass(CreateWrapOpKillPass())
-      .RegisterPass(CreateDeadBranchElimPass())
-      .RegisterPass(CreateMergeReturnPass())
-      .RegisterPass(CreateInlineExhaustivePass())
-      .RegisterPass(CreateAggressiveDCEPass())
-      .RegisterPass(CreatePrivateToLocalPass())
-      .RegisterPass(CreateLocalSingleBlockLoadStoreElimPass())
-      .RegisterPass(CreateLocalSingleStoreElimPass())
-      .RegisterPass(CreateAggressiveDCEPass())
-      .RegisterPass(CreateScalarReplacementPass())
-      .RegisterPass(CreateLocalAccessChainConvertPass())
-      .RegisterPass(CreateLocalSingleBlockLoadStoreElimPass())
-      .RegisterPass(CreateLocalSingleStoreElimPass())
-      .RegisterPass(CreateAggressiveDCEPass())
-      .RegisterPass(CreateLocalMultiStoreElimPass())
-      .RegisterPass(CreateAggressiveDCEPass())
-      .RegisterPass(CreateCCPPass())
-      .RegisterPass(CreateAggressiveDCEPass())
-      .RegisterPass(CreateLoopUnrollPass(true))
-      .RegisterPass(CreateDeadBranchElimPass())
-      .RegisterPass(CreateRedundancyEliminationPass())
-      .RegisterPass(CreateCombineAccessChainsPass())
-      .RegisterPass(CreateSimplificationPass())
-      .RegisterPass(CreateScalarReplacementPass())
-      .RegisterPass(CreateLocalAccessChainConvertPass())
-      .RegisterPass(CreateLocalSingleBlockLoadStoreElimPass())
-      .RegisterPass(CreateLocalSingleStoreElimPass())
-      .RegisterPass(CreateAggressiveDCEPass())
-      .RegisterPass(CreateSSARewritePass())
-      .RegisterPass(CreateAggressiveDCEPass())
-      .RegisterPass(CreateVectorDCEPass())
-      .RegisterPass(CreateDeadInsertElimPass())
-      .RegisterPass(CreateDeadBranchElimPass())
-      .RegisterPass(CreateSimplificationPass())
-      .RegisterPass(CreateIfConversionPass())
-      .RegisterPass(CreateCopyPropagateArraysPass())
-      .RegisterPass(CreateReduceLoadSizePass())
-      .RegisterPass(CreateAggressiveDCEPass())
-      .RegisterPass(CreateBlockMergePass())
-      .RegisterPass(CreateRedundancyEliminationPass())
-      .RegisterPass(CreateDeadBranchElimPass())
-      .RegisterPass(CreateBlockMergePass())
-      .RegisterPass(CreateSimplificationPass());
+  if (!RegisterRecipeFlags(this, kPerformancePrologueFlags)) {
+    impl_->invalid_recipe = true;
+    return *this;
+  }
+
+  if (impl_->fixed_point_rounds != 0) {
+    return RegisterPass(CreateFixedPointPass(
+        {CreateDeadBranchElimPass, CreateBlockMergePass,
+         CreateSimplificationPass, CreateRedundancyEliminationPass,
+         CreateCombineAccessChainsPass,
+         []() { return CreateScalarReplacementPass(); },
+         CreateLocalAccessChainConvertPass,
+         CreateLocalSingleBlockLoadStoreElimPass,
+         CreateLocalSingleStoreElimPass, CreateSSARewritePass,
+         CreateAggressiveDCEPass, CreateVectorDCEPass,
+         CreateDeadInsertElimPass, CreateIfConversionPass,
+         CreateCopyPropagateArraysPass, CreateReduceLoadSizePass},
+        impl_->fixed_point_rounds));
+  }
+
+  if (!RegisterRecipeFlags(this, kPerformanceCleanupFlags)) {
+    impl_->invalid_recipe = true;
+  }
+  return *this;
 }
 
 Optimizer& Optimizer::RegisterSizePasses() {
-  return RegisterPass(CreateWrapOpKillPass())
-      .RegisterPass(CreateDeadBranchElimPass())
-      .RegisterPass(CreateMergeReturnPass())
-      .RegisterPass(CreateInlineExhaustivePass())
-      .RegisterPass(CreateEliminateDeadFunctionsPass())
-      .RegisterPass(CreatePrivateToLocalPass())
-      .RegisterPass(CreateScalarReplacementPass(0))
-      .RegisterPass(CreateLocalMultiStoreElimPass())
-      .RegisterPass(CreateCCPPass())
-      .RegisterPass(CreateLoopUnrollPass(true))
-      .RegisterPass(CreateDeadBranchElimPass())
-      .RegisterPass(CreateSimplificationPass())
-      .RegisterPass(CreateScalarReplacementPass(0))
-      .RegisterPass(CreateLocalSingleStoreElimPass())
-      .RegisterPass(CreateIfConversionPass())
-      .RegisterPass(CreateSimplificationPass())
-      .RegisterPass(CreateAggressiveDCEPass())
-      .RegisterPass(CreateDeadBranchElimPass())
-      .RegisterPass(CreateBlockMergePass())
-      .RegisterPass(CreateLocalAccessChainConvertPass())
-      .RegisterPass(CreateLocalSingleBlockLoadStoreElimPass())
-      .RegisterPass(CreateAggressiveDCEPass())
-      .RegisterPass(CreateCopyPropagateArraysPass())
-      .RegisterPass(CreateVectorDCEPass())
-      .RegisterPass(CreateDeadInsertElimPass())
-      .RegisterPass(CreateEliminateDeadMembersPass())
-      .RegisterPass(CreateLocalSingleStoreElimPass())
-      .RegisterPass(CreateBlockMergePass())
-      .RegisterPass(CreateLocalMultiStoreElimPass())
-      .RegisterPass(CreateRedundancyEliminationPass())
-      .RegisterPass(CreateSimplificationPass())
-      .RegisterPass(CreateAggressiveDCEPass())
-      .RegisterPass(CreateCFGCleanupPass());
+  if (!RegisterRecipeFlags(this, kSizePrologueFlags)) {
+    impl_->invalid_recipe = true;
+    return *this;
+  }
+
+  if (impl_->fixed_point_rounds != 0) {
+    return RegisterPass(CreateFixedPointPass(
+                            {CreateDeadBranchElimPass, CreateBlockMergePass,
+                             CreateSimplificationPass,
+                             []() { return CreateScalarReplacementPass(0); },
+                             CreateLocalAccessChainConvertPass,
+                             CreateLocalSingleBlockLoadStoreElimPass,
+                             CreateLocalSingleStoreElimPass,
+                             CreateLocalMultiStoreElimPass,
+                             CreateIfConversionPass,
+                             CreateRedundancyEliminationPass,
+                             CreateCopyPropagateArraysPass, CreateVectorDCEPass,
+                             CreateDeadInsertElimPass, CreateAggressiveDCEPass,
+                             CreateCFGCleanupPass},
+                            impl_->fixed_point_rounds))
+        .RegisterPass(CreateEliminateDeadMembersPass())
+        .RegisterPass(CreateAggressiveDCEPass());
+  }
+
+  if (!RegisterRecipeFlags(this, kSizeCleanupFlags)) {
+    impl_->invalid_recipe = true;
+  }
+  return *this;
 }
 
 Optimizer& Optimizer::RegisterVulkanToWebGPUPasses() {
@@ -357,6 +466,18 @@ bool Optimizer::RegisterPassFromFlag(const std::string& flag) {
     RegisterPass(CreateDeadBranchElimPass());
   } else if (pass_name == "eliminate-dead-functions") {
     RegisterPass(CreateEliminateDeadFunctionsPass());
+  } else if (pass_name == "fixed-point-scheduling") {
+    int rounds = (pass_args.size() > 0) ? atoi(pass_args.c_str()) : 4;
+    if (rounds > 0) {
+      SetFixedPointScheduling(static_cast<uint32_t>(rounds));
+    } else {
+      Error(consumer(), nullptr, {},
+            "--fixed-point-scheduling must have no argument or a positive "
+            "integer argument");
+      return false;
+    }
+  } else if (pass_name == "eliminate-global-load-store") {
+    RegisterPass(CreateGlobalLoadStoreElimPass());
   } else if (pass_name == "eliminate-local-multi-store") {
     RegisterPass(CreateLocalMultiStoreElimPass());
   } else if (pass_name == "eliminate-dead-const") {
@@ -440,6 +561,24 @@ bool Optimizer::RegisterPassFromFlag(const std::string& flag) {
     RegisterPass(CreateConvertRelaxedToHalfPass());
   } else if (pass_name == "relax-float-ops") {
     RegisterPass(CreateRelaxFloatOpsPass());
+  } else if (pass_name == "relax-float-ops-by-precision") {
+    std::vector<uint32_t> locations;
+    std::string::size_type start = 0;
+    while (start <= pass_args.size()) {
+      std::string::size_type end = pass_args.find(',', start);
+      if (end == std::string::npos) end = pass_args.size();
+      std::string location = pass_args.substr(start, end - start);
+      if (location.empty() ||
+          location.find_first_not_of("0123456789") != std::string::npos) {
+        Error(consumer(), nullptr, {},
+              "--relax-float-ops-by-precision must have a comma-separated "
+              "list of non-negative integer Locations as argument");
+        return false;
+      }
+      locations.push_back(static_cast<uint32_t>(atoi(location.c_str())));
+      start = end + 1;
+    }
+    RegisterPass(CreateRelaxFloatOpsByPrecisionPass(locations));
   } else if (pass_name == "inst-debug-printf") {
     RegisterPass(CreateInstDebugPrintfPass(7, 23));
   } else if (pass_name == "simplify-instructions") {
@@ -485,6 +624,15 @@ bool Optimizer::RegisterPassFromFlag(const std::string& flag) {
             "--loop-unroll-partial must have a positive integer argument");
       return false;
     }
+  } else if (pass_name == "loop-vectorize") {
+    int width = (pass_args.size() > 0) ? atoi(pass_args.c_str()) : 4;
+    if (width == 2 || width == 4) {
+      RegisterPass(CreateLoopVectorizePass(static_cast<uint32_t>(width)));
+    } else {
+      Error(consumer(), nullptr, {},
+            "--loop-vectorize must have no argument or an argument of 2 or 4");
+      return false;
+    }
   } else if (pass_name == "loop-peeling") {
     RegisterPass(CreateLoopPeelingPass());
   } else if (pass_name == "loop-peeling-threshold") {
@@ -504,8 +652,10 @@ bool Optimizer::RegisterPassFromFlag(const std::string& flag) {
     RegisterPass(CreateFixStorageClassPass());
   } else if (pass_name == "O") {
     RegisterPerformancePasses();
+    if (impl_->invalid_recipe) return false;
   } else if (pass_name == "Os") {
     RegisterSizePasses();
+    if (impl_->invalid_recipe) return false;
   } else if (pass_name == "legalize-hlsl") {
     RegisterLegalizationPasses();
   } else if (pass_name == "generate-webgpu-initializers") {
@@ -559,16 +709,16 @@ bool Optimizer::Run(const uint32_t* original_binary,
                     const size_t original_binary_size,
                     std::vector<uint32_t>* optimized_binary,
                     const spv_optimizer_options opt_options) const {
-  spvtools::SpirvTools tools(impl_->target_env);
-  tools.SetMessageConsumer(impl_->pass_manager.consumer());
-  if (opt_options->run_validator_ &&
-      !tools.Validate(original_binary, original_binary_size,
-                      &opt_options->val_options_)) {
-    return false;
-  }
-
-  std::unique_ptr<opt::IRContext> context = BuildModule(
-      impl_->target_env, consumer(), original_binary, original_binary_size);
+  if (impl_->invalid_recipe) return false;
+
+  // Validation and IR construction share a single parse of the binary.
+  std::unique_ptr<opt::IRContext> context =
+      opt_options->run_validator_
+          ? ValidateAndBuildModule(impl_->target_env, consumer(),
+                                   original_binary, original_binary_size,
+                                   &opt_options->val_options_)
+          : BuildModule(impl_->target_env, consumer(), original_binary,
+                        original_binary_size);
   if (context == nullptr) return false;
 
   context->set_max_id_bound(opt_options->max_id_bound_);
@@ -611,6 +761,357 @@ bool Optimizer::Run(const uint32_t* original_binary,
   return true;
 }
 
+bool Optimizer::RunVariants(
+    const uint32_t* original_binary, const size_t original_binary_size,
+    const std::vector<std::unordered_map<uint32_t, std::string>>& variants,
+    const std::vector<std::string>& pass_flags,
+    std::vector<std::vector<uint32_t>>* optimized_binaries,
+    const spv_optimizer_options opt_options, uint32_t num_threads) const {
+  std::unique_ptr<opt::IRContext> base =
+      opt_options->run_validator_
+          ? ValidateAndBuildModule(impl_->target_env, consumer(),
+                                   original_binary, original_binary_size,
+                                   &opt_options->val_options_)
+          : BuildModule(impl_->target_env, consumer(), original_binary,
+                        original_binary_size);
+  if (base == nullptr) return false;
+
+  base->set_max_id_bound(opt_options->max_id_bound_);
+  base->set_preserve_bindings(opt_options->preserve_bindings_);
+  base->set_preserve_spec_constants(opt_options->preserve_spec_constants_);
+
+  // Reject bad flags once, rather than in every variant.
+  Optimizer flag_check(impl_->target_env);
+  flag_check.SetMessageConsumer(consumer());
+  if (!flag_check.RegisterPassesFromFlags(pass_flags)) return false;
+
+  optimized_binaries->assign(variants.size(), std::vector<uint32_t>());
+  std::atomic<size_t> next_variant(0);
+  std::atomic<bool> failed(false);
+
+  // Passes keep per-run state, so every variant gets its own pass manager.
+  // |base| is only read while it is being cloned.
+  auto run_variants = [&]() {
+    for (size_t i = next_variant++; i < variants.size() && !failed;
+         i = next_variant++) {
+      Optimizer optimizer(impl_->target_env);
+      optimizer.SetMessageConsumer(consumer());
+      optimizer.RegisterPass(
+          CreateSetSpecConstantDefaultValuePass(variants[i]));
+      optimizer.RegisterPassesFromFlags(pass_flags);
+      optimizer.impl_->pass_manager.SetValidatorOptions(
+          &opt_options->val_options_);
+      optimizer.impl_->pass_manager.SetTargetEnv(impl_->target_env);
+
+      std::unique_ptr<opt::IRContext> context = base->Clone();
+      if (optimizer.impl_->pass_manager.Run(context.get()) ==
+          opt::Pass::Status::Failure) {
+        failed = true;
+        return;
+      }
+      context->module()->ToBinary(&(*optimized_binaries)[i],
+                                  /* skip_nop = */ true);
+    }
+  };
+
+  std::vector<std::thread> workers;
+  const size_t num_workers =
+      std::min<size_t>(std::max<uint32_t>(num_threads, 1), variants.size());
+  for (size_t i = 1; i < num_workers; ++i) {
+    workers.emplace_back(run_variants);
+  }
+  run_variants();
+  for (auto& worker : workers) {
+    worker.join();
+  }
+
+  return !failed;
+}
+
+namespace {
+
+// Passes that are in neither recipe, and other settings of the
+// parameterized passes, that the tuner may also try by default.
+const char* const kExtraTuningFlags[] = {
+    "--scalar-replacement=50",
+    "--scalar-replacement=200",
+    "--loop-unroll-partial=2",
+    "--loop-unroll-partial=4",
+    "--loop-unroll-partial=8",
+    "--loop-invariant-code-motion",
+    "--loop-unswitch",
+    "--loop-peeling",
+    "--local-redundancy-elimination",
+    "--eliminate-global-load-store",
+    "--strength-reduction",
+    "--code-sink",
+    "--eliminate-dead-const",
+    "--unify-const",
+};
+
+using Recipe = std::vector<std::string>;
+
+// Returns the flags of |prologue| followed by those of |cleanup|.
+template <size_t N, size_t M>
+Recipe MakeRecipe(const char* const (&prologue)[N],
+                  const char* const (&cleanup)[M]) {
+  Recipe recipe(std::begin(prologue), std::end(prologue));
+  recipe.insert(recipe.end(), std::begin(cleanup), std::end(cleanup));
+  return recipe;
+}
+
+std::string RecipeKey(const Recipe& recipe) {
+  std::string key;
+  for (const auto& flag : recipe) {
+    key += flag;
+    key += '\n';
+  }
+  return key;
+}
+
+// Returns a copy of |recipe| with one to three random edits applied.  Each
+// edit inserts, removes, swaps or replaces flags, drawing new flags from
+// |pool|.  The result never has more than |max_length| flags.
+Recipe MutateRecipe(const Recipe& recipe, const std::vector<std::string>& pool,
+                    size_t max_length, std::mt19937* rng) {
+  Recipe result = recipe;
+  const uint32_t num_edits = 1 + (*rng)() % 3;
+  for (uint32_t i = 0; i < num_edits; ++i) {
+    const size_t size = result.size();
+    switch ((*rng)() % 4) {
+      case 0:
+        if (size < max_length) {
+          result.insert(result.begin() + (*rng)() % (size + 1),
+                        pool[(*rng)() % pool.size()]);
+        }
+        break;
+      case 1:
+        if (size > 1) result.erase(result.begin() + (*rng)() % size);
+        break;
+      case 2:
+        if (size > 1) {
+          const size_t pos = (*rng)() % (size - 1);
+          std::swap(result[pos], result[pos + 1]);
+        }
+        break;
+      default:
+        if (size > 0) result[(*rng)() % size] = pool[(*rng)() % pool.size()];
+        break;
+    }
+  }
+  return result;
+}
+
+}  // namespace
+
+Optimizer::TuningObjective Optimizer::InstructionCountObjective() {
+  return [](const std::vector<uint32_t>& binary) -> double {
+    size_t count = 0;
+    bool in_function = false;
+    for (size_t i = 5; i < binary.size();) {
+      const uint32_t num_words = binary[i] >> 16;
+      const uint32_t opcode = binary[i] & 0xFFFF;
+      if (opcode == SpvOpFunction) in_function = true;
+      if (in_function) ++count;
+      if (opcode == SpvOpFunctionEnd) in_function = false;
+      if (num_words == 0) break;
+      i += num_words;
+    }
+    return static_cast<double>(count);
+  };
+}
+
+Optimizer::TuningObjective Optimizer::CodeSizeObjective() {
+  return [](const std::vector<uint32_t>& binary) {
+    return static_cast<double>(binary.size());
+  };
+}
+
+Optimizer::TuningObjective Optimizer::RegisterPressureObjective() const {
+  const spv_target_env env = impl_->target_env;
+  return [env](const std::vector<uint32_t>& binary) -> double {
+    std::unique_ptr<opt::IRContext> context =
+        BuildModule(env, nullptr, binary.data(), binary.size());
+    if (context == nullptr) return std::numeric_limits<double>::infinity();
+
+    opt::LivenessAnalysis* liveness = context->GetLivenessAnalysis();
+    size_t pressure = 0;
+    for (auto& function : *context->module()) {
+      const opt::RegisterLiveness* function_liveness = liveness->Get(&function);
+      size_t max_live = 0;
+      for (const auto& block : function) {
+        const opt::RegisterLiveness::RegionRegisterLiveness* block_liveness =
+            function_liveness->Get(&block);
+        if (block_liveness != nullptr) {
+          max_live = std::max(max_live, block_liveness->used_registers_);
+        }
+      }
+      pressure += max_live;
+    }
+    return static_cast<double>(pressure);
+  };
+}
+
+bool Optimizer::TunePasses(const uint32_t* original_binary,
+                           const size_t original_binary_size,
+                           const TuningObjective& objective,
+                           const TuningOptions& tuning_options,
+                           std::vector<std::string>* best_flags,
+                           double* best_cost,
+                           const spv_optimizer_options opt_options) const {
+  std::unique_ptr<opt::IRContext> base =
+      opt_options->run_validator_
+          ? ValidateAndBuildModule(impl_->target_env, consumer(),
+                                   original_binary, original_binary_size,
+                                   &opt_options->val_options_)
+          : BuildModule(impl_->target_env, consumer(), original_binary,
+                        original_binary_size);
+  if (base == nullptr) return false;
+
+  base->set_max_id_bound(opt_options->max_id_bound_);
+  base->set_preserve_bindings(opt_options->preserve_bindings_);
+  base->set_preserve_spec_constants(opt_options->preserve_spec_constants_);
+
+  const TuningObjective score =
+      objective ? objective : InstructionCountObjective();
+
+  std::vector<Recipe> batch;
+  batch.push_back(
+      MakeRecipe(kPerformancePrologueFlags, kPerformanceCleanupFlags));
+  batch.push_back(MakeRecipe(kSizePrologueFlags, kSizeCleanupFlags));
+  batch.insert(batch.end(), tuning_options.initial_recipes.begin(),
+               tuning_options.initial_recipes.end());
+
+  std::vector<std::string> pool = tuning_options.candidate_flags;
+  if (pool.empty()) {
+    pool.insert(pool.end(), batch[0].begin(), batch[0].end());
+    pool.insert(pool.end(), batch[1].begin(), batch[1].end());
+    pool.insert(pool.end(), std::begin(kExtraTuningFlags),
+                std::end(kExtraTuningFlags));
+    std::sort(pool.begin(), pool.end());
+    pool.erase(std::unique(pool.begin(), pool.end()), pool.end());
+  }
+
+  // Reject bad flags once, rather than in every candidate.  This includes the
+  // performance and size recipes, which are not in |pool| when the caller
+  // gives its own candidate flags.
+  Optimizer flag_check(impl_->target_env);
+  flag_check.SetMessageConsumer(consumer());
+  if (!flag_check.RegisterPassesFromFlags(pool)) return false;
+  for (const auto& recipe : batch) {
+    if (!flag_check.RegisterPassesFromFlags(recipe)) return false;
+  }
+
+  // Candidates run silently: a recipe that breaks the module is expected
+  // during the search, and is simply scored as unusable.
+  const double kRejected = std::numeric_limits<double>::infinity();
+  auto evaluate = [&](const Recipe& recipe) -> double {
+    Optimizer optimizer(impl_->target_env);
+    optimizer.RegisterPassesFromFlags(recipe);
+    optimizer.impl_->pass_manager.SetValidatorOptions(
+        &opt_options->val_options_);
+    optimizer.impl_->pass_manager.SetTargetEnv(impl_->target_env);
+
+    std::unique_ptr<opt::IRContext> context = base->Clone();
+    if (optimizer.impl_->pass_manager.Run(context.get()) ==
+        opt::Pass::Status::Failure) {
+      return kRejected;
+    }
+    std::vector<uint32_t> binary;
+    context->module()->ToBinary(&binary, /* skip_nop = */ true);
+    if (opt_options->run_validator_ &&
+        !SpirvTools(impl_->target_env)
+             .Validate(binary.data(), binary.size(),
+                       &opt_options->val_options_)) {
+      return kRejected;
+    }
+    return score(binary);
+  };
+
+  // Evaluates every recipe in |batch| on up to |num_threads| threads.  |base|
+  // is only read while it is being cloned.
+  std::vector<double> costs;
+  auto evaluate_batch = [&]() {
+    costs.assign(batch.size(), kRejected);
+    std::atomic<size_t> next_recipe(0);
+    auto run_recipes = [&]() {
+      for (size_t i = next_recipe++; i < batch.size(); i = next_recipe++) {
+        costs[i] = evaluate(batch[i]);
+      }
+    };
+    std::vector<std::thread> workers;
+    const size_t num_workers = std::min<size_t>(
+        std::max<uint32_t>(tuning_options.num_threads, 1), batch.size());
+    for (size_t i = 1; i < num_workers; ++i) {
+      workers.emplace_back(run_recipes);
+    }
+    run_recipes();
+    for (auto& worker : workers) {
+      worker.join();
+    }
+  };
+
+  Recipe best;
+  double lowest_cost = kRejected;
+  std::unordered_map<std::string, double> seen;
+  auto keep_best = [&]() {
+    for (size_t i = 0; i < batch.size(); ++i) {
+      seen[RecipeKey(batch[i])] = costs[i];
+      if (costs[i] < lowest_cost ||
+          (costs[i] == lowest_cost && costs[i] != kRejected &&
+           batch[i].size() < best.size())) {
+        lowest_cost = costs[i];
+        best = batch[i];
+      }
+    }
+  };
+
+  evaluate_batch();
+  keep_best();
+
+  std::mt19937 rng(tuning_options.seed);
+  for (uint32_t round = 0;
+       round < tuning_options.num_rounds && lowest_cost != kRejected;
+       ++round) {
+    batch.clear();
+    std::unordered_set<std::string> in_batch;
+    // Give up on filling the round once mutations keep producing recipes
+    // that were already tried.
+    for (uint32_t attempt = 0;
+         attempt < 4 * tuning_options.candidates_per_round &&
+         batch.size() < tuning_options.candidates_per_round;
+         ++attempt) {
+      Recipe candidate = MutateRecipe(best, pool,
+                                      tuning_options.max_recipe_length, &rng);
+      const std::string key = RecipeKey(candidate);
+      if (seen.count(key) || !in_batch.insert(key).second) continue;
+      batch.push_back(std::move(candidate));
+    }
+    if (batch.empty()) break;
+    evaluate_batch();
+    keep_best();
+  }
+
+  if (lowest_cost == kRejected) return false;
+  *best_flags = best;
+  if (best_cost != nullptr) *best_cost = lowest_cost;
+  return true;
+}
+
+bool Optimizer::ReportCost(const uint32_t* original_binary,
+                           const size_t original_binary_size,
+                           std::ostream* report,
+                           size_t unknown_trip_count) const {
+  std::unique_ptr<opt::IRContext> context =
+      BuildModule(impl_->target_env, consumer(), original_binary,
+                  original_binary_size);
+  if (context == nullptr) return false;
+
+  opt::ShaderCostModel cost_model(context.get(), unknown_trip_count);
+  cost_model.PrintReport(cost_model.ComputeEntryPointCosts(), *report);
+  return true;
+}
+
 Optimizer& Optimizer::SetPrintAll(std::ostream* out) {
   impl_->pass_manager.SetPrintAll(out);
   return *this;
@@ -901,11 +1402,13 @@ Optimizer::PassToken CreateInstBindlessCheckPass(uint32_t desc_set,
                                                  uint32_t shader_id,
                                                  bool input_length_enable,
                                                  bool input_init_enable,
-                                                 bool input_buff_oob_enable) {
+                                                 bool input_buff_oob_enable,
+                                                 uint32_t sample_period,
+                                                 uint32_t sample_seed) {
   return MakeUnique<Optimizer::PassToken::Impl>(
       MakeUnique<opt::InstBindlessCheckPass>(
           desc_set, shader_id, input_length_enable, input_init_enable,
-          input_buff_oob_enable));
+          input_buff_oob_enable, sample_period, sample_seed));
 }
 
 Optimizer::PassToken CreateInstDebugPrintfPass(uint32_t desc_set,
@@ -915,9 +1418,12 @@ Optimizer::PassToken CreateInstDebugPrintfPass(uint32_t desc_set,
 }
 
 Optimizer::PassToken CreateInstBuffAddrCheckPass(uint32_t desc_set,
-                                                 uint32_t shader_id) {
+                                                 uint32_t shader_id,
+                                                 uint32_t sample_period,
+                                                 uint32_t sample_seed) {
   return MakeUnique<Optimizer::PassToken::Impl>(
-      MakeUnique<opt::InstBuffAddrCheckPass>(desc_set, shader_id));
+      MakeUnique<opt::InstBuffAddrCheckPass>(desc_set, shader_id,
+                                             sample_period, sample_seed));
 }
 
 Optimizer::PassToken CreateConvertRelaxedToHalfPass() {
@@ -979,4 +1485,34 @@ Optimizer::PassToken CreateAmdExtToKhrPass() {
       MakeUnique<opt::AmdExtensionToKhrPass>());
 }
 
+Optimizer::PassToken CreateLoopVectorizePass(uint32_t vector_width) {
+  return MakeUnique<Optimizer::PassToken::Impl>(
+      MakeUnique<opt::LoopVectorizer>(vector_width));
+}
+
+Optimizer::PassToken CreateGlobalLoadStoreElimPass() {
+  return MakeUnique<Optimizer::PassToken::Impl>(
+      MakeUnique<opt::GlobalLoadStoreElimPass>());
+}
+
+Optimizer::PassToken CreateFixedPointPass(
+    std::vector<std::function<Optimizer::PassToken()>> pass_factories,
+    uint32_t max_rounds) {
+  std::vector<opt::FixedPointPass::PassFactory> factories;
+  for (auto& pass_factory : pass_factories) {
+    factories.push_back([pass_factory]() {
+      Optimizer::PassToken token = pass_factory();
+      return std::move(token.impl_->pass);
+    });
+  }
+  return MakeUnique<Optimizer::PassToken::Impl>(
+      MakeUnique<opt::FixedPointPass>(std::move(factories), max_rounds));
+}
+
+Optimizer::PassToken CreateRelaxFloatOpsByPrecisionPass(
+    const std::vector<uint32_t>& unorm8_locations) {
+  return MakeUnique<Optimizer::PassToken::Impl>(
+      MakeUnique<opt::RelaxFloatOpsByPrecisionPass>(unorm8_locations));
+}
+
 }  // namespace spvtools
@@ -106,6 +106,11 @@ class Pass {
     return IRContext::kAnalysisNone;
   }
 
+  // Returns true if the pass transforms each function on its own.  Such a
+  // pass skips the functions outside the function scope of the context, and
+  // marks the functions it changes (see IRContext::MarkFunctionChanged).
+  virtual bool IsFunctionLocal() const { return false; }
+
   // Return type id for |ptrInst|'s pointee
   uint32_t GetPointeeTypeId(const Instruction* ptrInst) const;
 
@@ -14,26 +14,56 @@
 
 #include "source/opt/propagator.h"
 
+#include <algorithm>
+
 namespace spvtools {
 namespace opt {
 
-void SSAPropagator::AddControlEdge(const Edge& edge) {
-  BasicBlock* dest_bb = edge.dest;
+uint8_t& SSAPropagator::MutableInstState(const Instruction* inst) {
+  uint32_t id = inst->unique_id();
+  if (id >= inst_state_.size()) {
+    inst_state_.resize(std::max<size_t>(id + 1, inst_state_.size() * 2), 0);
+  }
+  if (inst_state_[id] == 0) {
+    touched_insts_.push_back(id);
+  }
+  return inst_state_[id];
+}
+
+uint32_t SSAPropagator::BlockIndex(const BasicBlock* block) const {
+  if (block == nullptr) return kNoBlock;
+  if (block == ctx_->cfg()->pseudo_exit_block()) return exit_index_;
+  if (block == ctx_->cfg()->pseudo_entry_block()) return entry_index_;
+  return BlockIndexOfLabel(block->id());
+}
+
+uint32_t SSAPropagator::EdgeIndex(uint32_t source, uint32_t dest) const {
+  for (uint32_t i = succ_begin_[source]; i < succ_begin_[source + 1]; ++i) {
+    if (succs_[i] == dest) {
+      return i;
+    }
+  }
+  assert(false && "Not a CFG edge.");
+  return succ_begin_[source];
+}
+
+void SSAPropagator::AddControlEdge(uint32_t edge) {
+  uint32_t dest = succs_[edge];
 
   // Refuse to add the exit block to the work list.
-  if (dest_bb == ctx_->cfg()->pseudo_exit_block()) {
+  if (dest == exit_index_) {
     return;
   }
 
   // Try to mark the edge executable.  If it was already in the set of
   // executable edges, do nothing.
-  if (!MarkEdgeExecutable(edge)) {
+  if (executable_edges_.Set(edge)) {
     return;
   }
 
   // If the edge had not already been marked executable, add the destination
   // basic block to the work list.
-  blocks_.push(dest_bb);
+  block_worklist_.push_back(dest);
 }
 
 void SSAPropagator::AddSSAEdges(Instruction* instr) {
@@ -47,24 +77,22 @@ void SSAPropagator::AddSSAEdges(Instruction* instr) {
         // If the basic block for |use_instr| has not been simulated yet, do
         // nothing.  The instruction |use_instr| will be simulated next time the
         // block is scheduled.
-        if (!BlockHasBeenSimulated(ctx_->get_instr_block(use_instr))) {
+        if (!BlockHasBeenSimulated(
+                BlockIndex(ctx_->get_instr_block(use_instr)))) {
           return;
         }
 
         if (ShouldSimulateAgain(use_instr)) {
-          ssa_edge_uses_.push(use_instr);
+          ssa_edge_uses_.push_back(use_instr);
         }
       });
 }
 
 bool SSAPropagator::IsPhiArgExecutable(Instruction* phi, uint32_t i) const {
-  BasicBlock* phi_bb = ctx_->get_instr_block(phi);
+  uint32_t phi_bb = BlockIndex(ctx_->get_instr_block(phi));
+  uint32_t in_bb = BlockIndexOfLabel(phi->GetSingleWordOperand(i + 1));
 
-  uint32_t in_label_id = phi->GetSingleWordOperand(i + 1);
-  Instruction* in_label_instr = get_def_use_mgr()->GetDef(in_label_id);
-  BasicBlock* in_bb = ctx_->get_instr_block(in_label_instr);
-
-  return IsEdgeExecutable(Edge(in_bb, phi_bb));
+  return IsEdgeExecutable(EdgeIndex(in_bb, phi_bb));
 }
 
 bool SSAPropagator::SetStatus(Instruction* inst, PropStatus status) {
@@ -79,7 +107,10 @@ bool SSAPropagator::SetStatus(Instruction* inst, PropStatus status) {
          "Invalid lattice transition");
 
   bool status_changed = !has_old_status || (old_status != status);
-  if (status_changed) statuses_[inst] = status;
+  if (status_changed) {
+    uint8_t& state = MutableInstState(inst);
+    state = static_cast<uint8_t>((state & ~kStatusMask) | (status + 1));
+  }
 
   return status_changed;
 }
@@ -107,8 +138,8 @@ bool SSAPropagator::Simulate(Instruction* instr) {
     // If |instr| is a block terminator, add all the control edges out of its
     // block.
     if (instr->IsBlockTerminator()) {
-      BasicBlock* block = ctx_->get_instr_block(instr);
-      for (const auto& e : bb_succs_.at(block)) {
+      uint32_t block = BlockIndex(ctx_->get_instr_block(instr));
+      for (uint32_t e = succ_begin_[block]; e < succ_begin_[block + 1]; ++e) {
         AddControlEdge(e);
       }
     }
@@ -123,7 +154,8 @@ bool SSAPropagator::Simulate(Instruction* instr) {
     // If there are multiple outgoing control flow edges and we know which one
     // will be taken, add the destination block to the CFG work list.
     if (dest_bb) {
-      AddControlEdge(Edge(ctx_->get_instr_block(instr), dest_bb));
+      AddControlEdge(EdgeIndex(BlockIndex(ctx_->get_instr_block(instr)),
+                               BlockIndex(dest_bb)));
     }
     changed = true;
   }
@@ -172,10 +204,11 @@ bool SSAPropagator::Simulate(Instruction* instr) {
   return changed;
 }
 
-bool SSAPropagator::Simulate(BasicBlock* block) {
-  if (block == ctx_->cfg()->pseudo_exit_block()) {
+bool SSAPropagator::Simulate(uint32_t block_index) {
+  if (block_index == exit_index_) {
     return false;
   }
+  BasicBlock* block = blocks_[block_index];
 
   // Always simulate Phi instructions, even if we have simulated this block
   // before. We do this because Phi instructions receive their inputs from
@@ -187,19 +220,19 @@ bool SSAPropagator::Simulate(BasicBlock* block) {
 
   // If this is the first time this block is being simulated, simulate every
   // statement in it.
-  if (!BlockHasBeenSimulated(block)) {
+  if (!BlockHasBeenSimulated(block_index)) {
     block->ForEachInst([this, &changed](Instruction* instr) {
       if (instr->opcode() != SpvOpPhi) {
         changed |= Simulate(instr);
       }
     });
 
-    MarkBlockSimulated(block);
+    MarkBlockSimulated(block_index);
 
     // If this block has exactly one successor, mark the edge to its successor
     // as executable.
-    if (bb_succs_.at(block).size() == 1) {
-      AddControlEdge(bb_succs_.at(block).at(0));
+    if (succ_begin_[block_index + 1] - succ_begin_[block_index] == 1) {
+      AddControlEdge(succ_begin_[block_index]);
     }
   }
 
@@ -207,31 +240,58 @@ bool SSAPropagator::Simulate(BasicBlock* block) {
 }
 
 void SSAPropagator::Initialize(Function* fn) {
-  // Compute predecessor and successor blocks for every block in |fn|'s CFG.
-  // TODO(dnovillo): Move this to CFG and always build them. Alternately,
-  // move it to IRContext and build CFG preds/succs on-demand.
-  bb_succs_[ctx_->cfg()->pseudo_entry_block()].push_back(
-      Edge(ctx_->cfg()->pseudo_entry_block(), fn->entry().get()));
-
+  // Forget the state left by a previous run on another function.
+  for (uint32_t id : touched_insts_) {
+    inst_state_[id] = 0;
+  }
+  touched_insts_.clear();
+  blocks_.clear();
+  ssa_edge_uses_.clear();
+  ssa_edge_uses_head_ = 0;
+  block_worklist_.clear();
+  block_worklist_head_ = 0;
+
+  // Number the blocks of |fn|.
   for (auto& block : *fn) {
-    const auto& const_block = block;
-    const_block.ForEachSuccessorLabel([this, &block](const uint32_t label_id) {
-      BasicBlock* succ_bb =
-          ctx_->get_instr_block(get_def_use_mgr()->GetDef(label_id));
-      bb_succs_[&block].push_back(Edge(&block, succ_bb));
-      bb_preds_[succ_bb].push_back(Edge(succ_bb, &block));
+    if (block.id() >= block_index_.size()) {
+      block_index_.resize(
+          std::max<size_t>(block.id() + 1, ctx_->module()->IdBound()), 0);
+    }
+    blocks_.push_back(&block);
+    block_index_[block.id()] = static_cast<uint32_t>(blocks_.size());
+  }
+  entry_index_ = static_cast<uint32_t>(blocks_.size());
+  exit_index_ = entry_index_ + 1;
+  blocks_.push_back(ctx_->cfg()->pseudo_entry_block());
+  blocks_.push_back(ctx_->cfg()->pseudo_exit_block());
+
+  // Compute the successor edges of every block in |fn|'s CFG.
+  succ_begin_.clear();
+  succs_.clear();
+  for (uint32_t i = 0; i < entry_index_; ++i) {
+    const BasicBlock* block = blocks_[i];
+    succ_begin_.push_back(static_cast<uint32_t>(succs_.size()));
+    block->ForEachSuccessorLabel([this](const uint32_t label_id) {
+      succs_.push_back(BlockIndexOfLabel(label_id));
     });
-    if (block.IsReturnOrAbort()) {
-      bb_succs_[&block].push_back(
-          Edge(&block, ctx_->cfg()->pseudo_exit_block()));
-      bb_preds_[ctx_->cfg()->pseudo_exit_block()].push_back(
-          Edge(ctx_->cfg()->pseudo_exit_block(), &block));
+    if (block->IsReturnOrAbort()) {
+      succs_.push_back(exit_index_);
     }
   }
+  // The pseudo entry block has a single edge to the function's entry, and the
+  // pseudo exit block has none.
+  succ_begin_.push_back(static_cast<uint32_t>(succs_.size()));
+  succs_.push_back(BlockIndex(fn->entry().get()));
+  succ_begin_.push_back(static_cast<uint32_t>(succs_.size()));
+  succ_begin_.push_back(static_cast<uint32_t>(succs_.size()));
+
+  simulated_blocks_ = utils::BitVector(static_cast<uint32_t>(blocks_.size()));
+  executable_edges_ =
+      utils::BitVector(static_cast<uint32_t>(succs_.size() + 1));
 
   // Add the edges out of the entry block to seed the propagator.
-  const auto& entry_succs = bb_succs_[ctx_->cfg()->pseudo_entry_block()];
-  for (const auto& e : entry_succs) {
+  for (uint32_t e = succ_begin_[entry_index_];
+       e < succ_begin_[entry_index_ + 1]; ++e) {
     AddControlEdge(e);
   }
 }
@@ -240,22 +300,21 @@ bool SSAPropagator::Run(Function* fn) {
   Initialize(fn);
 
   bool changed = false;
-  while (!blocks_.empty() || !ssa_edge_uses_.empty()) {
+  while (block_worklist_head_ < block_worklist_.size() ||
+         ssa_edge_uses_head_ < ssa_edge_uses_.size()) {
     // Simulate all blocks first. Simulating blocks will add SSA edges to
     // follow after all the blocks have been simulated.
-    if (!blocks_.empty()) {
-      auto block = blocks_.front();
-      changed |= Simulate(block);
-      blocks_.pop();
+    if (block_worklist_head_ < block_worklist_.size()) {
+      changed |= Simulate(block_worklist_[block_worklist_head_++]);
       continue;
     }
 
     // Simulate edges from the SSA queue.
-    if (!ssa_edge_uses_.empty()) {
-      Instruction* instr = ssa_edge_uses_.front();
-      changed |= Simulate(instr);
-      ssa_edge_uses_.pop();
-    }
+    changed |= Simulate(ssa_edge_uses_[ssa_edge_uses_head_++]);
+  }
+
+  for (uint32_t i = 0; i < entry_index_; ++i) {
+    block_index_[blocks_[i]->id()] = 0;
   }
 
 #ifndef NDEBUG
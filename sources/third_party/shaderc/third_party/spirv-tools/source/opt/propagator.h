@@ -16,33 +16,15 @@
 #define SOURCE_OPT_PROPAGATOR_H_
 
 #include <functional>
-#include <queue>
-#include <set>
-#include <unordered_map>
-#include <unordered_set>
-#include <utility>
 #include <vector>
 
 #include "source/opt/ir_context.h"
 #include "source/opt/module.h"
+#include "source/util/bit_vector.h"
 
 namespace spvtools {
 namespace opt {
 
-// Represents a CFG control edge.
-struct Edge {
-  Edge(BasicBlock* b1, BasicBlock* b2) : source(b1), dest(b2) {
-    assert(source && "CFG edges cannot have a null source block.");
-    assert(dest && "CFG edges cannot have a null destination block.");
-  }
-  BasicBlock* source;
-  BasicBlock* dest;
-  bool operator<(const Edge& o) const {
-    return std::make_pair(source->id(), dest->id()) <
-           std::make_pair(o.source->id(), o.dest->id());
-  }
-};
-
 // This class implements a generic value propagation algorithm based on the
 // conditional constant propagation algorithm proposed in
 //
@@ -200,12 +182,14 @@ class SSAPropagator {
 
   // Returns true if |inst| has a recorded status. This will be true once |inst|
   // has been simulated once.
-  bool HasStatus(Instruction* inst) const { return statuses_.count(inst); }
+  bool HasStatus(Instruction* inst) const {
+    return (InstState(inst) & kStatusMask) != 0;
+  }
 
   // Returns the current propagation status of |inst|. Assumes
   // |HasStatus(inst)| returns true.
   PropStatus Status(Instruction* inst) const {
-    return statuses_.find(inst)->second;
+    return static_cast<PropStatus>((InstState(inst) & kStatusMask) - 1);
   }
 
   // Records the propagation status |status| for |inst|. Returns true if the
@@ -213,12 +197,20 @@ class SSAPropagator {
   bool SetStatus(Instruction* inst, PropStatus status);
 
  private:
+  // Per-instruction state, indexed by unique id: the low bits hold 1 + the
+  // PropStatus (0 when there is no status), and kDoNotSimulate is set for
+  // instructions that should not be simulated again.
+  enum : uint8_t { kStatusMask = 0x3, kDoNotSimulate = 0x4 };
+
+  // Index used for blocks that are not part of the function being propagated.
+  enum : uint32_t { kNoBlock = ~0u };
+
   // Initialize processing.
   void Initialize(Function* fn);
 
   // Simulate the execution |block| by calling |visit_fn_| on every instruction
   // in it.
-  bool Simulate(BasicBlock* block);
+  bool Simulate(uint32_t block);
 
   // Simulate the execution of |instr| by replacing all the known values in
   // every operand and determining whether the result is interesting for
@@ -226,33 +218,54 @@ class SSAPropagator {
   // the value computed by |instr|.
   bool Simulate(Instruction* instr);
 
+  // Returns the state bits of |inst|, or 0 if it has none.
+  uint8_t InstState(const Instruction* inst) const {
+    if (inst == nullptr) return 0;
+    uint32_t id = inst->unique_id();
+    return id < inst_state_.size() ? inst_state_[id] : 0;
+  }
+
+  // Returns a reference to the state bits of |inst|, making room for them if
+  // needed.
+  uint8_t& MutableInstState(const Instruction* inst);
+
   // Returns true if |instr| should be simulated again.
   bool ShouldSimulateAgain(Instruction* instr) const {
-    return do_not_simulate_.find(instr) == do_not_simulate_.end();
+    return (InstState(instr) & kDoNotSimulate) == 0;
   }
 
   // Add |instr| to the set of instructions not to simulate again.
-  void DontSimulateAgain(Instruction* instr) { do_not_simulate_.insert(instr); }
-
-  // Returns true if |block| has been simulated already.
-  bool BlockHasBeenSimulated(BasicBlock* block) const {
-    return simulated_blocks_.find(block) != simulated_blocks_.end();
+  void DontSimulateAgain(Instruction* instr) {
+    MutableInstState(instr) |= kDoNotSimulate;
   }
 
-  // Marks block |block| as simulated.
-  void MarkBlockSimulated(BasicBlock* block) {
-    simulated_blocks_.insert(block);
+  // Returns the index of |block| in the function being propagated, or
+  // kNoBlock if |block| is null or not part of it.
+  uint32_t BlockIndex(const BasicBlock* block) const;
+
+  // Returns the index of the block labeled |label_id| in the function being
+  // propagated, or kNoBlock if there is none.
+  uint32_t BlockIndexOfLabel(uint32_t label_id) const {
+    return label_id < block_index_.size() ? block_index_[label_id] - 1
+                                          : kNoBlock;
   }
 
-  // Marks |edge| as executable.  Returns false if the edge was already marked
-  // as executable.
-  bool MarkEdgeExecutable(const Edge& edge) {
-    return executable_edges_.insert(edge).second;
+  // Returns true if block |block| has been simulated already.
+  bool BlockHasBeenSimulated(uint32_t block) const {
+    return block != kNoBlock && simulated_blocks_.Get(block);
   }
 
-  // Returns true if |edge| has been marked as executable.
-  bool IsEdgeExecutable(const Edge& edge) const {
-    return executable_edges_.find(edge) != executable_edges_.end();
+  // Marks block |block| as simulated.
+  void MarkBlockSimulated(uint32_t block) { simulated_blocks_.Set(block); }
+
+  // Returns the position in |succs_| of the edge |source| -> |dest|. Edges
+  // repeated in a terminator are always represented by their first position.
+  uint32_t EdgeIndex(uint32_t source, uint32_t dest) const;
+
+  // Returns true if the edge at position |edge| in |succs_| has been marked as
+  // executable.
+  bool IsEdgeExecutable(uint32_t edge) const {
+    return executable_edges_.Get(edge);
   }
 
   // Returns a pointer to the def-use manager for |ctx_|.
@@ -260,9 +273,9 @@ class SSAPropagator {
     return ctx_->get_def_use_mgr();
   }
 
-  // If the CFG edge |e| has not been executed, this function adds |e|'s
-  // destination block to the work list.
-  void AddControlEdge(const Edge& e);
+  // If the CFG edge at position |edge| in |succs_| has not been executed, this
+  // function adds its destination block to the work list.
+  void AddControlEdge(uint32_t edge);
 
   // Adds all the instructions that use the result of |instr| to the SSA edges
   // work list. If |instr| produces no result id, this does nothing.
@@ -278,34 +291,45 @@ class SSAPropagator {
   VisitFunction visit_fn_;
 
   // SSA def-use edges to traverse. Each entry is a destination statement for an
-  // SSA def-use edge as returned by |def_use_manager_|.
-  std::queue<Instruction*> ssa_edge_uses_;
-
-  // Blocks to simulate.
-  std::queue<BasicBlock*> blocks_;
-
-  // Blocks simulated during propagation.
-  std::unordered_set<BasicBlock*> simulated_blocks_;
-
-  // Set of instructions that should not be simulated again because they have
-  // been found to be in the kVarying state.
-  std::unordered_set<Instruction*> do_not_simulate_;
-
-  // Map between a basic block and its predecessor edges.
-  // TODO(dnovillo): Move this to CFG and always build them. Alternately,
-  // move it to IRContext and build CFG preds/succs on-demand.
-  std::unordered_map<BasicBlock*, std::vector<Edge>> bb_preds_;
-
-  // Map between a basic block and its successor edges.
-  // TODO(dnovillo): Move this to CFG and always build them. Alternately,
-  // move it to IRContext and build CFG preds/succs on-demand.
-  std::unordered_map<BasicBlock*, std::vector<Edge>> bb_succs_;
-
-  // Set of executable CFG edges.
-  std::set<Edge> executable_edges_;
-
-  // Tracks instruction propagation status.
-  std::unordered_map<Instruction*, SSAPropagator::PropStatus> statuses_;
+  // SSA def-use edge as returned by |def_use_manager_|. Entries before
+  // |ssa_edge_uses_head_| have been processed.
+  std::vector<Instruction*> ssa_edge_uses_;
+  size_t ssa_edge_uses_head_ = 0;
+
+  // Indices of blocks to simulate. Entries before |block_worklist_head_| have
+  // been processed.
+  std::vector<uint32_t> block_worklist_;
+  size_t block_worklist_head_ = 0;
+
+  // Blocks of the function being propagated, by index. The function's blocks
+  // come first, in layout order, followed by the pseudo entry block at
+  // |entry_index_| and the pseudo exit block at |exit_index_|.
+  std::vector<BasicBlock*> blocks_;
+  uint32_t entry_index_ = 0;
+  uint32_t exit_index_ = 0;
+
+  // Maps a label id to 1 + the index of its block, or 0 for labels of other
+  // functions. Only the entries of the current function are non-zero, and
+  // they are cleared at the end of Run().
+  std::vector<uint32_t> block_index_;
+
+  // Successor edges in compressed sparse row form: the edges out of block |i|
+  // go to the blocks in |succs_[succ_begin_[i] .. succ_begin_[i + 1])|.
+  std::vector<uint32_t> succ_begin_;
+  std::vector<uint32_t> succs_;
+
+  // Blocks simulated during propagation, by index.
+  utils::BitVector simulated_blocks_;
+
+  // Executable CFG edges, by position in |succs_|.
+  utils::BitVector executable_edges_;
+
+  // Propagation state of instructions, by unique id. See kStatusMask.
+  std::vector<uint8_t> inst_state_;
+
+  // Unique ids with a non-zero entry in |inst_state_|, so they can be reset
+  // when the propagator is run on another function.
+  std::vector<uint32_t> touched_insts_;
 };
 
 std::ostream& operator<<(std::ostream& str,
@@ -38,13 +38,19 @@ Pass::Status ReduceLoadSize::Process() {
   bool modified = false;
 
   for (auto& func : *get_module()) {
-    func.ForEachInst([&modified, this](Instruction* inst) {
+    if (!context()->IsInFunctionScope(func)) continue;
+    bool func_modified = false;
+    func.ForEachInst([&func_modified, this](Instruction* inst) {
       if (inst->opcode() == SpvOpCompositeExtract) {
         if (ShouldReplaceExtract(inst)) {
-          modified |= ReplaceExtract(inst);
+          func_modified |= ReplaceExtract(inst);
         }
       }
     });
+    if (func_modified) {
+      context()->MarkFunctionChanged(func);
+      modified = true;
+    }
   }
 
   return modified ? Status::SuccessWithChange : Status::SuccessWithoutChange;
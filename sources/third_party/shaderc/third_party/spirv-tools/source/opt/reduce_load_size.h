@@ -40,6 +40,8 @@ class ReduceLoadSize : public Pass {
            IRContext::kAnalysisConstants | IRContext::kAnalysisTypes;
   }
 
+  bool IsFunctionLocal() const override { return true; }
+
  private:
   // Replaces |inst|, which must be an OpCompositeExtract instruction, with
   // an OpAccessChain and a load if possible.  This happens only if it is a load
@@ -24,6 +24,8 @@ Pass::Status RedundancyEliminationPass::Process() {
   ValueNumberTable vnTable(context());
 
   for (auto& func : *get_module()) {
+    if (!context()->IsInFunctionScope(func)) continue;
+
     // Build the dominator tree for this function. It is how the code is
     // traversed.
     DominatorTree& dom_tree =
@@ -35,6 +37,7 @@ Pass::Status RedundancyEliminationPass::Process() {
     std::map<uint32_t, uint32_t> value_to_ids;
 
     if (EliminateRedundanciesFrom(dom_tree.GetRoot(), vnTable, value_to_ids)) {
+      context()->MarkFunctionChanged(func);
       modified = true;
     }
   }
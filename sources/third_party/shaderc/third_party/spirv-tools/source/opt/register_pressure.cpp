@@ -15,6 +15,7 @@
 #include "source/opt/register_pressure.h"
 
 #include <algorithm>
+#include <functional>
 #include <iterator>
 
 #include "source/opt/cfg.h"
@@ -28,22 +29,25 @@ namespace spvtools {
 namespace opt {
 
 namespace {
-// Predicate for the FilterIterator to only consider instructions that are not
-// phi instructions defined in the basic block |bb|.
-class ExcludePhiDefinedInBlock {
- public:
-  ExcludePhiDefinedInBlock(IRContext* context, const BasicBlock* bb)
-      : context_(context), bb_(bb) {}
-
-  bool operator()(Instruction* insn) const {
-    return !(insn->opcode() == SpvOpPhi &&
-             context_->get_instr_block(insn) == bb_);
+using LiveSet = RegisterLiveness::RegionRegisterLiveness::LiveSet;
+
+// Removes from |live| the phi instructions defined in the basic block |bb|.
+void ExcludePhiDefinedInBlock(const RegisterLiveness& liveness,
+                              const BasicBlock* bb, LiveSet* live) {
+  for (auto it = bb->cbegin(); it != bb->cend(); ++it) {
+    if (it->opcode() != SpvOpPhi) break;
+    live->Clear(liveness.GetRegisterIndex(it->result_id()));
   }
+}
 
- private:
-  IRContext* context_;
-  const BasicBlock* bb_;
-};
+// Calls |f| with the instruction defining each register of |live|.
+template <typename Function>
+void ForEachLiveInst(const RegisterLiveness& liveness, const LiveSet& live,
+                     Function f) {
+  live.ForEachSetBit([&liveness, &f](uint32_t index) {
+    f(liveness.GetRegisterDefinition(index));
+  });
+}
 
 // Returns true if |insn| generates a SSA register that is likely to require a
 // physical register.
@@ -63,7 +67,6 @@ class ComputeRegisterLiveness {
  public:
   ComputeRegisterLiveness(RegisterLiveness* reg_pressure, Function* f)
       : reg_pressure_(reg_pressure),
-        context_(reg_pressure->GetContext()),
         function_(f),
         cfg_(*reg_pressure->GetContext()->cfg()),
         def_use_manager_(*reg_pressure->GetContext()->get_def_use_mgr()),
@@ -96,7 +99,7 @@ class ComputeRegisterLiveness {
   // Registers all SSA register used by successors of |bb| in their phi
   // instructions.
   void ComputePhiUses(const BasicBlock& bb,
-                      RegisterLiveness::RegionRegisterLiveness::LiveSet* live) {
+                      LiveSet* live) {
     uint32_t bb_id = bb.id();
     bb.ForEachSuccessorLabel([live, bb_id, this](uint32_t sid) {
       BasicBlock* succ_bb = cfg_.block(sid);
@@ -106,7 +109,7 @@ class ComputeRegisterLiveness {
             Instruction* insn_op =
                 def_use_manager_.GetDef(phi->GetSingleWordInOperand(i));
             if (CreatesRegisterUsage(insn_op)) {
-              live->insert(insn_op);
+              live->Set(reg_pressure_->GetRegisterIndex(insn_op->result_id()));
               break;
             }
           }
@@ -138,24 +141,26 @@ class ComputeRegisterLiveness {
       assert(succ_live_inout &&
              "Successor liveness analysis was not performed");
 
-      ExcludePhiDefinedInBlock predicate(context_, succ_bb);
-      auto filter =
-          MakeFilterIteratorRange(succ_live_inout->live_in_.begin(),
-                                  succ_live_inout->live_in_.end(), predicate);
-      live_inout->live_out_.insert(filter.begin(), filter.end());
+      LiveSet succ_live_in = succ_live_inout->live_in_;
+      ExcludePhiDefinedInBlock(*reg_pressure_, succ_bb, &succ_live_in);
+      live_inout->live_out_.Or(succ_live_in);
     });
 
     live_inout->live_in_ = live_inout->live_out_;
     for (Instruction& insn : make_range(bb->rbegin(), bb->rend())) {
       if (insn.opcode() == SpvOpPhi) {
-        live_inout->live_in_.insert(&insn);
+        live_inout->live_in_.Set(
+            reg_pressure_->GetRegisterIndex(insn.result_id()));
         break;
       }
-      live_inout->live_in_.erase(&insn);
+      if (insn.HasResultId()) {
+        live_inout->live_in_.Clear(
+            reg_pressure_->GetRegisterIndex(insn.result_id()));
+      }
       insn.ForEachInId([live_inout, this](uint32_t* id) {
         Instruction* insn_op = def_use_manager_.GetDef(*id);
         if (CreatesRegisterUsage(insn_op)) {
-          live_inout->live_in_.insert(insn_op);
+          live_inout->live_in_.Set(reg_pressure_->GetRegisterIndex(*id));
         }
       });
     }
@@ -183,25 +188,24 @@ class ComputeRegisterLiveness {
     assert(header_live_inout &&
            "Liveness analysis was not performed for the current block");
 
-    ExcludePhiDefinedInBlock predicate(context_, loop.GetHeaderBlock());
-    auto live_loop =
-        MakeFilterIteratorRange(header_live_inout->live_in_.begin(),
-                                header_live_inout->live_in_.end(), predicate);
+    LiveSet live_loop = header_live_inout->live_in_;
+    ExcludePhiDefinedInBlock(*reg_pressure_, loop.GetHeaderBlock(),
+                             &live_loop);
 
     for (uint32_t bb_id : blocks_in_loop) {
       BasicBlock* bb = cfg_.block(bb_id);
 
       RegisterLiveness::RegionRegisterLiveness* live_inout =
           reg_pressure_->Get(bb);
-      live_inout->live_in_.insert(live_loop.begin(), live_loop.end());
-      live_inout->live_out_.insert(live_loop.begin(), live_loop.end());
+      live_inout->live_in_.Or(live_loop);
+      live_inout->live_out_.Or(live_loop);
     }
 
     for (const Loop* inner_loop : loop) {
       RegisterLiveness::RegionRegisterLiveness* live_inout =
           reg_pressure_->Get(inner_loop->GetHeaderBlock());
-      live_inout->live_in_.insert(live_loop.begin(), live_loop.end());
-      live_inout->live_out_.insert(live_loop.begin(), live_loop.end());
+      live_inout->live_in_.Or(live_loop);
+      live_inout->live_out_.Or(live_loop);
 
       DoLoopLivenessUnification(*inner_loop);
     }
@@ -214,10 +218,11 @@ class ComputeRegisterLiveness {
           reg_pressure_->Get(bb.id());
       assert(live_inout != nullptr && "Basic block not processed");
 
-      size_t reg_count = live_inout->live_out_.size();
-      for (Instruction* insn : live_inout->live_out_) {
-        live_inout->AddRegisterClass(insn);
-      }
+      size_t reg_count = live_inout->live_out_.Count();
+      ForEachLiveInst(*reg_pressure_, live_inout->live_out_,
+                      [live_inout](Instruction* insn) {
+                        live_inout->AddRegisterClass(insn);
+                      });
       live_inout->used_registers_ = reg_count;
 
       std::unordered_set<uint32_t> die_in_block;
@@ -232,7 +237,7 @@ class ComputeRegisterLiveness {
             [live_inout, &die_in_block, &reg_count, this](uint32_t* id) {
               Instruction* op_insn = def_use_manager_.GetDef(*id);
               if (!CreatesRegisterUsage(op_insn) ||
-                  live_inout->live_out_.count(op_insn)) {
+                  reg_pressure_->IsLive(live_inout->live_out_, *id)) {
                 // already taken into account.
                 return;
               }
@@ -252,7 +257,6 @@ class ComputeRegisterLiveness {
   }
 
   RegisterLiveness* reg_pressure_;
-  IRContext* context_;
   Function* function_;
   CFG& cfg_;
   analysis::DefUseManager& def_use_manager_;
@@ -282,12 +286,47 @@ void RegisterLiveness::RegionRegisterLiveness::AddRegisterClass(
 
 void RegisterLiveness::Analyze(Function* f) {
   block_pressure_.clear();
+  NumberRegisters(f);
   ComputeRegisterLiveness(this, f).Compute();
 }
 
+void RegisterLiveness::NumberRegisters(Function* f) {
+  register_indices_.clear();
+  registers_.clear();
+
+  analysis::DefUseManager* def_use_mgr = context_->get_def_use_mgr();
+  f->ForEachParam([this](Instruction* param) { AddRegister(param); });
+  for (BasicBlock& bb : *f) {
+    for (Instruction& insn : bb) {
+      // Operands defined outside of the function, such as global variables,
+      // are registers as well.
+      insn.ForEachInId([this, def_use_mgr](uint32_t* id) {
+        AddRegister(def_use_mgr->GetDef(*id));
+      });
+      AddRegister(&insn);
+    }
+  }
+}
+
+void RegisterLiveness::AddRegister(Instruction* insn) {
+  if (insn == nullptr || !CreatesRegisterUsage(insn)) return;
+  if (register_indices_.emplace(insn->result_id(), GetRegisterCount())
+          .second) {
+    registers_.push_back(insn);
+  }
+}
+
+void RegisterLiveness::ClearRegion(RegionRegisterLiveness* region) const {
+  region->Clear();
+  // BitVector needs a nonzero size.
+  uint32_t size = std::max(GetRegisterCount(), 1u);
+  region->live_in_ = RegionRegisterLiveness::LiveSet(size);
+  region->live_out_ = RegionRegisterLiveness::LiveSet(size);
+}
+
 void RegisterLiveness::ComputeLoopRegisterPressure(
     const Loop& loop, RegionRegisterLiveness* loop_reg_pressure) const {
-  loop_reg_pressure->Clear();
+  ClearRegion(loop_reg_pressure);
 
   const RegionRegisterLiveness* header_live_inout = Get(loop.GetHeaderBlock());
   loop_reg_pressure->live_in_ = header_live_inout->live_in_;
@@ -297,22 +336,23 @@ void RegisterLiveness::ComputeLoopRegisterPressure(
 
   for (uint32_t bb_id : exit_blocks) {
     const RegionRegisterLiveness* live_inout = Get(bb_id);
-    loop_reg_pressure->live_out_.insert(live_inout->live_in_.begin(),
-                                        live_inout->live_in_.end());
+    loop_reg_pressure->live_out_.Or(live_inout->live_in_);
   }
 
   std::unordered_set<uint32_t> seen_insn;
-  for (Instruction* insn : loop_reg_pressure->live_out_) {
-    loop_reg_pressure->AddRegisterClass(insn);
-    seen_insn.insert(insn->result_id());
-  }
-  for (Instruction* insn : loop_reg_pressure->live_in_) {
-    if (!seen_insn.count(insn->result_id())) {
-      continue;
-    }
-    loop_reg_pressure->AddRegisterClass(insn);
-    seen_insn.insert(insn->result_id());
-  }
+  ForEachLiveInst(*this, loop_reg_pressure->live_out_,
+                  [loop_reg_pressure, &seen_insn](Instruction* insn) {
+                    loop_reg_pressure->AddRegisterClass(insn);
+                    seen_insn.insert(insn->result_id());
+                  });
+  ForEachLiveInst(*this, loop_reg_pressure->live_in_,
+                  [loop_reg_pressure, &seen_insn](Instruction* insn) {
+                    if (!seen_insn.count(insn->result_id())) {
+                      return;
+                    }
+                    loop_reg_pressure->AddRegisterClass(insn);
+                    seen_insn.insert(insn->result_id());
+                  });
 
   loop_reg_pressure->used_registers_ = 0;
 
@@ -336,7 +376,7 @@ void RegisterLiveness::ComputeLoopRegisterPressure(
 
 void RegisterLiveness::SimulateFusion(
     const Loop& l1, const Loop& l2, RegionRegisterLiveness* sim_result) const {
-  sim_result->Clear();
+  ClearRegion(sim_result);
 
   // Compute the live-in state:
   //   sim_result.live_in = l1.live_in U l2.live_in
@@ -346,8 +386,7 @@ void RegisterLiveness::SimulateFusion(
   sim_result->live_in_ = l1_header_live_inout->live_in_;
 
   const RegionRegisterLiveness* l2_header_live_inout = Get(l2.GetHeaderBlock());
-  sim_result->live_in_.insert(l2_header_live_inout->live_in_.begin(),
-                              l2_header_live_inout->live_in_.end());
+  sim_result->live_in_.Or(l2_header_live_inout->live_in_);
 
   // The live-out set of the fused loop is the l2 live-out set.
   std::unordered_set<uint32_t> exit_blocks;
@@ -355,23 +394,24 @@ void RegisterLiveness::SimulateFusion(
 
   for (uint32_t bb_id : exit_blocks) {
     const RegionRegisterLiveness* live_inout = Get(bb_id);
-    sim_result->live_out_.insert(live_inout->live_in_.begin(),
-                                 live_inout->live_in_.end());
+    sim_result->live_out_.Or(live_inout->live_in_);
   }
 
   // Compute the register usage information.
   std::unordered_set<uint32_t> seen_insn;
-  for (Instruction* insn : sim_result->live_out_) {
-    sim_result->AddRegisterClass(insn);
-    seen_insn.insert(insn->result_id());
-  }
-  for (Instruction* insn : sim_result->live_in_) {
-    if (!seen_insn.count(insn->result_id())) {
-      continue;
-    }
-    sim_result->AddRegisterClass(insn);
-    seen_insn.insert(insn->result_id());
-  }
+  ForEachLiveInst(*this, sim_result->live_out_,
+                  [sim_result, &seen_insn](Instruction* insn) {
+                    sim_result->AddRegisterClass(insn);
+                    seen_insn.insert(insn->result_id());
+                  });
+  ForEachLiveInst(*this, sim_result->live_in_,
+                  [sim_result, &seen_insn](Instruction* insn) {
+                    if (!seen_insn.count(insn->result_id())) {
+                      return;
+                    }
+                    sim_result->AddRegisterClass(insn);
+                    seen_insn.insert(insn->result_id());
+                  });
 
   sim_result->used_registers_ = 0;
 
@@ -381,14 +421,9 @@ void RegisterLiveness::SimulateFusion(
   // l2 live-in header blocks) into the the live in/out of each basic block of
   // l1 to get the peak register usage. We then repeat the operation to for l2
   // basic blocks but in this case we inject the live-out of the latch of l1.
-  auto live_loop = MakeFilterIteratorRange(
-      sim_result->live_in_.begin(), sim_result->live_in_.end(),
-      [&l1, &l2](Instruction* insn) {
-        BasicBlock* bb = insn->context()->get_instr_block(insn);
-        return insn->HasResultId() &&
-               !(insn->opcode() == SpvOpPhi &&
-                 (bb == l1.GetHeaderBlock() || bb == l2.GetHeaderBlock()));
-      });
+  RegionRegisterLiveness::LiveSet live_loop = sim_result->live_in_;
+  ExcludePhiDefinedInBlock(*this, l1.GetHeaderBlock(), &live_loop);
+  ExcludePhiDefinedInBlock(*this, l2.GetHeaderBlock(), &live_loop);
 
   for (uint32_t bb_id : l1.GetBlocks()) {
     BasicBlock* bb = context_->cfg()->block(bb_id);
@@ -396,11 +431,11 @@ void RegisterLiveness::SimulateFusion(
     const RegionRegisterLiveness* live_inout_info = Get(bb_id);
     assert(live_inout_info != nullptr && "Basic block not processed");
     RegionRegisterLiveness::LiveSet live_out = live_inout_info->live_out_;
-    live_out.insert(live_loop.begin(), live_loop.end());
+    live_out.Or(live_loop);
     sim_result->used_registers_ =
         std::max(sim_result->used_registers_,
-                 live_inout_info->used_registers_ + live_out.size() -
-                     live_inout_info->live_out_.size());
+                 live_inout_info->used_registers_ + live_out.Count() -
+                     live_inout_info->live_out_.Count());
 
     for (Instruction& insn : *bb) {
       if (insn.opcode() == SpvOpPhi || !CreatesRegisterUsage(&insn) ||
@@ -414,12 +449,9 @@ void RegisterLiveness::SimulateFusion(
   const RegionRegisterLiveness* l1_latch_live_inout_info =
       Get(l1.GetLatchBlock()->id());
   assert(l1_latch_live_inout_info != nullptr && "Basic block not processed");
-  RegionRegisterLiveness::LiveSet l1_latch_live_out =
+  RegionRegisterLiveness::LiveSet live_loop_l2 =
       l1_latch_live_inout_info->live_out_;
-  l1_latch_live_out.insert(live_loop.begin(), live_loop.end());
-
-  auto live_loop_l2 =
-      make_range(l1_latch_live_out.begin(), l1_latch_live_out.end());
+  live_loop_l2.Or(live_loop);
 
   for (uint32_t bb_id : l2.GetBlocks()) {
     BasicBlock* bb = context_->cfg()->block(bb_id);
@@ -427,11 +459,11 @@ void RegisterLiveness::SimulateFusion(
     const RegionRegisterLiveness* live_inout_info = Get(bb_id);
     assert(live_inout_info != nullptr && "Basic block not processed");
     RegionRegisterLiveness::LiveSet live_out = live_inout_info->live_out_;
-    live_out.insert(live_loop_l2.begin(), live_loop_l2.end());
+    live_out.Or(live_loop_l2);
     sim_result->used_registers_ =
         std::max(sim_result->used_registers_,
-                 live_inout_info->used_registers_ + live_out.size() -
-                     live_inout_info->live_out_.size());
+                 live_inout_info->used_registers_ + live_out.Count() -
+                     live_inout_info->live_out_.Count());
 
     for (Instruction& insn : *bb) {
       if (insn.opcode() == SpvOpPhi || !CreatesRegisterUsage(&insn) ||
@@ -448,8 +480,8 @@ void RegisterLiveness::SimulateFission(
     const std::unordered_set<Instruction*>& copied_inst,
     RegionRegisterLiveness* l1_sim_result,
     RegionRegisterLiveness* l2_sim_result) const {
-  l1_sim_result->Clear();
-  l2_sim_result->Clear();
+  ClearRegion(l1_sim_result);
+  ClearRegion(l2_sim_result);
 
   // Filter predicates: consider instructions that only belong to the first and
   // second loop.
@@ -461,21 +493,22 @@ void RegisterLiveness::SimulateFission(
     return !moved_inst.count(insn);
   };
 
+  // Adds to |to| the registers of |from| whose definition satisfies |pred|.
+  auto insert_filtered = [this](const RegionRegisterLiveness::LiveSet& from,
+                                const std::function<bool(Instruction*)>& pred,
+                                RegionRegisterLiveness::LiveSet* to) {
+    from.ForEachSetBit([this, &pred, to](uint32_t index) {
+      if (pred(GetRegisterDefinition(index))) to->Set(index);
+    });
+  };
+
   const RegionRegisterLiveness* header_live_inout = Get(loop.GetHeaderBlock());
   // l1 live-in
-  {
-    auto live_loop = MakeFilterIteratorRange(
-        header_live_inout->live_in_.begin(), header_live_inout->live_in_.end(),
-        belong_to_loop1);
-    l1_sim_result->live_in_.insert(live_loop.begin(), live_loop.end());
-  }
+  insert_filtered(header_live_inout->live_in_, belong_to_loop1,
+                  &l1_sim_result->live_in_);
   // l2 live-in
-  {
-    auto live_loop = MakeFilterIteratorRange(
-        header_live_inout->live_in_.begin(), header_live_inout->live_in_.end(),
-        belong_to_loop2);
-    l2_sim_result->live_in_.insert(live_loop.begin(), live_loop.end());
-  }
+  insert_filtered(header_live_inout->live_in_, belong_to_loop2,
+                  &l2_sim_result->live_in_);
 
   std::unordered_set<uint32_t> exit_blocks;
   loop.GetExitBlocks(&exit_blocks);
@@ -483,32 +516,24 @@ void RegisterLiveness::SimulateFission(
   // l2 live-out.
   for (uint32_t bb_id : exit_blocks) {
     const RegionRegisterLiveness* live_inout = Get(bb_id);
-    l2_sim_result->live_out_.insert(live_inout->live_in_.begin(),
-                                    live_inout->live_in_.end());
+    l2_sim_result->live_out_.Or(live_inout->live_in_);
   }
   // l1 live-out.
-  {
-    auto live_out = MakeFilterIteratorRange(l2_sim_result->live_out_.begin(),
-                                            l2_sim_result->live_out_.end(),
-                                            belong_to_loop1);
-    l1_sim_result->live_out_.insert(live_out.begin(), live_out.end());
-  }
-  {
-    auto live_out =
-        MakeFilterIteratorRange(l2_sim_result->live_in_.begin(),
-                                l2_sim_result->live_in_.end(), belong_to_loop1);
-    l1_sim_result->live_out_.insert(live_out.begin(), live_out.end());
-  }
+  insert_filtered(l2_sim_result->live_out_, belong_to_loop1,
+                  &l1_sim_result->live_out_);
+  insert_filtered(l2_sim_result->live_in_, belong_to_loop1,
+                  &l1_sim_result->live_out_);
   // Lives out of l1 are live out of l2 so are live in of l2 as well.
-  l2_sim_result->live_in_.insert(l1_sim_result->live_out_.begin(),
-                                 l1_sim_result->live_out_.end());
+  l2_sim_result->live_in_.Or(l1_sim_result->live_out_);
 
-  for (Instruction* insn : l1_sim_result->live_in_) {
-    l1_sim_result->AddRegisterClass(insn);
-  }
-  for (Instruction* insn : l2_sim_result->live_in_) {
-    l2_sim_result->AddRegisterClass(insn);
-  }
+  ForEachLiveInst(*this, l1_sim_result->live_in_,
+                  [l1_sim_result](Instruction* insn) {
+                    l1_sim_result->AddRegisterClass(insn);
+                  });
+  ForEachLiveInst(*this, l2_sim_result->live_in_,
+                  [l2_sim_result](Instruction* insn) {
+                    l2_sim_result->AddRegisterClass(insn);
+                  });
 
   l1_sim_result->used_registers_ = 0;
   l2_sim_result->used_registers_ = 0;
@@ -518,17 +543,13 @@ void RegisterLiveness::SimulateFission(
 
     const RegisterLiveness::RegionRegisterLiveness* live_inout = Get(bb_id);
     assert(live_inout != nullptr && "Basic block not processed");
-    auto l1_block_live_out =
-        MakeFilterIteratorRange(live_inout->live_out_.begin(),
-                                live_inout->live_out_.end(), belong_to_loop1);
-    auto l2_block_live_out =
-        MakeFilterIteratorRange(live_inout->live_out_.begin(),
-                                live_inout->live_out_.end(), belong_to_loop2);
-
-    size_t l1_reg_count =
-        std::distance(l1_block_live_out.begin(), l1_block_live_out.end());
-    size_t l2_reg_count =
-        std::distance(l2_block_live_out.begin(), l2_block_live_out.end());
+    size_t l1_reg_count = 0;
+    size_t l2_reg_count = 0;
+    ForEachLiveInst(*this, live_inout->live_out_,
+                    [&](Instruction* insn) {
+                      if (belong_to_loop1(insn)) l1_reg_count++;
+                      if (belong_to_loop2(insn)) l2_reg_count++;
+                    });
 
     std::unordered_set<uint32_t> die_in_block;
     for (Instruction& insn : make_range(bb->rbegin(), bb->rend())) {
@@ -543,7 +564,7 @@ void RegisterLiveness::SimulateFission(
                         this](uint32_t* id) {
         Instruction* op_insn = context_->get_def_use_mgr()->GetDef(*id);
         if (!CreatesRegisterUsage(op_insn) ||
-            live_inout->live_out_.count(op_insn)) {
+            IsLive(live_inout->live_out_, *id)) {
           // already taken into account.
           return;
         }
@@ -563,13 +584,13 @@ void RegisterLiveness::SimulateFission(
           std::max(l2_sim_result->used_registers_, l2_reg_count);
       if (CreatesRegisterUsage(&insn)) {
         if (does_belong_to_loop1) {
-          if (!l1_sim_result->live_in_.count(&insn)) {
+          if (!IsLive(l1_sim_result->live_in_, insn.result_id())) {
             l1_sim_result->AddRegisterClass(&insn);
           }
           l1_reg_count--;
         }
         if (does_belong_to_loop2) {
-          if (!l2_sim_result->live_in_.count(&insn)) {
+          if (!IsLive(l2_sim_result->live_in_, insn.result_id())) {
             l2_sim_result->AddRegisterClass(&insn);
           }
           l2_reg_count--;
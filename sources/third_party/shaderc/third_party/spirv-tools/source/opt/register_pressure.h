@@ -22,6 +22,7 @@
 
 #include "source/opt/function.h"
 #include "source/opt/types.h"
+#include "source/util/bit_vector.h"
 
 namespace spvtools {
 namespace opt {
@@ -46,8 +47,14 @@ class RegisterLiveness {
     }
   };
 
+  // Returned by GetRegisterIndex for ids that are not registers of the
+  // function.
+  enum : uint32_t { kNoRegister = 0xFFFFFFFF };
+
   struct RegionRegisterLiveness {
-    using LiveSet = std::unordered_set<Instruction*>;
+    // The live SSA registers, by their index in the function (see
+    // GetRegisterIndex).
+    using LiveSet = utils::BitVector;
     using RegClassSetTy = std::vector<std::pair<RegisterClass, size_t>>;
 
     // SSA register live when entering the basic block.
@@ -61,8 +68,8 @@ class RegisterLiveness {
     RegClassSetTy registers_classes_;
 
     void Clear() {
-      live_out_.clear();
-      live_in_.clear();
+      live_out_.Reset();
+      live_in_.Reset();
       used_registers_ = 0;
       registers_classes_.clear();
     }
@@ -106,6 +113,32 @@ class RegisterLiveness {
 
   IRContext* GetContext() const { return context_; }
 
+  // Returns the index of the register defined by |id| in the live sets, or
+  // kNoRegister if |id| is neither defined nor used as a register in the
+  // function. Registers are numbered densely per function so that the live
+  // sets stay small in large modules.
+  uint32_t GetRegisterIndex(uint32_t id) const {
+    std::unordered_map<uint32_t, uint32_t>::const_iterator it =
+        register_indices_.find(id);
+    return it != register_indices_.end() ? it->second : kNoRegister;
+  }
+
+  // Returns the instruction defining the register at |index|.
+  Instruction* GetRegisterDefinition(uint32_t index) const {
+    return registers_[index];
+  }
+
+  // Returns the number of registers defined or used in the function.
+  uint32_t GetRegisterCount() const {
+    return static_cast<uint32_t>(registers_.size());
+  }
+
+  // Returns true if the register defined by |id| is in |live|.
+  bool IsLive(const RegionRegisterLiveness::LiveSet& live, uint32_t id) const {
+    uint32_t index = GetRegisterIndex(id);
+    return index != kNoRegister && live.Get(index);
+  }
+
   // Returns liveness and register information for the basic block |bb|. If no
   // entry exist for the basic block, the function returns null.
   RegionRegisterLiveness* Get(const BasicBlock* bb) { return Get(bb->id()); }
@@ -123,7 +156,12 @@ class RegisterLiveness {
   // Returns liveness and register information for the basic block id |bb_id| or
   // create a new empty entry if no entry already existed.
   RegionRegisterLiveness* GetOrInsert(uint32_t bb_id) {
-    return &block_pressure_[bb_id];
+    auto it = block_pressure_.find(bb_id);
+    if (it == block_pressure_.end()) {
+      it = block_pressure_.emplace(bb_id, RegionRegisterLiveness{}).first;
+      ClearRegion(&it->second);
+    }
+    return &it->second;
   }
 
   // Compute the register pressure for the |loop| and store the result into
@@ -159,8 +197,21 @@ class RegisterLiveness {
 
   IRContext* context_;
   RegionRegisterLivenessMap block_pressure_;
+  // Maps the result id of each register to its index in the live sets.
+  std::unordered_map<uint32_t, uint32_t> register_indices_;
+  // The instruction defining each register, by index.
+  std::vector<Instruction*> registers_;
 
   void Analyze(Function* f);
+
+  // Numbers the registers defined or used in |f|.
+  void NumberRegisters(Function* f);
+
+  // Gives |insn| the next register index, if it does not have one.
+  void AddRegister(Instruction* insn);
+
+  // Clears |region| and sizes its live sets for the registers of the function.
+  void ClearRegion(RegionRegisterLiveness* region) const;
 };
 
 // Handles the register pressure of a function for different regions (function,
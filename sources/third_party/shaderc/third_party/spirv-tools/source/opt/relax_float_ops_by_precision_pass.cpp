@@ -0,0 +1,517 @@
+// Copyright (c) 2020 Google LLC.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "source/opt/relax_float_ops_by_precision_pass.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <string>
+
+#include "GLSL.std.450.h"
+#include "source/opcode.h"
+#include "source/opt/ir_context.h"
+
+namespace spvtools {
+namespace opt {
+
+namespace {
+
+const uint32_t kEntryPointExecutionModelInIdx = 0;
+const uint32_t kDecorationLocationInIdx = 2;
+const uint32_t kExtInstSetIdInIdx = 0;
+const uint32_t kExtInstInstructionInIdx = 1;
+const uint32_t kExtInstFirstOperandInIdx = 2;
+const uint32_t kStorePointerInIdx = 0;
+const uint32_t kStoreObjectInIdx = 1;
+const uint32_t kAccessChainBaseInIdx = 0;
+const uint32_t kTypeVectorCountInIdx = 1;
+
+const double kInfinity = std::numeric_limits<double>::infinity();
+
+// The largest finite float16 value.
+const double kMaxHalf = 65504.0;
+
+// Rounding to float16 changes a normal value by at most this fraction of it.
+const double kHalfUnitRoundoff = 1.0 / 2048.0;
+
+// Rounding to float16 changes a smaller value by at most half the smallest
+// denormal, or by up to the smallest normal value if it flushes denormals.
+const double kHalfDenormalError = 1.0 / 33554432.0;
+const double kHalfMinNormal = 1.0 / 16384.0;
+
+// Half a step of an 8-bit normalized value: a larger error may change the
+// value written to the target by more than one step.
+const double kUnorm8Tolerance = 0.5 / 255.0;
+
+double Magnitude(double min, double max) {
+  return std::max(std::fabs(min), std::fabs(max));
+}
+
+}  // namespace
+
+Pass::Status RelaxFloatOpsByPrecisionPass::Process() {
+  // Only fragment shaders write to render targets.
+  for (auto& entry : get_module()->entry_points()) {
+    if (entry.GetSingleWordInOperand(kEntryPointExecutionModelInIdx) !=
+        SpvExecutionModelFragment) {
+      return Status::SuccessWithoutChange;
+    }
+  }
+
+  for (auto& inst : get_module()->types_values()) {
+    if (inst.opcode() != SpvOpVariable ||
+        inst.GetSingleWordInOperand(0) != SpvStorageClassOutput) {
+      continue;
+    }
+    get_decoration_mgr()->ForEachDecoration(
+        inst.result_id(), SpvDecorationLocation,
+        [this, &inst](const Instruction& decoration) {
+          if (unorm8_locations_.count(decoration.GetSingleWordInOperand(
+                  kDecorationLocationInIdx))) {
+            unorm8_outputs_.insert(inst.result_id());
+          }
+        });
+  }
+  if (unorm8_outputs_.empty()) return Status::SuccessWithoutChange;
+
+  small_value_error_ =
+      PreservesHalfDenormals() ? kHalfDenormalError : kHalfMinNormal;
+
+  Pass::ProcessFunction pfn = [this](Function* fp) {
+    return ProcessFunction(fp);
+  };
+  bool modified = context()->ProcessEntryPointCallTree(pfn);
+  return modified ? Status::SuccessWithChange : Status::SuccessWithoutChange;
+}
+
+bool RelaxFloatOpsByPrecisionPass::ProcessFunction(Function* func) {
+  std::unordered_set<uint32_t> candidates = FindCandidates(func);
+  RemoveEscapingCandidates(&candidates);
+
+  // Each round computes in float32 the values stored to outputs whose error
+  // is too large.  This can only lower the errors of the other values.
+  while (!candidates.empty()) {
+    ComputeValueInfos(func, candidates);
+    std::vector<uint32_t> failed;
+    func->ForEachInst([this, &candidates, &failed](Instruction* inst) {
+      if (!IsUnorm8OutputStore(inst)) return;
+      uint32_t value_id = inst->GetSingleWordInOperand(kStoreObjectInIdx);
+      if (candidates.count(value_id) &&
+          !(infos_[value_id].error <= kUnorm8Tolerance)) {
+        failed.push_back(value_id);
+      }
+    });
+    if (failed.empty()) break;
+    for (uint32_t id : failed) candidates.erase(id);
+    RemoveEscapingCandidates(&candidates);
+  }
+
+  // Decorate in id order so that the output does not depend on hashing.
+  std::vector<uint32_t> relaxed;
+  for (uint32_t id : candidates) {
+    if (!IsRelaxed(id)) relaxed.push_back(id);
+  }
+  std::sort(relaxed.begin(), relaxed.end());
+  for (uint32_t id : relaxed) {
+    get_decoration_mgr()->AddDecoration(id, SpvDecorationRelaxedPrecision);
+    if (consumer()) {
+      std::string message =
+          "Relaxing " +
+          get_def_use_mgr()->GetDef(id)->PrettyPrint(
+              SPV_BINARY_TO_TEXT_OPTION_FRIENDLY_NAMES) +
+          ", error at most " + std::to_string(infos_[id].error);
+      consumer()(SPV_MSG_INFO, "", {0, 0, 0}, message.c_str());
+    }
+  }
+  return !relaxed.empty();
+}
+
+std::unordered_set<uint32_t> RelaxFloatOpsByPrecisionPass::FindCandidates(
+    Function* func) {
+  std::unordered_set<uint32_t> candidates;
+  func->ForEachInst([this, &candidates](Instruction* inst) {
+    if (inst->result_id() == 0 || !IsFloat32ScalarOrVector(inst->type_id()) ||
+        !IsSupported(inst)) {
+      return;
+    }
+    for (uint32_t id : GetFloatOperands(inst)) {
+      if (!IsFloat32ScalarOrVector(get_def_use_mgr()->GetDef(id)->type_id()))
+        return;
+    }
+    candidates.insert(inst->result_id());
+  });
+  return candidates;
+}
+
+void RelaxFloatOpsByPrecisionPass::RemoveEscapingCandidates(
+    std::unordered_set<uint32_t>* candidates) {
+  bool changed = true;
+  while (changed) {
+    std::vector<uint32_t> escaping;
+    for (uint32_t id : *candidates) {
+      bool escapes = !get_def_use_mgr()->WhileEachUse(
+          id, [this, candidates](Instruction* user, uint32_t index) {
+            if (spvOpcodeIsDecoration(user->opcode()) ||
+                user->opcode() == SpvOpName) {
+              return true;
+            }
+            if (candidates->count(user->result_id())) return true;
+            return IsUnorm8OutputStore(user) &&
+                   index == user->NumOperands() - user->NumInOperands() +
+                                kStoreObjectInIdx;
+          });
+      if (escapes) escaping.push_back(id);
+    }
+    for (uint32_t id : escaping) candidates->erase(id);
+    changed = !escaping.empty();
+  }
+}
+
+void RelaxFloatOpsByPrecisionPass::ComputeValueInfos(
+    Function* func, const std::unordered_set<uint32_t>& candidates) {
+  infos_.clear();
+  // Operands other than phi operands are defined before their uses in
+  // reverse post order, and phis have an unknown range.
+  cfg()->ForEachBlockInReversePostOrder(
+      func->entry().get(), [this, &candidates](BasicBlock* bb) {
+        for (auto& inst : *bb) {
+          if (inst.result_id() == 0 ||
+              !IsFloat32ScalarOrVector(inst.type_id())) {
+            continue;
+          }
+          ValueInfo info = ComputeValueInfo(&inst, candidates);
+          // A value computed in float32 has no error of its own.
+          if (!candidates.count(inst.result_id())) info.error = 0;
+          infos_[inst.result_id()] = info;
+        }
+      });
+}
+
+RelaxFloatOpsByPrecisionPass::ValueInfo
+RelaxFloatOpsByPrecisionPass::ComputeValueInfo(
+    Instruction* inst, const std::unordered_set<uint32_t>& candidates) {
+  const ValueInfo unknown = {-kInfinity, kInfinity, kInfinity};
+  const std::vector<uint32_t> ops_ids = GetFloatOperands(inst);
+  std::vector<ValueInfo> ops;
+  for (uint32_t id : ops_ids) {
+    ops.push_back(GetOperandInfo(id, candidates));
+  }
+
+  switch (inst->opcode()) {
+    case SpvOpFNegate:
+      return MakeInfo(-ops[0].max, -ops[0].min, ops[0].error);
+    case SpvOpFAdd:
+      return Add(ops[0], ops[1]);
+    case SpvOpFSub:
+      return Add(ops[0], MakeInfo(-ops[1].max, -ops[1].min, ops[1].error));
+    case SpvOpFMul:
+    case SpvOpVectorTimesScalar:
+      return Multiply(ops[0], ops[1]);
+    case SpvOpDot: {
+      // The sum of |count| products, each partial sum rounded to float16.
+      Instruction* vector = get_def_use_mgr()->GetDef(ops_ids[0]);
+      Instruction* type = get_def_use_mgr()->GetDef(vector->type_id());
+      double count = type->GetSingleWordInOperand(kTypeVectorCountInIdx);
+      ValueInfo product = Multiply(ops[0], ops[1]);
+      double sum_error =
+          RoundingError(count * (Magnitude(product.min, product.max) +
+                                 product.error));
+      return MakeInfo(count * product.min, count * product.max,
+                      count * product.error + (count - 1) * sum_error);
+    }
+    case SpvOpCopyObject:
+    case SpvOpCompositeExtract:
+      return ops[0];
+    case SpvOpCompositeConstruct:
+    case SpvOpVectorShuffle:
+    case SpvOpSelect:
+      return Hull(ops);
+    case SpvOpExtInst:
+      break;
+    default:
+      return GetConstantInfo(inst);
+  }
+
+  if (inst->GetSingleWordInOperand(kExtInstSetIdInIdx) !=
+      context()->get_feature_mgr()->GetExtInstImportId_GLSLstd450()) {
+    return unknown;
+  }
+  switch (inst->GetSingleWordInOperand(kExtInstInstructionInIdx)) {
+    case GLSLstd450FAbs: {
+      const ValueInfo& x = ops[0];
+      if (x.min >= 0) return x;
+      if (x.max <= 0) return MakeInfo(-x.max, -x.min, x.error);
+      return MakeInfo(0, Magnitude(x.min, x.max), x.error);
+    }
+    case GLSLstd450FMin:
+    case GLSLstd450NMin:
+      return MakeInfo(std::min(ops[0].min, ops[1].min),
+                      std::min(ops[0].max, ops[1].max),
+                      std::max(ops[0].error, ops[1].error));
+    case GLSLstd450FMax:
+    case GLSLstd450NMax:
+      return MakeInfo(std::max(ops[0].min, ops[1].min),
+                      std::max(ops[0].max, ops[1].max),
+                      std::max(ops[0].error, ops[1].error));
+    case GLSLstd450FClamp:
+    case GLSLstd450NClamp: {
+      // The result is undefined if the bounds may cross, in float16 too.
+      const ValueInfo& x = ops[0];
+      const ValueInfo& lo = ops[1];
+      const ValueInfo& hi = ops[2];
+      if (!(lo.max + lo.error <= hi.min - hi.error)) return unknown;
+      return MakeInfo(std::min(std::max(x.min, lo.min), hi.min),
+                      std::min(std::max(x.max, lo.max), hi.max),
+                      std::max({x.error, lo.error, hi.error}));
+    }
+    // The instructions below are never relaxed, but their range is known.
+    case GLSLstd450Sin:
+    case GLSLstd450Cos:
+    case GLSLstd450FSign:
+    case GLSLstd450Normalize:
+      return MakeInfo(-1, 1, kInfinity);
+    case GLSLstd450Fract:
+    case GLSLstd450Step:
+    case GLSLstd450SmoothStep:
+      return MakeInfo(0, 1, kInfinity);
+    case GLSLstd450Sqrt:
+      return MakeInfo(0, std::sqrt(std::max(ops[0].max, 0.0)), kInfinity);
+    case GLSLstd450Floor:
+    case GLSLstd450Ceil:
+      return MakeInfo(std::floor(ops[0].min), std::ceil(ops[0].max),
+                      kInfinity);
+    case GLSLstd450FMix:
+      // A mix of |x| and |y| stays between them if |a| is in [0, 1].
+      if (ops[2].min >= 0 && ops[2].max <= 1) {
+        ValueInfo info = Hull({ops[0], ops[1]});
+        info.error = kInfinity;
+        return info;
+      }
+      return unknown;
+    default:
+      return unknown;
+  }
+}
+
+RelaxFloatOpsByPrecisionPass::ValueInfo
+RelaxFloatOpsByPrecisionPass::GetOperandInfo(
+    uint32_t id, const std::unordered_set<uint32_t>& candidates) {
+  ValueInfo info;
+  auto it = infos_.find(id);
+  if (it != infos_.end()) {
+    info = it->second;
+  } else {
+    info = GetConstantInfo(get_def_use_mgr()->GetDef(id));
+  }
+  // An operand computed in float32 is rounded when converted to float16.
+  if (!candidates.count(id)) {
+    info.error = RoundingError(Magnitude(info.min, info.max));
+  }
+  return info;
+}
+
+RelaxFloatOpsByPrecisionPass::ValueInfo
+RelaxFloatOpsByPrecisionPass::GetConstantInfo(Instruction* inst) {
+  const ValueInfo unknown = {-kInfinity, kInfinity, kInfinity};
+  if (!IsFloat32ScalarOrVector(inst->type_id())) return unknown;
+  const analysis::Constant* constant =
+      context()->get_constant_mgr()->GetConstantFromInst(inst);
+  if (constant == nullptr) return unknown;
+
+  if (constant->AsNullConstant()) return MakeInfo(0, 0, 0);
+  std::vector<const analysis::Constant*> components;
+  if (const auto* composite = constant->AsCompositeConstant()) {
+    components = composite->GetComponents();
+  } else {
+    components.push_back(constant);
+  }
+  double min = kInfinity;
+  double max = -kInfinity;
+  for (const analysis::Constant* component : components) {
+    double value = 0;
+    if (const auto* float_constant = component->AsFloatConstant()) {
+      value = float_constant->GetFloatValue();
+    }
+    min = std::min(min, value);
+    max = std::max(max, value);
+  }
+  return MakeInfo(min, max, 0);
+}
+
+std::vector<uint32_t> RelaxFloatOpsByPrecisionPass::GetFloatOperands(
+    Instruction* inst) {
+  std::vector<uint32_t> operands;
+  uint32_t first = 0;
+  uint32_t count = inst->NumInOperands();
+  switch (inst->opcode()) {
+    case SpvOpExtInst:
+      first = kExtInstFirstOperandInIdx;
+      break;
+    case SpvOpSelect:
+      first = 1;
+      break;
+    case SpvOpCompositeExtract:
+      count = 1;
+      break;
+    case SpvOpVectorShuffle:
+      count = 2;
+      break;
+    default:
+      break;
+  }
+  for (uint32_t i = first; i < count; ++i) {
+    operands.push_back(inst->GetSingleWordInOperand(i));
+  }
+  return operands;
+}
+
+bool RelaxFloatOpsByPrecisionPass::IsSupported(Instruction* inst) {
+  switch (inst->opcode()) {
+    case SpvOpFNegate:
+    case SpvOpFAdd:
+    case SpvOpFSub:
+    case SpvOpFMul:
+    case SpvOpVectorTimesScalar:
+    case SpvOpDot:
+    case SpvOpCompositeExtract:
+    case SpvOpCompositeConstruct:
+    case SpvOpVectorShuffle:
+    case SpvOpCopyObject:
+    case SpvOpSelect:
+      return true;
+    case SpvOpExtInst:
+      break;
+    default:
+      return false;
+  }
+  if (inst->GetSingleWordInOperand(kExtInstSetIdInIdx) !=
+      context()->get_feature_mgr()->GetExtInstImportId_GLSLstd450()) {
+    return false;
+  }
+  switch (inst->GetSingleWordInOperand(kExtInstInstructionInIdx)) {
+    case GLSLstd450FAbs:
+    case GLSLstd450FMin:
+    case GLSLstd450FMax:
+    case GLSLstd450NMin:
+    case GLSLstd450NMax:
+    case GLSLstd450FClamp:
+    case GLSLstd450NClamp:
+      return true;
+    default:
+      return false;
+  }
+}
+
+bool RelaxFloatOpsByPrecisionPass::PreservesHalfDenormals() {
+  for (auto& entry : get_module()->entry_points()) {
+    uint32_t function_id = entry.GetSingleWordInOperand(1);
+    bool preserves = false;
+    for (auto& mode : get_module()->execution_modes()) {
+      if (mode.opcode() == SpvOpExecutionMode &&
+          mode.GetSingleWordInOperand(0) == function_id &&
+          mode.GetSingleWordInOperand(1) == SpvExecutionModeDenormPreserve &&
+          mode.GetSingleWordInOperand(2) == 16) {
+        preserves = true;
+      }
+    }
+    if (!preserves) return false;
+  }
+  return true;
+}
+
+double RelaxFloatOpsByPrecisionPass::RoundingError(double magnitude) const {
+  if (!(magnitude <= kMaxHalf)) return kInfinity;
+  return magnitude * kHalfUnitRoundoff + small_value_error_;
+}
+
+RelaxFloatOpsByPrecisionPass::ValueInfo RelaxFloatOpsByPrecisionPass::Add(
+    const ValueInfo& a, const ValueInfo& b) const {
+  double min = a.min + b.min;
+  double max = a.max + b.max;
+  double error = a.error + b.error;
+  return MakeInfo(min, max,
+                  error + RoundingError(Magnitude(min, max) + error));
+}
+
+RelaxFloatOpsByPrecisionPass::ValueInfo RelaxFloatOpsByPrecisionPass::Multiply(
+    const ValueInfo& a, const ValueInfo& b) const {
+  const auto products = {a.min * b.min, a.min * b.max, a.max * b.min,
+                         a.max * b.max};
+  for (double product : products) {
+    if (std::isnan(product)) return MakeInfo(-kInfinity, kInfinity, kInfinity);
+  }
+  double min = std::min(products);
+  double max = std::max(products);
+  double error = Magnitude(a.min, a.max) * b.error +
+                 Magnitude(b.min, b.max) * a.error + a.error * b.error;
+  return MakeInfo(min, max,
+                  error + RoundingError(Magnitude(min, max) + error));
+}
+
+RelaxFloatOpsByPrecisionPass::ValueInfo RelaxFloatOpsByPrecisionPass::Hull(
+    const std::vector<ValueInfo>& infos) {
+  ValueInfo hull = {kInfinity, -kInfinity, 0};
+  for (const ValueInfo& info : infos) {
+    hull.min = std::min(hull.min, info.min);
+    hull.max = std::max(hull.max, info.max);
+    hull.error = std::max(hull.error, info.error);
+  }
+  return MakeInfo(hull.min, hull.max, hull.error);
+}
+
+RelaxFloatOpsByPrecisionPass::ValueInfo RelaxFloatOpsByPrecisionPass::MakeInfo(
+    double min, double max, double error) {
+  if (std::isnan(min)) min = -kInfinity;
+  if (std::isnan(max)) max = kInfinity;
+  if (std::isnan(error)) error = kInfinity;
+  return {min, max, error};
+}
+
+bool RelaxFloatOpsByPrecisionPass::IsFloat32ScalarOrVector(uint32_t type_id) {
+  if (type_id == 0) return false;
+  Instruction* type = get_def_use_mgr()->GetDef(type_id);
+  if (type->opcode() == SpvOpTypeMatrix) return false;
+  return IsFloat(type_id, 32);
+}
+
+bool RelaxFloatOpsByPrecisionPass::IsUnorm8OutputStore(Instruction* inst) {
+  if (inst->opcode() != SpvOpStore) return false;
+  Instruction* ptr = get_def_use_mgr()->GetDef(
+      inst->GetSingleWordInOperand(kStorePointerInIdx));
+  if (ptr->opcode() != SpvOpAccessChain &&
+      ptr->opcode() != SpvOpInBoundsAccessChain) {
+    return unorm8_outputs_.count(ptr->result_id()) != 0;
+  }
+
+  // An access chain into an array of outputs reaches other Locations, so
+  // only components of a vector output are accepted.
+  Instruction* var = get_def_use_mgr()->GetDef(
+      ptr->GetSingleWordInOperand(kAccessChainBaseInIdx));
+  if (!unorm8_outputs_.count(var->result_id())) return false;
+  Instruction* pointee = get_def_use_mgr()->GetDef(GetPointeeTypeId(var));
+  return pointee->opcode() == SpvOpTypeVector;
+}
+
+bool RelaxFloatOpsByPrecisionPass::IsRelaxed(uint32_t id) {
+  for (auto decoration : get_decoration_mgr()->GetDecorationsFor(id, false)) {
+    if (decoration->opcode() == SpvOpDecorate &&
+        decoration->GetSingleWordInOperand(1) == SpvDecorationRelaxedPrecision)
+      return true;
+  }
+  return false;
+}
+
+}  // namespace opt
+}  // namespace spvtools
@@ -0,0 +1,163 @@
+// Copyright (c) 2020 Google LLC.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SOURCE_OPT_RELAX_FLOAT_OPS_BY_PRECISION_PASS_H_
+#define SOURCE_OPT_RELAX_FLOAT_OPS_BY_PRECISION_PASS_H_
+
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "source/opt/ir_context.h"
+#include "source/opt/pass.h"
+
+namespace spvtools {
+namespace opt {
+
+// Decorates float32 instructions with RelaxedPrecision where an analysis of
+// value ranges and rounding errors proves that computing them in float16
+// hardly changes what a fragment shader writes to 8-bit normalized render
+// targets.  ConvertToHalfPass then turns them into float16 instructions.
+//
+// The pass is given the Locations of the fragment outputs which are written
+// to 8-bit UNORM targets.  It only relaxes instructions all of whose results
+// flow into stores to those outputs through other relaxed instructions:
+// arithmetic, dot products, min, max, clamp, abs, select and composite
+// operations on float32 scalars and vectors.
+//
+// The range of every float value is computed forward from constants and from
+// instructions with a known range, such as clamps, sin or fract; values read
+// from memory or images have an unknown range.  For each relaxed instruction
+// a bound on the absolute difference between its float16 and float32 results
+// is then propagated, counting the float16 rounding of each result and of
+// each operand converted from float32.  An output is only computed in
+// float16 if the bound on the value it stores is at most half a step of the
+// 8-bit target, and no relaxed value can exceed the float16 range.  Outputs
+// whose bound is too large are computed in float32 again, and the analysis
+// is repeated without them.
+//
+// Float16 denormals may be flushed to zero unless every entry point declares
+// the DenormPreserve execution mode for 16-bit floats, and the bounds assume
+// they are.
+//
+// Each relaxed instruction is reported through the message consumer.
+class RelaxFloatOpsByPrecisionPass : public Pass {
+ public:
+  explicit RelaxFloatOpsByPrecisionPass(
+      const std::vector<uint32_t>& unorm8_locations)
+      : unorm8_locations_(unorm8_locations.begin(), unorm8_locations.end()) {}
+
+  const char* name() const override { return "relax-float-ops-by-precision"; }
+  Status Process() override;
+
+  IRContext::Analysis GetPreservedAnalyses() override {
+    return IRContext::kAnalysisDefUse |
+           IRContext::kAnalysisInstrToBlockMapping |
+           IRContext::kAnalysisDecorations | IRContext::kAnalysisCombinators |
+           IRContext::kAnalysisCFG | IRContext::kAnalysisDominatorAnalysis |
+           IRContext::kAnalysisLoopAnalysis | IRContext::kAnalysisNameMap |
+           IRContext::kAnalysisConstants | IRContext::kAnalysisTypes;
+  }
+
+ private:
+  // The range of the float32 values of every component of a value, and a
+  // bound on the absolute error of the value if it is computed in float16.
+  struct ValueInfo {
+    double min;
+    double max;
+    double error;
+  };
+
+  // Relaxes the instructions of |func| which can be computed in float16.
+  // Returns true if |func| was changed.
+  bool ProcessFunction(Function* func);
+
+  // Returns the instructions of |func| which may be relaxed, before taking
+  // errors into account.
+  std::unordered_set<uint32_t> FindCandidates(Function* func);
+
+  // Removes from |candidates| the instructions having a use other than a
+  // candidate or a store to an 8-bit output.
+  void RemoveEscapingCandidates(std::unordered_set<uint32_t>* candidates);
+
+  // Computes |infos_| for the float values of |func|, assuming the
+  // instructions in |candidates| are computed in float16.
+  void ComputeValueInfos(Function* func,
+                         const std::unordered_set<uint32_t>& candidates);
+
+  // Returns the range and error of |inst| computed from its operands.
+  ValueInfo ComputeValueInfo(Instruction* inst,
+                             const std::unordered_set<uint32_t>& candidates);
+
+  // Returns the range of |id| and its error when used by an instruction
+  // computed in float16.
+  ValueInfo GetOperandInfo(uint32_t id,
+                           const std::unordered_set<uint32_t>& candidates);
+
+  // Returns the range of the float constant |inst|, or an unknown range if
+  // |inst| is not one.
+  ValueInfo GetConstantInfo(Instruction* inst);
+
+  // Returns the ids of the float operands of |inst|.
+  std::vector<uint32_t> GetFloatOperands(Instruction* inst);
+
+  // Returns true if |inst| is an instruction the analysis can bound the
+  // float16 error of.
+  bool IsSupported(Instruction* inst);
+
+  // Returns true if every entry point preserves float16 denormals.
+  bool PreservesHalfDenormals();
+
+  // Returns a bound on the error of rounding to float16 a value of at most
+  // |magnitude|, which is infinite if the value may not fit in float16.
+  double RoundingError(double magnitude) const;
+
+  // Returns the range and error of the sum, product and componentwise hull
+  // of values.  The sum and product include the rounding of the result to
+  // float16.
+  ValueInfo Add(const ValueInfo& a, const ValueInfo& b) const;
+  ValueInfo Multiply(const ValueInfo& a, const ValueInfo& b) const;
+  static ValueInfo Hull(const std::vector<ValueInfo>& infos);
+
+  // Returns a ValueInfo, replacing NaN bounds by unknown ones.
+  static ValueInfo MakeInfo(double min, double max, double error);
+
+  // Returns true if the type |type_id| is a float32 scalar or vector.
+  bool IsFloat32ScalarOrVector(uint32_t type_id);
+
+  // Returns true if |inst| stores to an 8-bit output.
+  bool IsUnorm8OutputStore(Instruction* inst);
+
+  // Returns true if |id| is decorated RelaxedPrecision.
+  bool IsRelaxed(uint32_t id);
+
+  // Locations of the outputs written to 8-bit UNORM targets.
+  std::unordered_set<uint32_t> unorm8_locations_;
+
+  // The largest error of rounding a value smaller than the smallest normal
+  // float16 value: half the smallest denormal if denormals are preserved,
+  // and the smallest normal value if they may be flushed to zero.
+  double small_value_error_ = 0;
+
+  // Output variables at |unorm8_locations_|.
+  std::unordered_set<uint32_t> unorm8_outputs_;
+
+  // Range and error of each float value of the current function.
+  std::unordered_map<uint32_t, ValueInfo> infos_;
+};
+
+}  // namespace opt
+}  // namespace spvtools
+
+#endif  // SOURCE_OPT_RELAX_FLOAT_OPS_BY_PRECISION_PASS_H_
@@ -35,11 +35,14 @@ namespace opt {
 Pass::Status ScalarReplacementPass::Process() {
   Status status = Status::SuccessWithoutChange;
   for (auto& f : *get_module()) {
+    if (!context()->IsInFunctionScope(f)) continue;
     Status functionStatus = ProcessFunction(&f);
-    if (functionStatus == Status::Failure)
+    if (functionStatus == Status::Failure) {
       return functionStatus;
-    else if (functionStatus == Status::SuccessWithChange)
+    } else if (functionStatus == Status::SuccessWithChange) {
+      context()->MarkFunctionChanged(f);
       status = functionStatus;
+    }
   }
 
   return status;
@@ -27,7 +27,11 @@ Pass::Status SimplificationPass::Process() {
   bool modified = false;
 
   for (Function& function : *get_module()) {
-    modified |= SimplifyFunction(&function);
+    if (!context()->IsInFunctionScope(function)) continue;
+    if (SimplifyFunction(&function)) {
+      context()->MarkFunctionChanged(function);
+      modified = true;
+    }
   }
   return (modified ? Status::SuccessWithChange : Status::SuccessWithoutChange);
 }
@@ -622,8 +622,12 @@ Pass::Status SSARewriter::RewriteFunctionIntoSSA(Function* fp) {
 Pass::Status SSARewritePass::Process() {
   Status status = Status::SuccessWithoutChange;
   for (auto& fn : *get_module()) {
-    status =
-        CombineStatus(status, SSARewriter(this).RewriteFunctionIntoSSA(&fn));
+    if (!context()->IsInFunctionScope(fn)) continue;
+    Status fn_status = SSARewriter(this).RewriteFunctionIntoSSA(&fn);
+    if (fn_status == Status::SuccessWithChange) {
+      context()->MarkFunctionChanged(fn);
+    }
+    status = CombineStatus(status, fn_status);
     // Kill DebugDeclares for target variables.
     for (auto var_id : seen_target_vars_) {
       context()->get_debug_info_mgr()->KillDebugDeclares(var_id);
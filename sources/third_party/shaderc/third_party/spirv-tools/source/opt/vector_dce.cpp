@@ -29,7 +29,11 @@ const uint32_t kInsertCompositeIdInIdx = 1;
 Pass::Status VectorDCE::Process() {
   bool modified = false;
   for (Function& function : *get_module()) {
-    modified |= VectorDCEFunction(&function);
+    if (!context()->IsInFunctionScope(function)) continue;
+    if (VectorDCEFunction(&function)) {
+      context()->MarkFunctionChanged(function);
+      modified = true;
+    }
   }
   return (modified ? Status::SuccessWithChange : Status::SuccessWithoutChange);
 }
@@ -57,6 +57,8 @@ class VectorDCE : public MemPass {
            IRContext::kAnalysisConstants | IRContext::kAnalysisTypes;
   }
 
+  bool IsFunctionLocal() const override { return true; }
+
  private:
   // Runs the vector dce pass on |function|.  Returns true if |function| was
   // modified.
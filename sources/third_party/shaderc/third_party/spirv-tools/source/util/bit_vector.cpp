@@ -14,23 +14,31 @@
 
 #include "source/util/bit_vector.h"
 
+#include <algorithm>
 #include <cassert>
 #include <iostream>
 
 namespace spvtools {
 namespace utils {
 
-void BitVector::ReportDensity(std::ostream& out) {
-  uint32_t count = 0;
+namespace {
 
-  for (BitContainer e : bits_) {
-    while (e != 0) {
-      if ((e & 1) != 0) {
-        ++count;
-      }
-      e = e >> 1;
-    }
-  }
+// Returns the number of 1 bits in |b|.
+uint32_t CountBits(uint64_t b) {
+#if defined(__GNUC__) || defined(__clang__)
+  return static_cast<uint32_t>(__builtin_popcountll(b));
+#else
+  b = b - ((b >> 1) & 0x5555555555555555ull);
+  b = (b & 0x3333333333333333ull) + ((b >> 2) & 0x3333333333333333ull);
+  b = (b + (b >> 4)) & 0x0f0f0f0f0f0f0f0full;
+  return static_cast<uint32_t>((b * 0x0101010101010101ull) >> 56);
+#endif
+}
+
+}  // namespace
+
+void BitVector::ReportDensity(std::ostream& out) {
+  uint32_t count = Count();
 
   out << "count=" << count
       << ", total size (bytes)=" << bits_.size() * sizeof(BitContainer)
@@ -38,27 +46,87 @@ void BitVector::ReportDensity(std::ostream& out) {
       << (double)(bits_.size() * sizeof(BitContainer)) / (double)(count);
 }
 
+uint32_t BitVector::Count() const {
+  uint32_t count = 0;
+  for (BitContainer e : bits_) {
+    count += CountBits(e);
+  }
+  return count;
+}
+
+// The bulk operations below accumulate the changed bits instead of branching
+// on each element, so that the loops can be vectorized.
+
 bool BitVector::Or(const BitVector& other) {
-  auto this_it = this->bits_.begin();
-  auto other_it = other.bits_.begin();
-  bool modified = false;
-
-  while (this_it != this->bits_.end() && other_it != other.bits_.end()) {
-    auto temp = *this_it | *other_it;
-    if (temp != *this_it) {
-      modified = true;
-      *this_it = temp;
-    }
-    ++this_it;
-    ++other_it;
+  size_t common_size = std::min(bits_.size(), other.bits_.size());
+  BitContainer changed = 0;
+  for (size_t i = 0; i < common_size; ++i) {
+    BitContainer temp = bits_[i] | other.bits_[i];
+    changed |= temp ^ bits_[i];
+    bits_[i] = temp;
   }
 
-  if (other_it != other.bits_.end()) {
-    modified = true;
-    this->bits_.insert(this->bits_.end(), other_it, other.bits_.end());
+  for (size_t i = common_size; i < other.bits_.size(); ++i) {
+    changed |= other.bits_[i];
+  }
+  if (other.bits_.size() > bits_.size()) {
+    bits_.insert(bits_.end(), other.bits_.begin() + common_size,
+                 other.bits_.end());
   }
 
-  return modified;
+  return changed != 0;
+}
+
+bool BitVector::And(const BitVector& other) {
+  size_t common_size = std::min(bits_.size(), other.bits_.size());
+  BitContainer changed = 0;
+  for (size_t i = 0; i < common_size; ++i) {
+    BitContainer temp = bits_[i] & other.bits_[i];
+    changed |= temp ^ bits_[i];
+    bits_[i] = temp;
+  }
+
+  for (size_t i = common_size; i < bits_.size(); ++i) {
+    changed |= bits_[i];
+    bits_[i] = 0;
+  }
+
+  return changed != 0;
+}
+
+bool BitVector::AndNot(const BitVector& other) {
+  size_t common_size = std::min(bits_.size(), other.bits_.size());
+  BitContainer changed = 0;
+  for (size_t i = 0; i < common_size; ++i) {
+    BitContainer temp = bits_[i] & ~other.bits_[i];
+    changed |= temp ^ bits_[i];
+    bits_[i] = temp;
+  }
+  return changed != 0;
+}
+
+bool BitVector::Intersects(const BitVector& other) const {
+  size_t common_size = std::min(bits_.size(), other.bits_.size());
+  BitContainer common = 0;
+  for (size_t i = 0; i < common_size; ++i) {
+    common |= bits_[i] & other.bits_[i];
+  }
+  return common != 0;
+}
+
+bool BitVector::operator==(const BitVector& other) const {
+  size_t common_size = std::min(bits_.size(), other.bits_.size());
+  BitContainer difference = 0;
+  for (size_t i = 0; i < common_size; ++i) {
+    difference |= bits_[i] ^ other.bits_[i];
+  }
+
+  const std::vector<BitContainer>& longer =
+      bits_.size() > other.bits_.size() ? bits_ : other.bits_;
+  for (size_t i = common_size; i < longer.size(); ++i) {
+    difference |= longer[i];
+  }
+  return difference == 0;
 }
 
 std::ostream& operator<<(std::ostream& out, const BitVector& bv) {
@@ -19,6 +19,10 @@
 #include <iosfwd>
 #include <vector>
 
+#if defined(_MSC_VER) && defined(_M_X64)
+#include <intrin.h>
+#endif
+
 namespace spvtools {
 namespace utils {
 
@@ -32,6 +36,9 @@ class BitVector {
   enum { kInitialNumBits = 1024 };
 
  public:
+  // Returned by FindNextSet when there is no set bit left.
+  enum : uint32_t { kNoSetBit = 0xFFFFFFFF };
+
   // Creates a bit vector contianing 0s.
   BitVector(uint32_t reserved_size = kInitialNumBits)
       : bits_((reserved_size - 1) / kBitContainerSize + 1, 0) {}
@@ -99,6 +106,48 @@ class BitVector {
     return true;
   }
 
+  // Sets every bit to 0, keeping the storage.
+  void Reset() {
+    for (BitContainer& b : bits_) {
+      b = 0;
+    }
+  }
+
+  // Returns the number of bits that are 1.
+  uint32_t Count() const;
+
+  // Returns the index of the first bit that is 1 at or after |i|, or
+  // kNoSetBit if there is none.
+  uint32_t FindNextSet(uint32_t i) const {
+    uint32_t element_index = i / kBitContainerSize;
+    if (element_index >= bits_.size()) {
+      return kNoSetBit;
+    }
+
+    BitContainer b = bits_[element_index] &
+                     (~static_cast<BitContainer>(0) << (i % kBitContainerSize));
+    while (b == 0) {
+      if (++element_index == bits_.size()) {
+        return kNoSetBit;
+      }
+      b = bits_[element_index];
+    }
+    return element_index * kBitContainerSize + CountTrailingZeros(b);
+  }
+
+  // Calls |f| with the index of each bit that is 1, in increasing order.  |f|
+  // may clear the bit it is called with, and any bit before it.
+  template <typename Function>
+  void ForEachSetBit(Function f) const {
+    for (uint32_t i = 0; i < bits_.size(); ++i) {
+      BitContainer b = bits_[i];
+      while (b != 0) {
+        f(i * kBitContainerSize + CountTrailingZeros(b));
+        b &= b - 1;
+      }
+    }
+  }
+
   // Print a report on the densicy of the bit vector, number of 1 bits, number
   // of bytes, and average bytes for 1 bit, to |out|.
   void ReportDensity(std::ostream& out);
@@ -109,7 +158,41 @@ class BitVector {
   // |this|.  Return true if |this| changed.
   bool Or(const BitVector& that);
 
+  // Performs a bitwise-and operation on |this| and |that|, storing the result
+  // in |this|.  Return true if |this| changed.
+  bool And(const BitVector& that);
+
+  // Clears in |this| every bit that is 1 in |that|.  Return true if |this|
+  // changed.
+  bool AndNot(const BitVector& that);
+
+  // Returns true if a bit is 1 in both |this| and |that|.
+  bool Intersects(const BitVector& that) const;
+
+  // Two bit vectors are equal if they have the same bits set, whatever their
+  // reserved sizes.
+  bool operator==(const BitVector& that) const;
+  bool operator!=(const BitVector& that) const { return !(*this == that); }
+
  private:
+  // Returns the index of the lowest 1 bit in |b|, which must not be 0.
+  static uint32_t CountTrailingZeros(BitContainer b) {
+#if defined(__GNUC__) || defined(__clang__)
+    return static_cast<uint32_t>(__builtin_ctzll(b));
+#elif defined(_MSC_VER) && defined(_M_X64)
+    unsigned long index;
+    _BitScanForward64(&index, b);
+    return static_cast<uint32_t>(index);
+#else
+    uint32_t count = 0;
+    while ((b & 1) == 0) {
+      b >>= 1;
+      ++count;
+    }
+    return count;
+#endif
+  }
+
   std::vector<BitContainer> bits_;
 };
 
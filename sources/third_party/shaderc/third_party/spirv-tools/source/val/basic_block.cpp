@@ -25,6 +25,8 @@ BasicBlock::BasicBlock(uint32_t label_id)
     : id_(label_id),
       immediate_dominator_(nullptr),
       immediate_post_dominator_(nullptr),
+      dominator_interval_{nullptr, 0, 0},
+      post_dominator_interval_{nullptr, 0, 0},
       predecessors_(),
       successors_(),
       type_(0),
@@ -34,10 +36,22 @@ BasicBlock::BasicBlock(uint32_t label_id)
 
 void BasicBlock::SetImmediateDominator(BasicBlock* dom_block) {
   immediate_dominator_ = dom_block;
+  dominator_interval_ = {nullptr, 0, 0};
 }
 
 void BasicBlock::SetImmediatePostDominator(BasicBlock* pdom_block) {
   immediate_post_dominator_ = pdom_block;
+  post_dominator_interval_ = {nullptr, 0, 0};
+}
+
+void BasicBlock::SetDominatorInterval(const BasicBlock* root, uint32_t pre,
+                                      uint32_t post) {
+  dominator_interval_ = {root, pre, post};
+}
+
+void BasicBlock::SetPostDominatorInterval(const BasicBlock* root,
+                                          uint32_t pre, uint32_t post) {
+  post_dominator_interval_ = {root, pre, post};
 }
 
 const BasicBlock* BasicBlock::immediate_dominator() const {
@@ -62,12 +76,19 @@ void BasicBlock::RegisterSuccessors(
 }
 
 bool BasicBlock::dominates(const BasicBlock& other) const {
+  if (dominator_interval_.is_set() && other.dominator_interval_.is_set()) {
+    return dominator_interval_.contains(other.dominator_interval_);
+  }
   return (this == &other) ||
          !(other.dom_end() ==
            std::find(other.dom_begin(), other.dom_end(), this));
 }
 
 bool BasicBlock::postdominates(const BasicBlock& other) const {
+  if (post_dominator_interval_.is_set() &&
+      other.post_dominator_interval_.is_set()) {
+    return post_dominator_interval_.contains(other.post_dominator_interval_);
+  }
   return (this == &other) ||
          !(other.pdom_end() ==
            std::find(other.pdom_begin(), other.pdom_end(), this));
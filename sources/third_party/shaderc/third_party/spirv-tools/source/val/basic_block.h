@@ -106,6 +106,20 @@ class BasicBlock {
   /// Returns the immedate post dominator of this basic block
   const BasicBlock* immediate_post_dominator() const;
 
+  /// Records the position of this block in a depth first numbering of the
+  /// dominator tree, which lets dominates() answer in constant time.
+  /// Setting the immediate dominator discards it.
+  ///
+  /// @param[in] root The root of the tree containing this block
+  /// @param[in] pre  The number given to this block before its children
+  /// @param[in] post The number given to this block after its children
+  void SetDominatorInterval(const BasicBlock* root, uint32_t pre,
+                            uint32_t post);
+
+  /// Like SetDominatorInterval, for the post dominator tree.
+  void SetPostDominatorInterval(const BasicBlock* root, uint32_t pre,
+                                uint32_t post);
+
   /// Returns the label instruction for the block, or nullptr if not set.
   const Instruction* label() const { return label_; }
 
@@ -129,11 +143,14 @@ class BasicBlock {
   bool operator==(const uint32_t& other_id) const { return other_id == id_; }
 
   /// Returns true if this block dominates the other block.
-  /// Assumes dominators have been computed.
+  /// Assumes dominators have been computed.  Takes constant time if the
+  /// dominator intervals of both blocks are set, and walks the dominator
+  /// chain of the other block otherwise.
   bool dominates(const BasicBlock& other) const;
 
   /// Returns true if this block postdominates the other block.
-  /// Assumes dominators have been computed.
+  /// Assumes dominators have been computed.  Takes constant time if the
+  /// post dominator intervals of both blocks are set.
   bool postdominates(const BasicBlock& other) const;
 
   /// @brief A BasicBlock dominator iterator class
@@ -200,6 +217,26 @@ class BasicBlock {
   DominatorIterator pdom_end();
 
  private:
+  /// The position of a block in a depth first numbering of a (post)dominator
+  /// tree.  A block is an ancestor of another if the interval [pre, post] of
+  /// the block contains the interval of the other.
+  struct TreeInterval {
+    /// Returns true if the interval has been set
+    bool is_set() const { return root != nullptr; }
+
+    /// Returns true if this interval contains @p other.  Blocks of different
+    /// trees, including trees of different functions, never contain each
+    /// other.
+    bool contains(const TreeInterval& other) const {
+      return root == other.root && pre <= other.pre && other.post <= post;
+    }
+
+    /// The root of the tree, or nullptr if the interval is not set
+    const BasicBlock* root;
+    uint32_t pre;
+    uint32_t post;
+  };
+
   /// Id of the BasicBlock
   const uint32_t id_;
 
@@ -209,6 +246,12 @@ class BasicBlock {
   /// Pointer to the immediate dominator of the BasicBlock
   BasicBlock* immediate_post_dominator_;
 
+  /// Position of the BasicBlock in the dominator tree
+  TreeInterval dominator_interval_;
+
+  /// Position of the BasicBlock in the post dominator tree
+  TreeInterval post_dominator_interval_;
+
   /// The set of predecessors of the BasicBlock
   std::vector<BasicBlock*> predecessors_;
 
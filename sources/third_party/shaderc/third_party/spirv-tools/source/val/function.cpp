@@ -32,6 +32,58 @@ namespace val {
 // Universal Limit of ResultID + 1
 static const uint32_t kInvalidId = 0x400000;
 
+namespace {
+
+// Numbers the forest in which the parent of each of |blocks| is
+// |parent(block)|, or which is a root if that is null or the block itself.
+// Calls |set_interval| with each block, the root of its tree and the numbers
+// the block was given before and after its descendants.
+void NumberTree(
+    const std::vector<BasicBlock*>& blocks,
+    const std::function<BasicBlock*(BasicBlock*)>& parent,
+    const std::function<void(BasicBlock*, const BasicBlock*, uint32_t,
+                             uint32_t)>& set_interval) {
+  std::unordered_map<const BasicBlock*, std::vector<BasicBlock*>> children;
+  std::vector<BasicBlock*> roots;
+  for (BasicBlock* block : blocks) {
+    BasicBlock* p = parent(block);
+    if (p == nullptr || p == block) {
+      roots.push_back(block);
+    } else {
+      children[p].push_back(block);
+    }
+  }
+
+  // A block being visited, with its preorder number and the index of the
+  // next child to visit.
+  struct Frame {
+    BasicBlock* block;
+    uint32_t pre;
+    size_t next_child;
+  };
+  static const std::vector<BasicBlock*> kNoChildren;
+  uint32_t number = 0;
+  std::vector<Frame> stack;
+  for (BasicBlock* root : roots) {
+    stack.push_back({root, ++number, 0});
+    while (!stack.empty()) {
+      Frame& frame = stack.back();
+      auto where = children.find(frame.block);
+      const auto& block_children =
+          where == children.end() ? kNoChildren : where->second;
+      if (frame.next_child < block_children.size()) {
+        BasicBlock* child = block_children[frame.next_child++];
+        stack.push_back({child, ++number, 0});
+      } else {
+        set_interval(frame.block, root, frame.pre, ++number);
+        stack.pop_back();
+      }
+    }
+  }
+}
+
+}  // namespace
+
 Function::Function(uint32_t function_id, uint32_t result_type_id,
                    SpvFunctionControlMask function_control,
                    uint32_t function_type_id)
@@ -298,6 +350,22 @@ Construct& Function::FindConstructForEntryBlock(const BasicBlock* entry_block,
   return *construct_ptr;
 }
 
+void Function::ComputeDominatorIntervals() {
+  std::vector<BasicBlock*> blocks(ordered_blocks_);
+  blocks.push_back(&pseudo_entry_block_);
+  blocks.push_back(&pseudo_exit_block_);
+  NumberTree(
+      blocks, [](BasicBlock* b) { return b->immediate_dominator(); },
+      [](BasicBlock* b, const BasicBlock* root, uint32_t pre, uint32_t post) {
+        b->SetDominatorInterval(root, pre, post);
+      });
+  NumberTree(
+      blocks, [](BasicBlock* b) { return b->immediate_post_dominator(); },
+      [](BasicBlock* b, const BasicBlock* root, uint32_t pre, uint32_t post) {
+        b->SetPostDominatorInterval(root, pre, post);
+      });
+}
+
 int Function::GetBlockDepth(BasicBlock* bb) {
   // Guard against nullptr.
   if (!bb) {
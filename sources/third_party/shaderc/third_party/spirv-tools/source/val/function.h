@@ -191,6 +191,11 @@ class Function {
   /// Returns the block predecessors function for the augmented CFG.
   GetBlocksFunction AugmentedCFGPredecessorsFunction() const;
 
+  /// Numbers the dominator and post dominator trees of the function so that
+  /// BasicBlock::dominates and BasicBlock::postdominates take constant time.
+  /// Must be called again whenever the immediate (post)dominators change.
+  void ComputeDominatorIntervals();
+
   /// Returns the control flow nesting depth of the given basic block.
   /// This function only works when you have structured control flow.
   /// This function should only be called after the control flow constructs have
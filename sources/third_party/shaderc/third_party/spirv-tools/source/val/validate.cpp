@@ -94,6 +94,32 @@ spv_result_t ProcessInstruction(void* user_data,
   return SPV_SUCCESS;
 }
 
+// Callbacks receiving the validator's parse of the module in addition to the
+// validation state. See ValidateBinaryAndForwardParse().
+struct ParseForwarder {
+  ValidationState_t* vstate;
+  void* user_data;
+  spv_parsed_header_fn_t parsed_header;
+  spv_parsed_instruction_fn_t parsed_instruction;
+};
+
+spv_result_t ForwardHeader(void* user_data, spv_endianness_t endian,
+                           uint32_t magic, uint32_t version, uint32_t generator,
+                           uint32_t id_bound, uint32_t reserved) {
+  auto* forwarder = reinterpret_cast<ParseForwarder*>(user_data);
+  if (!forwarder->parsed_header) return SPV_SUCCESS;
+  return forwarder->parsed_header(forwarder->user_data, endian, magic, version,
+                                  generator, id_bound, reserved);
+}
+
+spv_result_t ProcessAndForwardInstruction(
+    void* user_data, const spv_parsed_instruction_t* inst) {
+  auto* forwarder = reinterpret_cast<ParseForwarder*>(user_data);
+  if (auto error = ProcessInstruction(forwarder->vstate, inst)) return error;
+  if (!forwarder->parsed_instruction) return SPV_SUCCESS;
+  return forwarder->parsed_instruction(forwarder->user_data, inst);
+}
+
 spv_result_t ValidateForwardDecls(ValidationState_t& _) {
   if (_.unresolved_forward_id_count() == 0) return SPV_SUCCESS;
 
@@ -211,7 +237,8 @@ spv_result_t ValidateEntryPoints(ValidationState_t& _) {
 
 spv_result_t ValidateBinaryUsingContextAndValidationState(
     const spv_context_t& context, const uint32_t* words, const size_t num_words,
-    spv_diagnostic* pDiagnostic, ValidationState_t* vstate) {
+    spv_diagnostic* pDiagnostic, ValidationState_t* vstate,
+    ParseForwarder* forwarder = nullptr) {
   auto binary = std::unique_ptr<spv_const_binary_t>(
       new spv_const_binary_t{words, num_words});
 
@@ -266,9 +293,15 @@ spv_result_t ValidateBinaryUsingContextAndValidationState(
 
   // Parse the module and perform inline validation checks. These checks do
   // not require the the knowledge of the whole module.
-  if (auto error = spvBinaryParse(&context, vstate, words, num_words,
-                                  /*parsed_header =*/nullptr,
-                                  ProcessInstruction, pDiagnostic)) {
+  if (forwarder) {
+    if (auto error = spvBinaryParse(&context, forwarder, words, num_words,
+                                    ForwardHeader, ProcessAndForwardInstruction,
+                                    pDiagnostic)) {
+      return error;
+    }
+  } else if (auto error = spvBinaryParse(&context, vstate, words, num_words,
+                                         /*parsed_header =*/nullptr,
+                                         ProcessInstruction, pDiagnostic)) {
     return error;
   }
 
@@ -462,6 +495,26 @@ spv_result_t ValidateBinaryAndKeepValidationState(
       hijack_context, words, num_words, pDiagnostic, vstate->get());
 }
 
+spv_result_t ValidateBinaryAndForwardParse(
+    const spv_const_context context, spv_const_validator_options options,
+    const uint32_t* words, const size_t num_words, spv_diagnostic* pDiagnostic,
+    void* user_data, spv_parsed_header_fn_t parsed_header,
+    spv_parsed_instruction_fn_t parsed_instruction) {
+  spv_context_t hijack_context = *context;
+  if (pDiagnostic) {
+    *pDiagnostic = nullptr;
+    UseDiagnosticAsMessageConsumer(&hijack_context, pDiagnostic);
+  }
+
+  ValidationState_t vstate(&hijack_context, options, words, num_words,
+                           kDefaultMaxNumOfWarnings);
+  ParseForwarder forwarder = {&vstate, user_data, parsed_header,
+                              parsed_instruction};
+
+  return ValidateBinaryUsingContextAndValidationState(
+      hijack_context, words, num_words, pDiagnostic, &vstate, &forwarder);
+}
+
 }  // namespace val
 }  // namespace spvtools
 
@@ -236,6 +236,17 @@ spv_result_t ValidateBinaryAndKeepValidationState(
     const uint32_t* words, const size_t num_words, spv_diagnostic* pDiagnostic,
     std::unique_ptr<ValidationState_t>* vstate);
 
+// Performs validation for the SPIR-V module binary, and forwards the header
+// and every instruction of the validator's parse to |parsed_header| and
+// |parsed_instruction| with |user_data|. This lets a caller build its own
+// representation of a module it validates without parsing it a second time.
+// An error returned by a forwarded callback stops validation and is returned.
+spv_result_t ValidateBinaryAndForwardParse(
+    const spv_const_context context, spv_const_validator_options options,
+    const uint32_t* words, const size_t num_words, spv_diagnostic* pDiagnostic,
+    void* user_data, spv_parsed_header_fn_t parsed_header,
+    spv_parsed_instruction_fn_t parsed_instruction);
+
 }  // namespace val
 }  // namespace spvtools
 
@@ -16,10 +16,8 @@
 
 #include "source/val/validate.h"
 
+#include <algorithm>
 #include <functional>
-#include <list>
-#include <map>
-#include <set>
 #include <sstream>
 #include <stack>
 #include <string>
@@ -386,6 +384,7 @@ class BuiltInsValidator {
   // Validates that |built_in_inst| is not (even indirectly) referenced from
   // within a function which can be called with |execution_model|.
   //
+  // |vuid| - Vulkan error id of the restriction, or 0 if it has none.
   // |comment| - text explaining why the restriction was imposed.
   // |decoration| - BuiltIn decoration which causes the restriction.
   // |referenced_inst| - instruction which is dependent on |built_in_inst| and
@@ -393,7 +392,7 @@ class BuiltInsValidator {
   // |referenced_from_inst| - instruction which references id defined by
   //                          |referenced_inst| from within a function.
   spv_result_t ValidateNotCalledWithExecutionModel(
-      std::string comment, SpvExecutionModel execution_model,
+      uint32_t vuid, const char* comment, SpvExecutionModel execution_model,
       const Decoration& decoration, const Instruction& built_in_inst,
       const Instruction& referenced_inst,
       const Instruction& referenced_from_inst);
@@ -479,14 +478,57 @@ class BuiltInsValidator {
   // instruction.
   void Update(const Instruction& inst);
 
+  // The signature shared by the ValidateXYZAtReference functions.
+  using AtReferenceFunction = spv_result_t (BuiltInsValidator::*)(
+      const Decoration& decoration, const Instruction& built_in_inst,
+      const Instruction& referenced_inst,
+      const Instruction& referenced_from_inst);
+
+  // A rule validating the instructions which reference an id dependent on a
+  // built-in.  It only points into the module, so creating and propagating
+  // rules does not allocate.
+  struct AtReferenceCheck {
+    // The ValidateXYZAtReference function to call, or nullptr to call
+    // ValidateNotCalledWithExecutionModel.
+    AtReferenceFunction validate;
+    const Decoration* decoration;
+    const Instruction* built_in_inst;
+    const Instruction* referenced_inst;
+    // Arguments of ValidateNotCalledWithExecutionModel.
+    uint32_t vuid;
+    const char* comment;
+    SpvExecutionModel execution_model;
+  };
+
+  // Registers |validate| to be called for every instruction referencing the
+  // id defined by |referenced_inst|.
+  void AddAtReferenceCheck(AtReferenceFunction validate,
+                           const Decoration& decoration,
+                           const Instruction& built_in_inst,
+                           const Instruction& referenced_inst);
+
+  // Registers ValidateNotCalledWithExecutionModel to be called for every
+  // instruction referencing the id defined by |referenced_inst|.
+  void AddNotCalledWithExecutionModelCheck(uint32_t vuid, const char* comment,
+                                           SpvExecutionModel execution_model,
+                                           const Decoration& decoration,
+                                           const Instruction& built_in_inst,
+                                           const Instruction& referenced_inst);
+
+  // Adds |check| to the rules of the id defined by |referenced_inst|.
+  void AddCheck(const Instruction& referenced_inst,
+                const AtReferenceCheck& check);
+
   ValidationState_t& _;
 
-  // Mapping id -> list of rules which validate instruction referencing the
-  // id. Rules can create new rules and add them to this container.
-  // Using std::map, and not std::unordered_map to avoid iterator invalidation
-  // during rehashing.
-  std::map<uint32_t, std::list<std::function<spv_result_t(const Instruction&)>>>
-      id_to_at_reference_checks_;
+  // Mapping id -> rules which validate instructions referencing the id.
+  // Rules can create new rules for the id of the instruction they validate,
+  // which is never the id being checked.  Empty until the first rule is
+  // added, then indexed by id.
+  std::vector<std::vector<AtReferenceCheck>> id_to_at_reference_checks_;
+
+  // The ids already checked for the current instruction.
+  std::vector<uint32_t> checked_ids_;
 
   // Id of the function we are currently inside. 0 if not inside a function.
   uint32_t function_id_ = 0;
@@ -497,25 +539,65 @@ class BuiltInsValidator {
   const std::vector<uint32_t> no_entry_points;
   const std::vector<uint32_t>* entry_points_ = &no_entry_points;
 
-  // Execution models with which the current function can be called.
-  std::set<SpvExecutionModel> execution_models_;
+  // Execution models with which the current function can be called, sorted.
+  std::vector<SpvExecutionModel> execution_models_;
+
+  // Maps each function to the sorted execution models of the entry points
+  // which can call it, computed the first time the function is entered.
+  std::unordered_map<uint32_t, std::vector<SpvExecutionModel>>
+      function_execution_models_;
 };
 
+void BuiltInsValidator::AddAtReferenceCheck(
+    AtReferenceFunction validate, const Decoration& decoration,
+    const Instruction& built_in_inst, const Instruction& referenced_inst) {
+  AddCheck(referenced_inst, {validate, &decoration, &built_in_inst,
+                             &referenced_inst, 0, nullptr,
+                             SpvExecutionModelMax});
+}
+
+void BuiltInsValidator::AddNotCalledWithExecutionModelCheck(
+    uint32_t vuid, const char* comment, SpvExecutionModel execution_model,
+    const Decoration& decoration, const Instruction& built_in_inst,
+    const Instruction& referenced_inst) {
+  AddCheck(referenced_inst, {nullptr, &decoration, &built_in_inst,
+                             &referenced_inst, vuid, comment, execution_model});
+}
+
+void BuiltInsValidator::AddCheck(const Instruction& referenced_inst,
+                                 const AtReferenceCheck& check) {
+  // Instructions without a result id cannot be referenced.
+  if (referenced_inst.id() == 0) return;
+  if (id_to_at_reference_checks_.empty()) {
+    id_to_at_reference_checks_.resize(_.getIdBound());
+  }
+  id_to_at_reference_checks_[referenced_inst.id()].push_back(check);
+}
+
 void BuiltInsValidator::Update(const Instruction& inst) {
   const SpvOp opcode = inst.opcode();
   if (opcode == SpvOpFunction) {
     // Entering a function.
     assert(function_id_ == 0);
     function_id_ = inst.id();
-    execution_models_.clear();
     entry_points_ = &_.FunctionEntryPoints(function_id_);
-    // Collect execution models from all entry points from which the current
-    // function can be called.
-    for (const uint32_t entry_point : *entry_points_) {
-      if (const auto* models = _.GetExecutionModels(entry_point)) {
-        execution_models_.insert(models->begin(), models->end());
+    auto where = function_execution_models_.find(function_id_);
+    if (where == function_execution_models_.end()) {
+      // Collect execution models from all entry points from which the current
+      // function can be called.
+      std::vector<SpvExecutionModel> models;
+      for (const uint32_t entry_point : *entry_points_) {
+        if (const auto* entry_point_models =
+                _.GetExecutionModels(entry_point)) {
+          models.insert(models.end(), entry_point_models->begin(),
+                        entry_point_models->end());
+        }
       }
+      std::sort(models.begin(), models.end());
+      models.erase(std::unique(models.begin(), models.end()), models.end());
+      where = function_execution_models_.emplace(function_id_, models).first;
     }
+    execution_models_ = where->second;
   }
 
   if (opcode == SpvOpFunctionEnd) {
@@ -892,18 +974,20 @@ spv_result_t BuiltInsValidator::ValidateF32ArrHelper(
 }
 
 spv_result_t BuiltInsValidator::ValidateNotCalledWithExecutionModel(
-    std::string comment, SpvExecutionModel execution_model,
+    uint32_t vuid, const char* comment, SpvExecutionModel execution_model,
     const Decoration& decoration, const Instruction& built_in_inst,
     const Instruction& referenced_inst,
     const Instruction& referenced_from_inst) {
   if (function_id_) {
-    if (execution_models_.count(execution_model)) {
+    if (std::binary_search(execution_models_.begin(), execution_models_.end(),
+                           execution_model)) {
       const char* execution_model_str = _.grammar().lookupOperandName(
           SPV_OPERAND_TYPE_EXECUTION_MODEL, execution_model);
       const char* built_in_str = _.grammar().lookupOperandName(
           SPV_OPERAND_TYPE_BUILT_IN, decoration.params()[0]);
       return _.diag(SPV_ERROR_INVALID_DATA, &referenced_from_inst)
-             << comment << " " << GetIdDesc(referenced_inst) << " depends on "
+             << (vuid ? _.VkErrorID(vuid) : std::string()) << comment << " "
+             << GetIdDesc(referenced_inst) << " depends on "
              << GetIdDesc(built_in_inst) << " which is decorated with BuiltIn "
              << built_in_str << "."
              << " Id <" << referenced_inst.id() << "> is later referenced by "
@@ -913,10 +997,9 @@ spv_result_t BuiltInsValidator::ValidateNotCalledWithExecutionModel(
     }
   } else {
     // Propagate this rule to all dependant ids in the global scope.
-    id_to_at_reference_checks_[referenced_from_inst.id()].push_back(
-        std::bind(&BuiltInsValidator::ValidateNotCalledWithExecutionModel, this,
-                  comment, execution_model, decoration, built_in_inst,
-                  referenced_from_inst, std::placeholders::_1));
+    AddNotCalledWithExecutionModelCheck(vuid, comment, execution_model,
+                                        decoration, built_in_inst,
+                                        referenced_from_inst);
   }
   return SPV_SUCCESS;
 }
@@ -950,24 +1033,24 @@ spv_result_t BuiltInsValidator::ValidateClipOrCullDistanceAtReference(
 
     if (storage_class == SpvStorageClassInput) {
       assert(function_id_ == 0);
-      id_to_at_reference_checks_[referenced_from_inst.id()].push_back(std::bind(
-          &BuiltInsValidator::ValidateNotCalledWithExecutionModel, this,
+      AddNotCalledWithExecutionModelCheck(
+          0,
           "Vulkan spec doesn't allow BuiltIn ClipDistance/CullDistance to be "
           "used for variables with Input storage class if execution model is "
           "Vertex.",
           SpvExecutionModelVertex, decoration, built_in_inst,
-          referenced_from_inst, std::placeholders::_1));
+          referenced_from_inst);
     }
 
     if (storage_class == SpvStorageClassOutput) {
       assert(function_id_ == 0);
-      id_to_at_reference_checks_[referenced_from_inst.id()].push_back(std::bind(
-          &BuiltInsValidator::ValidateNotCalledWithExecutionModel, this,
+      AddNotCalledWithExecutionModelCheck(
+          0,
           "Vulkan spec doesn't allow BuiltIn ClipDistance/CullDistance to be "
           "used for variables with Output storage class if execution model is "
           "Fragment.",
           SpvExecutionModelFragment, decoration, built_in_inst,
-          referenced_from_inst, std::placeholders::_1));
+          referenced_from_inst);
     }
 
     for (const SpvExecutionModel execution_model : execution_models_) {
@@ -1065,10 +1148,9 @@ spv_result_t BuiltInsValidator::ValidateClipOrCullDistanceAtReference(
 
   if (function_id_ == 0) {
     // Propagate this rule to all dependant ids in the global scope.
-    id_to_at_reference_checks_[referenced_from_inst.id()].push_back(
-        std::bind(&BuiltInsValidator::ValidateClipOrCullDistanceAtReference,
-                  this, decoration, built_in_inst, referenced_from_inst,
-                  std::placeholders::_1));
+    AddAtReferenceCheck(
+        &BuiltInsValidator::ValidateClipOrCullDistanceAtReference, decoration,
+        built_in_inst, referenced_from_inst);
   }
 
   return SPV_SUCCESS;
@@ -1128,9 +1210,8 @@ spv_result_t BuiltInsValidator::ValidateFragCoordAtReference(
 
   if (function_id_ == 0) {
     // Propagate this rule to all dependant ids in the global scope.
-    id_to_at_reference_checks_[referenced_from_inst.id()].push_back(std::bind(
-        &BuiltInsValidator::ValidateFragCoordAtReference, this, decoration,
-        built_in_inst, referenced_from_inst, std::placeholders::_1));
+    AddAtReferenceCheck(&BuiltInsValidator::ValidateFragCoordAtReference,
+                        decoration, built_in_inst, referenced_from_inst);
   }
 
   return SPV_SUCCESS;
@@ -1204,9 +1285,8 @@ spv_result_t BuiltInsValidator::ValidateFragDepthAtReference(
 
   if (function_id_ == 0) {
     // Propagate this rule to all dependant ids in the global scope.
-    id_to_at_reference_checks_[referenced_from_inst.id()].push_back(std::bind(
-        &BuiltInsValidator::ValidateFragDepthAtReference, this, decoration,
-        built_in_inst, referenced_from_inst, std::placeholders::_1));
+    AddAtReferenceCheck(&BuiltInsValidator::ValidateFragDepthAtReference,
+                        decoration, built_in_inst, referenced_from_inst);
   }
 
   return SPV_SUCCESS;
@@ -1265,9 +1345,8 @@ spv_result_t BuiltInsValidator::ValidateFrontFacingAtReference(
 
   if (function_id_ == 0) {
     // Propagate this rule to all dependant ids in the global scope.
-    id_to_at_reference_checks_[referenced_from_inst.id()].push_back(std::bind(
-        &BuiltInsValidator::ValidateFrontFacingAtReference, this, decoration,
-        built_in_inst, referenced_from_inst, std::placeholders::_1));
+    AddAtReferenceCheck(&BuiltInsValidator::ValidateFrontFacingAtReference,
+                        decoration, built_in_inst, referenced_from_inst);
   }
 
   return SPV_SUCCESS;
@@ -1324,10 +1403,8 @@ spv_result_t BuiltInsValidator::ValidateHelperInvocationAtReference(
 
   if (function_id_ == 0) {
     // Propagate this rule to all dependant ids in the global scope.
-    id_to_at_reference_checks_[referenced_from_inst.id()].push_back(
-        std::bind(&BuiltInsValidator::ValidateHelperInvocationAtReference, this,
-                  decoration, built_in_inst, referenced_from_inst,
-                  std::placeholders::_1));
+    AddAtReferenceCheck(&BuiltInsValidator::ValidateHelperInvocationAtReference,
+                        decoration, built_in_inst, referenced_from_inst);
   }
 
   return SPV_SUCCESS;
@@ -1385,9 +1462,8 @@ spv_result_t BuiltInsValidator::ValidateInvocationIdAtReference(
 
   if (function_id_ == 0) {
     // Propagate this rule to all dependant ids in the global scope.
-    id_to_at_reference_checks_[referenced_from_inst.id()].push_back(std::bind(
-        &BuiltInsValidator::ValidateInvocationIdAtReference, this, decoration,
-        built_in_inst, referenced_from_inst, std::placeholders::_1));
+    AddAtReferenceCheck(&BuiltInsValidator::ValidateInvocationIdAtReference,
+                        decoration, built_in_inst, referenced_from_inst);
   }
 
   return SPV_SUCCESS;
@@ -1446,9 +1522,8 @@ spv_result_t BuiltInsValidator::ValidateInstanceIndexAtReference(
 
   if (function_id_ == 0) {
     // Propagate this rule to all dependant ids in the global scope.
-    id_to_at_reference_checks_[referenced_from_inst.id()].push_back(std::bind(
-        &BuiltInsValidator::ValidateInstanceIndexAtReference, this, decoration,
-        built_in_inst, referenced_from_inst, std::placeholders::_1));
+    AddAtReferenceCheck(&BuiltInsValidator::ValidateInstanceIndexAtReference,
+                        decoration, built_in_inst, referenced_from_inst);
   }
 
   return SPV_SUCCESS;
@@ -1507,9 +1582,8 @@ spv_result_t BuiltInsValidator::ValidatePatchVerticesAtReference(
 
   if (function_id_ == 0) {
     // Propagate this rule to all dependant ids in the global scope.
-    id_to_at_reference_checks_[referenced_from_inst.id()].push_back(std::bind(
-        &BuiltInsValidator::ValidatePatchVerticesAtReference, this, decoration,
-        built_in_inst, referenced_from_inst, std::placeholders::_1));
+    AddAtReferenceCheck(&BuiltInsValidator::ValidatePatchVerticesAtReference,
+                        decoration, built_in_inst, referenced_from_inst);
   }
 
   return SPV_SUCCESS;
@@ -1567,9 +1641,8 @@ spv_result_t BuiltInsValidator::ValidatePointCoordAtReference(
 
   if (function_id_ == 0) {
     // Propagate this rule to all dependant ids in the global scope.
-    id_to_at_reference_checks_[referenced_from_inst.id()].push_back(std::bind(
-        &BuiltInsValidator::ValidatePointCoordAtReference, this, decoration,
-        built_in_inst, referenced_from_inst, std::placeholders::_1));
+    AddAtReferenceCheck(&BuiltInsValidator::ValidatePointCoordAtReference,
+                        decoration, built_in_inst, referenced_from_inst);
   }
 
   return SPV_SUCCESS;
@@ -1601,15 +1674,12 @@ spv_result_t BuiltInsValidator::ValidatePointSizeAtReference(
 
     if (storage_class == SpvStorageClassInput) {
       assert(function_id_ == 0);
-      id_to_at_reference_checks_[referenced_from_inst.id()].push_back(std::bind(
-          &BuiltInsValidator::ValidateNotCalledWithExecutionModel, this,
-          std::string(
-              _.VkErrorID(4315) +
-              "Vulkan spec doesn't allow BuiltIn PointSize to be used for "
-              "variables with Input storage class if execution model is "
-              "Vertex."),
+      AddNotCalledWithExecutionModelCheck(
+          4315,
+          "Vulkan spec doesn't allow BuiltIn PointSize to be used for "
+          "variables with Input storage class if execution model is Vertex.",
           SpvExecutionModelVertex, decoration, built_in_inst,
-          referenced_from_inst, std::placeholders::_1));
+          referenced_from_inst);
     }
 
     for (const SpvExecutionModel execution_model : execution_models_) {
@@ -1686,9 +1756,8 @@ spv_result_t BuiltInsValidator::ValidatePointSizeAtReference(
 
   if (function_id_ == 0) {
     // Propagate this rule to all dependant ids in the global scope.
-    id_to_at_reference_checks_[referenced_from_inst.id()].push_back(std::bind(
-        &BuiltInsValidator::ValidatePointSizeAtReference, this, decoration,
-        built_in_inst, referenced_from_inst, std::placeholders::_1));
+    AddAtReferenceCheck(&BuiltInsValidator::ValidatePointSizeAtReference,
+                        decoration, built_in_inst, referenced_from_inst);
   }
 
   return SPV_SUCCESS;
@@ -1719,14 +1788,12 @@ spv_result_t BuiltInsValidator::ValidatePositionAtReference(
 
     if (storage_class == SpvStorageClassInput) {
       assert(function_id_ == 0);
-      id_to_at_reference_checks_[referenced_from_inst.id()].push_back(std::bind(
-          &BuiltInsValidator::ValidateNotCalledWithExecutionModel, this,
-          std::string(_.VkErrorID(4320) +
-                      "Vulkan spec doesn't allow BuiltIn Position to be used "
-                      "for variables "
-                      "with Input storage class if execution model is Vertex."),
+      AddNotCalledWithExecutionModelCheck(
+          4320,
+          "Vulkan spec doesn't allow BuiltIn Position to be used for variables "
+          "with Input storage class if execution model is Vertex.",
           SpvExecutionModelVertex, decoration, built_in_inst,
-          referenced_from_inst, std::placeholders::_1));
+          referenced_from_inst);
     }
 
     for (const SpvExecutionModel execution_model : execution_models_) {
@@ -1846,9 +1913,8 @@ spv_result_t BuiltInsValidator::ValidatePositionAtReference(
 
   if (function_id_ == 0) {
     // Propagate this rule to all dependant ids in the global scope.
-    id_to_at_reference_checks_[referenced_from_inst.id()].push_back(std::bind(
-        &BuiltInsValidator::ValidatePositionAtReference, this, decoration,
-        built_in_inst, referenced_from_inst, std::placeholders::_1));
+    AddAtReferenceCheck(&BuiltInsValidator::ValidatePositionAtReference,
+                        decoration, built_in_inst, referenced_from_inst);
   }
 
   return SPV_SUCCESS;
@@ -1910,33 +1976,26 @@ spv_result_t BuiltInsValidator::ValidatePrimitiveIdAtReference(
 
     if (storage_class == SpvStorageClassOutput) {
       assert(function_id_ == 0);
-      id_to_at_reference_checks_[referenced_from_inst.id()].push_back(std::bind(
-          &BuiltInsValidator::ValidateNotCalledWithExecutionModel, this,
-          std::string(
-              _.VkErrorID(4334) +
-              "Vulkan spec doesn't allow BuiltIn PrimitiveId to be used for "
-              "variables with Output storage class if execution model is "
-              "TessellationControl."),
+      AddNotCalledWithExecutionModelCheck(
+          4334,
+          "Vulkan spec doesn't allow BuiltIn PrimitiveId to be used for "
+          "variables with Output storage class if execution model is "
+          "TessellationControl.",
           SpvExecutionModelTessellationControl, decoration, built_in_inst,
-          referenced_from_inst, std::placeholders::_1));
-      id_to_at_reference_checks_[referenced_from_inst.id()].push_back(std::bind(
-          &BuiltInsValidator::ValidateNotCalledWithExecutionModel, this,
-          std::string(
-              _.VkErrorID(4334) +
-              "Vulkan spec doesn't allow BuiltIn PrimitiveId to be used for "
-              "variables with Output storage class if execution model is "
-              "TessellationEvaluation."),
+          referenced_from_inst);
+      AddNotCalledWithExecutionModelCheck(
+          4334,
+          "Vulkan spec doesn't allow BuiltIn PrimitiveId to be used for "
+          "variables with Output storage class if execution model is "
+          "TessellationEvaluation.",
           SpvExecutionModelTessellationEvaluation, decoration, built_in_inst,
-          referenced_from_inst, std::placeholders::_1));
-      id_to_at_reference_checks_[referenced_from_inst.id()].push_back(std::bind(
-          &BuiltInsValidator::ValidateNotCalledWithExecutionModel, this,
-          std::string(
-              _.VkErrorID(4334) +
-              "Vulkan spec doesn't allow BuiltIn PrimitiveId to be used for "
-              "variables with Output storage class if execution model is "
-              "Fragment."),
+          referenced_from_inst);
+      AddNotCalledWithExecutionModelCheck(
+          4334,
+          "Vulkan spec doesn't allow BuiltIn PrimitiveId to be used for "
+          "variables with Output storage class if execution model is Fragment.",
           SpvExecutionModelFragment, decoration, built_in_inst,
-          referenced_from_inst, std::placeholders::_1));
+          referenced_from_inst);
     }
 
     for (const SpvExecutionModel execution_model : execution_models_) {
@@ -1971,9 +2030,8 @@ spv_result_t BuiltInsValidator::ValidatePrimitiveIdAtReference(
 
   if (function_id_ == 0) {
     // Propagate this rule to all dependant ids in the global scope.
-    id_to_at_reference_checks_[referenced_from_inst.id()].push_back(std::bind(
-        &BuiltInsValidator::ValidatePrimitiveIdAtReference, this, decoration,
-        built_in_inst, referenced_from_inst, std::placeholders::_1));
+    AddAtReferenceCheck(&BuiltInsValidator::ValidatePrimitiveIdAtReference,
+                        decoration, built_in_inst, referenced_from_inst);
   }
 
   return SPV_SUCCESS;
@@ -2030,9 +2088,8 @@ spv_result_t BuiltInsValidator::ValidateSampleIdAtReference(
 
   if (function_id_ == 0) {
     // Propagate this rule to all dependant ids in the global scope.
-    id_to_at_reference_checks_[referenced_from_inst.id()].push_back(std::bind(
-        &BuiltInsValidator::ValidateSampleIdAtReference, this, decoration,
-        built_in_inst, referenced_from_inst, std::placeholders::_1));
+    AddAtReferenceCheck(&BuiltInsValidator::ValidateSampleIdAtReference,
+                        decoration, built_in_inst, referenced_from_inst);
   }
 
   return SPV_SUCCESS;
@@ -2091,9 +2148,8 @@ spv_result_t BuiltInsValidator::ValidateSampleMaskAtReference(
 
   if (function_id_ == 0) {
     // Propagate this rule to all dependant ids in the global scope.
-    id_to_at_reference_checks_[referenced_from_inst.id()].push_back(std::bind(
-        &BuiltInsValidator::ValidateSampleMaskAtReference, this, decoration,
-        built_in_inst, referenced_from_inst, std::placeholders::_1));
+    AddAtReferenceCheck(&BuiltInsValidator::ValidateSampleMaskAtReference,
+                        decoration, built_in_inst, referenced_from_inst);
   }
 
   return SPV_SUCCESS;
@@ -2153,9 +2209,8 @@ spv_result_t BuiltInsValidator::ValidateSamplePositionAtReference(
 
   if (function_id_ == 0) {
     // Propagate this rule to all dependant ids in the global scope.
-    id_to_at_reference_checks_[referenced_from_inst.id()].push_back(std::bind(
-        &BuiltInsValidator::ValidateSamplePositionAtReference, this, decoration,
-        built_in_inst, referenced_from_inst, std::placeholders::_1));
+    AddAtReferenceCheck(&BuiltInsValidator::ValidateSamplePositionAtReference,
+                        decoration, built_in_inst, referenced_from_inst);
   }
 
   return SPV_SUCCESS;
@@ -2213,9 +2268,8 @@ spv_result_t BuiltInsValidator::ValidateTessCoordAtReference(
 
   if (function_id_ == 0) {
     // Propagate this rule to all dependant ids in the global scope.
-    id_to_at_reference_checks_[referenced_from_inst.id()].push_back(std::bind(
-        &BuiltInsValidator::ValidateTessCoordAtReference, this, decoration,
-        built_in_inst, referenced_from_inst, std::placeholders::_1));
+    AddAtReferenceCheck(&BuiltInsValidator::ValidateTessCoordAtReference,
+                        decoration, built_in_inst, referenced_from_inst);
   }
 
   return SPV_SUCCESS;
@@ -2286,26 +2340,24 @@ spv_result_t BuiltInsValidator::ValidateTessLevelAtReference(
 
     if (storage_class == SpvStorageClassInput) {
       assert(function_id_ == 0);
-      id_to_at_reference_checks_[referenced_from_inst.id()].push_back(std::bind(
-          &BuiltInsValidator::ValidateNotCalledWithExecutionModel, this,
-          "Vulkan spec doesn't allow TessLevelOuter/TessLevelInner to be "
-          "used "
+      AddNotCalledWithExecutionModelCheck(
+          0,
+          "Vulkan spec doesn't allow TessLevelOuter/TessLevelInner to be used "
           "for variables with Input storage class if execution model is "
           "TessellationControl.",
           SpvExecutionModelTessellationControl, decoration, built_in_inst,
-          referenced_from_inst, std::placeholders::_1));
+          referenced_from_inst);
     }
 
     if (storage_class == SpvStorageClassOutput) {
       assert(function_id_ == 0);
-      id_to_at_reference_checks_[referenced_from_inst.id()].push_back(std::bind(
-          &BuiltInsValidator::ValidateNotCalledWithExecutionModel, this,
-          "Vulkan spec doesn't allow TessLevelOuter/TessLevelInner to be "
-          "used "
+      AddNotCalledWithExecutionModelCheck(
+          0,
+          "Vulkan spec doesn't allow TessLevelOuter/TessLevelInner to be used "
           "for variables with Output storage class if execution model is "
           "TessellationEvaluation.",
           SpvExecutionModelTessellationEvaluation, decoration, built_in_inst,
-          referenced_from_inst, std::placeholders::_1));
+          referenced_from_inst);
     }
 
     for (const SpvExecutionModel execution_model : execution_models_) {
@@ -2333,9 +2385,8 @@ spv_result_t BuiltInsValidator::ValidateTessLevelAtReference(
 
   if (function_id_ == 0) {
     // Propagate this rule to all dependant ids in the global scope.
-    id_to_at_reference_checks_[referenced_from_inst.id()].push_back(std::bind(
-        &BuiltInsValidator::ValidateTessLevelAtReference, this, decoration,
-        built_in_inst, referenced_from_inst, std::placeholders::_1));
+    AddAtReferenceCheck(&BuiltInsValidator::ValidateTessLevelAtReference,
+                        decoration, built_in_inst, referenced_from_inst);
   }
 
   return SPV_SUCCESS;
@@ -2408,9 +2459,8 @@ spv_result_t BuiltInsValidator::ValidateInstanceIdAtReference(
 
   if (function_id_ == 0) {
     // Propagate this rule to all dependant ids in the global scope.
-    id_to_at_reference_checks_[referenced_from_inst.id()].push_back(std::bind(
-        &BuiltInsValidator::ValidateInstanceIdAtReference, this, decoration,
-        built_in_inst, referenced_from_inst, std::placeholders::_1));
+    AddAtReferenceCheck(&BuiltInsValidator::ValidateInstanceIdAtReference,
+                        decoration, built_in_inst, referenced_from_inst);
   }
 
   return SPV_SUCCESS;
@@ -2465,10 +2515,9 @@ spv_result_t BuiltInsValidator::ValidateLocalInvocationIndexAtReference(
 
   if (function_id_ == 0) {
     // Propagate this rule to all dependant ids in the global scope.
-    id_to_at_reference_checks_[referenced_from_inst.id()].push_back(
-        std::bind(&BuiltInsValidator::ValidateLocalInvocationIndexAtReference,
-                  this, decoration, built_in_inst, referenced_from_inst,
-                  std::placeholders::_1));
+    AddAtReferenceCheck(
+        &BuiltInsValidator::ValidateLocalInvocationIndexAtReference, decoration,
+        built_in_inst, referenced_from_inst);
   }
 
   return SPV_SUCCESS;
@@ -2506,9 +2555,8 @@ spv_result_t BuiltInsValidator::ValidateVertexIndexAtReference(
 
   if (function_id_ == 0) {
     // Propagate this rule to all dependant ids in the global scope.
-    id_to_at_reference_checks_[referenced_from_inst.id()].push_back(std::bind(
-        &BuiltInsValidator::ValidateVertexIndexAtReference, this, decoration,
-        built_in_inst, referenced_from_inst, std::placeholders::_1));
+    AddAtReferenceCheck(&BuiltInsValidator::ValidateVertexIndexAtReference,
+                        decoration, built_in_inst, referenced_from_inst);
   }
 
   return SPV_SUCCESS;
@@ -2587,30 +2635,24 @@ spv_result_t BuiltInsValidator::ValidateLayerOrViewportIndexAtReference(
       for (const auto em :
            {SpvExecutionModelVertex, SpvExecutionModelTessellationEvaluation,
             SpvExecutionModelGeometry}) {
-        id_to_at_reference_checks_[referenced_from_inst.id()].push_back(
-            std::bind(&BuiltInsValidator::ValidateNotCalledWithExecutionModel,
-                      this,
-                      "Vulkan spec doesn't allow BuiltIn Layer and "
-                      "ViewportIndex to be "
-                      "used for variables with Input storage class if "
-                      "execution model is Vertex, TessellationEvaluation, or "
-                      "Geometry.",
-                      em, decoration, built_in_inst, referenced_from_inst,
-                      std::placeholders::_1));
+        AddNotCalledWithExecutionModelCheck(
+            0,
+            "Vulkan spec doesn't allow BuiltIn Layer and ViewportIndex to be "
+            "used for variables with Input storage class if execution model is "
+            "Vertex, TessellationEvaluation, or Geometry.",
+            em, decoration, built_in_inst, referenced_from_inst);
       }
     }
 
     if (storage_class == SpvStorageClassOutput) {
       assert(function_id_ == 0);
-      id_to_at_reference_checks_[referenced_from_inst.id()].push_back(std::bind(
-          &BuiltInsValidator::ValidateNotCalledWithExecutionModel, this,
-          "Vulkan spec doesn't allow BuiltIn Layer and "
-          "ViewportIndex to be "
-          "used for variables with Output storage class if "
-          "execution model is "
+      AddNotCalledWithExecutionModelCheck(
+          0,
+          "Vulkan spec doesn't allow BuiltIn Layer and ViewportIndex to be "
+          "used for variables with Output storage class if execution model is "
           "Fragment.",
           SpvExecutionModelFragment, decoration, built_in_inst,
-          referenced_from_inst, std::placeholders::_1));
+          referenced_from_inst);
     }
 
     for (const SpvExecutionModel execution_model : execution_models_) {
@@ -2649,10 +2691,9 @@ spv_result_t BuiltInsValidator::ValidateLayerOrViewportIndexAtReference(
 
   if (function_id_ == 0) {
     // Propagate this rule to all dependant ids in the global scope.
-    id_to_at_reference_checks_[referenced_from_inst.id()].push_back(
-        std::bind(&BuiltInsValidator::ValidateLayerOrViewportIndexAtReference,
-                  this, decoration, built_in_inst, referenced_from_inst,
-                  std::placeholders::_1));
+    AddAtReferenceCheck(
+        &BuiltInsValidator::ValidateLayerOrViewportIndexAtReference, decoration,
+        built_in_inst, referenced_from_inst);
   }
 
   return SPV_SUCCESS;
@@ -2772,10 +2813,9 @@ spv_result_t BuiltInsValidator::ValidateComputeShaderI32Vec3InputAtReference(
 
   if (function_id_ == 0) {
     // Propagate this rule to all dependant ids in the global scope.
-    id_to_at_reference_checks_[referenced_from_inst.id()].push_back(std::bind(
-        &BuiltInsValidator::ValidateComputeShaderI32Vec3InputAtReference, this,
-        decoration, built_in_inst, referenced_from_inst,
-        std::placeholders::_1));
+    AddAtReferenceCheck(
+        &BuiltInsValidator::ValidateComputeShaderI32Vec3InputAtReference,
+        decoration, built_in_inst, referenced_from_inst);
   }
 
   return SPV_SUCCESS;
@@ -2851,10 +2891,8 @@ spv_result_t BuiltInsValidator::ValidateComputeI32InputAtReference(
 
   if (function_id_ == 0) {
     // Propagate this rule to all dependant ids in the global scope.
-    id_to_at_reference_checks_[referenced_from_inst.id()].push_back(
-        std::bind(&BuiltInsValidator::ValidateComputeI32InputAtReference, this,
-                  decoration, built_in_inst, referenced_from_inst,
-                  std::placeholders::_1));
+    AddAtReferenceCheck(&BuiltInsValidator::ValidateComputeI32InputAtReference,
+                        decoration, built_in_inst, referenced_from_inst);
   }
 
   return SPV_SUCCESS;
@@ -2998,9 +3036,8 @@ spv_result_t BuiltInsValidator::ValidateWorkgroupSizeAtReference(
 
   if (function_id_ == 0) {
     // Propagate this rule to all dependant ids in the global scope.
-    id_to_at_reference_checks_[referenced_from_inst.id()].push_back(std::bind(
-        &BuiltInsValidator::ValidateWorkgroupSizeAtReference, this, decoration,
-        built_in_inst, referenced_from_inst, std::placeholders::_1));
+    AddAtReferenceCheck(&BuiltInsValidator::ValidateWorkgroupSizeAtReference,
+                        decoration, built_in_inst, referenced_from_inst);
   }
 
   return SPV_SUCCESS;
@@ -3067,10 +3104,9 @@ spv_result_t BuiltInsValidator::ValidateBaseInstanceOrVertexAtReference(
 
   if (function_id_ == 0) {
     // Propagate this rule to all dependant ids in the global scope.
-    id_to_at_reference_checks_[referenced_from_inst.id()].push_back(
-        std::bind(&BuiltInsValidator::ValidateBaseInstanceOrVertexAtReference,
-                  this, decoration, built_in_inst, referenced_from_inst,
-                  std::placeholders::_1));
+    AddAtReferenceCheck(
+        &BuiltInsValidator::ValidateBaseInstanceOrVertexAtReference, decoration,
+        built_in_inst, referenced_from_inst);
   }
 
   return SPV_SUCCESS;
@@ -3135,9 +3171,8 @@ spv_result_t BuiltInsValidator::ValidateDrawIndexAtReference(
 
   if (function_id_ == 0) {
     // Propagate this rule to all dependant ids in the global scope.
-    id_to_at_reference_checks_[referenced_from_inst.id()].push_back(std::bind(
-        &BuiltInsValidator::ValidateDrawIndexAtReference, this, decoration,
-        built_in_inst, referenced_from_inst, std::placeholders::_1));
+    AddAtReferenceCheck(&BuiltInsValidator::ValidateDrawIndexAtReference,
+                        decoration, built_in_inst, referenced_from_inst);
   }
 
   return SPV_SUCCESS;
@@ -3199,9 +3234,8 @@ spv_result_t BuiltInsValidator::ValidateViewIndexAtReference(
 
   if (function_id_ == 0) {
     // Propagate this rule to all dependant ids in the global scope.
-    id_to_at_reference_checks_[referenced_from_inst.id()].push_back(std::bind(
-        &BuiltInsValidator::ValidateViewIndexAtReference, this, decoration,
-        built_in_inst, referenced_from_inst, std::placeholders::_1));
+    AddAtReferenceCheck(&BuiltInsValidator::ValidateViewIndexAtReference,
+                        decoration, built_in_inst, referenced_from_inst);
   }
 
   return SPV_SUCCESS;
@@ -3251,9 +3285,8 @@ spv_result_t BuiltInsValidator::ValidateDeviceIndexAtReference(
 
   if (function_id_ == 0) {
     // Propagate this rule to all dependant ids in the global scope.
-    id_to_at_reference_checks_[referenced_from_inst.id()].push_back(std::bind(
-        &BuiltInsValidator::ValidateDeviceIndexAtReference, this, decoration,
-        built_in_inst, referenced_from_inst, std::placeholders::_1));
+    AddAtReferenceCheck(&BuiltInsValidator::ValidateDeviceIndexAtReference,
+                        decoration, built_in_inst, referenced_from_inst);
   }
 
   return SPV_SUCCESS;
@@ -3306,9 +3339,8 @@ spv_result_t BuiltInsValidator::ValidateSMBuiltinsAtReference(
 
   if (function_id_ == 0) {
     // Propagate this rule to all dependant ids in the global scope.
-    id_to_at_reference_checks_[referenced_from_inst.id()].push_back(std::bind(
-        &BuiltInsValidator::ValidateSMBuiltinsAtReference, this, decoration,
-        built_in_inst, referenced_from_inst, std::placeholders::_1));
+    AddAtReferenceCheck(&BuiltInsValidator::ValidateSMBuiltinsAtReference,
+                        decoration, built_in_inst, referenced_from_inst);
   }
 
   return SPV_SUCCESS;
@@ -3562,7 +3594,7 @@ spv_result_t BuiltInsValidator::Run() {
   for (const Instruction& inst : _.ordered_instructions()) {
     Update(inst);
 
-    std::set<uint32_t> already_checked;
+    checked_ids_.clear();
 
     for (const auto& operand : inst.operands()) {
       if (!spvIsIdType(operand.type)) {
@@ -3576,21 +3608,30 @@ spv_result_t BuiltInsValidator::Run() {
         continue;
       }
 
-      if (!already_checked.insert(id).second) {
+      if (std::find(checked_ids_.begin(), checked_ids_.end(), id) !=
+          checked_ids_.end()) {
         // The instruction has already referenced this id.
         continue;
       }
+      checked_ids_.push_back(id);
 
       // Instruction references the id. Run all checks associated with the id
-      // on the instruction. id_to_at_reference_checks_ can be modified in the
-      // process, iterators are safe because it's a tree-based map.
-      const auto it = id_to_at_reference_checks_.find(id);
-      if (it != id_to_at_reference_checks_.end()) {
-        for (const auto& check : it->second) {
-          if (spv_result_t error = check(inst)) {
-            return error;
-          }
+      // on the instruction. The checks can only add rules for the id defined
+      // by the instruction, so the rules of |id| are not changed.
+      if (id >= id_to_at_reference_checks_.size()) continue;
+      for (const AtReferenceCheck& check : id_to_at_reference_checks_[id]) {
+        spv_result_t error = SPV_SUCCESS;
+        if (check.validate) {
+          error = (this->*check.validate)(*check.decoration,
+                                          *check.built_in_inst,
+                                          *check.referenced_inst, inst);
+        } else {
+          error = ValidateNotCalledWithExecutionModel(
+              check.vuid, check.comment, check.execution_model,
+              *check.decoration, *check.built_in_inst, *check.referenced_inst,
+              inst);
         }
+        if (error) return error;
       }
     }
   }
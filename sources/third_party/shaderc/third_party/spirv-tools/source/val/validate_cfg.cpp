@@ -971,6 +971,7 @@ spv_result_t PerformCfgChecks(ValidationState_t& _) {
       for (auto edge : postdom_edges) {
         edge.first->SetImmediatePostDominator(edge.second);
       }
+      function.ComputeDominatorIntervals();
       /// calculate back edges.
       CFA<BasicBlock>::DepthFirstTraversal(
           function.pseudo_entry_block(),
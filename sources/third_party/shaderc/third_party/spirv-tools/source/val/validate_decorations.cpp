@@ -14,6 +14,7 @@
 
 #include <algorithm>
 #include <cassert>
+#include <set>
 #include <string>
 #include <tuple>
 #include <unordered_map>
@@ -59,6 +60,10 @@ struct LayoutConstraints {
       MatrixLayout the_majorness = MatrixLayout::kColumnMajor,
       uint32_t stride = 0)
       : majorness(the_majorness), matrix_stride(stride) {}
+  bool operator==(const LayoutConstraints& other) const {
+    return majorness == other.majorness &&
+           matrix_stride == other.matrix_stride;
+  }
   MatrixLayout majorness;
   uint32_t matrix_stride;
 };
@@ -67,6 +72,40 @@ struct LayoutConstraints {
 using MemberConstraints = std::unordered_map<std::pair<uint32_t, uint32_t>,
                                              LayoutConstraints, PairHash>;
 
+// Layout information shared by all the buffers of a module.  The member
+// constraints and offsets of a struct, and the scalar alignment of any type,
+// only depend on the types and their decorations.  So do the size and base
+// alignment of a struct, given whether the uniform buffer rules are in effect,
+// since a struct gives its members their own constraints.  They are computed
+// the first time they are needed, instead of again for every buffer using
+// the type.
+struct LayoutCache {
+  // Member constraints of the structs reachable from |constrained_structs|.
+  // The cached base alignments, sizes and checked layouts below depend on
+  // them, so they are cleared whenever a member's constraints change.
+  MemberConstraints constraints;
+  std::unordered_set<uint32_t> constrained_structs;
+  // Maps a struct id to the offset of each member, or 0xffffffff for members
+  // without an Offset decoration.
+  std::unordered_map<uint32_t, std::vector<uint32_t>> member_offsets;
+  // Maps a type id to its scalar alignment.
+  std::unordered_map<uint32_t, uint32_t> scalar_alignments;
+  // Maps (struct id, whether rounded up) to its base alignment.
+  std::unordered_map<std::pair<uint32_t, uint32_t>, uint32_t, PairHash>
+      struct_base_alignments;
+  // Maps a struct id to its size.
+  std::unordered_map<uint32_t, uint32_t> struct_sizes;
+  // The (struct id, offset, block rules) for which checkLayout succeeded.
+  std::set<std::tuple<uint32_t, uint32_t, bool>> checked_layouts;
+
+  // Forgets the results computed from the member constraints.
+  void ClearConstrainedResults() {
+    struct_base_alignments.clear();
+    struct_sizes.clear();
+    checked_layouts.clear();
+  }
+};
+
 // Returns the array stride of the given array type.
 uint32_t GetArrayStride(uint32_t array_id, ValidationState_t& vstate) {
   for (auto& decoration : vstate.id_decorations(array_id)) {
@@ -156,13 +195,33 @@ uint32_t align(uint32_t x, uint32_t alignment) {
   return (x + alignment - 1) & ~(alignment - 1);
 }
 
+// Returns the offset of each member of the given struct, or 0xffffffff for
+// members without an Offset decoration.
+const std::vector<uint32_t>& getMemberOffsets(uint32_t struct_id,
+                                              LayoutCache& cache,
+                                              ValidationState_t& vstate) {
+  auto where = cache.member_offsets.find(struct_id);
+  if (where != cache.member_offsets.end()) return where->second;
+
+  std::vector<uint32_t> offsets(getStructMembers(struct_id, vstate).size(),
+                                0xffffffff);
+  for (auto& decoration : vstate.id_decorations(struct_id)) {
+    const int member_index = decoration.struct_member_index();
+    if (SpvDecorationOffset == decoration.dec_type() &&
+        Decoration::kInvalidMember != member_index &&
+        uint32_t(member_index) < offsets.size()) {
+      offsets[member_index] = decoration.params()[0];
+    }
+  }
+  return cache.member_offsets[struct_id] = std::move(offsets);
+}
+
 // Returns base alignment of struct member. If |roundUp| is true, also
 // ensure that structs and arrays are aligned at least to a multiple of 16
 // bytes.
 uint32_t getBaseAlignment(uint32_t member_id, bool roundUp,
                           const LayoutConstraints& inherited,
-                          MemberConstraints& constraints,
-                          ValidationState_t& vstate) {
+                          LayoutCache& cache, ValidationState_t& vstate) {
   const auto inst = vstate.FindDef(member_id);
   const auto& words = inst->words();
   // Minimal alignment is byte-aligned.
@@ -175,8 +234,8 @@ uint32_t getBaseAlignment(uint32_t member_id, bool roundUp,
     case SpvOpTypeVector: {
       const auto componentId = words[2];
       const auto numComponents = words[3];
-      const auto componentAlignment = getBaseAlignment(
-          componentId, roundUp, inherited, constraints, vstate);
+      const auto componentAlignment =
+          getBaseAlignment(componentId, roundUp, inherited, cache, vstate);
       baseAlignment =
           componentAlignment * (numComponents == 3 ? 4 : numComponents);
       break;
@@ -184,16 +243,16 @@ uint32_t getBaseAlignment(uint32_t member_id, bool roundUp,
     case SpvOpTypeMatrix: {
       const auto column_type = words[2];
       if (inherited.majorness == kColumnMajor) {
-        baseAlignment = getBaseAlignment(column_type, roundUp, inherited,
-                                         constraints, vstate);
+        baseAlignment =
+            getBaseAlignment(column_type, roundUp, inherited, cache, vstate);
       } else {
         // A row-major matrix of C columns has a base alignment equal to the
         // base alignment of a vector of C matrix components.
         const auto num_columns = words[3];
         const auto component_inst = vstate.FindDef(column_type);
         const auto component_id = component_inst->words()[2];
-        const auto componentAlignment = getBaseAlignment(
-            component_id, roundUp, inherited, constraints, vstate);
+        const auto componentAlignment =
+            getBaseAlignment(component_id, roundUp, inherited, cache, vstate);
         baseAlignment =
             componentAlignment * (num_columns == 3 ? 4 : num_columns);
       }
@@ -201,21 +260,25 @@ uint32_t getBaseAlignment(uint32_t member_id, bool roundUp,
     case SpvOpTypeArray:
     case SpvOpTypeRuntimeArray:
       baseAlignment =
-          getBaseAlignment(words[2], roundUp, inherited, constraints, vstate);
+          getBaseAlignment(words[2], roundUp, inherited, cache, vstate);
       if (roundUp) baseAlignment = align(baseAlignment, 16u);
       break;
     case SpvOpTypeStruct: {
+      const auto key = std::make_pair(member_id, uint32_t(roundUp));
+      auto where = cache.struct_base_alignments.find(key);
+      if (where != cache.struct_base_alignments.end()) return where->second;
       const auto members = getStructMembers(member_id, vstate);
       for (uint32_t memberIdx = 0, numMembers = uint32_t(members.size());
            memberIdx < numMembers; ++memberIdx) {
         const auto id = members[memberIdx];
         const auto& constraint =
-            constraints[std::make_pair(member_id, memberIdx)];
+            cache.constraints[std::make_pair(member_id, memberIdx)];
         baseAlignment = std::max(
             baseAlignment,
-            getBaseAlignment(id, roundUp, constraint, constraints, vstate));
+            getBaseAlignment(id, roundUp, constraint, cache, vstate));
       }
       if (roundUp) baseAlignment = align(baseAlignment, 16u);
+      cache.struct_base_alignments[key] = baseAlignment;
       break;
     }
     case SpvOpTypePointer:
@@ -230,47 +293,55 @@ uint32_t getBaseAlignment(uint32_t member_id, bool roundUp,
 }
 
 // Returns scalar alignment of a type.
-uint32_t getScalarAlignment(uint32_t type_id, ValidationState_t& vstate) {
+uint32_t getScalarAlignment(uint32_t type_id, LayoutCache& cache,
+                            ValidationState_t& vstate) {
+  auto where = cache.scalar_alignments.find(type_id);
+  if (where != cache.scalar_alignments.end()) return where->second;
+
   const auto inst = vstate.FindDef(type_id);
   const auto& words = inst->words();
+  uint32_t alignment = 1;
   switch (inst->opcode()) {
     case SpvOpTypeInt:
     case SpvOpTypeFloat:
-      return words[2] / 8;
+      alignment = words[2] / 8;
+      break;
     case SpvOpTypeVector:
     case SpvOpTypeMatrix:
     case SpvOpTypeArray:
     case SpvOpTypeRuntimeArray: {
       const auto compositeMemberTypeId = words[2];
-      return getScalarAlignment(compositeMemberTypeId, vstate);
+      alignment = getScalarAlignment(compositeMemberTypeId, cache, vstate);
+      break;
     }
     case SpvOpTypeStruct: {
       const auto members = getStructMembers(type_id, vstate);
-      uint32_t max_member_alignment = 1;
       for (uint32_t memberIdx = 0, numMembers = uint32_t(members.size());
            memberIdx < numMembers; ++memberIdx) {
         const auto id = members[memberIdx];
-        uint32_t member_alignment = getScalarAlignment(id, vstate);
-        if (member_alignment > max_member_alignment) {
-          max_member_alignment = member_alignment;
+        uint32_t member_alignment = getScalarAlignment(id, cache, vstate);
+        if (member_alignment > alignment) {
+          alignment = member_alignment;
         }
       }
-      return max_member_alignment;
-    } break;
+      break;
+    }
     case SpvOpTypePointer:
-      return vstate.pointer_size_and_alignment();
+      alignment = vstate.pointer_size_and_alignment();
+      break;
     default:
       assert(0);
       break;
   }
 
-  return 1;
+  cache.scalar_alignments[type_id] = alignment;
+  return alignment;
 }
 
 // Returns size of a struct member. Doesn't include padding at the end of struct
 // or array.  Assumes that in the struct case, all members have offsets.
 uint32_t getSize(uint32_t member_id, const LayoutConstraints& inherited,
-                 MemberConstraints& constraints, ValidationState_t& vstate) {
+                 LayoutCache& cache, ValidationState_t& vstate) {
   const auto inst = vstate.FindDef(member_id);
   const auto& words = inst->words();
   switch (inst->opcode()) {
@@ -281,7 +352,7 @@ uint32_t getSize(uint32_t member_id, const LayoutConstraints& inherited,
       const auto componentId = words[2];
       const auto numComponents = words[3];
       const auto componentSize =
-          getSize(componentId, inherited, constraints, vstate);
+          getSize(componentId, inherited, cache, vstate);
       const auto size = componentSize * numComponents;
       return size;
     }
@@ -292,7 +363,7 @@ uint32_t getSize(uint32_t member_id, const LayoutConstraints& inherited,
       const uint32_t num_elem = sizeInst->words()[3];
       const uint32_t elem_type = words[2];
       const uint32_t elem_size =
-          getSize(elem_type, inherited, constraints, vstate);
+          getSize(elem_type, inherited, cache, vstate);
       // Account for gaps due to alignments in the first N-1 elements,
       // then add the size of the last element.
       const auto size =
@@ -312,29 +383,30 @@ uint32_t getSize(uint32_t member_id, const LayoutConstraints& inherited,
         const auto num_rows = component_inst->words()[3];
         const auto scalar_elem_type = component_inst->words()[2];
         const uint32_t scalar_elem_size =
-            getSize(scalar_elem_type, inherited, constraints, vstate);
+            getSize(scalar_elem_type, inherited, cache, vstate);
         return (num_rows - 1) * inherited.matrix_stride +
                num_columns * scalar_elem_size;
       }
     }
     case SpvOpTypeStruct: {
+      auto where = cache.struct_sizes.find(member_id);
+      if (where != cache.struct_sizes.end()) return where->second;
       const auto& members = getStructMembers(member_id, vstate);
       if (members.empty()) return 0;
       const auto lastIdx = uint32_t(members.size() - 1);
       const auto& lastMember = members.back();
-      uint32_t offset = 0xffffffff;
       // Find the offset of the last element and add the size.
-      for (auto& decoration : vstate.id_decorations(member_id)) {
-        if (SpvDecorationOffset == decoration.dec_type() &&
-            decoration.struct_member_index() == (int)lastIdx) {
-          offset = decoration.params()[0];
-        }
-      }
+      const uint32_t offset =
+          getMemberOffsets(member_id, cache, vstate)[lastIdx];
       // This check depends on the fact that all members have offsets.  This
       // has been checked earlier in the flow.
       assert(offset != 0xffffffff);
-      const auto& constraint = constraints[std::make_pair(lastMember, lastIdx)];
-      return offset + getSize(lastMember, constraint, constraints, vstate);
+      const auto& constraint =
+          cache.constraints[std::make_pair(lastMember, lastIdx)];
+      const uint32_t size =
+          offset + getSize(lastMember, constraint, cache, vstate);
+      cache.struct_sizes[member_id] = size;
+      return size;
     }
     case SpvOpTypePointer:
       return vstate.pointer_size_and_alignment();
@@ -353,9 +425,8 @@ uint32_t getSize(uint32_t member_id, const LayoutConstraints& inherited,
 // decorations placing its first byte at a non-integer multiple of 16.
 bool hasImproperStraddle(uint32_t id, uint32_t offset,
                          const LayoutConstraints& inherited,
-                         MemberConstraints& constraints,
-                         ValidationState_t& vstate) {
-  const auto size = getSize(id, inherited, constraints, vstate);
+                         LayoutCache& cache, ValidationState_t& vstate) {
+  const auto size = getSize(id, inherited, cache, vstate);
   const auto F = offset;
   const auto L = offset + size - 1;
   if (size <= 16) {
@@ -379,8 +450,7 @@ bool IsAlignedTo(uint32_t offset, uint32_t alignment) {
 // or row major-ness.
 spv_result_t checkLayout(uint32_t struct_id, const char* storage_class_str,
                          const char* decoration_str, bool blockRules,
-                         uint32_t incoming_offset,
-                         MemberConstraints& constraints,
+                         uint32_t incoming_offset, LayoutCache& cache,
                          ValidationState_t& vstate) {
   if (vstate.options()->skip_block_layout) return SPV_SUCCESS;
 
@@ -394,6 +464,12 @@ spv_result_t checkLayout(uint32_t struct_id, const char* storage_class_str,
   const bool relaxed_block_layout = vstate.IsRelaxedBlockLayout();
   const bool scalar_block_layout = vstate.options()->scalar_block_layout;
 
+  // The layout rules are the same for every buffer, so a struct placed at the
+  // same offset only needs to be checked once.
+  const auto checked_key =
+      std::make_tuple(struct_id, incoming_offset, blockRules);
+  if (cache.checked_layouts.count(checked_key)) return SPV_SUCCESS;
+
   auto fail = [&vstate, struct_id, storage_class_str, decoration_str,
                blockRules, relaxed_block_layout,
                scalar_block_layout](uint32_t member_idx) -> DiagnosticStream {
@@ -420,22 +496,11 @@ spv_result_t checkLayout(uint32_t struct_id, const char* storage_class_str,
   };
   std::vector<MemberOffsetPair> member_offsets;
   member_offsets.reserve(members.size());
+  const auto& offsets = getMemberOffsets(struct_id, cache, vstate);
   for (uint32_t memberIdx = 0, numMembers = uint32_t(members.size());
        memberIdx < numMembers; memberIdx++) {
-    uint32_t offset = 0xffffffff;
-    for (auto& decoration : vstate.id_decorations(struct_id)) {
-      if (decoration.struct_member_index() == (int)memberIdx) {
-        switch (decoration.dec_type()) {
-          case SpvDecorationOffset:
-            offset = decoration.params()[0];
-            break;
-          default:
-            break;
-        }
-      }
-    }
     member_offsets.push_back(
-        MemberOffsetPair{memberIdx, incoming_offset + offset});
+        MemberOffsetPair{memberIdx, incoming_offset + offsets[memberIdx]});
   }
   std::stable_sort(
       member_offsets.begin(), member_offsets.end(),
@@ -452,17 +517,17 @@ spv_result_t checkLayout(uint32_t struct_id, const char* storage_class_str,
     const auto offset = member_offset.offset;
     auto id = members[member_offset.member];
     const LayoutConstraints& constraint =
-        constraints[std::make_pair(struct_id, uint32_t(memberIdx))];
+        cache.constraints[std::make_pair(struct_id, uint32_t(memberIdx))];
     // Scalar layout takes precedence because it's more permissive, and implying
     // an alignment that divides evenly into the alignment that would otherwise
     // be used.
     const auto alignment =
         scalar_block_layout
-            ? getScalarAlignment(id, vstate)
-            : getBaseAlignment(id, blockRules, constraint, constraints, vstate);
+            ? getScalarAlignment(id, cache, vstate)
+            : getBaseAlignment(id, blockRules, constraint, cache, vstate);
     const auto inst = vstate.FindDef(id);
     const auto opcode = inst->opcode();
-    const auto size = getSize(id, constraint, constraints, vstate);
+    const auto size = getSize(id, constraint, cache, vstate);
     // Check offset.
     if (offset == 0xffffffff)
       return fail(memberIdx) << "is missing an Offset decoration";
@@ -471,7 +536,8 @@ spv_result_t checkLayout(uint32_t struct_id, const char* storage_class_str,
       // In relaxed block layout, the vector offset must be aligned to the
       // vector's scalar element type.
       const auto componentId = inst->words()[2];
-      const auto scalar_alignment = getScalarAlignment(componentId, vstate);
+      const auto scalar_alignment =
+          getScalarAlignment(componentId, cache, vstate);
       if (!IsAlignedTo(offset, scalar_alignment)) {
         return fail(memberIdx)
                << "at offset " << offset
@@ -492,7 +558,7 @@ spv_result_t checkLayout(uint32_t struct_id, const char* storage_class_str,
     if (!scalar_block_layout && relaxed_block_layout) {
       // Check improper straddle of vectors.
       if (SpvOpTypeVector == opcode &&
-          hasImproperStraddle(id, offset, constraint, constraints, vstate))
+          hasImproperStraddle(id, offset, constraint, cache, vstate))
         return fail(memberIdx)
                << "is an improperly straddling vector at offset " << offset;
     }
@@ -501,7 +567,7 @@ spv_result_t checkLayout(uint32_t struct_id, const char* storage_class_str,
     if (SpvOpTypeStruct == opcode &&
         SPV_SUCCESS != (recursive_status = checkLayout(
                             id, storage_class_str, decoration_str, blockRules,
-                            offset, constraints, vstate)))
+                            offset, cache, vstate)))
       return recursive_status;
     // Check matrix stride.
     if (SpvOpTypeMatrix == opcode) {
@@ -553,7 +619,7 @@ spv_result_t checkLayout(uint32_t struct_id, const char* storage_class_str,
         if (SpvOpTypeStruct == element_inst->opcode() &&
             SPV_SUCCESS != (recursive_status = checkLayout(
                                 typeId, storage_class_str, decoration_str,
-                                blockRules, next_offset, constraints, vstate)))
+                                blockRules, next_offset, cache, vstate)))
           return recursive_status;
         // If offsets accumulate up to a 16-byte multiple stop checking since
         // it will just repeat.
@@ -562,13 +628,14 @@ spv_result_t checkLayout(uint32_t struct_id, const char* storage_class_str,
 
       // Proceed to the element in case it is an array.
       array_inst = element_inst;
-      array_alignment = scalar_block_layout
-                            ? getScalarAlignment(array_inst->id(), vstate)
-                            : getBaseAlignment(array_inst->id(), blockRules,
-                                               constraint, constraints, vstate);
+      array_alignment =
+          scalar_block_layout
+              ? getScalarAlignment(array_inst->id(), cache, vstate)
+              : getBaseAlignment(array_inst->id(), blockRules, constraint,
+                                 cache, vstate);
 
       const auto element_size =
-          getSize(element_inst->id(), constraint, constraints, vstate);
+          getSize(element_inst->id(), constraint, cache, vstate);
       if (element_size > array_stride) {
         return fail(memberIdx)
                << "contains an array with stride " << array_stride
@@ -583,6 +650,7 @@ spv_result_t checkLayout(uint32_t struct_id, const char* storage_class_str,
       nextValidOffset = align(nextValidOffset, alignment);
     }
   }
+  cache.checked_layouts.insert(checked_key);
   return SPV_SUCCESS;
 }
 
@@ -783,25 +851,26 @@ spv_result_t CheckDecorationsOfEntryPoints(ValidationState_t& vstate) {
 }
 
 // Load |constraints| with all the member constraints for structs contained
-// within the given array type.
-void ComputeMemberConstraintsForArray(MemberConstraints* constraints,
+// within the given array type.  Returns true if the constraints of a member
+// that was already in |constraints| changed.
+bool ComputeMemberConstraintsForArray(MemberConstraints* constraints,
                                       uint32_t array_id,
                                       const LayoutConstraints& inherited,
                                       ValidationState_t& vstate);
 
 // Load |constraints| with all the member constraints for the given struct,
-// and all its contained structs.
-void ComputeMemberConstraintsForStruct(MemberConstraints* constraints,
+// and all its contained structs.  Returns true if the constraints of a member
+// that was already in |constraints| changed.
+bool ComputeMemberConstraintsForStruct(MemberConstraints* constraints,
                                        uint32_t struct_id,
                                        const LayoutConstraints& inherited,
                                        ValidationState_t& vstate) {
   assert(constraints);
+  bool changed = false;
   const auto& members = getStructMembers(struct_id, vstate);
   for (uint32_t memberIdx = 0, numMembers = uint32_t(members.size());
        memberIdx < numMembers; memberIdx++) {
-    LayoutConstraints& constraint =
-        (*constraints)[std::make_pair(struct_id, memberIdx)];
-    constraint = inherited;
+    LayoutConstraints constraint = inherited;
     for (auto& decoration : vstate.id_decorations(struct_id)) {
       if (decoration.struct_member_index() == (int)memberIdx) {
         switch (decoration.dec_type()) {
@@ -819,6 +888,14 @@ void ComputeMemberConstraintsForStruct(MemberConstraints* constraints,
         }
       }
     }
+    const auto key = std::make_pair(struct_id, memberIdx);
+    auto where = constraints->find(key);
+    if (where == constraints->end()) {
+      constraints->emplace(key, constraint);
+    } else if (!(where->second == constraint)) {
+      where->second = constraint;
+      changed = true;
+    }
 
     // Now recurse
     auto member_type_id = members[memberIdx];
@@ -827,20 +904,21 @@ void ComputeMemberConstraintsForStruct(MemberConstraints* constraints,
     switch (opcode) {
       case SpvOpTypeArray:
       case SpvOpTypeRuntimeArray:
-        ComputeMemberConstraintsForArray(constraints, member_type_id, inherited,
-                                         vstate);
+        changed |= ComputeMemberConstraintsForArray(
+            constraints, member_type_id, inherited, vstate);
         break;
       case SpvOpTypeStruct:
-        ComputeMemberConstraintsForStruct(constraints, member_type_id,
-                                          inherited, vstate);
+        changed |= ComputeMemberConstraintsForStruct(
+            constraints, member_type_id, inherited, vstate);
         break;
       default:
         break;
     }
   }
+  return changed;
 }
 
-void ComputeMemberConstraintsForArray(MemberConstraints* constraints,
+bool ComputeMemberConstraintsForArray(MemberConstraints* constraints,
                                       uint32_t array_id,
                                       const LayoutConstraints& inherited,
                                       ValidationState_t& vstate) {
@@ -851,21 +929,20 @@ void ComputeMemberConstraintsForArray(MemberConstraints* constraints,
   switch (opcode) {
     case SpvOpTypeArray:
     case SpvOpTypeRuntimeArray:
-      ComputeMemberConstraintsForArray(constraints, elem_type_id, inherited,
-                                       vstate);
-      break;
+      return ComputeMemberConstraintsForArray(constraints, elem_type_id,
+                                              inherited, vstate);
     case SpvOpTypeStruct:
-      ComputeMemberConstraintsForStruct(constraints, elem_type_id, inherited,
-                                        vstate);
-      break;
+      return ComputeMemberConstraintsForStruct(constraints, elem_type_id,
+                                               inherited, vstate);
     default:
-      break;
+      return false;
   }
 }
 
 spv_result_t CheckDecorationsOfBuffers(ValidationState_t& vstate) {
   // Set of entry points that are known to use a push constant.
   std::unordered_set<uint32_t> uses_push_constant;
+  LayoutCache layout_cache;
   for (const auto& inst : vstate.ordered_instructions()) {
     const auto& words = inst.words();
     if (SpvOpVariable == inst.opcode()) {
@@ -955,9 +1032,12 @@ spv_result_t CheckDecorationsOfBuffers(ValidationState_t& vstate) {
         }
         // Struct requirement is checked on variables so just move on here.
         if (SpvOpTypeStruct != id_inst->opcode()) continue;
-        MemberConstraints constraints;
-        ComputeMemberConstraintsForStruct(&constraints, id, LayoutConstraints(),
-                                          vstate);
+        if (layout_cache.constrained_structs.insert(id).second &&
+            ComputeMemberConstraintsForStruct(&layout_cache.constraints, id,
+                                              LayoutConstraints(), vstate)) {
+          // Results were computed from the constraints this struct changed.
+          layout_cache.ClearConstrainedResults();
+        }
         // Prepare for messages
         const char* sc_str =
             uniform ? "Uniform"
@@ -1073,12 +1153,12 @@ spv_result_t CheckDecorationsOfBuffers(ValidationState_t& vstate) {
             } else if (blockRules &&
                        (SPV_SUCCESS != (recursive_status = checkLayout(
                                             id, sc_str, deco_str, true, 0,
-                                            constraints, vstate)))) {
+                                            layout_cache, vstate)))) {
               return recursive_status;
             } else if (bufferRules &&
                        (SPV_SUCCESS != (recursive_status = checkLayout(
                                             id, sc_str, deco_str, false, 0,
-                                            constraints, vstate)))) {
+                                            layout_cache, vstate)))) {
               return recursive_status;
             }
           }